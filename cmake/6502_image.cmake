@@ -119,3 +119,32 @@ function(build_6502_image)
       PARENT_SCOPE)
 
 endfunction()
+
+function(build_6502_recompiled_module)
+  set(options)
+  set(oneValueArgs IMAGE NAME)
+  set(multiValueArgs DEPENDS)
+  cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+  set(GENERATED_SOURCE ${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}.cpp)
+  message("* Adding recompiled module ${ARG_NAME}")
+
+  add_custom_command(
+    OUTPUT ${GENERATED_SOURCE}
+    COMMENT "Recompiling ${ARG_NAME}"
+    COMMAND emu_6502_recompile --output ${GENERATED_SOURCE} ${ARG_IMAGE}
+    DEPENDS ${ARG_IMAGE} ${ARG_DEPENDS} emu_6502_recompile
+    VERBATIM)
+
+  # Cpu symbols are resolved from the executable which loads the module
+  add_library(${ARG_NAME} MODULE ${GENERATED_SOURCE})
+  target_include_directories(${ARG_NAME} PRIVATE $<TARGET_PROPERTY:emu_6502,INTERFACE_INCLUDE_DIRECTORIES>
+                                                 $<TARGET_PROPERTY:emu_core,INTERFACE_INCLUDE_DIRECTORIES>)
+  target_link_libraries(${ARG_NAME} PRIVATE fmt::fmt)
+  set_target_properties(${ARG_NAME} PROPERTIES PREFIX "" LIBRARY_OUTPUT_DIRECTORY ${TARGET_DESTINATTION})
+  add_dependencies(build_all_6502_images ${ARG_NAME})
+
+  set(${ARG_NAME}
+      $<TARGET_FILE:${ARG_NAME}>
+      PARENT_SCOPE)
+endfunction()
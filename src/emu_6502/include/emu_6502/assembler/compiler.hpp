@@ -53,5 +53,7 @@ CompileFile(const std::string &file,
             InstructionSet cpu_instruction_set = InstructionSet::Default);
 
 std::string GenerateSymbolDump(Program &program);
+// Symbols of GenerateSymbolDump output, aliases are skipped
+SymbolMap ParseSymbolDump(const std::string &dump);
 
 } // namespace emu::emu6502::assembler
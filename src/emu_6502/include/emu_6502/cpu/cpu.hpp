@@ -2,65 +2,355 @@
 
 #include "debugger.hpp"
 #include "emu_6502/instruction_set.hpp"
+#include "emu_core/event_scheduler.hpp"
 #include "emu_core/memory.hpp"
+#include "native_routine.hpp"
+#include "recompiled_program.hpp"
 #include "registers.hpp"
 
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <emu_core/clock.hpp>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace emu::emu6502::cpu {
 
 struct Cpu;
+struct DecodedInstruction;
 
 using OperandFunctionPtr = void (*)(Cpu *cpu);
 using InstructionHandlerArray = std::array<OperandFunctionPtr, 256>;
+using InstructionCycleArray = std::array<uint8_t, 256>;
 
-struct ExecutionHalted : public std::runtime_error {
-    ExecutionHalted(Registers regs, Reg8 halt_code)
-        : std::runtime_error("Execution halted"), regs(regs), halt_code(halt_code) {}
-    const Registers regs;
-    const Reg8 halt_code;
+// Runs two decoded instructions as one call, decrements remaining before each of them
+using FusedHandlerPtr = void (*)(Cpu *cpu, const DecodedInstruction *pair,
+                                 uint64_t &remaining);
+
+using CodePageGeneration = uint32_t;
+using CodePageGenerationArray = std::array<CodePageGeneration, 256>;
+
+class BlockCache;
+class IdleLoopDetector;
+class RecompiledCode;
+namespace jit {
+class JitCompiler;
+}
+
+enum class ExecutionEngine {
+    Reference, // one handler call through the handler table per instruction
+    Threaded,  // computed-goto dispatch over batches of instructions
+    Cached,    // runs predecoded basic blocks from a cache keyed by program counter
+    Jit,       // Cached, hot blocks are translated to host code (x86-64 only)
+    // Reference, every bus access including dummy reads and writes is made and ticks
+    // the clock in its own cycle. Idle loops are not skipped.
+    CycleExact,
+
+    Default = Reference,
+};
+
+std::string to_string(ExecutionEngine engine);
+ExecutionEngine ParseExecutionEngine(const std::string &name);
+
+// Why the execution loop has returned. Exceptions are left for faults of the emulator
+// itself (memory, clock, jit), guest program stops are reported this way.
+enum class ExecutionStatus : uint8_t {
+    Running,         // nothing stopped the cpu
+    Halted,          // HLT or STP instruction, see ExecutionResult::halt_code
+    InvalidOpcode,   // opcode without handler, see ExecutionResult::opcode
+    BudgetExhausted, // instruction or cycle budget or deadline of the call was reached
+    Breakpoint,      // debugger stopped before the instruction at program counter
+    StopRequested,   // Cpu::RequestStop was called
+    Waiting,         // WAI with no scheduled event, only an interrupt line resumes it
+    Trapped,         // jump or branch to itself which nothing can leave, PC is at it
+};
+
+std::string to_string(ExecutionStatus status);
+
+struct ExecutionResult {
+    ExecutionStatus status = ExecutionStatus::Running;
+    Registers regs;     // when execution stopped
+    Reg8 halt_code = 0; // Halted only
+    Reg8 opcode = 0;    // InvalidOpcode only
+};
+
+// Handlers and execution loops compiled for one memory/clock pair and instruction set
+struct InstructionDispatch {
+    InstructionHandlerArray handlers;
+    InstructionCycleArray cycles;
+    uint8_t (*fetch_next_byte)(Cpu *cpu);
+    void (*flush_cycles)(Cpu *cpu);
+    void (*handle_interrupt)(Cpu *cpu, const Interrupt &interrupt);
+    const FusedHandlerPtr *fused_handlers; // one per pair of fused_pairs.hpp
+    uint64_t (Cpu::*execute_threaded)(uint64_t count);
+    uint64_t (Cpu::*execute_cached)(uint64_t count);
 };
 
-struct InvalidOpcodeException : public std::runtime_error {
-    InvalidOpcodeException(Registers regs, Reg8 opcode)
-        : std::runtime_error("Invalid opcode"), regs(regs), opcode(opcode) {}
-    const Registers regs;
-    const Reg8 opcode;
+struct FusedPairCount {
+    std::string_view name;
+    uint64_t count;
 };
 
-struct Cpu {
+struct Cpu : public InterruptLines {
     Registers reg;
     Memory16 *const memory;
+    Clock *const clock;
     const InstructionHandlerArray *instruction_handlers;
 
     Cpu(Clock *clock, Memory16 *memory, std::ostream *verbose_stream = nullptr,
         InstructionSet instruction_set = InstructionSet::NMOS6502,
-        Debugger *external_debugger = nullptr);
+        Debugger *external_debugger = nullptr,
+        ExecutionEngine engine = ExecutionEngine::Default);
+    ~Cpu() override;
 
+    // Handlers compiled for Memory16/Clock interfaces, same set of opcodes as any other
+    // instantiation
     static const InstructionHandlerArray &
     GetInstructionHandlerArray(InstructionSet instruction_set);
 
-    void Execute();
-    void ExecuteFor(std::chrono::nanoseconds timeout);
-    void ExecuteUntil(std::chrono::steady_clock::time_point deadline);
-    void ExecuteNextInstruction();
+    // Base cost of every opcode, see instruction_cycles.hpp for the cycle model
+    static const InstructionCycleArray &
+    GetInstructionCycleArray(InstructionSet instruction_set);
+
+    // Defined only for memory/clock pairs instantiated in cpu.cpp, see BasicCpu.
+    // Cycle-exact engine gets the same dispatch for every pair.
+    template <typename MemoryT, typename ClockT>
+    static const InstructionDispatch &
+    GetInstructionDispatch(InstructionSet instruction_set,
+                           ExecutionEngine engine = ExecutionEngine::Default);
+
+    // Reset and run until the program stops
+    ExecutionResult Execute();
+    ExecutionResult ExecuteFor(std::chrono::nanoseconds timeout);
+    ExecutionResult ExecuteUntil(std::chrono::steady_clock::time_point deadline);
+
+    // Continue from the current state until the program stops or the budget runs out.
+    // Cycle budget can be overrun by the last instruction (and interrupt entry).
+    // Deadline and stop requests are checked every kStopCheckCycles cycles, never per
+    // instruction.
+    ExecutionResult ExecuteInstructions(uint64_t budget);
+    ExecutionResult ExecuteCycles(uint64_t budget);
+    ExecutionResult
+    ExecuteBudget(uint64_t instructions, uint64_t cycles,
+                  std::chrono::steady_clock::time_point deadline =
+                      std::chrono::steady_clock::time_point::max());
+    static constexpr uint64_t kStopCheckCycles = 16 * 1024;
+
+    // May be called from other threads, running Execute call returns with
+    // StopRequested
+    void RequestStop() { stop_requested.store(true, std::memory_order_relaxed); }
+
+    // Continue from the current state. ExecuteBatch returns number of executed
+    // instructions, which is less than count when the program stopped, see Status.
+    ExecutionStatus ExecuteNextInstruction();
+    uint64_t ExecuteBatch(uint64_t count);
 
     void Reset();
 
-    void WaitForNextCycle() const;
+    [[nodiscard]] ExecutionEngine Engine() const { return engine; }
+    [[nodiscard]] uint64_t ExecutedInstructions() const { return executed_instructions; }
+
+    // Stop of the last Execute call, Running when it has used up its instruction count
+    [[nodiscard]] ExecutionStatus Status() const { return stop_status; }
+    [[nodiscard]] ExecutionResult Result() const;
+
+    // Called by handlers, execution loop returns after the current instruction
+    void Stop(ExecutionStatus status, Reg8 code = 0) {
+        stop_status = status;
+        stop_code = code;
+    }
+
+    // Instruction pairs which ran as one fused handler (cached and jit engines) and how
+    // often, pairs which never ran are left out
+    [[nodiscard]] std::vector<FusedPairCount> FusedPairCounts() const;
+
+    // Cycles are accumulated while instructions run and passed to the clock in one
+    // Advance call per instruction, block or batch
+    void AddCycles(uint64_t cycles) { pending_cycles += cycles; }
+    void FlushCycles();
+    uint64_t pending_cycles = 0;
+    uint64_t flushed_cycles = 0; // since Reset
+    // Part of pending cycles the cycle-exact engine has already passed to the clock
+    uint64_t bus_cycles = 0;
+    [[nodiscard]] uint64_t ExecutedCycles() const {
+        return flushed_cycles + pending_cycles;
+    }
 
-    void SetInterruptPending(Interrupt interrupt) { pending_interrupt = interrupt; }
+    // WAI (65C02). Cycles up to the next scheduled event are skipped instead of being
+    // spent by the host, until an interrupt line is asserted. When nothing could assert
+    // one before the end of the budget, the cpu stops with Waiting and false is
+    // returned, WAI has to leave program counter at itself.
+    bool WaitForInterrupt();
+
+    // Short loops which only read memory, e.g. polling of a device register, are
+    // fast-forwarded by ExecuteBudget. Once an iteration leaves registers unchanged,
+    // whole iterations are skipped up to the next scheduled event, end of the budget or
+    // deadline check. Loops which read a device area skip at most kIdleDeviceSkipCycles
+    // at once, devices see the time which has passed when they are read again. Loop
+    // which nothing but an interrupt line can end stops the cpu with Waiting, as WAI
+    // does. Skipped iterations count as executed instructions. Enabled by default, never
+    // used with a debugger.
+    // Jump or branch to itself (JMP *, BNE * while Z is clear) which no event or
+    // interrupt can leave stops the cpu with Trapped, program counter is left at it.
+    // It is found the same way, also when idle loops are not skipped.
+    void SetIdleLoopSkip(bool enabled) { idle_loop_skip = enabled; }
+    void AddDeviceArea(MemPtr offset, size_t size);
+    [[nodiscard]] uint64_t IdleSkippedCycles() const { return idle_skipped_cycles; }
+    static constexpr uint64_t kIdleDeviceSkipCycles = 4 * 1024;
+
+    // Native routine runs instead of the guest subroutine at address whenever JSR calls
+    // it, with every engine and in recompiled code. It counts as one executed
+    // instruction, JSR and the simulated RTS are done by the cpu. With verification the
+    // guest code runs as well: native routine gets copies of registers and memory,
+    // once the guest code has returned both results and cycle counts are compared and a
+    // difference throws. Guest code goes on with the results of the guest routine,
+    // subroutines it calls are not replaced. Events due meanwhile run as usual, an
+    // interrupt taken inside the routine shows up as a difference.
+    void AddNativeRoutine(MemPtr address, NativeRoutine routine);
+    void SetNativeRoutineVerification(bool enabled) { native_verification = enabled; }
+    [[nodiscard]] uint64_t NativeRoutineCalls() const { return native_routine_calls; }
+
+    // Called by JSR once the return address is pushed, routine runs before events.
+    // Handlers may work on a copy of the registers, so they pass the target.
+    void OnSubroutineCall(MemPtr target) {
+        if (!native_routines.empty()) {
+            CheckNativeRoutineCall(target);
+        }
+    }
+    void OnSubroutineCall() { OnSubroutineCall(reg.program_counter); }
+
+    // Taken after the current instruction regardless of I flag, used by BRK
+    void SetInterruptPending(Interrupt interrupt) {
+        pending_interrupt = interrupt;
+        scheduler.Wake();
+    }
+
+    // Lines are sampled between instructions. NMI goes first, IRQ is taken while an
+    // enabled source is asserted and I flag is clear. 6502 has one IRQ vector, so
+    // sources differ only by their mask bit.
+    void SetIrq(unsigned source, bool asserted) override;
+    void TriggerNmi() override;
+    void SetIrqSourceMask(uint32_t mask); // bit per enabled source, all by default
+
+    // Called once CLI, PLP or RTI has cleared I flag, an IRQ held back by it is taken
+    // after the instruction. Returns true when there is one.
+    bool OnInterruptFlagCleared() {
+        if ((irq_lines & irq_source_mask) == 0) {
+            return false;
+        }
+        scheduler.Wake();
+        return true;
+    }
+
+    // Execution loops compare cycles with EventScheduler::NextEventCycle after each
+    // instruction (block for recompiled and jit code) and run due events, interrupts
+    // wake the scheduler. Reset does not touch scheduled events.
+    EventScheduler &Scheduler() { return scheduler; }
+
+    // Blocks of program are run instead of interpreted ones at the same address. Needs
+    // an engine other than reference, program must outlive the cpu.
+    void AttachRecompiledProgram(const RecompiledProgram *program);
+
+    // Every store done by the cpu bumps generation of the written page, blocks decoded
+    // from a page with a different generation are dropped
+    void OnMemoryStore(MemPtr address) { ++code_page_generation[address >> 8]; }
+    [[nodiscard]] const CodePageGenerationArray &CodePageGenerations() const {
+        return code_page_generation;
+    }
+
+    // Set while a cached instruction runs, operand bytes are read from here instead of
+    // memory
+    const uint8_t *decoded_operand = nullptr;
+
+    // Zero page and stack page when plain RAM backs them. Taken from memory by the
+    // constructor and Reset, memory must not be remapped in between.
+    DirectPages<MemPtr, 2> direct_pages;
+
+protected:
+    Cpu(const InstructionDispatch &dispatch, Clock *clock, Memory16 *memory,
+        std::ostream *verbose_stream, InstructionSet instruction_set,
+        Debugger *external_debugger, ExecutionEngine engine);
 
 private:
-    Clock *const clock;
+    const InstructionDispatch *const dispatch;
     std::ostream *const verbose_stream;
     Debugger *const debugger;
+    const InstructionSet instruction_set;
+    const ExecutionEngine engine;
+    // ExecuteReference instantiation picked once, with hooks only when there is debugger
+    uint64_t (Cpu::*const execute_reference)(uint64_t count);
 
+    EventScheduler scheduler;
     Interrupt pending_interrupt = Interrupt::None;
+    bool nmi_pending = false;
+    uint32_t irq_lines = 0;
+    uint32_t irq_source_mask = ~0u;
+    uint64_t wait_limit = EventScheduler::kNever; // cycle WAI may skip to
+    bool idle_loop_skip = true;
+    uint64_t idle_skipped_cycles = 0; // since Reset
+    std::unordered_map<MemPtr, NativeRoutine> native_routines;
+    const NativeRoutine *native_call = nullptr; // called by JSR, run by HandleEvents
+    bool native_verification = false;
+    bool verifying_native_routine = false;
+    uint64_t native_routine_calls = 0; // since Reset
+    ExecutionStatus stop_status = ExecutionStatus::Running;
+    Reg8 stop_code = 0;
+    std::atomic<bool> stop_requested = false;
+    uint64_t executed_instructions = 0;
+    std::vector<uint64_t> fused_pair_counts;
+
+    CodePageGenerationArray code_page_generation{};
+    std::unique_ptr<BlockCache> block_cache;
+    std::unique_ptr<IdleLoopDetector> idle_loop_detector;
+    std::unique_ptr<jit::JitCompiler> jit_compiler;
+    std::unique_ptr<RecompiledCode> recompiled_code;
+
+    void HandleEvents();
+    void EnterInterrupt(Interrupt interrupt);
+    ExecutionStatus ClearStop();
+    uint64_t RunInstructions(uint64_t count);
+    bool SkipIdleLoop(uint64_t instructions_left, uint64_t limit);
+    void CheckNativeRoutineCall(MemPtr target);
+    void RunNativeRoutine(const NativeRoutine &routine);
+    void VerifyNativeRoutine(const NativeRoutine &routine);
+    // No scheduled event and no interrupt which could be taken
+    [[nodiscard]] bool IsTrapped() const;
+
+    template <InstructionSet kInstructionSet, typename MemoryT, typename ClockT>
+    static constexpr InstructionDispatch MakeInstructionDispatch();
+    template <InstructionSet kInstructionSet>
+    static constexpr InstructionDispatch MakeCycleExactDispatch();
+    static const InstructionDispatch &
+    GetCycleExactDispatch(InstructionSet instruction_set);
+
+    template <bool kInstrumented>
+    uint64_t ExecuteReference(uint64_t count);
+
+    template <typename MemoryT, typename ClockT>
+    uint64_t ExecuteCached(uint64_t count);
+
+    template <InstructionSet kInstructionSet, typename MemoryT, typename ClockT>
+    uint64_t ExecuteThreaded(uint64_t count);
+};
+
+// Cpu with handlers and execution loops compiled for concrete memory and clock types,
+// so memory accesses and clock ticks are direct calls instead of virtual ones. Plain
+// Cpu is the type-erased Memory16/Clock instantiation. cpu.cpp instantiates it for
+// MemoryBlock16 with ClockSimple or ClockSteady and for MemorySparse16 with
+// ClockSimple.
+template <typename MemoryT, typename ClockT>
+struct BasicCpu : public Cpu {
+    BasicCpu(ClockT *clock, MemoryT *memory, std::ostream *verbose_stream = nullptr,
+             InstructionSet instruction_set = InstructionSet::NMOS6502,
+             Debugger *external_debugger = nullptr,
+             ExecutionEngine engine = ExecutionEngine::Default)
+        : Cpu(GetInstructionDispatch<MemoryT, ClockT>(instruction_set, engine), clock,
+              memory, verbose_stream, instruction_set, external_debugger, engine) {}
 };
 
 } // namespace emu::emu6502::cpu
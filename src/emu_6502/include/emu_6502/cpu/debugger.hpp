@@ -14,6 +14,10 @@ struct Debugger {
     virtual ~Debugger() = default;
 
     virtual void OnNextInstruction(const Registers &regs) = 0;
+
+    // Execution stops with ExecutionStatus::Breakpoint before the instruction at
+    // address, the instruction runs once execution is resumed
+    virtual bool IsBreakpoint(MemPtr /*address*/) { return false; }
 };
 
 } // namespace emu::emu6502::cpu
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "registers.hpp"
+#include <array>
+#include <cstdint>
+
+namespace emu::emu6502::cpu {
+
+// Decimal mode ADC/SBC of NMOS 6502, including results for invalid BCD operands.
+// ADC: Z comes from the binary sum, N and V from the sum with adjusted low digit only.
+// SBC: all flags are the same as in binary mode.
+struct DecimalResult {
+    uint8_t value;
+    Reg8 flags; // N, V, Z and C bits of the status register
+};
+
+// Indexed by carry << 16 | a << 8 | operand
+using DecimalTable = std::array<DecimalResult, 0x20000>;
+
+extern const DecimalTable kDecimalAddTable;
+extern const DecimalTable kDecimalSubtractTable;
+
+inline const DecimalResult &DecimalAdd(uint8_t a, uint8_t operand, uint8_t carry) {
+    return kDecimalAddTable[(carry << 16) | (a << 8) | operand];
+}
+
+inline const DecimalResult &DecimalSubtract(uint8_t a, uint8_t operand, uint8_t carry) {
+    return kDecimalSubtractTable[(carry << 16) | (a << 8) | operand];
+}
+
+} // namespace emu::emu6502::cpu
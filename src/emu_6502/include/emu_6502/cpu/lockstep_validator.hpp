@@ -0,0 +1,61 @@
+#pragma once
+
+#include "cpu.hpp"
+#include "emu_6502/instruction_set.hpp"
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace emu::emu6502::cpu {
+
+struct LockstepDivergence {
+    uint64_t instructions; // run by the reference cpu up to the compared state
+    std::string difference;
+    std::vector<std::string> history; // last instructions of the reference, oldest first
+
+    [[nodiscard]] std::string Describe() const;
+};
+
+// Proves that an engine behaves as the reference interpreter. Reference and candidate
+// cpus run the same program on their own copies of memory (and devices). Candidate
+// runs steps of its engine through ExecuteInstructions, reference runs as many
+// instructions one by one, then registers, executed cycles, stop status and every page
+// which either cpu has stored to are compared. Both cpus have to be reset to the same
+// state and reference should use the reference engine. Stops the engine finds on its
+// own (trapped or idle loop waiting for an interrupt) end the validation.
+class LockstepValidator {
+public:
+    static constexpr size_t kDefaultHistorySize = 32;
+
+    LockstepValidator(InstructionSet instruction_set, Cpu *reference, Cpu *candidate,
+                      size_t history_size = kDefaultHistorySize);
+
+    // Until the program stops, max_instructions have run or the first divergence
+    std::optional<LockstepDivergence> Run(uint64_t max_instructions, uint64_t step = 1);
+
+    [[nodiscard]] uint64_t ValidatedInstructions() const { return validated; }
+    // Why the candidate stopped in last Run
+    [[nodiscard]] const ExecutionResult &CandidateResult() const {
+        return candidate_result;
+    }
+
+private:
+    const InstructionSet instruction_set;
+    Cpu *const reference;
+    Cpu *const candidate;
+    const size_t history_size;
+
+    std::deque<std::string> history;
+    CodePageGenerationArray reference_pages{};
+    CodePageGenerationArray candidate_pages{};
+    uint64_t validated = 0;
+    ExecutionResult candidate_result;
+
+    std::optional<std::string> Compare(const ExecutionResult &reference_result);
+    std::optional<std::string> CompareStoredPages();
+    LockstepDivergence Diverged(std::string difference) const;
+};
+
+} // namespace emu::emu6502::cpu
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/memory.hpp"
+#include "emu_core/program.hpp"
+#include "registers.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace emu::emu6502::cpu {
+
+// High-level emulation of a guest subroutine (memcpy, multiply, CRC...). Gets registers
+// and memory as they are at the first instruction of the routine, with the return
+// address pushed by JSR, and leaves them as the guest code does at its RTS. Returns
+// cycles the guest code takes from its first instruction up to and including RTS. The
+// return itself is done by the cpu.
+using NativeRoutine = std::function<uint64_t(Registers &reg, Memory16 &memory)>;
+
+// Address of a routine in Program::symbols or in symbols read back from a symbol dump,
+// see assembler::ParseSymbolDump
+MemPtr RoutineAddress(const SymbolMap &symbols, const std::string &name);
+
+} // namespace emu::emu6502::cpu
@@ -1,17 +1,13 @@
 #pragma once
 
 #include "emu_6502/instruction_set.hpp"
+#include <array>
 #include <cstdint>
 #include <string_view>
 #include <unordered_map>
 
 namespace emu::emu6502::cpu::opcode {
 
-// constexpr Opcode INS_STA_INDZP = 0x92;
-// constexpr Opcode INS_LDA_INDZP = 0xB2;
-// constexpr Opcode INS_INC_ACC = 0x1A;
-// constexpr Opcode INS_DEC_ACC = 0x3A;
-
 //LDA
 constexpr Opcode INS_LDA_IM = 0xA9;
 constexpr Opcode INS_LDA_ZP = 0xA5;
@@ -209,6 +205,132 @@ constexpr Opcode INS_RTI = 0x40;
 constexpr Opcode INS_HLT_ACC = 0xFA;
 constexpr Opcode INS_HLT_IM = 0xFB;
 
+//65C02, PLX takes the opcode of HLT A
+constexpr Opcode INS_BRA = 0x80;
+
+constexpr Opcode INS_PHX = 0xDA;
+constexpr Opcode INS_PHY = 0x5A;
+constexpr Opcode INS_PLX = 0xFA;
+constexpr Opcode INS_PLY = 0x7A;
+
+constexpr Opcode INS_STZ_ZP = 0x64;
+constexpr Opcode INS_STZ_ZPX = 0x74;
+constexpr Opcode INS_STZ_ABS = 0x9C;
+constexpr Opcode INS_STZ_ABSX = 0x9E;
+
+constexpr Opcode INS_TRB_ZP = 0x14;
+constexpr Opcode INS_TRB_ABS = 0x1C;
+constexpr Opcode INS_TSB_ZP = 0x04;
+constexpr Opcode INS_TSB_ABS = 0x0C;
+
+constexpr Opcode INS_ORA_INDZP = 0x12;
+constexpr Opcode INS_AND_INDZP = 0x32;
+constexpr Opcode INS_EOR_INDZP = 0x52;
+constexpr Opcode INS_ADC_INDZP = 0x72;
+constexpr Opcode INS_STA_INDZP = 0x92;
+constexpr Opcode INS_LDA_INDZP = 0xB2;
+constexpr Opcode INS_CMP_INDZP = 0xD2;
+constexpr Opcode INS_SBC_INDZP = 0xF2;
+
+constexpr Opcode INS_INC_ACC = 0x1A;
+constexpr Opcode INS_DEC_ACC = 0x3A;
+
+constexpr Opcode INS_BIT_IM = 0x89;
+constexpr Opcode INS_BIT_ZPX = 0x34;
+constexpr Opcode INS_BIT_ABSX = 0x3C;
+
+constexpr Opcode INS_JMP_ABSX_IND = 0x7C;
+
+constexpr Opcode INS_WAI = 0xCB;
+constexpr Opcode INS_STP = 0xDB;
+
+// Bit instructions, opcode for bit n is base + n * 0x10
+constexpr Opcode INS_RMB0 = 0x07;
+constexpr Opcode INS_SMB0 = 0x87;
+constexpr Opcode INS_BBR0 = 0x0F;
+constexpr Opcode INS_BBS0 = 0x8F;
+
+constexpr Opcode BitOpcode(Opcode base, uint8_t bit) {
+    return static_cast<Opcode>(base + (bit << 4));
+}
+
 //http://wiki.nesdev.com/w/index.php/Programming_with_unofficial_opcodes
+//NMOS undocumented, stable ones only. JAM and the unstable opcodes (ANE, LXA, SHA,
+//SHX, SHY, TAS, LAS) are left invalid.
+
+//SLO (ASL + ORA)
+constexpr Opcode INS_SLO_ZP = 0x07;
+constexpr Opcode INS_SLO_ZPX = 0x17;
+constexpr Opcode INS_SLO_ABS = 0x0F;
+constexpr Opcode INS_SLO_ABSX = 0x1F;
+constexpr Opcode INS_SLO_ABSY = 0x1B;
+constexpr Opcode INS_SLO_INDX = 0x03;
+constexpr Opcode INS_SLO_INDY = 0x13;
+//RLA (ROL + AND)
+constexpr Opcode INS_RLA_ZP = 0x27;
+constexpr Opcode INS_RLA_ZPX = 0x37;
+constexpr Opcode INS_RLA_ABS = 0x2F;
+constexpr Opcode INS_RLA_ABSX = 0x3F;
+constexpr Opcode INS_RLA_ABSY = 0x3B;
+constexpr Opcode INS_RLA_INDX = 0x23;
+constexpr Opcode INS_RLA_INDY = 0x33;
+//SRE (LSR + EOR)
+constexpr Opcode INS_SRE_ZP = 0x47;
+constexpr Opcode INS_SRE_ZPX = 0x57;
+constexpr Opcode INS_SRE_ABS = 0x4F;
+constexpr Opcode INS_SRE_ABSX = 0x5F;
+constexpr Opcode INS_SRE_ABSY = 0x5B;
+constexpr Opcode INS_SRE_INDX = 0x43;
+constexpr Opcode INS_SRE_INDY = 0x53;
+//RRA (ROR + ADC)
+constexpr Opcode INS_RRA_ZP = 0x67;
+constexpr Opcode INS_RRA_ZPX = 0x77;
+constexpr Opcode INS_RRA_ABS = 0x6F;
+constexpr Opcode INS_RRA_ABSX = 0x7F;
+constexpr Opcode INS_RRA_ABSY = 0x7B;
+constexpr Opcode INS_RRA_INDX = 0x63;
+constexpr Opcode INS_RRA_INDY = 0x73;
+//DCP (DEC + CMP)
+constexpr Opcode INS_DCP_ZP = 0xC7;
+constexpr Opcode INS_DCP_ZPX = 0xD7;
+constexpr Opcode INS_DCP_ABS = 0xCF;
+constexpr Opcode INS_DCP_ABSX = 0xDF;
+constexpr Opcode INS_DCP_ABSY = 0xDB;
+constexpr Opcode INS_DCP_INDX = 0xC3;
+constexpr Opcode INS_DCP_INDY = 0xD3;
+//ISC (INC + SBC)
+constexpr Opcode INS_ISC_ZP = 0xE7;
+constexpr Opcode INS_ISC_ZPX = 0xF7;
+constexpr Opcode INS_ISC_ABS = 0xEF;
+constexpr Opcode INS_ISC_ABSX = 0xFF;
+constexpr Opcode INS_ISC_ABSY = 0xFB;
+constexpr Opcode INS_ISC_INDX = 0xE3;
+constexpr Opcode INS_ISC_INDY = 0xF3;
+//SAX (store A & X)
+constexpr Opcode INS_SAX_ZP = 0x87;
+constexpr Opcode INS_SAX_ZPY = 0x97;
+constexpr Opcode INS_SAX_ABS = 0x8F;
+constexpr Opcode INS_SAX_INDX = 0x83;
+//LAX (LDA + LDX)
+constexpr Opcode INS_LAX_ZP = 0xA7;
+constexpr Opcode INS_LAX_ZPY = 0xB7;
+constexpr Opcode INS_LAX_ABS = 0xAF;
+constexpr Opcode INS_LAX_ABSY = 0xBF;
+constexpr Opcode INS_LAX_INDX = 0xA3;
+constexpr Opcode INS_LAX_INDY = 0xB3;
+//immediate
+constexpr Opcode INS_ANC_IM = 0x0B;
+constexpr Opcode INS_ANC_IM2 = 0x2B;
+constexpr Opcode INS_ALR_IM = 0x4B;
+constexpr Opcode INS_ARR_IM = 0x6B;
+constexpr Opcode INS_SBX_IM = 0xCB;
+constexpr Opcode INS_SBC_IM2 = 0xEB;
+//NOPs, the ones with an operand read it
+constexpr std::array<Opcode, 6> kNopImplied = {0x1A, 0x3A, 0x5A, 0x7A, 0xDA, 0xFA};
+constexpr std::array<Opcode, 5> kNopIM = {0x80, 0x82, 0x89, 0xC2, 0xE2};
+constexpr std::array<Opcode, 3> kNopZP = {0x04, 0x44, 0x64};
+constexpr std::array<Opcode, 6> kNopZPX = {0x14, 0x34, 0x54, 0x74, 0xD4, 0xF4};
+constexpr Opcode INS_NOP_ABS = 0x0C;
+constexpr std::array<Opcode, 6> kNopABSX = {0x1C, 0x3C, 0x5C, 0x7C, 0xDC, 0xFC};
 
 } // namespace emu::emu6502::cpu::opcode
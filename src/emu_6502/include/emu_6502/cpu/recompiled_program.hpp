@@ -0,0 +1,45 @@
+#pragma once
+
+#include "emu_6502/instruction_set.hpp"
+#include "registers.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace emu::emu6502::cpu {
+
+struct Cpu;
+
+// Native version of one basic block, produced by emu_6502_recompile. Increments
+// executed before every instruction it starts and leaves program counter at the next
+// instruction to run.
+using RecompiledFunction = void (*)(Cpu *cpu, uint32_t *executed);
+
+struct RecompiledBlock {
+    MemPtr address;
+    uint16_t instructions; // most instructions one call can execute
+    uint16_t code_size;
+    uint32_t max_cycles; // with page cross and branch penalties of all instructions
+    const uint8_t *code; // original bytes, block runs only while memory still holds them
+    RecompiledFunction function;
+};
+
+struct RecompiledProgram {
+    uint32_t abi_version;
+    InstructionSet instruction_set;
+    const RecompiledBlock *blocks;
+    size_t block_count;
+};
+
+// Layout of registers differs with lazy flags, modules have to be built the same way.
+// Version 2 reports HLT through Cpu::Stop instead of an exception, version 3 reports
+// JSR through Cpu::OnSubroutineCall, version 4 checks native routines of the target
+// passed to it, version 5 reaches zero page and stack through Cpu::direct_pages,
+// version 6 reports I flag cleared by CLI, PLP and RTI through
+// Cpu::OnInterruptFlagCleared, version 7 has RecompiledBlock::max_cycles.
+constexpr uint32_t kRecompiledAbiVersion = kLazyFlags ? 0x107 : 7;
+
+// Name of the exported `const RecompiledProgram *()` function of a recompiled module.
+// Module uses cpu symbols of the executable which loads it.
+constexpr auto kRecompiledProgramSymbol = "emu6502_recompiled_program";
+
+} // namespace emu::emu6502::cpu
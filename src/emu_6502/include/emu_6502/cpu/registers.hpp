@@ -5,6 +5,18 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <type_traits>
+
+// Handlers and the register methods they use get the registers by reference. The
+// threaded loop passes registers it keeps in locals, every such call is forced inline
+// so that their address does not escape and they can live in host registers.
+#if defined(__GNUC__)
+#define EMU6502_ALWAYS_INLINE [[gnu::always_inline]] inline
+#elif defined(_MSC_VER)
+#define EMU6502_ALWAYS_INLINE __forceinline
+#else
+#define EMU6502_ALWAYS_INLINE inline
+#endif
 
 namespace emu::emu6502::cpu {
 
@@ -13,50 +25,214 @@ struct Cpu;
 using OperandFunctionPtr = void (*)(Cpu *cpu);
 using InstructionHandlerArray = std::array<OperandFunctionPtr, 256>;
 
+#if defined(EMU6502_LAZY_FLAGS)
+constexpr bool kLazyFlags = true;
+#else
+constexpr bool kLazyFlags = false;
+#endif
+
+enum class StatusFlags : Reg8 {
+    Carry = 0x01,
+    Zero = 0x02,
+    IRQB = 0x04,
+    DecimalMode = 0x08,
+    Brk = 0x10,
+    NotUsed = 0x20, //rename to irq?
+    Overflow = 0x40,
+    Negative = 0x80,
+};
+
+// Status register. Eager variant updates the flag byte on every change. Lazy variant
+// keeps result of the last operation (N, Z) and operands of the last addition (C, V)
+// and builds those flags only when they are read, most of them are overwritten
+// before that happens. Both behave the same, see EMU6502_LAZY_FLAGS build option.
+template <bool kLazy>
+class BasicFlagRegister {
+public:
+    BasicFlagRegister(Reg8 v = 0) : value(v) {}
+
+    EMU6502_ALWAYS_INLINE BasicFlagRegister &operator=(Reg8 v) {
+        value = v;
+        if constexpr (kLazy) {
+            lazy.pending = 0;
+        }
+        return *this;
+    }
+    EMU6502_ALWAYS_INLINE BasicFlagRegister &operator|=(Reg8 v) {
+        return *this = Get() | v;
+    }
+    EMU6502_ALWAYS_INLINE BasicFlagRegister &operator&=(Reg8 v) {
+        return *this = Get() & v;
+    }
+    EMU6502_ALWAYS_INLINE operator Reg8() const { return Get(); }
+
+    [[nodiscard]] EMU6502_ALWAYS_INLINE Reg8 Get() const {
+        if constexpr (kLazy) {
+            return (value & ~lazy.pending) | Compute(lazy.pending);
+        } else {
+            return value;
+        }
+    }
+
+    [[nodiscard]] EMU6502_ALWAYS_INLINE bool Test(StatusFlags f) const {
+        const auto mask = static_cast<Reg8>(f);
+        if constexpr (kLazy) {
+            if ((lazy.pending & mask) != 0) {
+                return Compute(mask) == mask;
+            }
+        }
+        return (value & mask) == mask;
+    }
+
+    EMU6502_ALWAYS_INLINE void Set(StatusFlags f, bool state) {
+        const auto mask = static_cast<Reg8>(f);
+        if (state) {
+            value |= mask;
+        } else {
+            value &= ~mask;
+        }
+        if constexpr (kLazy) {
+            lazy.pending &= ~mask;
+        }
+    }
+
+    EMU6502_ALWAYS_INLINE void SetNegativeZero(uint8_t v) {
+        if constexpr (kLazy) {
+            lazy.result = v;
+            lazy.pending |= kNegativeZeroMask;
+        } else {
+            value = (value & ~kNegativeZeroMask) | NegativeZero(v);
+        }
+    }
+
+    // N, Z, C and V of binary a + operand + carry == sum. Subtraction passes inverted
+    // operand.
+    EMU6502_ALWAYS_INLINE void SetAddition(uint8_t a, uint8_t operand, uint16_t sum) {
+        if constexpr (kLazy) {
+            lazy.result = static_cast<uint8_t>(sum);
+            lazy.addition_a = a;
+            lazy.addition_operand = operand;
+            lazy.addition_sum = sum;
+            lazy.pending |= kArithmeticMask;
+        } else {
+            value = (value & ~kArithmeticMask) | NegativeZero(static_cast<uint8_t>(sum)) |
+                    CarryOverflow(a, operand, sum);
+        }
+    }
+
+    // N, Z, C and V taken from bits, other flags are kept
+    EMU6502_ALWAYS_INLINE void SetArithmetic(Reg8 bits) {
+        value = (value & ~kArithmeticMask) | (bits & kArithmeticMask);
+        if constexpr (kLazy) {
+            lazy.pending &= ~kArithmeticMask;
+        }
+    }
+
+    // Lazy flags are written into the flag byte, for code which accesses it directly
+    void Materialize() {
+        if constexpr (kLazy) {
+            *this = Get();
+        }
+    }
+
+private:
+    static constexpr Reg8 kNegativeZeroMask =
+        static_cast<Reg8>(StatusFlags::Negative) | static_cast<Reg8>(StatusFlags::Zero);
+    static constexpr Reg8 kCarryOverflowMask =
+        static_cast<Reg8>(StatusFlags::Carry) | static_cast<Reg8>(StatusFlags::Overflow);
+    static constexpr Reg8 kArithmeticMask = kNegativeZeroMask | kCarryOverflowMask;
+
+    // Must stay first, jit code loads and stores it by address of the register
+    Reg8 value;
+
+    struct Empty {};
+    struct LazyState {
+        Reg8 pending = 0; // flags which are not up to date in value
+        uint8_t result = 0;
+        uint8_t addition_a = 0;
+        uint8_t addition_operand = 0;
+        uint16_t addition_sum = 0;
+    };
+    [[no_unique_address]] std::conditional_t<kLazy, LazyState, Empty> lazy;
+
+    EMU6502_ALWAYS_INLINE static Reg8 NegativeZero(uint8_t v) {
+        return (v == 0 ? static_cast<Reg8>(StatusFlags::Zero) : 0) |
+               (v & static_cast<Reg8>(StatusFlags::Negative));
+    }
+
+    EMU6502_ALWAYS_INLINE static Reg8 CarryOverflow(uint8_t a, uint8_t operand,
+                                                    uint16_t sum) {
+        bool overflow = ((a ^ operand) & kNegativeBit) == 0 &&
+                        ((sum ^ operand) & kNegativeBit) != 0;
+        return (sum > 0xFF ? static_cast<Reg8>(StatusFlags::Carry) : 0) |
+               (overflow ? static_cast<Reg8>(StatusFlags::Overflow) : 0);
+    }
+
+    // Builds pending flags selected by mask
+    EMU6502_ALWAYS_INLINE Reg8 Compute(Reg8 mask) const {
+        Reg8 r = 0;
+        if ((mask & kNegativeZeroMask) != 0) {
+            r |= NegativeZero(lazy.result);
+        }
+        if ((mask & kCarryOverflowMask) != 0) {
+            r |= CarryOverflow(lazy.addition_a, lazy.addition_operand, lazy.addition_sum);
+        }
+        return r & mask;
+    }
+};
+
+using FlagRegister = BasicFlagRegister<kLazyFlags>;
+
 struct Registers {
     Reg16 program_counter;
 
     Reg8 a, x, y;
     Reg8 stack_pointer;
 
-    Reg8 flags;
-
-    enum class Flags {
-        Carry = 0x01,
-        Zero = 0x02,
-        IRQB = 0x04,
-        DecimalMode = 0x08,
-        Brk = 0x10,
-        NotUsed = 0x20, //rename to irq?
-        Overflow = 0x40,
-        Negative = 0x80,
-    };
+    FlagRegister flags;
+
+    using Flags = StatusFlags;
 
     void Reset();
 
     std::string DumpFlags() const;
     std::string Dump() const;
 
-    bool TestFlag(Flags f) const {
-        return (flags & static_cast<Reg8>(f)) == static_cast<Reg8>(f);
+    EMU6502_ALWAYS_INLINE bool TestFlag(Flags f) const { return flags.Test(f); }
+    EMU6502_ALWAYS_INLINE void SetFlag(Flags f, bool value) { flags.Set(f, value); }
+
+    EMU6502_ALWAYS_INLINE void SetNegativeZeroFlag(uint8_t v) {
+        flags.SetNegativeZero(v);
     }
-    void SetFlag(Flags f, bool value) {
-        if (value) {
-            flags |= static_cast<Reg8>(f);
-        } else {
-            flags &= ~static_cast<Reg8>(f);
-        }
+    EMU6502_ALWAYS_INLINE void SetNegativeFlag(uint8_t v) {
+        SetFlag(Flags::Negative, (v & kNegativeBit) != 0);
     }
 
-    void SetNegativeZeroFlag(uint8_t v) {
-        SetFlag(Flags::Zero, v == 0);
-        SetFlag(Flags::Negative, (v & kNegativeBit) != 0);
+    // Result of binary ADC, SBC passes inverted operand (a + ~operand + carry)
+    EMU6502_ALWAYS_INLINE void SetAdditionFlags(uint8_t a, uint8_t operand,
+                                                uint16_t sum) {
+        flags.SetAddition(a, operand, sum);
+    }
+
+    // N, Z, C and V bits of a precomputed result, see decimal_arithmetic.hpp
+    EMU6502_ALWAYS_INLINE void SetArithmeticFlags(Reg8 bits) {
+        flags.SetArithmetic(bits);
     }
-    void SetNegativeFlag(uint8_t v) { SetFlag(Flags::Negative, (v & kNegativeBit) != 0); }
 
-    uint8_t CarryValue() const { return TestFlag(Flags::Carry) ? 1 : 0; }
+    EMU6502_ALWAYS_INLINE uint8_t CarryValue() const {
+        return TestFlag(Flags::Carry) ? 1 : 0;
+    }
 
-    MemPtr StackPointerMemoryAddress() const { return kStackBase | stack_pointer; }
+    EMU6502_ALWAYS_INLINE MemPtr StackPointerMemoryAddress() const {
+        return kStackBase | stack_pointer;
+    }
+
+    // Lazy flags are compared by the byte they build
+    bool operator==(const Registers &other) const {
+        return program_counter == other.program_counter && a == other.a &&
+               x == other.x && y == other.y && stack_pointer == other.stack_pointer &&
+               static_cast<Reg8>(flags) == static_cast<Reg8>(other.flags);
+    }
 };
 
 } // namespace emu::emu6502::cpu
@@ -2,6 +2,7 @@
 
 #include "emu_core/memory.hpp"
 #include <cstdint>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 
@@ -12,6 +13,8 @@ enum class InstructionSet {
 
     NMOS6502,
     NMOS6502Emu,
+    CMOS65C02,
+    NMOS6502Undocumented, // NMOS6502 and its stable undocumented opcodes
 
     Default = NMOS6502,
 };
@@ -30,10 +33,16 @@ enum class AddressMode {
     ACC,
     REL,
     ABS_IND,
+    ZP_IND,   // (zp), 65C02
+    ABS_INDX, // (a,x), 65C02 JMP
+    ZP_REL,   // zp,r, 65C02 BBR/BBS: tested zero page byte and branch offset
 
     IM = Immediate,
 };
 
+std::string to_string(InstructionSet instruction_set);
+InstructionSet ParseInstructionSet(const std::string &name);
+
 std::string to_string(AddressMode mode);
 size_t ArgumentByteSize(AddressMode mode);
 
@@ -52,6 +61,8 @@ using OpcodeInstructionMap = std::unordered_map<Opcode, OpcodeInfo>;
 
 const OpcodeInstructionMap &Get6502InstructionSet();
 const OpcodeInstructionMap &Get6502EmuInstructionSet();
+const OpcodeInstructionMap &Get65C02InstructionSet();
+const OpcodeInstructionMap &Get6502UndocumentedInstructionSet();
 const OpcodeInstructionMap &GetInstructionSet(InstructionSet instruction_set);
 
 using MemPtr = Memory16::Address_t;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/memory.hpp"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace emu::emu6502::recompiler {
+
+struct Instruction {
+    MemPtr address;
+    OpcodeInfo info;
+    uint8_t length;                 // opcode + operand bytes
+    std::array<uint8_t, 2> operand; // bytes following the opcode
+
+    [[nodiscard]] MemPtr NextAddress() const { return address + length; }
+    [[nodiscard]] MemPtr AbsoluteOperand() const {
+        return operand[0] | (operand[1] << 8);
+    }
+    // Offset follows the tested zero page address in BBR/BBS
+    [[nodiscard]] MemPtr BranchTarget() const {
+        auto offset = info.addres_mode == AddressMode::ZP_REL ? operand[1] : operand[0];
+        return NextAddress() + static_cast<int8_t>(offset);
+    }
+};
+
+// Instructions from a branch/jump target (or an entry point) up to the first branch,
+// jump, return, BRK, HLT or next block. Like in the cpu block cache, all instructions
+// start in the first page of the block.
+struct CodeBlock {
+    MemPtr address;
+    std::vector<Instruction> instructions;
+
+    [[nodiscard]] uint16_t CodeSize() const;
+};
+
+struct CodeMap {
+    std::map<MemPtr, CodeBlock> blocks;
+    // JMP (ind), RTS and RTI: targets are known only at run time, cpu dispatches them
+    // to a recompiled block or to the interpreter
+    std::set<MemPtr> indirect_jumps;
+};
+
+// Reset, irq and nmi vectors which point to readable memory
+std::vector<MemPtr> GetVectorEntryPoints(const Memory16 &memory);
+
+// Follows every static control flow edge from entry points. Memory is read with
+// DebugRead, so only preloaded areas are considered to be code.
+CodeMap DiscoverCode(const Memory16 &memory, InstructionSet instruction_set,
+                     const std::vector<MemPtr> &entry_points);
+
+// C++ source with one function per block and an exported RecompiledProgram, see
+// emu_6502/cpu/recompiled_program.hpp
+std::string GenerateCpp(const CodeMap &code, InstructionSet instruction_set,
+                        const std::string &source_name);
+
+} // namespace emu::emu6502::recompiler
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/cpu/decimal_arithmetic.hpp"
+#include "emu_6502/cpu/recompiled_program.hpp"
+#include "emu_6502/instruction_set.hpp"
+#include <cstdint>
+#include <stdexcept>
+
+// Helpers used by the code generated by emu_6502_recompile. Timing and flag behavior
+// follow the cpu instruction handlers one to one. Cpu enters a block only when no
+// scheduled event is due before its end, an interrupt a device raises while the block
+// runs is taken after it.
+
+#if defined(_WIN32)
+#define EMU6502_RECOMPILED_EXPORT extern "C" __declspec(dllexport)
+#else
+#define EMU6502_RECOMPILED_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+namespace emu::emu6502::recompiler::runtime {
+
+using cpu::Cpu;
+using cpu::Registers;
+using Flags = Registers::Flags;
+
+// Opcode and operand fetch of a predecoded instruction, cycles is the base cost of the
+// opcode taken from the cycle table of the cpu when the code is generated
+inline void Fetch(Cpu *cpu, MemPtr next_pc, int cycles) {
+    cpu->AddCycles(cycles);
+    cpu->reg.program_counter = next_pc;
+}
+
+inline uint8_t Load(Cpu *cpu, MemPtr address) {
+    return cpu->memory->Load(address);
+}
+
+inline void Store(Cpu *cpu, MemPtr address, uint8_t value) {
+    cpu->memory->Store(address, value);
+    cpu->OnMemoryStore(address);
+}
+
+// Zero page and stack page of plain RAM are accessed in host memory, see
+// Cpu::direct_pages
+inline uint8_t LoadDirect(Cpu *cpu, MemPtr address) {
+    if (const uint8_t *byte = cpu->direct_pages.Byte(address); byte != nullptr) {
+        return *byte;
+    }
+    return Load(cpu, address);
+}
+
+inline void StoreDirect(Cpu *cpu, MemPtr address, uint8_t value) {
+    if (uint8_t *byte = cpu->direct_pages.Byte(address); byte != nullptr) {
+        *byte = value;
+        cpu->OnMemoryStore(address);
+        return;
+    }
+    Store(cpu, address, value);
+}
+
+//-----------------------------------------------------------------------------
+
+inline MemPtr ZeroPageIndexed(Cpu *cpu, uint8_t zp, uint8_t index) { // zp,x zp,y
+    return (zp + index) & 0xFF;
+}
+
+// Fast variant spends extra cycle when page is crossed, slow one has it in base cost
+template <bool fast>
+MemPtr AbsoluteIndexed(Cpu *cpu, MemPtr base, uint8_t index) { // a,x a,y
+    if constexpr (fast) {
+        if ((((base & 0xFF) + index) & 0xFF00) != 0) {
+            cpu->AddCycles(1);
+        }
+    }
+    return base + index;
+}
+
+inline MemPtr ZeroPageIndexedIndirect(Cpu *cpu, uint8_t zp, uint8_t x) { // (zp,x)
+    MemPtr ind0 = (zp + x) & 0xFF;
+    MemPtr low = LoadDirect(cpu, ind0);
+    MemPtr hi = LoadDirect(cpu, (ind0 + 1) & 0xFF);
+    return (hi << 8) | low;
+}
+
+template <bool fast>
+MemPtr ZeroPageIndirectIndexed(Cpu *cpu, uint8_t zp, uint8_t y) { // (zp),y
+    MemPtr low = LoadDirect(cpu, zp);
+    MemPtr hi = LoadDirect(cpu, (zp + 1) & 0xFF);
+    return AbsoluteIndexed<fast>(cpu, (hi << 8) | low, y);
+}
+
+//-----------------------------------------------------------------------------
+
+inline void LoadRegister(Registers &reg, Reg8 &target, uint8_t value) {
+    target = value;
+    reg.SetNegativeZeroFlag(value);
+}
+
+inline void Transfer(Cpu *cpu, Reg8 source, Reg8 &target, bool set_flags = true) {
+    if (set_flags) {
+        cpu->reg.SetNegativeZeroFlag(source);
+    }
+    target = source;
+}
+
+inline void Increment(Cpu *cpu, Reg8 &target, int8_t direction) {
+    uint8_t value = target + direction;
+    cpu->reg.SetNegativeZeroFlag(value);
+    target = value;
+}
+
+inline void MemoryIncrement(Cpu *cpu, MemPtr address, int8_t direction) {
+    uint8_t value = Load(cpu, address) + direction;
+    cpu->reg.SetNegativeZeroFlag(value);
+    Store(cpu, address, value);
+}
+
+inline void Compare(Cpu *cpu, Reg8 source, uint8_t operand) {
+    cpu->reg.SetNegativeZeroFlag(source - operand);
+    cpu->reg.SetFlag(Flags::Carry, source >= operand);
+}
+
+inline void Bit(Cpu *cpu, uint8_t operand) {
+    auto &reg = cpu->reg;
+    reg.SetFlag(Flags::Zero, (reg.a & operand) == 0);
+    reg.SetFlag(Flags::Negative, (operand & 0x80) != 0);
+    reg.SetFlag(Flags::Overflow, (operand & 0x40) != 0);
+}
+
+template <bool subtract>
+void Arithmetic(Cpu *cpu, uint8_t operand) {
+    auto &reg = cpu->reg;
+    if (reg.TestFlag(Flags::DecimalMode)) {
+        const auto &result =
+            subtract ? cpu::DecimalSubtract(reg.a, operand, reg.CarryValue())
+                     : cpu::DecimalAdd(reg.a, operand, reg.CarryValue());
+        reg.a = result.value;
+        reg.SetArithmeticFlags(result.flags);
+        return;
+    }
+    if constexpr (subtract) {
+        operand = ~operand;
+    }
+    const uint8_t a = reg.a;
+    const uint16_t sum = a + operand + reg.CarryValue();
+    reg.a = sum & 0xFF;
+    reg.SetAdditionFlags(a, operand, sum);
+}
+
+//-----------------------------------------------------------------------------
+
+enum class Shift { ASL, LSR, ROL, ROR };
+
+template <Shift kind>
+uint8_t ShiftValue(Registers &reg, uint8_t value) {
+    uint8_t carry_in = reg.CarryValue();
+    uint8_t result = 0;
+    bool carry_out = false;
+    if constexpr (kind == Shift::ASL || kind == Shift::ROL) {
+        result = static_cast<uint8_t>(value << 1) | (kind == Shift::ROL ? carry_in : 0);
+        carry_out = (value & 0x80) != 0;
+    } else {
+        result = (value >> 1) | (kind == Shift::ROR ? carry_in << 7 : 0);
+        carry_out = (value & 0x01) != 0;
+    }
+    reg.SetNegativeZeroFlag(result);
+    reg.SetFlag(Flags::Carry, carry_out);
+    return result;
+}
+
+template <Shift kind>
+void ShiftAccumulator(Cpu *cpu) {
+    cpu->reg.a = ShiftValue<kind>(cpu->reg, cpu->reg.a);
+}
+
+template <Shift kind>
+void ShiftMemory(Cpu *cpu, MemPtr address) {
+    auto operand = Load(cpu, address);
+    Store(cpu, address, ShiftValue<kind>(cpu->reg, operand));
+}
+
+//-----------------------------------------------------------------------------
+
+inline void Push(Cpu *cpu, uint8_t value) {
+    StoreDirect(cpu, cpu->reg.StackPointerMemoryAddress(), value);
+    cpu->reg.stack_pointer--;
+}
+
+inline uint8_t Pull(Cpu *cpu) {
+    cpu->reg.stack_pointer++;
+    return LoadDirect(cpu, cpu->reg.StackPointerMemoryAddress());
+}
+
+inline void PushFlags(Cpu *cpu) {
+    Push(cpu, cpu->reg.flags | static_cast<uint8_t>(Flags::Brk) |
+                  static_cast<uint8_t>(Flags::NotUsed));
+}
+
+// True when I flag is clear and an IRQ has waited for it, the block returns so it is
+// taken after the instruction
+inline bool InterruptFlagCleared(Cpu *cpu) {
+    return !cpu->reg.TestFlag(Flags::IRQB) && cpu->OnInterruptFlagCleared();
+}
+
+inline void PullFlags(Cpu *cpu) {
+    cpu->reg.flags = Pull(cpu);
+    cpu->reg.SetFlag(Flags::Brk, false);
+    cpu->reg.SetFlag(Flags::NotUsed, false);
+}
+
+inline void PullAccumulator(Cpu *cpu) {
+    auto value = Pull(cpu);
+    LoadRegister(cpu->reg, cpu->reg.a, value);
+}
+
+//-----------------------------------------------------------------------------
+
+// Page crossing of a taken branch is known when the code is generated
+inline void Branch(Cpu *cpu, bool taken, MemPtr target, int cycles) {
+    if (taken) {
+        cpu->AddCycles(cycles);
+        cpu->reg.program_counter = target;
+    }
+}
+
+inline void JumpIndirect(Cpu *cpu, MemPtr address) {
+    MemPtr target = Load(cpu, address);
+    target |= Load(cpu, (address & 0xFF00) | ((address + 1) & 0xFF)) << 8;
+    cpu->reg.program_counter = target;
+}
+
+inline void JumpSubroutine(Cpu *cpu, MemPtr target) {
+    auto &reg = cpu->reg;
+    reg.program_counter -= 1;
+    Push(cpu, reg.program_counter >> 8);
+    Push(cpu, reg.program_counter & 0xFF);
+    reg.program_counter = target;
+    cpu->OnSubroutineCall();
+}
+
+inline void ReturnFromSubroutine(Cpu *cpu, bool inc_pc = true) {
+    MemPtr low = Pull(cpu);
+    MemPtr hi = Pull(cpu);
+    cpu->reg.program_counter = (hi << 8) | low;
+    if (inc_pc) {
+        ++cpu->reg.program_counter;
+    }
+}
+
+// RTI ends a block
+inline void ReturnFromInterrupt(Cpu *cpu) {
+    PullFlags(cpu);
+    ReturnFromSubroutine(cpu, false);
+    (void)InterruptFlagCleared(cpu);
+}
+
+inline void Break(Cpu *cpu) {
+    cpu->SetInterruptPending(Interrupt::Brk);
+}
+
+// HLT ends a block, so the block returns right after it
+inline void Halt(Cpu *cpu, uint8_t value) {
+    cpu->Stop(cpu::ExecutionStatus::Halted, value);
+}
+
+} // namespace emu::emu6502::recompiler::runtime
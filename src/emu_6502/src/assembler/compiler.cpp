@@ -4,6 +4,7 @@
 #include "emu_core/base16.hpp"
 #include "emu_core/container_utils.hpp"
 #include <fstream>
+#include <regex>
 #include <sstream>
 
 namespace emu::emu6502::assembler {
@@ -39,13 +40,58 @@ std::string GenerateSymbolDump(Program &program) {
     return ss.str();
 }
 
+SymbolMap ParseSymbolDump(const std::string &dump) {
+    // Imported symbol without value is dumped as bare 0x
+    static const std::regex kSymbolLine{R"(^\.symbol\s+([^\s,]+),\s*)"
+                                        R"(0x([0-9a-fA-F]{2}|[0-9a-fA-F]{4})?,\s*)"
+                                        R"((true|false)\s*$)"};
+    static const std::regex kAliasLine{R"(^\w+\s*=\s*0x[0-9a-fA-F]+\s*$)"};
+
+    SymbolMap symbols;
+    std::istringstream ss{dump};
+    std::string line;
+    for (size_t line_number = 1; std::getline(ss, line); ++line_number) {
+        std::smatch match;
+        if (line.empty() || line.starts_with(";") || std::regex_match(line, kAliasLine)) {
+            continue;
+        }
+        if (!std::regex_match(line, match, kSymbolLine)) {
+            throw std::runtime_error(
+                fmt::format("Invalid symbol dump line {}: '{}'", line_number, line));
+        }
+        SymbolAddress offset;
+        if (match[2].matched) {
+            auto value = std::stoul(match[2].str(), nullptr, 16);
+            offset = match[2].length() == 2 ? SymbolAddress{static_cast<uint8_t>(value)}
+                                            : SymbolAddress{static_cast<uint16_t>(value)};
+        }
+        auto symbol = std::make_shared<SymbolInfo>(SymbolInfo{
+            .name = match[1].str(), .offset = offset, .imported = match[3] == "true"});
+        symbols[symbol->name] = std::move(symbol);
+    }
+    return symbols;
+}
+
 //-----------------------------------------------------------------------------
 
 Compiler6502::Compiler6502(InstructionSet cpu_instruction_set,
                            std::ostream *verbose_stream)
     : verbose_stream(verbose_stream) {
+    // Undocumented NOPs and SBC # share mnemonic and mode with documented opcodes or
+    // with each other, assembler emits the documented one, otherwise the lowest
+    const auto &documented = Get6502InstructionSet();
+    auto preferred = [&documented](const OpcodeInfo &a, const OpcodeInfo &b) {
+        if (documented.contains(a.opcode) != documented.contains(b.opcode)) {
+            return documented.contains(a.opcode);
+        }
+        return a.opcode < b.opcode;
+    };
     for (auto &[opcode, info] : GetInstructionSet(cpu_instruction_set)) {
-        instruction_set[info.mnemonic].variants[info.addres_mode] = info;
+        auto &variants = instruction_set[info.mnemonic].variants;
+        auto [it, inserted] = variants.try_emplace(info.addres_mode, info);
+        if (!inserted && preferred(info, it->second)) {
+            it->second = info;
+        }
     }
 }
 
@@ -86,6 +86,15 @@ std::string to_string(const InstructionArgument &ia) {
         }
         r += "}";
         break;
+    case 3: {
+        const auto &arg = std::get<3>(ia.argument_value);
+        r += "{";
+        for (auto i : arg.zero_page) {
+            r += fmt::format("{:02x},", i);
+        }
+        r += "}, '" + arg.target + "'";
+        break;
+    }
 
     default:
         r += "?";
@@ -95,6 +104,32 @@ std::string to_string(const InstructionArgument &ia) {
     return r;
 }
 
+namespace {
+
+InstructionArgument ParseZeroPageRelativeArgument(const Token &token,
+                                                  const std::string &zero_page,
+                                                  const std::string &target,
+                                                  const AliasMap &aliases) {
+    // Branch target has to be a label, its offset is known after relocation
+    if (GetTokenType(Token{token.location, target}, &aliases, nullptr) !=
+        TokenType::kUnknown) {
+        ThrowCompilationError(CompilationError::InvalidOperandArgument, token);
+    }
+    ByteVector zp_value;
+    try {
+        zp_value = ParseImmediateValue(zero_page, aliases, 1);
+    } catch (const std::exception &e) {
+        ThrowCompilationError(CompilationError::InvalidOperandArgument, token, "{}",
+                              e.what());
+    }
+    return InstructionArgument{
+        .possible_address_modes = {AddressMode::ZP_REL},
+        .argument_value = ZeroPageRelativeArgument{zp_value, target},
+    };
+}
+
+} // namespace
+
 InstructionArgument ParseInstructionArgument(const Token &token,
                                              const AliasMap &aliases) {
     // +---------------------+--------------------------+
@@ -128,7 +163,8 @@ InstructionArgument ParseInstructionArgument(const Token &token,
         {std::regex{R"==(^([$\w]+)$)=="}, {AM::ABS, AM::ZP, AM::REL}},
 
         // | Indirect Absolute   |          (aaaa)          |
-        {std::regex{R"==(^\(([$\w]+)\)$)=="}, {AM::ABS_IND}},
+        // | Zero Page Indirect  |          (aa)            |
+        {std::regex{R"==(^\(([$\w]+)\)$)=="}, {AM::ABS_IND, AM::ZP_IND}},
 
         // | Zero Page Indexed,X |          aa,X            |
         // | Absolute Indexed,X  |          aaaa,X          |
@@ -139,7 +175,8 @@ InstructionArgument ParseInstructionArgument(const Token &token,
         {std::regex{R"==(^([$\w]+),Y$)=="}, {AM::ABSY, AM::ZPY}},
 
         // | Indexed Indirect    |          (aa,X)          |
-        {std::regex{R"==(^\(([$\w]+),X\)$)=="}, {AM::INDX}},
+        // | Abs Indexed Indirect|          (aaaa,X)        |
+        {std::regex{R"==(^\(([$\w]+),X\)$)=="}, {AM::INDX, AM::ABS_INDX}},
 
         // | Indirect Indexed    |          (aa),Y          |
         {std::regex{R"==(^\(([$\w]+)\),Y$)=="}, {AM::INDY}},
@@ -192,6 +229,16 @@ InstructionArgument ParseInstructionArgument(const Token &token,
         }
     }
 
+    // | Zero Page Relative  |          aa,label        |
+    // Checked last, aa,X and aa,Y are indexed modes
+    const std::regex zp_rel_regex{R"==(^([$\w]+),(\w+)$)=="};
+    std::smatch zp_rel_match;
+    const auto &str = token.String();
+    if (std::regex_match(str, zp_rel_match, zp_rel_regex)) {
+        return ParseZeroPageRelativeArgument(token, zp_rel_match[1], zp_rel_match[2],
+                                             aliases);
+    }
+
     ThrowCompilationError(CompilationError::InvalidOperandArgument, token);
 }
 
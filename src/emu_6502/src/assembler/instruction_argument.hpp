@@ -15,8 +15,16 @@ namespace emu::emu6502::assembler {
 std::set<AddressMode> FilterPossibleModes(const std::set<AddressMode> &modes,
                                           size_t size);
 
-using ArgumentValueVariant =
-    std::variant<std::nullptr_t, std::string, std::vector<uint8_t>>;
+// BBR/BBS operand, zero page address and label of the branch target
+struct ZeroPageRelativeArgument {
+    std::vector<uint8_t> zero_page;
+    std::string target;
+
+    bool operator==(const ZeroPageRelativeArgument &other) const = default;
+};
+
+using ArgumentValueVariant = std::variant<std::nullptr_t, std::string,
+                                          std::vector<uint8_t>, ZeroPageRelativeArgument>;
 struct InstructionArgument {
     std::set<AddressMode> possible_address_modes;
     ArgumentValueVariant argument_value;
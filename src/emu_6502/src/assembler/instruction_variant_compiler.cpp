@@ -45,6 +45,11 @@ std::set<AddressMode> InstructionVariantSelector::Select(const ByteVector &bv) c
     return FilterPossibleModes(possible_address_modes, bv.size());
 }
 
+std::set<AddressMode>
+InstructionVariantSelector::Select(const ZeroPageRelativeArgument & /*arg*/) const {
+    return possible_address_modes;
+}
+
 //-----------------------------------------------------------------------------
 
 using Result = InstructionArgumentDataProcessor::Result;
@@ -85,4 +90,17 @@ Result InstructionArgumentDataProcessor::Process(const std::string &symbol) cons
     };
 }
 
+Result
+InstructionArgumentDataProcessor::Process(const ZeroPageRelativeArgument &arg) const {
+    ByteVector r{opcode.opcode};
+    r.insert(r.end(), arg.zero_page.begin(), arg.zero_page.end());
+    r.resize(r.size() + RelocationSize(RelocationMode::Relative), 0);
+    return Result{
+        .bytes = r,
+        .relocation_mode = RelocationMode::Relative,
+        .relocation_position = static_cast<Address_t>(current_position + 2u),
+        .relocation_symbol = arg.target,
+    };
+}
+
 } // namespace emu::emu6502::assembler
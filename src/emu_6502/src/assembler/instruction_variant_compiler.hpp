@@ -21,6 +21,7 @@ struct InstructionVariantSelector {
     std::set<AddressMode> Select(const std::string &symbol) const;
     std::set<AddressMode> Select(std::nullptr_t) const;
     std::set<AddressMode> Select(const ByteVector &bv) const;
+    std::set<AddressMode> Select(const ZeroPageRelativeArgument &arg) const;
 };
 
 struct InstructionArgumentDataProcessor {
@@ -41,6 +42,7 @@ struct InstructionArgumentDataProcessor {
     Result Process(std::nullptr_t) const;
     Result Process(const ByteVector &data) const;
     Result Process(const std::string &symbol) const;
+    Result Process(const ZeroPageRelativeArgument &arg) const;
 };
 
 } // namespace emu::emu6502::assembler
@@ -0,0 +1,115 @@
+#include "block_cache.hpp"
+#include "fused_pairs.hpp"
+#include <algorithm>
+#include <string_view>
+
+namespace emu::emu6502::cpu {
+
+namespace {
+
+using namespace std::string_view_literals;
+
+// Besides branches, instructions which change flow or may stop the cpu
+constexpr std::array kBlockEndMnemonics = {"JMP"sv, "JSR"sv, "RTS"sv, "RTI"sv, "BRK"sv,
+                                           "HLT"sv, "STP"sv, "WAI"sv};
+
+} // namespace
+
+BlockCache::BlockCache(const Memory16 *memory, const InstructionDispatch &dispatch,
+                       InstructionSet instruction_set)
+    : memory(memory), handlers(dispatch.handlers), cycles(dispatch.cycles),
+      fused_handlers(dispatch.fused_handlers), blocks(0x10000) {
+    // Unknown opcodes stop the cpu when executed, so they are one byte long block
+    // terminators
+    instruction_length.fill(1);
+    ends_block.fill(true);
+
+    for (const auto &[opcode, info] : GetInstructionSet(instruction_set)) {
+        instruction_length[opcode] = 1 + ArgumentByteSize(info.addres_mode);
+        ends_block[opcode] = info.addres_mode == AddressMode::REL ||
+                             info.addres_mode == AddressMode::ZP_REL ||
+                             std::ranges::find(kBlockEndMnemonics, info.mnemonic) !=
+                                 kBlockEndMnemonics.end();
+    }
+}
+
+DecodedBlock *BlockCache::Lookup(MemPtr address, const CodePageGenerationArray &pages) {
+    auto &block = blocks[address];
+    if (block == nullptr || !block->IsValid(pages)) {
+        block = Decode(address, pages);
+        if (block != nullptr) {
+            ++decoded_blocks;
+        }
+    }
+    return block.get();
+}
+
+void BlockCache::Clear() {
+    for (auto &block : blocks) {
+        block.reset();
+    }
+}
+
+std::unique_ptr<DecodedBlock>
+BlockCache::Decode(MemPtr address, const CodePageGenerationArray &pages) const {
+    auto block = std::make_unique<DecodedBlock>();
+    block->start = address;
+    block->generation = {pages[block->FirstPage()], pages[block->NextPage()]};
+
+    MemPtr pc = address;
+    while (block->instructions.size() < kMaxBlockInstructions) {
+        auto opcode = memory->DebugRead(pc);
+        if (!opcode.has_value()) {
+            break;
+        }
+
+        DecodedInstruction instruction{
+            .handler = handlers[*opcode],
+            .fused_handler = nullptr,
+            .fused_pair = 0,
+            .opcode = *opcode,
+            .length = instruction_length[*opcode],
+            .cycles = cycles[*opcode],
+            .operand = {},
+        };
+        bool readable = true;
+        for (uint8_t i = 1; i < instruction.length; ++i) {
+            auto byte = memory->DebugRead(static_cast<MemPtr>(pc + i));
+            readable = readable && byte.has_value();
+            instruction.operand[i - 1] = byte.value_or(0);
+        }
+        if (!readable) {
+            break;
+        }
+
+        block->instructions.emplace_back(instruction);
+        block->max_cycles += instruction.cycles + kMaxPenaltyCycles;
+        pc += instruction.length;
+        if (ends_block[*opcode] || (pc >> 8) != block->FirstPage()) {
+            break;
+        }
+    }
+
+    if (block->instructions.empty()) {
+        return nullptr;
+    }
+    FusePairs(*block);
+    return block;
+}
+
+void BlockCache::FusePairs(DecodedBlock &block) const {
+    auto &instructions = block.instructions;
+    bool zero_page_code = block.FirstPage() == 0 || block.NextPage() == 0;
+    for (size_t i = 0; i + 1 < instructions.size(); ++i) {
+        auto pair = FindFusedPair(instructions[i].opcode, instructions[i + 1].opcode);
+        if (!pair.has_value() ||
+            (kFusedPairs[*pair].first_stores_zero_page && zero_page_code)) {
+            continue;
+        }
+        instructions[i].fused_handler = fused_handlers[*pair];
+        instructions[i].fused_pair = static_cast<uint8_t>(*pair);
+        ++i;
+    }
+}
+
+} // namespace emu::emu6502::cpu
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/memory.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace emu::emu6502::cpu {
+
+// Native translation of a block, returns JitExit packed by jit::JitCompiler
+using JitFunction = uint32_t (*)(Cpu *cpu, Registers *reg);
+
+// Cycles an instruction may take above its base cost, for a taken branch which crosses
+// the page. Indexed access across the page adds one, 65C02 decimal ADC/SBC one more.
+constexpr uint32_t kMaxPenaltyCycles = 2;
+
+struct DecodedInstruction {
+    OperandFunctionPtr handler;
+    FusedHandlerPtr fused_handler; // set when it starts a pair, see fused_pairs.hpp
+    uint8_t fused_pair;            // index in kFusedPairs
+    uint8_t opcode;
+    uint8_t length;                  // opcode + operand bytes
+    uint8_t cycles;                  // base cost, without page cross and branch penalties
+    std::array<uint8_t, 2> operand;  // bytes following the opcode
+};
+
+// Straight-line run of instructions from start address up to (and including) the first
+// branch, jump, return, BRK, HLT/STP/WAI or unknown opcode. Instructions always start in
+// the first page, the last one may spill into the next page.
+struct DecodedBlock {
+    MemPtr start;
+    std::array<CodePageGeneration, 2> generation;
+    std::vector<DecodedInstruction> instructions;
+    uint32_t max_cycles = 0; // with page cross and branch penalties of all instructions
+
+    uint32_t entry_count = 0;
+    JitFunction jit_function = nullptr;
+    bool jit_rejected = false;
+
+    [[nodiscard]] uint8_t FirstPage() const { return start >> 8; }
+    [[nodiscard]] uint8_t NextPage() const { return FirstPage() + 1; }
+
+    [[nodiscard]] bool IsValid(const CodePageGenerationArray &pages) const {
+        return generation[0] == pages[FirstPage()] && generation[1] == pages[NextPage()];
+    }
+};
+
+class BlockCache {
+public:
+    BlockCache(const Memory16 *memory, const InstructionDispatch &dispatch,
+               InstructionSet instruction_set);
+
+    // Returns nullptr when there is no valid block at address and one can not be
+    // decoded (code is not readable through DebugRead)
+    DecodedBlock *Lookup(MemPtr address, const CodePageGenerationArray &pages);
+
+    void Clear();
+
+    [[nodiscard]] uint64_t DecodedBlocks() const { return decoded_blocks; }
+
+private:
+    static constexpr size_t kMaxBlockInstructions = 64;
+
+    const Memory16 *const memory;
+    const InstructionHandlerArray &handlers;
+    const InstructionCycleArray &cycles;
+    const FusedHandlerPtr *const fused_handlers;
+    std::array<uint8_t, 256> instruction_length{};
+    std::array<bool, 256> ends_block{};
+
+    std::vector<std::unique_ptr<DecodedBlock>> blocks;
+    uint64_t decoded_blocks = 0;
+
+    std::unique_ptr<DecodedBlock> Decode(MemPtr address,
+                                         const CodePageGenerationArray &pages) const;
+    void FusePairs(DecodedBlock &block) const;
+};
+
+} // namespace emu::emu6502::cpu
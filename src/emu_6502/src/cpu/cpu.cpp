@@ -1,258 +1,742 @@
 #include "emu_6502/cpu/cpu.hpp"
+#include "block_cache.hpp"
 #include "emu_6502/cpu/opcode.hpp"
 #include "emu_6502/instruction_set.hpp"
+#include "fused_pairs.hpp"
+#include "idle_loop.hpp"
+#include "instruction_cycles.hpp"
 #include "instruction_functors.hpp"
+#include "jit/jit_compiler.hpp"
 #include "memory_addressing.hpp"
+#include "recompiled_code.hpp"
+#include <emu_core/clock_steady.hpp>
+#include <emu_core/memory/memory_block.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <algorithm>
 #include <fmt/format.h>
+#include <limits>
+#include <map>
+#include <utility>
 
 namespace emu::emu6502::cpu {
 
 namespace {
 
+constexpr uint64_t kUnlimited = std::numeric_limits<uint64_t>::max();
+
+// Block entries before it is handed to the jit compiler
+constexpr uint32_t kJitHotBlockThreshold = 16;
+
+using instructions::RegisterHandlerArray;
+
 template <std::size_t... I>
-InstructionHandlerArray InitHandlerArray(std::index_sequence<I...>) {
-    return InstructionHandlerArray{&instructions::InvalidOpcode<I>...};
+constexpr RegisterHandlerArray InitHandlerArray(std::index_sequence<I...>) {
+    return RegisterHandlerArray{&instructions::InvalidOpcode<I>...};
+}
+
+// Memory of the cpu as native routines see it, stores drop decoded code as the ones
+// done by instructions do
+class NativeRoutineMemory : public Memory16 {
+public:
+    explicit NativeRoutineMemory(Cpu *cpu) : cpu(cpu) {}
+
+    [[nodiscard]] uint8_t Load(MemPtr address) const override {
+        return cpu->memory->Load(address);
+    }
+    void Store(MemPtr address, uint8_t value) override {
+        cpu->memory->Store(address, value);
+        cpu->OnMemoryStore(address);
+    }
+    [[nodiscard]] std::optional<uint8_t> DebugRead(MemPtr address) const override {
+        return cpu->memory->DebugRead(address);
+    }
+
+private:
+    Cpu *const cpu;
+};
+
+// Verified native routine stores here, memory is left to the guest routine
+class ShadowMemory : public Memory16 {
+public:
+    explicit ShadowMemory(const Memory16 *memory) : memory(memory) {}
+
+    [[nodiscard]] uint8_t Load(MemPtr address) const override {
+        auto v = DebugRead(address);
+        return v.has_value() ? *v : memory->Load(address);
+    }
+    void Store(MemPtr address, uint8_t value) override { stores[address] = value; }
+    [[nodiscard]] std::optional<uint8_t> DebugRead(MemPtr address) const override {
+        auto it = stores.find(address);
+        return it != stores.end() ? it->second : memory->DebugRead(address);
+    }
+
+    [[nodiscard]] std::optional<uint8_t> Stored(MemPtr address) const {
+        auto it = stores.find(address);
+        return it != stores.end() ? std::optional<uint8_t>{it->second} : std::nullopt;
+    }
+
+private:
+    const Memory16 *const memory;
+    std::map<MemPtr, uint8_t> stores;
+};
+
+// Pulls return address the way RTS does
+void ReturnFromSubroutine(Registers &reg, const Memory16 &memory) {
+    MemPtr low = memory.Load(kStackBase + ++reg.stack_pointer);
+    MemPtr hi = memory.Load(kStackBase + ++reg.stack_pointer);
+    reg.program_counter = static_cast<MemPtr>(((hi << 8) | low) + 1);
 }
 
+constexpr size_t kAddressSpaceSize = 0x10000;
+
+// Guest routine which has not returned by then is taken as a fault of the verification
+constexpr uint64_t kMaxVerifiedInstructions = 100'000'000;
+
 } // namespace
 
 namespace {
 
-InstructionHandlerArray GenInstructionHandlerArray(InstructionSet instruction_set) {
-    InstructionHandlerArray r = InitHandlerArray(std::make_index_sequence<256>{});
+// RMB/SMB/BBR/BBS of every bit
+template <typename B, uint8_t... kBit>
+constexpr void SetBitInstructionHandlers(RegisterHandlerArray &r,
+                                         std::integer_sequence<uint8_t, kBit...>) {
+    using namespace opcode;
+    using namespace instructions;
+    ((r[BitOpcode(INS_RMB0, kBit)] = &MemoryBit<B, kBit, false>), ...);
+    ((r[BitOpcode(INS_SMB0, kBit)] = &MemoryBit<B, kBit, true>), ...);
+    ((r[BitOpcode(INS_BBR0, kBit)] = &BranchOnBit<B, kBit, false>), ...);
+    ((r[BitOpcode(INS_BBS0, kBit)] = &BranchOnBit<B, kBit, true>), ...);
+}
+
+// Stable NMOS undocumented opcodes, read-modify-write ones use the same address
+// functions as documented read-modify-write instructions
+template <typename B>
+constexpr void SetUndocumentedInstructionHandlers(RegisterHandlerArray &r) {
+    using namespace opcode;
+    using namespace instructions;
+
+    r[INS_SLO_ZP] = &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressZP<B>>;
+    r[INS_SLO_ZPX] = &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressZPX<B>>;
+    r[INS_SLO_ABS] = &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressABS<B>>;
+    r[INS_SLO_ABSX] = &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressABSX<B>>;
+    r[INS_SLO_ABSY] = &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressABSY<B>>;
+    r[INS_SLO_INDX] = &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressINDX<B>>;
+    r[INS_SLO_INDY] =
+        &ShiftLogical<B, &Operation::ASL, &Operation::ORA, kAddressStoreINDY<B>>;
+
+    r[INS_RLA_ZP] = &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressZP<B>>;
+    r[INS_RLA_ZPX] = &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressZPX<B>>;
+    r[INS_RLA_ABS] = &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressABS<B>>;
+    r[INS_RLA_ABSX] = &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressABSX<B>>;
+    r[INS_RLA_ABSY] = &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressABSY<B>>;
+    r[INS_RLA_INDX] = &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressINDX<B>>;
+    r[INS_RLA_INDY] =
+        &ShiftLogical<B, &Operation::ROL, &Operation::AND, kAddressStoreINDY<B>>;
+
+    r[INS_SRE_ZP] = &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressZP<B>>;
+    r[INS_SRE_ZPX] = &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressZPX<B>>;
+    r[INS_SRE_ABS] = &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressABS<B>>;
+    r[INS_SRE_ABSX] = &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressABSX<B>>;
+    r[INS_SRE_ABSY] = &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressABSY<B>>;
+    r[INS_SRE_INDX] = &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressINDX<B>>;
+    r[INS_SRE_INDY] =
+        &ShiftLogical<B, &Operation::LSR, &Operation::XOR, kAddressStoreINDY<B>>;
+
+    r[INS_RRA_ZP] = &RotateAdd<B, kAddressZP<B>>;
+    r[INS_RRA_ZPX] = &RotateAdd<B, kAddressZPX<B>>;
+    r[INS_RRA_ABS] = &RotateAdd<B, kAddressABS<B>>;
+    r[INS_RRA_ABSX] = &RotateAdd<B, kAddressABSX<B>>;
+    r[INS_RRA_ABSY] = &RotateAdd<B, kAddressABSY<B>>;
+    r[INS_RRA_INDX] = &RotateAdd<B, kAddressINDX<B>>;
+    r[INS_RRA_INDY] = &RotateAdd<B, kAddressStoreINDY<B>>;
+
+    r[INS_DCP_ZP] = &DecrementCompare<B, kAddressZP<B>>;
+    r[INS_DCP_ZPX] = &DecrementCompare<B, kAddressZPX<B>>;
+    r[INS_DCP_ABS] = &DecrementCompare<B, kAddressABS<B>>;
+    r[INS_DCP_ABSX] = &DecrementCompare<B, kAddressABSX<B>>;
+    r[INS_DCP_ABSY] = &DecrementCompare<B, kAddressABSY<B>>;
+    r[INS_DCP_INDX] = &DecrementCompare<B, kAddressINDX<B>>;
+    r[INS_DCP_INDY] = &DecrementCompare<B, kAddressStoreINDY<B>>;
+
+    r[INS_ISC_ZP] = &IncrementSubtract<B, kAddressZP<B>>;
+    r[INS_ISC_ZPX] = &IncrementSubtract<B, kAddressZPX<B>>;
+    r[INS_ISC_ABS] = &IncrementSubtract<B, kAddressABS<B>>;
+    r[INS_ISC_ABSX] = &IncrementSubtract<B, kAddressABSX<B>>;
+    r[INS_ISC_ABSY] = &IncrementSubtract<B, kAddressABSY<B>>;
+    r[INS_ISC_INDX] = &IncrementSubtract<B, kAddressINDX<B>>;
+    r[INS_ISC_INDY] = &IncrementSubtract<B, kAddressStoreINDY<B>>;
+
+    r[INS_SAX_ZP] = &StoreAX<B, kAddressZP<B>>;
+    r[INS_SAX_ZPY] = &StoreAX<B, kAddressZPY<B>>;
+    r[INS_SAX_ABS] = &StoreAX<B, kAddressABS<B>>;
+    r[INS_SAX_INDX] = &StoreAX<B, kAddressINDX<B>>;
+
+    r[INS_LAX_ZP] = &LoadAX<B, kFetchZP<B>>;
+    r[INS_LAX_ZPY] = &LoadAX<B, kFetchZPY<B>>;
+    r[INS_LAX_ABS] = &LoadAX<B, kFetchABS<B>>;
+    r[INS_LAX_ABSY] = &LoadAX<B, kFetchFastABSY<B>>;
+    r[INS_LAX_INDX] = &LoadAX<B, kFetchINDX<B>>;
+    r[INS_LAX_INDY] = &LoadAX<B, kFetchINDY<B>>;
+
+    r[INS_ANC_IM] = &AndCarry<B>;
+    r[INS_ANC_IM2] = &AndCarry<B>;
+    r[INS_ALR_IM] = &AndShiftRight<B>;
+    r[INS_ARR_IM] = &AndRotateRight<B>;
+    r[INS_SBX_IM] = &SubtractX<B>;
+    r[INS_SBC_IM2] = &ArithmeticOperation<B, kFetchIM<B>, true>;
+
+    for (auto op : kNopImplied) {
+        r[op] = &NOP<B>;
+    }
+    for (auto op : kNopIM) {
+        r[op] = &ReadNOP<B, kFetchIM<B>>;
+    }
+    for (auto op : kNopZP) {
+        r[op] = &ReadNOP<B, kFetchZP<B>>;
+    }
+    for (auto op : kNopZPX) {
+        r[op] = &ReadNOP<B, kFetchZPX<B>>;
+    }
+    r[INS_NOP_ABS] = &ReadNOP<B, kFetchABS<B>>;
+    for (auto op : kNopABSX) {
+        r[op] = &ReadNOP<B, kFetchFastABSX<B>>;
+    }
+}
+
+template <typename B>
+constexpr RegisterHandlerArray GenRegisterHandlerArray(InstructionSet instruction_set) {
+    RegisterHandlerArray r = InitHandlerArray(std::make_index_sequence<256>{});
 
     using namespace opcode;
     using namespace instructions;
     using Flags = Registers::Flags;
 
     //LDA
-    r[INS_LDA_ABS] = &Register8Load<&Registers::a, kFetchABS>;
-    r[INS_LDA_ABSX] = &Register8Load<&Registers::a, kFetchFastABSX>;
-    r[INS_LDA_ABSY] = &Register8Load<&Registers::a, kFetchFastABSY>;
-    r[INS_LDA_IM] = &Register8Load<&Registers::a, kFetchIM>;
-    r[INS_LDA_ZP] = &Register8Load<&Registers::a, kFetchZP>;
-    r[INS_LDA_ZPX] = &Register8Load<&Registers::a, kFetchZPX>;
-    r[INS_LDA_INDX] = &Register8Load<&Registers::a, kFetchINDX>;
-    r[INS_LDA_INDY] = &Register8Load<&Registers::a, kFetchINDY>;
-    // r[INS_LDA_INDZP] = &Register8Load<&Registers::a, &Cpu::GetZeroPageIndirectAddress>;
+    r[INS_LDA_ABS] = &Register8Load<B, &Registers::a, kFetchABS<B>>;
+    r[INS_LDA_ABSX] = &Register8Load<B, &Registers::a, kFetchFastABSX<B>>;
+    r[INS_LDA_ABSY] = &Register8Load<B, &Registers::a, kFetchFastABSY<B>>;
+    r[INS_LDA_IM] = &Register8Load<B, &Registers::a, kFetchIM<B>>;
+    r[INS_LDA_ZP] = &Register8Load<B, &Registers::a, kFetchZP<B>>;
+    r[INS_LDA_ZPX] = &Register8Load<B, &Registers::a, kFetchZPX<B>>;
+    r[INS_LDA_INDX] = &Register8Load<B, &Registers::a, kFetchINDX<B>>;
+    r[INS_LDA_INDY] = &Register8Load<B, &Registers::a, kFetchINDY<B>>;
 
     //LDX
-    r[INS_LDX_ABS] = &Register8Load<&Registers::x, kFetchABS>;
-    r[INS_LDX_ABSY] = &Register8Load<&Registers::x, kFetchFastABSY>;
-    r[INS_LDX_IM] = &Register8Load<&Registers::x, kFetchIM>;
-    r[INS_LDX_ZP] = &Register8Load<&Registers::x, kFetchZP>;
-    r[INS_LDX_ZPY] = &Register8Load<&Registers::x, kFetchZPY>;
+    r[INS_LDX_ABS] = &Register8Load<B, &Registers::x, kFetchABS<B>>;
+    r[INS_LDX_ABSY] = &Register8Load<B, &Registers::x, kFetchFastABSY<B>>;
+    r[INS_LDX_IM] = &Register8Load<B, &Registers::x, kFetchIM<B>>;
+    r[INS_LDX_ZP] = &Register8Load<B, &Registers::x, kFetchZP<B>>;
+    r[INS_LDX_ZPY] = &Register8Load<B, &Registers::x, kFetchZPY<B>>;
 
     //LDY
-    r[INS_LDY_ABS] = &Register8Load<&Registers::y, kFetchABS>;
-    r[INS_LDY_ABSX] = &Register8Load<&Registers::y, kFetchFastABSX>;
-    r[INS_LDY_IM] = &Register8Load<&Registers::y, kFetchIM>;
-    r[INS_LDY_ZP] = &Register8Load<&Registers::y, kFetchZP>;
-    r[INS_LDY_ZPX] = &Register8Load<&Registers::y, kFetchZPX>;
+    r[INS_LDY_ABS] = &Register8Load<B, &Registers::y, kFetchABS<B>>;
+    r[INS_LDY_ABSX] = &Register8Load<B, &Registers::y, kFetchFastABSX<B>>;
+    r[INS_LDY_IM] = &Register8Load<B, &Registers::y, kFetchIM<B>>;
+    r[INS_LDY_ZP] = &Register8Load<B, &Registers::y, kFetchZP<B>>;
+    r[INS_LDY_ZPX] = &Register8Load<B, &Registers::y, kFetchZPX<B>>;
 
     //STA
-    r[INS_STA_ZP] = &Register8Store<&Registers::a, kAddressZP>;
-    r[INS_STA_ZPX] = &Register8Store<&Registers::a, kAddressZPX>;
-    r[INS_STA_ABS] = &Register8Store<&Registers::a, kAddressABS>;
-    r[INS_STA_ABSX] = &Register8Store<&Registers::a, kAddressABSX>;
-    r[INS_STA_ABSY] = &Register8Store<&Registers::a, kAddressABSY>;
-    r[INS_STA_INDX] = &Register8Store<&Registers::a, kAddressINDX>;
-    r[INS_STA_INDY] = &Register8Store<&Registers::a, kAddressStoreINDY>;
-    // r[INS_STA_INDZP] = &Register8Store<&Registers::a, &Cpu::kAddressGetZeroPageIndirectAddress>;
+    r[INS_STA_ZP] = &Register8Store<B, &Registers::a, kAddressZP<B>>;
+    r[INS_STA_ZPX] = &Register8Store<B, &Registers::a, kAddressZPX<B>>;
+    r[INS_STA_ABS] = &Register8Store<B, &Registers::a, kAddressABS<B>>;
+    r[INS_STA_ABSX] = &Register8Store<B, &Registers::a, kAddressABSX<B>>;
+    r[INS_STA_ABSY] = &Register8Store<B, &Registers::a, kAddressABSY<B>>;
+    r[INS_STA_INDX] = &Register8Store<B, &Registers::a, kAddressINDX<B>>;
+    r[INS_STA_INDY] = &Register8Store<B, &Registers::a, kAddressStoreINDY<B>>;
 
     //STX
-    r[INS_STX_ZP] = &Register8Store<&Registers::x, kAddressZP>;
-    r[INS_STX_ZPY] = &Register8Store<&Registers::x, kAddressZPY>;
-    r[INS_STX_ABS] = &Register8Store<&Registers::x, kAddressABS>;
+    r[INS_STX_ZP] = &Register8Store<B, &Registers::x, kAddressZP<B>>;
+    r[INS_STX_ZPY] = &Register8Store<B, &Registers::x, kAddressZPY<B>>;
+    r[INS_STX_ABS] = &Register8Store<B, &Registers::x, kAddressABS<B>>;
 
     //STY
-    r[INS_STY_ZP] = &Register8Store<&Registers::y, kAddressZP>;
-    r[INS_STY_ZPX] = &Register8Store<&Registers::y, kAddressZPX>;
-    r[INS_STY_ABS] = &Register8Store<&Registers::y, kAddressABS>;
+    r[INS_STY_ZP] = &Register8Store<B, &Registers::y, kAddressZP<B>>;
+    r[INS_STY_ZPX] = &Register8Store<B, &Registers::y, kAddressZPX<B>>;
+    r[INS_STY_ABS] = &Register8Store<B, &Registers::y, kAddressABS<B>>;
 
     //DEC
-    r[INS_DEC_ABS] = &MemoryIncrement<kAddressABS, -1>;
-    r[INS_DEC_ABSX] = &MemoryIncrement<kAddressABSX, -1>;
-    r[INS_DEC_ZP] = &MemoryIncrement<kAddressZP, -1>;
-    r[INS_DEC_ZPX] = &MemoryIncrement<kAddressZPX, -1>;
+    r[INS_DEC_ABS] = &MemoryIncrement<B, kAddressABS<B>, -1>;
+    r[INS_DEC_ABSX] = &MemoryIncrement<B, kAddressABSX<B>, -1>;
+    r[INS_DEC_ZP] = &MemoryIncrement<B, kAddressZP<B>, -1>;
+    r[INS_DEC_ZPX] = &MemoryIncrement<B, kAddressZPX<B>, -1>;
 
     //INC
-    r[INS_INC_ABS] = &MemoryIncrement<kAddressABS, 1>;
-    r[INS_INC_ABSX] = &MemoryIncrement<kAddressABSX, 1>;
-    r[INS_INC_ZP] = &MemoryIncrement<kAddressZP, 1>;
-    r[INS_INC_ZPX] = &MemoryIncrement<kAddressZPX, 1>;
+    r[INS_INC_ABS] = &MemoryIncrement<B, kAddressABS<B>, 1>;
+    r[INS_INC_ABSX] = &MemoryIncrement<B, kAddressABSX<B>, 1>;
+    r[INS_INC_ZP] = &MemoryIncrement<B, kAddressZP<B>, 1>;
+    r[INS_INC_ZPX] = &MemoryIncrement<B, kAddressZPX<B>, 1>;
 
     //Transfer Registers
-    r[INS_TAX] = &Register8Transfer<&Registers::a, &Registers::x>;
-    r[INS_TAY] = &Register8Transfer<&Registers::a, &Registers::y>;
-    r[INS_TXA] = &Register8Transfer<&Registers::x, &Registers::a>;
-    r[INS_TYA] = &Register8Transfer<&Registers::y, &Registers::a>;
+    r[INS_TAX] = &Register8Transfer<B, &Registers::a, &Registers::x>;
+    r[INS_TAY] = &Register8Transfer<B, &Registers::a, &Registers::y>;
+    r[INS_TXA] = &Register8Transfer<B, &Registers::x, &Registers::a>;
+    r[INS_TYA] = &Register8Transfer<B, &Registers::y, &Registers::a>;
 
     //inc-dec registers
-    r[INS_INY] = &Register8Increment<&Registers::y, 1>;
-    r[INS_INX] = &Register8Increment<&Registers::x, 1>;
-    // r[INS_INC_ACC] = &Register8Increment<&Registers::a, 1>;
-    r[INS_DEY] = &Register8Increment<&Registers::y, -1>;
-    r[INS_DEX] = &Register8Increment<&Registers::x, -1>;
-    // r[INS_DEC_ACC] = &Register8Increment<&Registers::a, -1>;
+    r[INS_INY] = &Register8Increment<B, &Registers::y, 1>;
+    r[INS_INX] = &Register8Increment<B, &Registers::x, 1>;
+    r[INS_DEY] = &Register8Increment<B, &Registers::y, -1>;
+    r[INS_DEX] = &Register8Increment<B, &Registers::x, -1>;
 
     //Arithmetic
-    r[INS_ADC] = &ArithmeticOperation<kFetchIM, false>;
-    r[INS_ADC_ABS] = &ArithmeticOperation<kFetchABS, false>;
-    r[INS_ADC_ZP] = &ArithmeticOperation<kFetchZP, false>;
-    r[INS_ADC_ZPX] = &ArithmeticOperation<kFetchZPX, false>;
-    r[INS_ADC_ABSX] = &ArithmeticOperation<kFetchFastABSX, false>;
-    r[INS_ADC_ABSY] = &ArithmeticOperation<kFetchFastABSY, false>;
-    r[INS_ADC_INDX] = &ArithmeticOperation<kFetchINDX, false>;
-    r[INS_ADC_INDY] = &ArithmeticOperation<kFetchINDY, false>;
-    r[INS_SBC] = &ArithmeticOperation<kFetchIM, true>;
-    r[INS_SBC_ABS] = &ArithmeticOperation<kFetchABS, true>;
-    r[INS_SBC_ZP] = &ArithmeticOperation<kFetchZP, true>;
-    r[INS_SBC_ZPX] = &ArithmeticOperation<kFetchZPX, true>;
-    r[INS_SBC_ABSX] = &ArithmeticOperation<kFetchFastABSX, true>;
-    r[INS_SBC_ABSY] = &ArithmeticOperation<kFetchFastABSY, true>;
-    r[INS_SBC_INDX] = &ArithmeticOperation<kFetchINDX, true>;
-    r[INS_SBC_INDY] = &ArithmeticOperation<kFetchINDY, true>;
+    r[INS_ADC] = &ArithmeticOperation<B, kFetchIM<B>, false>;
+    r[INS_ADC_ABS] = &ArithmeticOperation<B, kFetchABS<B>, false>;
+    r[INS_ADC_ZP] = &ArithmeticOperation<B, kFetchZP<B>, false>;
+    r[INS_ADC_ZPX] = &ArithmeticOperation<B, kFetchZPX<B>, false>;
+    r[INS_ADC_ABSX] = &ArithmeticOperation<B, kFetchFastABSX<B>, false>;
+    r[INS_ADC_ABSY] = &ArithmeticOperation<B, kFetchFastABSY<B>, false>;
+    r[INS_ADC_INDX] = &ArithmeticOperation<B, kFetchINDX<B>, false>;
+    r[INS_ADC_INDY] = &ArithmeticOperation<B, kFetchINDY<B>, false>;
+    r[INS_SBC] = &ArithmeticOperation<B, kFetchIM<B>, true>;
+    r[INS_SBC_ABS] = &ArithmeticOperation<B, kFetchABS<B>, true>;
+    r[INS_SBC_ZP] = &ArithmeticOperation<B, kFetchZP<B>, true>;
+    r[INS_SBC_ZPX] = &ArithmeticOperation<B, kFetchZPX<B>, true>;
+    r[INS_SBC_ABSX] = &ArithmeticOperation<B, kFetchFastABSX<B>, true>;
+    r[INS_SBC_ABSY] = &ArithmeticOperation<B, kFetchFastABSY<B>, true>;
+    r[INS_SBC_INDX] = &ArithmeticOperation<B, kFetchINDX<B>, true>;
+    r[INS_SBC_INDY] = &ArithmeticOperation<B, kFetchINDY<B>, true>;
 
     // Register Comparison
-    r[INS_CMP] = &Register8Compare<&Registers::a, kFetchIM>;
-    r[INS_CMP_ZP] = &Register8Compare<&Registers::a, kFetchZP>;
-    r[INS_CMP_ZPX] = &Register8Compare<&Registers::a, kFetchZPX>;
-    r[INS_CMP_ABS] = &Register8Compare<&Registers::a, kFetchABS>;
-    r[INS_CMP_ABSX] = &Register8Compare<&Registers::a, kFetchFastABSX>;
-    r[INS_CMP_ABSY] = &Register8Compare<&Registers::a, kFetchFastABSY>;
-    r[INS_CMP_INDY] = &Register8Compare<&Registers::a, kFetchINDY>;
-    r[INS_CMP_INDX] = &Register8Compare<&Registers::a, kFetchINDX>;
-    r[INS_CPX] = &Register8Compare<&Registers::x, kFetchIM>;
-    r[INS_CPY] = &Register8Compare<&Registers::y, kFetchIM>;
-    r[INS_CPX_ZP] = &Register8Compare<&Registers::x, kFetchZP>;
-    r[INS_CPY_ZP] = &Register8Compare<&Registers::y, kFetchZP>;
-    r[INS_CPX_ABS] = &Register8Compare<&Registers::x, kFetchABS>;
-    r[INS_CPY_ABS] = &Register8Compare<&Registers::y, kFetchABS>;
+    r[INS_CMP] = &Register8Compare<B, &Registers::a, kFetchIM<B>>;
+    r[INS_CMP_ZP] = &Register8Compare<B, &Registers::a, kFetchZP<B>>;
+    r[INS_CMP_ZPX] = &Register8Compare<B, &Registers::a, kFetchZPX<B>>;
+    r[INS_CMP_ABS] = &Register8Compare<B, &Registers::a, kFetchABS<B>>;
+    r[INS_CMP_ABSX] = &Register8Compare<B, &Registers::a, kFetchFastABSX<B>>;
+    r[INS_CMP_ABSY] = &Register8Compare<B, &Registers::a, kFetchFastABSY<B>>;
+    r[INS_CMP_INDY] = &Register8Compare<B, &Registers::a, kFetchINDY<B>>;
+    r[INS_CMP_INDX] = &Register8Compare<B, &Registers::a, kFetchINDX<B>>;
+    r[INS_CPX] = &Register8Compare<B, &Registers::x, kFetchIM<B>>;
+    r[INS_CPY] = &Register8Compare<B, &Registers::y, kFetchIM<B>>;
+    r[INS_CPX_ZP] = &Register8Compare<B, &Registers::x, kFetchZP<B>>;
+    r[INS_CPY_ZP] = &Register8Compare<B, &Registers::y, kFetchZP<B>>;
+    r[INS_CPX_ABS] = &Register8Compare<B, &Registers::x, kFetchABS<B>>;
+    r[INS_CPY_ABS] = &Register8Compare<B, &Registers::y, kFetchABS<B>>;
 
     //branches
-    r[INS_BCC] = &Branch<Flags::Carry, false>;
-    r[INS_BCS] = &Branch<Flags::Carry, true>;
-    r[INS_BEQ] = &Branch<Flags::Zero, true>;
-    r[INS_BNE] = &Branch<Flags::Zero, false>;
-    r[INS_BMI] = &Branch<Flags::Negative, true>;
-    r[INS_BPL] = &Branch<Flags::Negative, false>;
-    r[INS_BVC] = &Branch<Flags::Overflow, false>;
-    r[INS_BVS] = &Branch<Flags::Overflow, true>;
+    r[INS_BCC] = &Branch<B, Flags::Carry, false>;
+    r[INS_BCS] = &Branch<B, Flags::Carry, true>;
+    r[INS_BEQ] = &Branch<B, Flags::Zero, true>;
+    r[INS_BNE] = &Branch<B, Flags::Zero, false>;
+    r[INS_BMI] = &Branch<B, Flags::Negative, true>;
+    r[INS_BPL] = &Branch<B, Flags::Negative, false>;
+    r[INS_BVC] = &Branch<B, Flags::Overflow, false>;
+    r[INS_BVS] = &Branch<B, Flags::Overflow, true>;
 
     // jumps/calls
-    r[INS_JMP_ABS] = &JumpABS;
-    r[INS_JMP_IND] = &JumpIND;
-    r[INS_JSR] = &JSR;
-    r[INS_RTS] = &RTS;
-    r[INS_RTI] = &RTI;
-    r[INS_BRK] = &BRK;
+    r[INS_JMP_ABS] = &JumpABS<B>;
+    r[INS_JMP_IND] = &JumpIND<B>;
+    r[INS_JSR] = &JSR<B>;
+    r[INS_RTS] = &RTS<B>;
+    r[INS_RTI] = &RTI<B>;
+    r[INS_BRK] = &BRK<B>;
 
     //Logical
-    r[INS_AND_IM] = &LogicalOperation<&Operation::AND, kFetchIM>;
-    r[INS_AND_ZP] = &LogicalOperation<&Operation::AND, kFetchZP>;
-    r[INS_AND_ZPX] = &LogicalOperation<&Operation::AND, kFetchZPX>;
-    r[INS_AND_ABS] = &LogicalOperation<&Operation::AND, kFetchABS>;
-    r[INS_AND_ABSX] = &LogicalOperation<&Operation::AND, kFetchFastABSX>;
-    r[INS_AND_ABSY] = &LogicalOperation<&Operation::AND, kFetchFastABSY>;
-    r[INS_AND_INDX] = &LogicalOperation<&Operation::AND, kFetchINDX>;
-    r[INS_AND_INDY] = &LogicalOperation<&Operation::AND, kFetchINDY>;
-    r[INS_ORA_IM] = &LogicalOperation<&Operation::ORA, kFetchIM>;
-    r[INS_ORA_ZP] = &LogicalOperation<&Operation::ORA, kFetchZP>;
-    r[INS_ORA_ZPX] = &LogicalOperation<&Operation::ORA, kFetchZPX>;
-    r[INS_ORA_ABS] = &LogicalOperation<&Operation::ORA, kFetchABS>;
-    r[INS_ORA_ABSX] = &LogicalOperation<&Operation::ORA, kFetchFastABSX>;
-    r[INS_ORA_ABSY] = &LogicalOperation<&Operation::ORA, kFetchFastABSY>;
-    r[INS_ORA_INDX] = &LogicalOperation<&Operation::ORA, kFetchINDX>;
-    r[INS_ORA_INDY] = &LogicalOperation<&Operation::ORA, kFetchINDY>;
-    r[INS_EOR_IM] = &LogicalOperation<&Operation::XOR, kFetchIM>;
-    r[INS_EOR_ZP] = &LogicalOperation<&Operation::XOR, kFetchZP>;
-    r[INS_EOR_ZPX] = &LogicalOperation<&Operation::XOR, kFetchZPX>;
-    r[INS_EOR_ABS] = &LogicalOperation<&Operation::XOR, kFetchABS>;
-    r[INS_EOR_ABSX] = &LogicalOperation<&Operation::XOR, kFetchFastABSX>;
-    r[INS_EOR_ABSY] = &LogicalOperation<&Operation::XOR, kFetchFastABSY>;
-    r[INS_EOR_INDX] = &LogicalOperation<&Operation::XOR, kFetchINDX>;
-    r[INS_EOR_INDY] = &LogicalOperation<&Operation::XOR, kFetchINDY>;
+    r[INS_AND_IM] = &LogicalOperation<B, &Operation::AND, kFetchIM<B>>;
+    r[INS_AND_ZP] = &LogicalOperation<B, &Operation::AND, kFetchZP<B>>;
+    r[INS_AND_ZPX] = &LogicalOperation<B, &Operation::AND, kFetchZPX<B>>;
+    r[INS_AND_ABS] = &LogicalOperation<B, &Operation::AND, kFetchABS<B>>;
+    r[INS_AND_ABSX] = &LogicalOperation<B, &Operation::AND, kFetchFastABSX<B>>;
+    r[INS_AND_ABSY] = &LogicalOperation<B, &Operation::AND, kFetchFastABSY<B>>;
+    r[INS_AND_INDX] = &LogicalOperation<B, &Operation::AND, kFetchINDX<B>>;
+    r[INS_AND_INDY] = &LogicalOperation<B, &Operation::AND, kFetchINDY<B>>;
+    r[INS_ORA_IM] = &LogicalOperation<B, &Operation::ORA, kFetchIM<B>>;
+    r[INS_ORA_ZP] = &LogicalOperation<B, &Operation::ORA, kFetchZP<B>>;
+    r[INS_ORA_ZPX] = &LogicalOperation<B, &Operation::ORA, kFetchZPX<B>>;
+    r[INS_ORA_ABS] = &LogicalOperation<B, &Operation::ORA, kFetchABS<B>>;
+    r[INS_ORA_ABSX] = &LogicalOperation<B, &Operation::ORA, kFetchFastABSX<B>>;
+    r[INS_ORA_ABSY] = &LogicalOperation<B, &Operation::ORA, kFetchFastABSY<B>>;
+    r[INS_ORA_INDX] = &LogicalOperation<B, &Operation::ORA, kFetchINDX<B>>;
+    r[INS_ORA_INDY] = &LogicalOperation<B, &Operation::ORA, kFetchINDY<B>>;
+    r[INS_EOR_IM] = &LogicalOperation<B, &Operation::XOR, kFetchIM<B>>;
+    r[INS_EOR_ZP] = &LogicalOperation<B, &Operation::XOR, kFetchZP<B>>;
+    r[INS_EOR_ZPX] = &LogicalOperation<B, &Operation::XOR, kFetchZPX<B>>;
+    r[INS_EOR_ABS] = &LogicalOperation<B, &Operation::XOR, kFetchABS<B>>;
+    r[INS_EOR_ABSX] = &LogicalOperation<B, &Operation::XOR, kFetchFastABSX<B>>;
+    r[INS_EOR_ABSY] = &LogicalOperation<B, &Operation::XOR, kFetchFastABSY<B>>;
+    r[INS_EOR_INDX] = &LogicalOperation<B, &Operation::XOR, kFetchINDX<B>>;
+    r[INS_EOR_INDY] = &LogicalOperation<B, &Operation::XOR, kFetchINDY<B>>;
 
     //status flag changes
-    r[INS_CLC] = &SetFlag<Flags::Carry, false>;
-    r[INS_SEC] = &SetFlag<Flags::Carry, true>;
-    r[INS_CLD] = &SetFlag<Flags::DecimalMode, false>;
-    r[INS_SED] = &SetFlag<Flags::DecimalMode, true>;
-    r[INS_CLI] = &SetFlag<Flags::IRQB, false>;
-    r[INS_SEI] = &SetFlag<Flags::IRQB, true>;
-    r[INS_CLV] = &SetFlag<Flags::Overflow, false>;
+    r[INS_CLC] = &SetFlag<B, Flags::Carry, false>;
+    r[INS_SEC] = &SetFlag<B, Flags::Carry, true>;
+    r[INS_CLD] = &SetFlag<B, Flags::DecimalMode, false>;
+    r[INS_SED] = &SetFlag<B, Flags::DecimalMode, true>;
+    r[INS_CLI] = &ClearInterruptFlag<B>;
+    r[INS_SEI] = &SetFlag<B, Flags::IRQB, true>;
+    r[INS_CLV] = &SetFlag<B, Flags::Overflow, false>;
 
     // shifts
-    r[INS_ASL] = &Register8Shift<&Registers::a, &Operation::ASL>;
-    r[INS_LSR] = &Register8Shift<&Registers::a, &Operation::LSR>;
-    r[INS_ROL] = &Register8Shift<&Registers::a, &Operation::ROL>;
-    r[INS_ROR] = &Register8Shift<&Registers::a, &Operation::ROR>;
-
-    r[INS_ASL_ZP] = &MemoryShift<&Operation::ASL, kAddressZP>;
-    r[INS_ASL_ZPX] = &MemoryShift<&Operation::ASL, kAddressZPX>;
-    r[INS_ASL_ABS] = &MemoryShift<&Operation::ASL, kAddressABS>;
-    r[INS_ASL_ABSX] = &MemoryShift<&Operation::ASL, kAddressABSX>;
-    r[INS_LSR_ZP] = &MemoryShift<&Operation::LSR, kAddressZP>;
-    r[INS_LSR_ZPX] = &MemoryShift<&Operation::LSR, kAddressZPX>;
-    r[INS_LSR_ABS] = &MemoryShift<&Operation::LSR, kAddressABS>;
-    r[INS_LSR_ABSX] = &MemoryShift<&Operation::LSR, kAddressABSX>;
-    r[INS_ROL_ZP] = &MemoryShift<&Operation::ROL, kAddressZP>;
-    r[INS_ROL_ZPX] = &MemoryShift<&Operation::ROL, kAddressZPX>;
-    r[INS_ROL_ABS] = &MemoryShift<&Operation::ROL, kAddressABS>;
-    r[INS_ROL_ABSX] = &MemoryShift<&Operation::ROL, kAddressABSX>;
-    r[INS_ROR_ZP] = &MemoryShift<&Operation::ROR, kAddressZP>;
-    r[INS_ROR_ZPX] = &MemoryShift<&Operation::ROR, kAddressZPX>;
-    r[INS_ROR_ABS] = &MemoryShift<&Operation::ROR, kAddressABS>;
-    r[INS_ROR_ABSX] = &MemoryShift<&Operation::ROR, kAddressABSX>;
+    r[INS_ASL] = &Register8Shift<B, &Registers::a, &Operation::ASL>;
+    r[INS_LSR] = &Register8Shift<B, &Registers::a, &Operation::LSR>;
+    r[INS_ROL] = &Register8Shift<B, &Registers::a, &Operation::ROL>;
+    r[INS_ROR] = &Register8Shift<B, &Registers::a, &Operation::ROR>;
+
+    r[INS_ASL_ZP] = &MemoryShift<B, &Operation::ASL, kAddressZP<B>>;
+    r[INS_ASL_ZPX] = &MemoryShift<B, &Operation::ASL, kAddressZPX<B>>;
+    r[INS_ASL_ABS] = &MemoryShift<B, &Operation::ASL, kAddressABS<B>>;
+    r[INS_ASL_ABSX] = &MemoryShift<B, &Operation::ASL, kAddressABSX<B>>;
+    r[INS_LSR_ZP] = &MemoryShift<B, &Operation::LSR, kAddressZP<B>>;
+    r[INS_LSR_ZPX] = &MemoryShift<B, &Operation::LSR, kAddressZPX<B>>;
+    r[INS_LSR_ABS] = &MemoryShift<B, &Operation::LSR, kAddressABS<B>>;
+    r[INS_LSR_ABSX] = &MemoryShift<B, &Operation::LSR, kAddressABSX<B>>;
+    r[INS_ROL_ZP] = &MemoryShift<B, &Operation::ROL, kAddressZP<B>>;
+    r[INS_ROL_ZPX] = &MemoryShift<B, &Operation::ROL, kAddressZPX<B>>;
+    r[INS_ROL_ABS] = &MemoryShift<B, &Operation::ROL, kAddressABS<B>>;
+    r[INS_ROL_ABSX] = &MemoryShift<B, &Operation::ROL, kAddressABSX<B>>;
+    r[INS_ROR_ZP] = &MemoryShift<B, &Operation::ROR, kAddressZP<B>>;
+    r[INS_ROR_ZPX] = &MemoryShift<B, &Operation::ROR, kAddressZPX<B>>;
+    r[INS_ROR_ABS] = &MemoryShift<B, &Operation::ROR, kAddressABS<B>>;
+    r[INS_ROR_ABSX] = &MemoryShift<B, &Operation::ROR, kAddressABSX<B>>;
 
     // stack
-    r[INS_TSX] = &Register8Transfer<&Registers::stack_pointer, &Registers::x>;
-    r[INS_TXS] = &Register8Transfer<&Registers::x, &Registers::stack_pointer, false>;
+    r[INS_TSX] = &Register8Transfer<B, &Registers::stack_pointer, &Registers::x>;
+    r[INS_TXS] = &Register8Transfer<B, &Registers::x, &Registers::stack_pointer, false>;
 
-    r[INS_PHA] = &StackPush<&Registers::a>;
-    r[INS_PLA] = &StackPull<&Registers::a>;
-    r[INS_PHP] = &PushFlags;
-    r[INS_PLP] = &PullFlags;
+    r[INS_PHA] = &StackPush<B, &Registers::a>;
+    r[INS_PLA] = &StackPull<B, &Registers::a>;
+    r[INS_PHP] = &PushFlags<B>;
+    r[INS_PLP] = &PullFlags<B>;
 
     //BIT
-    r[INS_BIT_ZP] = &BitOperation<&Operation::AND, kFetchZP>;
-    r[INS_BIT_ABS] = &BitOperation<&Operation::AND, kFetchABS>;
+    r[INS_BIT_ZP] = &BitOperation<B, &Operation::AND, kFetchZP<B>>;
+    r[INS_BIT_ABS] = &BitOperation<B, &Operation::AND, kFetchABS<B>>;
 
     //misc
-    r[INS_NOP] = &NOP;
+    r[INS_NOP] = &NOP<B>;
 
     if (instruction_set == InstructionSet::NMOS6502Emu) {
-        r[INS_HLT_ACC] = &HLT<kFetchAcc>;
-        r[INS_HLT_IM] = &HLT<kFetchIM>;
+        r[INS_HLT_ACC] = &HLT<B, kFetchAcc<B>>;
+        r[INS_HLT_IM] = &HLT<B, kFetchIM<B>>;
     }
 
+    if (instruction_set == InstructionSet::CMOS65C02) {
+        r[INS_BRA] = &BranchAlways<B>;
+        r[INS_JMP_IND] = &JumpIND<B, false>;
+        r[INS_JMP_ABSX_IND] = &JumpABSXIND<B>;
+
+        r[INS_PHX] = &StackPush<B, &Registers::x>;
+        r[INS_PHY] = &StackPush<B, &Registers::y>;
+        r[INS_PLX] = &StackPull<B, &Registers::x>;
+        r[INS_PLY] = &StackPull<B, &Registers::y>;
+
+        r[INS_STZ_ZP] = &StoreZero<B, kAddressZP<B>>;
+        r[INS_STZ_ZPX] = &StoreZero<B, kAddressZPX<B>>;
+        r[INS_STZ_ABS] = &StoreZero<B, kAddressABS<B>>;
+        r[INS_STZ_ABSX] = &StoreZero<B, kAddressABSX<B>>;
+
+        r[INS_TRB_ZP] = &TestAndModifyBits<B, kAddressZP<B>, false>;
+        r[INS_TRB_ABS] = &TestAndModifyBits<B, kAddressABS<B>, false>;
+        r[INS_TSB_ZP] = &TestAndModifyBits<B, kAddressZP<B>, true>;
+        r[INS_TSB_ABS] = &TestAndModifyBits<B, kAddressABS<B>, true>;
+
+        r[INS_ORA_INDZP] = &LogicalOperation<B, &Operation::ORA, kFetchZPIND<B>>;
+        r[INS_AND_INDZP] = &LogicalOperation<B, &Operation::AND, kFetchZPIND<B>>;
+        r[INS_EOR_INDZP] = &LogicalOperation<B, &Operation::XOR, kFetchZPIND<B>>;
+        r[INS_STA_INDZP] = &Register8Store<B, &Registers::a, kAddressZPIND<B>>;
+        r[INS_LDA_INDZP] = &Register8Load<B, &Registers::a, kFetchZPIND<B>>;
+        r[INS_CMP_INDZP] = &Register8Compare<B, &Registers::a, kFetchZPIND<B>>;
+
+        // Decimal mode takes one cycle more
+        r[INS_ADC] = &ArithmeticOperation<B, kFetchIM<B>, false, true>;
+        r[INS_ADC_ABS] = &ArithmeticOperation<B, kFetchABS<B>, false, true>;
+        r[INS_ADC_ZP] = &ArithmeticOperation<B, kFetchZP<B>, false, true>;
+        r[INS_ADC_ZPX] = &ArithmeticOperation<B, kFetchZPX<B>, false, true>;
+        r[INS_ADC_ABSX] = &ArithmeticOperation<B, kFetchFastABSX<B>, false, true>;
+        r[INS_ADC_ABSY] = &ArithmeticOperation<B, kFetchFastABSY<B>, false, true>;
+        r[INS_ADC_INDX] = &ArithmeticOperation<B, kFetchINDX<B>, false, true>;
+        r[INS_ADC_INDY] = &ArithmeticOperation<B, kFetchINDY<B>, false, true>;
+        r[INS_ADC_INDZP] = &ArithmeticOperation<B, kFetchZPIND<B>, false, true>;
+        r[INS_SBC] = &ArithmeticOperation<B, kFetchIM<B>, true, true>;
+        r[INS_SBC_ABS] = &ArithmeticOperation<B, kFetchABS<B>, true, true>;
+        r[INS_SBC_ZP] = &ArithmeticOperation<B, kFetchZP<B>, true, true>;
+        r[INS_SBC_ZPX] = &ArithmeticOperation<B, kFetchZPX<B>, true, true>;
+        r[INS_SBC_ABSX] = &ArithmeticOperation<B, kFetchFastABSX<B>, true, true>;
+        r[INS_SBC_ABSY] = &ArithmeticOperation<B, kFetchFastABSY<B>, true, true>;
+        r[INS_SBC_INDX] = &ArithmeticOperation<B, kFetchINDX<B>, true, true>;
+        r[INS_SBC_INDY] = &ArithmeticOperation<B, kFetchINDY<B>, true, true>;
+        r[INS_SBC_INDZP] = &ArithmeticOperation<B, kFetchZPIND<B>, true, true>;
+
+        // Shifts a,x pay the index cycle only when page is crossed
+        r[INS_ASL_ABSX] = &MemoryShift<B, &Operation::ASL, kAddressFastABSX<B>>;
+        r[INS_LSR_ABSX] = &MemoryShift<B, &Operation::LSR, kAddressFastABSX<B>>;
+        r[INS_ROL_ABSX] = &MemoryShift<B, &Operation::ROL, kAddressFastABSX<B>>;
+        r[INS_ROR_ABSX] = &MemoryShift<B, &Operation::ROR, kAddressFastABSX<B>>;
+
+        r[INS_INC_ACC] = &Register8Increment<B, &Registers::a, 1>;
+        r[INS_DEC_ACC] = &Register8Increment<B, &Registers::a, -1>;
+
+        r[INS_BIT_IM] = &BitOperation<B, &Operation::AND, kFetchIM<B>, true>;
+        r[INS_BIT_ZPX] = &BitOperation<B, &Operation::AND, kFetchZPX<B>>;
+        r[INS_BIT_ABSX] = &BitOperation<B, &Operation::AND, kFetchFastABSX<B>>;
+
+        SetBitInstructionHandlers<B>(r, std::make_integer_sequence<uint8_t, 8>{});
+
+        r[INS_WAI] = &WAI<B>;
+        r[INS_STP] = &STP<B>;
+    }
+
+    if (instruction_set == InstructionSet::NMOS6502Undocumented) {
+        SetUndocumentedInstructionHandlers<B>(r);
+    }
+
+    return r;
+}
+
+template <InstructionSet instruction_set, typename B>
+constexpr RegisterHandlerArray kRegisterHandlers =
+    GenRegisterHandlerArray<B>(instruction_set);
+
+// Handler on registers of the cpu, for loops which keep no copy of them
+template <const RegisterHandlerArray &kHandlers, size_t kOpcode>
+void OnCpuRegisters(Cpu *cpu) {
+    kHandlers[kOpcode](cpu, cpu->reg);
+}
+
+template <const RegisterHandlerArray &kHandlers, size_t... I>
+constexpr InstructionHandlerArray MakeCpuRegisterHandlers(std::index_sequence<I...>) {
+    return {&OnCpuRegisters<kHandlers, I>...};
+}
+
+template <InstructionSet instruction_set, typename B>
+constexpr InstructionHandlerArray kInstructionHandlers =
+    MakeCpuRegisterHandlers<kRegisterHandlers<instruction_set, B>>(
+        std::make_index_sequence<256>{});
+
+template <InstructionSet instruction_set>
+constexpr InstructionCycleArray kInstructionCycles =
+    GenInstructionCycleArray(instruction_set);
+
+// Same steps as the cached loop does for each of the two instructions, handlers come
+// from the constexpr table so both calls are direct
+template <InstructionSet instruction_set, typename B, size_t kPair>
+void RunFusedPair(Cpu *cpu, const DecodedInstruction *pair, uint64_t &remaining) {
+    constexpr const auto &kHandlers = kRegisterHandlers<instruction_set, B>;
+    constexpr const auto &kCycles = kInstructionCycles<instruction_set>;
+    constexpr auto kFirst = kFusedPairs[kPair].first;
+    constexpr auto kSecond = kFusedPairs[kPair].second;
+
+    --remaining;
+    cpu->pending_cycles += kCycles[kFirst];
+    ++cpu->reg.program_counter;
+    cpu->decoded_operand = pair[0].operand.data();
+    kHandlers[kFirst](cpu, cpu->reg);
+
+    --remaining;
+    cpu->pending_cycles += kCycles[kSecond];
+    ++cpu->reg.program_counter;
+    cpu->decoded_operand = pair[1].operand.data();
+    kHandlers[kSecond](cpu, cpu->reg);
+    cpu->decoded_operand = nullptr;
+}
+
+template <InstructionSet instruction_set, typename B, size_t... I>
+constexpr std::array<FusedHandlerPtr, sizeof...(I)>
+MakeFusedHandlers(std::index_sequence<I...>) {
+    return {&RunFusedPair<instruction_set, B, I>...};
+}
+
+template <InstructionSet instruction_set, typename B>
+constexpr auto kFusedHandlers =
+    MakeFusedHandlers<instruction_set, B>(std::make_index_sequence<kFusedPairs.size()>{});
+
+// Opcodes whose handler may stop the cpu: HLT, STP, WAI and the ones without an
+// instruction. Threaded loop checks for a stop only after these.
+template <InstructionSet instruction_set, typename B>
+constexpr std::array<bool, 256> GenStopOpcodeArray() {
+    constexpr auto kInvalid = InitHandlerArray(std::make_index_sequence<256>{});
+    constexpr const auto &kHandlers = kRegisterHandlers<instruction_set, B>;
+    std::array<bool, 256> r{};
+    for (size_t i = 0; i < r.size(); ++i) {
+        r[i] = kHandlers[i] == kInvalid[i];
+    }
+    if constexpr (instruction_set == InstructionSet::NMOS6502Emu) {
+        r[opcode::INS_HLT_ACC] = true;
+        r[opcode::INS_HLT_IM] = true;
+    }
+    if constexpr (instruction_set == InstructionSet::CMOS65C02) {
+        r[opcode::INS_STP] = true;
+        r[opcode::INS_WAI] = true;
+    }
     return r;
 }
 
+template <InstructionSet instruction_set, typename B>
+constexpr std::array<bool, 256> kStopOpcodes = GenStopOpcodeArray<instruction_set, B>();
+
 } // namespace
 
 //-----------------------------------------------------------------------------
 
+std::string to_string(ExecutionEngine engine) {
+    switch (engine) {
+    case ExecutionEngine::Reference:
+        return "reference";
+    case ExecutionEngine::Threaded:
+        return "threaded";
+    case ExecutionEngine::Cached:
+        return "cached";
+    case ExecutionEngine::Jit:
+        return "jit";
+    case ExecutionEngine::CycleExact:
+        return "cycle_exact";
+    }
+    return fmt::format("[Invalid engine {}]", static_cast<int>(engine));
+}
+
+ExecutionEngine ParseExecutionEngine(const std::string &name) {
+    for (auto engine : {ExecutionEngine::Reference, ExecutionEngine::Threaded,
+                        ExecutionEngine::Cached, ExecutionEngine::Jit,
+                        ExecutionEngine::CycleExact}) {
+        if (to_string(engine) == name) {
+            return engine;
+        }
+    }
+    throw std::runtime_error(fmt::format("Invalid execution engine: {}", name));
+}
+
+std::string to_string(ExecutionStatus status) {
+    switch (status) {
+    case ExecutionStatus::Running:
+        return "running";
+    case ExecutionStatus::Halted:
+        return "halted";
+    case ExecutionStatus::InvalidOpcode:
+        return "invalid opcode";
+    case ExecutionStatus::BudgetExhausted:
+        return "budget exhausted";
+    case ExecutionStatus::Breakpoint:
+        return "breakpoint";
+    case ExecutionStatus::StopRequested:
+        return "stop requested";
+    case ExecutionStatus::Waiting:
+        return "waiting for interrupt";
+    case ExecutionStatus::Trapped:
+        return "trapped";
+    }
+    return fmt::format("[Invalid status {}]", static_cast<int>(status));
+}
+
+//-----------------------------------------------------------------------------
+
 Cpu::Cpu(Clock *clock, Memory16 *memory, std::ostream *verbose_stream,
-         InstructionSet instruction_set, Debugger *external_debugger)
-    : memory(memory), instruction_handlers(&GetInstructionHandlerArray(instruction_set)),
-      clock(clock), verbose_stream(verbose_stream), debugger(external_debugger) {
+         InstructionSet instruction_set, Debugger *external_debugger,
+         ExecutionEngine engine)
+    : Cpu(GetInstructionDispatch<Memory16, Clock>(instruction_set, engine), clock,
+          memory, verbose_stream, instruction_set, external_debugger, engine) {}
+
+Cpu::Cpu(const InstructionDispatch &dispatch, Clock *clock, Memory16 *memory,
+         std::ostream *verbose_stream, InstructionSet instruction_set,
+         Debugger *external_debugger, ExecutionEngine engine)
+    : memory(memory), clock(clock), instruction_handlers(&dispatch.handlers),
+      dispatch(&dispatch), verbose_stream(verbose_stream), debugger(external_debugger),
+      instruction_set(instruction_set), engine(engine),
+      execute_reference(external_debugger != nullptr ? &Cpu::ExecuteReference<true>
+                                                     : &Cpu::ExecuteReference<false>),
+      fused_pair_counts(kFusedPairs.size()) {
+    if (engine == ExecutionEngine::Cached || engine == ExecutionEngine::Jit) {
+        block_cache = std::make_unique<BlockCache>(memory, dispatch, instruction_set);
+    }
+    if (engine == ExecutionEngine::Jit && jit::JitCompiler::IsSupported()) {
+        // Without host support jit engine runs as plain cached one
+        jit_compiler = std::make_unique<jit::JitCompiler>(instruction_set);
+    }
+    if (external_debugger == nullptr) {
+        idle_loop_detector = std::make_unique<IdleLoopDetector>(memory, instruction_set);
+    }
+    direct_pages.Update(memory);
 }
 
+Cpu::~Cpu() = default;
+
 const InstructionHandlerArray &
 Cpu::GetInstructionHandlerArray(InstructionSet instruction_set) {
+    return GetInstructionDispatch<Memory16, Clock>(instruction_set).handlers;
+}
+
+const InstructionCycleArray &
+Cpu::GetInstructionCycleArray(InstructionSet instruction_set) {
+    return GetInstructionDispatch<Memory16, Clock>(instruction_set).cycles;
+}
+
+template <InstructionSet kInstructionSet, typename MemoryT, typename ClockT>
+constexpr InstructionDispatch Cpu::MakeInstructionDispatch() {
+    using B = instructions::Bus<MemoryT, ClockT>;
+    return InstructionDispatch{
+        .handlers = kInstructionHandlers<kInstructionSet, B>,
+        .cycles = kInstructionCycles<kInstructionSet>,
+        .fetch_next_byte = &instructions::FetchOpcode<B>,
+        .flush_cycles = &B::FlushCycles,
+        .handle_interrupt = &instructions::HandleInterrupt<B, kInstructionSet>,
+        .fused_handlers = kFusedHandlers<kInstructionSet, B>.data(),
+        .execute_threaded = &Cpu::ExecuteThreaded<kInstructionSet, MemoryT, ClockT>,
+        .execute_cached = &Cpu::ExecuteCached<MemoryT, ClockT>,
+    };
+}
+
+// Batches, blocks and fused pairs are never used by the cycle-exact engine
+template <InstructionSet kInstructionSet>
+constexpr InstructionDispatch Cpu::MakeCycleExactDispatch() {
+    using B = instructions::CycleExactBus<kInstructionSet == InstructionSet::CMOS65C02>;
+    return InstructionDispatch{
+        .handlers = kInstructionHandlers<kInstructionSet, B>,
+        .cycles = kInstructionCycles<kInstructionSet>,
+        .fetch_next_byte = &instructions::FetchOpcode<B>,
+        .flush_cycles = &B::FlushCycles,
+        .handle_interrupt = &instructions::HandleInterrupt<B, kInstructionSet>,
+        .fused_handlers = nullptr,
+        .execute_threaded = nullptr,
+        .execute_cached = nullptr,
+    };
+}
+
+const InstructionDispatch &Cpu::GetCycleExactDispatch(InstructionSet instruction_set) {
+    static constexpr InstructionDispatch kNMOS6502 =
+        MakeCycleExactDispatch<InstructionSet::NMOS6502>();
+    static constexpr InstructionDispatch kNMOS6502Emu =
+        MakeCycleExactDispatch<InstructionSet::NMOS6502Emu>();
+    static constexpr InstructionDispatch kCMOS65C02 =
+        MakeCycleExactDispatch<InstructionSet::CMOS65C02>();
+    static constexpr InstructionDispatch kNMOS6502Undocumented =
+        MakeCycleExactDispatch<InstructionSet::NMOS6502Undocumented>();
     switch (instruction_set) {
-    case InstructionSet::NMOS6502: {
-        static const InstructionHandlerArray array =
-            GenInstructionHandlerArray(instruction_set);
-        return array;
+    case InstructionSet::NMOS6502:
+        return kNMOS6502;
+    case InstructionSet::NMOS6502Emu:
+        return kNMOS6502Emu;
+    case InstructionSet::CMOS65C02:
+        return kCMOS65C02;
+    case InstructionSet::NMOS6502Undocumented:
+        return kNMOS6502Undocumented;
+    case InstructionSet::Unknown:
+        break;
     }
-    case InstructionSet::NMOS6502Emu: {
-        static const InstructionHandlerArray array =
-            GenInstructionHandlerArray(instruction_set);
-        return array;
+    throw std::runtime_error(
+        fmt::format("Invalid instruction set: {}", static_cast<int>(instruction_set)));
+}
+
+template <typename MemoryT, typename ClockT>
+const InstructionDispatch &Cpu::GetInstructionDispatch(InstructionSet instruction_set,
+                                                       ExecutionEngine engine) {
+    if (engine == ExecutionEngine::CycleExact) {
+        return GetCycleExactDispatch(instruction_set);
     }
+    static constexpr InstructionDispatch kNMOS6502 =
+        MakeInstructionDispatch<InstructionSet::NMOS6502, MemoryT, ClockT>();
+    static constexpr InstructionDispatch kNMOS6502Emu =
+        MakeInstructionDispatch<InstructionSet::NMOS6502Emu, MemoryT, ClockT>();
+    static constexpr InstructionDispatch kCMOS65C02 =
+        MakeInstructionDispatch<InstructionSet::CMOS65C02, MemoryT, ClockT>();
+    static constexpr InstructionDispatch kNMOS6502Undocumented =
+        MakeInstructionDispatch<InstructionSet::NMOS6502Undocumented, MemoryT, ClockT>();
+    switch (instruction_set) {
+    case InstructionSet::NMOS6502:
+        return kNMOS6502;
+    case InstructionSet::NMOS6502Emu:
+        return kNMOS6502Emu;
+    case InstructionSet::CMOS65C02:
+        return kCMOS65C02;
+    case InstructionSet::NMOS6502Undocumented:
+        return kNMOS6502Undocumented;
     case InstructionSet::Unknown:
         break;
     }
@@ -260,72 +744,755 @@ Cpu::GetInstructionHandlerArray(InstructionSet instruction_set) {
         fmt::format("Invalid instruction set: {}", static_cast<int>(instruction_set)));
 }
 
+void Cpu::AttachRecompiledProgram(const RecompiledProgram *program) {
+    if (engine == ExecutionEngine::Reference || engine == ExecutionEngine::CycleExact) {
+        throw std::runtime_error(fmt::format("Recompiled code can not run with {} engine",
+                                             to_string(engine)));
+    }
+    if (program->instruction_set != instruction_set) {
+        throw std::runtime_error("Recompiled code uses different instruction set");
+    }
+    recompiled_code = std::make_unique<RecompiledCode>(memory, program);
+    if (block_cache == nullptr) {
+        // Recompiled blocks are dispatched by the cached loop
+        block_cache = std::make_unique<BlockCache>(memory, *dispatch, instruction_set);
+    }
+}
+
 void Cpu::Reset() {
     // if (debugger != nullptr) {
     // debugger->OnReset();
     // }
     reg.Reset();
+    executed_instructions = 0;
+    decoded_operand = nullptr;
+    ClearStop();
+    pending_interrupt = Interrupt::None;
+    nmi_pending = false;
+    if (block_cache != nullptr) {
+        // memory could have been reloaded behind cpu back
+        block_cache->Clear();
+    }
+    direct_pages.Update(memory);
+    if (jit_compiler != nullptr) {
+        jit_compiler->Reset();
+    }
+    if (recompiled_code != nullptr) {
+        recompiled_code->Invalidate();
+    }
     reg.program_counter = kResetVector;
+    flushed_cycles = 0;
+    bus_cycles = 0;
+    idle_skipped_cycles = 0;
+    native_call = nullptr;
+    native_routine_calls = 0;
+    pending_cycles = kResetCycles;
     auto handler = (*instruction_handlers)[opcode::INS_JMP_ABS];
     handler(this);
+    FlushCycles();
 }
 
-void Cpu::Execute() {
+ExecutionResult Cpu::Execute() {
     Reset();
+    return ExecuteBudget(kUnlimited, kUnlimited);
+}
+
+ExecutionResult Cpu::ExecuteUntil(std::chrono::steady_clock::time_point deadline) {
+    Reset();
+    return ExecuteBudget(kUnlimited, kUnlimited, deadline);
+}
+
+ExecutionResult Cpu::ExecuteFor(std::chrono::nanoseconds timeout) {
+    return ExecuteUntil(std::chrono::steady_clock::now() + timeout);
+}
+
+ExecutionResult Cpu::ExecuteInstructions(uint64_t budget) {
+    return ExecuteBudget(budget, kUnlimited);
+}
+
+ExecutionResult Cpu::ExecuteCycles(uint64_t budget) {
+    return ExecuteBudget(kUnlimited, budget);
+}
+
+ExecutionResult Cpu::ExecuteBudget(uint64_t instructions, uint64_t cycles,
+                                   std::chrono::steady_clock::time_point deadline) {
+    const uint64_t start_instructions = executed_instructions;
+    const uint64_t start_cycles = ExecutedCycles();
+    const bool has_deadline = deadline != std::chrono::steady_clock::time_point::max();
+    const uint64_t budget_end = cycles == kUnlimited ? kUnlimited : start_cycles + cycles;
+    uint64_t next_check = start_cycles + kStopCheckCycles;
+    struct WaitLimitReset {
+        Cpu *cpu;
+        ~WaitLimitReset() { cpu->wait_limit = EventScheduler::kNever; }
+    } wait_limit_reset{this};
+
     for (;;) {
-        ExecuteNextInstruction();
+        uint64_t spent_instructions = executed_instructions - start_instructions;
+        uint64_t spent_cycles = ExecutedCycles() - start_cycles;
+        if (spent_instructions >= instructions || spent_cycles >= cycles) {
+            Stop(ExecutionStatus::BudgetExhausted);
+            return Result();
+        }
+
+        if (ExecutedCycles() >= next_check) {
+            next_check = ExecutedCycles() + kStopCheckCycles;
+            if (has_deadline && std::chrono::steady_clock::now() >= deadline) {
+                Stop(ExecutionStatus::BudgetExhausted);
+                return Result();
+            }
+        }
+        if (stop_requested.exchange(false, std::memory_order_relaxed)) {
+            Stop(ExecutionStatus::StopRequested);
+            return Result();
+        }
+
+        // Batch ends before the next check and can overrun cycle budget by at most one
+        // instruction
+        uint64_t cycles_left = std::min(cycles - spent_cycles, kStopCheckCycles);
+        uint64_t count = std::max<uint64_t>(cycles_left / kMaxInstructionCycles, 1);
+        // WAI skips cycles up to the end of the budget, and up to the next deadline
+        // check when it waits for a scheduled event
+        wait_limit = budget_end;
+        if (has_deadline && scheduler.NextEventCycle() != EventScheduler::kNever) {
+            wait_limit = std::min(wait_limit, next_check);
+        }
+        count = std::min(count, instructions - spent_instructions);
+        // Idle loop check runs up to two iterations, no more than the batch would. Unlike
+        // WAI, idle loop goes on up to the deadline when nothing is scheduled.
+        uint64_t idle_limit =
+            has_deadline ? std::min(budget_end, next_check) : budget_end;
+        if (count < 2 * IdleLoopDetector::kMaxLoopInstructions ||
+            !SkipIdleLoop(instructions - spent_instructions, idle_limit)) {
+            RunInstructions(count);
+        }
+        if (stop_status == ExecutionStatus::Waiting && wait_limit != kUnlimited) {
+            // WAI has reached the limit, it runs again after budget and deadline checks
+            ClearStop();
+            continue;
+        }
+        if (stop_status != ExecutionStatus::Running) {
+            return Result();
+        }
     }
 }
 
-void Cpu::ExecuteUntil(std::chrono::steady_clock::time_point deadline) {
-    Reset();
-    while (deadline > std::chrono::steady_clock::now()) {
-        ExecuteNextInstruction();
+uint64_t Cpu::RunInstructions(uint64_t count) {
+    if (engine != ExecutionEngine::Reference) {
+        return ExecuteBatch(count);
     }
+    return (this->*execute_reference)(count);
 }
 
-void Cpu::ExecuteFor(std::chrono::nanoseconds timeout) {
-    return ExecuteUntil(std::chrono::steady_clock::now() + timeout);
+bool Cpu::SkipIdleLoop(uint64_t instructions_left, uint64_t limit) {
+    if (idle_loop_detector == nullptr) {
+        return false;
+    }
+    auto loop = idle_loop_detector->Find(reg.program_counter);
+    // Skipped iterations would not access the bus
+    const bool skip = idle_loop_skip && engine != ExecutionEngine::CycleExact;
+    // Jump to itself is looked at for traps even when idle loops are not skipped
+    if (!loop.has_value() || (!skip && loop->instructions > 1)) {
+        return false;
+    }
+
+    // Finish the current iteration, then run one more to see that it changes nothing
+    if (loop->instructions_left > 0) {
+        RunInstructions(loop->instructions_left);
+        if (stop_status != ExecutionStatus::Running ||
+            reg.program_counter != loop->head) {
+            return true;
+        }
+    }
+    const Registers start_regs = reg;
+    const uint64_t start_cycles = ExecutedCycles();
+    RunInstructions(loop->instructions);
+    if (stop_status != ExecutionStatus::Running || start_regs != reg) {
+        return true;
+    }
+
+    if (loop->instructions == 1 && IsTrapped()) {
+        Stop(ExecutionStatus::Trapped);
+        return true;
+    }
+    if (!skip) {
+        return true;
+    }
+
+    const uint64_t now = ExecutedCycles();
+    const uint64_t iteration_cycles = now - start_cycles;
+    limit = std::min(limit, scheduler.NextEventCycle());
+    if (loop->reads_device) {
+        limit = std::min(limit, now + kIdleDeviceSkipCycles);
+    }
+    if (limit == EventScheduler::kNever) {
+        // Nothing but an interrupt line can end the loop, it runs again when execution
+        // is resumed
+        Stop(ExecutionStatus::Waiting);
+        return true;
+    }
+
+    // Whole iterations which end before the limit, so the loop is left at the same cycle
+    // as without skipping
+    uint64_t iterations = limit > now ? (limit - now - 1) / iteration_cycles : 0;
+    if (instructions_left != kUnlimited) {
+        auto ran = loop->instructions_left + loop->instructions;
+        iterations = std::min(iterations, (instructions_left - ran) / loop->instructions);
+    }
+    pending_cycles += iterations * iteration_cycles;
+    executed_instructions += iterations * loop->instructions;
+    idle_skipped_cycles += iterations * iteration_cycles;
+    // Clock sleeps over the skipped cycles
+    FlushCycles();
+    return true;
 }
 
-void Cpu::ExecuteNextInstruction() {
-    if (debugger != nullptr) {
-        debugger->OnNextInstruction(reg);
-    }
-    auto opcode = instructions::FetchNextByte(this);
-    auto handler = (*instruction_handlers)[opcode];
-    if (handler == nullptr) {
-        if (verbose_stream != nullptr) {
-            (*verbose_stream) << fmt::format("Unknown opcode {:02x} at {:04x}\n", opcode,
-                                             reg.program_counter - 1);
+bool Cpu::IsTrapped() const {
+    // Any scheduled event may raise NMI, even while I flag is set
+    bool irq_taken =
+        (irq_lines & irq_source_mask) != 0 && !reg.TestFlag(Registers::Flags::IRQB);
+    return scheduler.Size() == 0 && !nmi_pending &&
+           pending_interrupt == Interrupt::None && !irq_taken;
+}
+
+void Cpu::AddNativeRoutine(MemPtr address, NativeRoutine routine) {
+    native_routines[address] = std::move(routine);
+}
+
+void Cpu::CheckNativeRoutineCall(MemPtr target) {
+    if (verifying_native_routine) {
+        return;
+    }
+    auto it = native_routines.find(target);
+    if (it != native_routines.end()) {
+        native_call = &it->second;
+        scheduler.Wake();
+    }
+}
+
+void Cpu::RunNativeRoutine(const NativeRoutine &routine) {
+    ++native_routine_calls;
+    if (native_verification) {
+        VerifyNativeRoutine(routine);
+        return;
+    }
+    NativeRoutineMemory native_memory{this};
+    pending_cycles += routine(reg, native_memory);
+    ReturnFromSubroutine(reg, *memory);
+    ++executed_instructions;
+}
+
+void Cpu::VerifyNativeRoutine(const NativeRoutine &routine) {
+    const MemPtr address = reg.program_counter;
+    auto fail = [address](const std::string &what) {
+        throw std::runtime_error(fmt::format(
+            "Native routine at {:04x} differs from guest code: {}", address, what));
+    };
+
+    Registers native_reg = reg;
+    ShadowMemory shadow{memory};
+    const uint64_t native_cycles = routine(native_reg, shadow);
+    ReturnFromSubroutine(native_reg, shadow);
+
+    // Guest routine has returned once its return address is pulled
+    const auto memory_before = memory->DebugReadRange(0, kAddressSpaceSize);
+    const Reg8 return_stack_pointer = reg.stack_pointer + 2;
+    const uint64_t start_cycles = ExecutedCycles();
+    struct VerificationEnd {
+        Cpu *cpu;
+        ~VerificationEnd() { cpu->verifying_native_routine = false; }
+    } verification_end{this};
+    verifying_native_routine = true;
+    for (uint64_t i = 0; reg.stack_pointer != return_stack_pointer; ++i) {
+        if (i == kMaxVerifiedInstructions) {
+            fail("guest routine has not returned");
+        }
+        ExecuteReference<false>(1);
+        if (stop_status != ExecutionStatus::Running) {
+            fail(fmt::format("guest routine has stopped: {}", to_string(stop_status)));
         }
-        // if (debugger != nullptr) {
-        // debugger->OnUnknownOpcode();
-        // } else {
-        throw std::runtime_error(fmt::format("Invalid opcode {:02x} at address {:04x}",
-                                             opcode, reg.program_counter));
-        // }
     }
 
-    handler(this);
+    if (native_reg != reg) {
+        fail(fmt::format("registers {} != {}", native_reg.Dump(), reg.Dump()));
+    }
+    const uint64_t guest_cycles = ExecutedCycles() - start_cycles;
+    if (native_cycles != guest_cycles) {
+        fail(fmt::format("cycles {} != {}", native_cycles, guest_cycles));
+    }
+    const auto memory_after = memory->DebugReadRange(0, kAddressSpaceSize);
+    for (size_t i = 0; i < memory_after.size(); ++i) {
+        auto at = static_cast<MemPtr>(i);
+        // Free part of the stack holds whatever either of them has left there
+        bool free_stack = at >= kStackBase && at <= kStackBase + reg.stack_pointer;
+        if (free_stack || !memory_after[i].has_value()) {
+            continue;
+        }
+        auto expected = shadow.Stored(at);
+        if (!expected.has_value()) {
+            expected = memory_before[i];
+        }
+        if (expected != memory_after[i]) {
+            fail(fmt::format("memory at {:04x} {:02x} != {:02x}", at,
+                             expected.value_or(0), *memory_after[i]));
+        }
+    }
+}
+
+void Cpu::AddDeviceArea(MemPtr offset, size_t size) {
+    if (idle_loop_detector != nullptr) {
+        idle_loop_detector->AddDeviceArea(offset, size);
+    }
+}
+
+ExecutionResult Cpu::Result() const {
+    ExecutionResult r{.status = stop_status, .regs = reg};
+    if (stop_status == ExecutionStatus::Halted) {
+        r.halt_code = stop_code;
+    } else if (stop_status == ExecutionStatus::InvalidOpcode) {
+        r.opcode = stop_code;
+    }
+    return r;
+}
+
+ExecutionStatus Cpu::ClearStop() {
+    stop_code = 0;
+    return std::exchange(stop_status, ExecutionStatus::Running);
+}
+
+ExecutionStatus Cpu::ExecuteNextInstruction() {
+    (this->*execute_reference)(1);
+    return stop_status;
+}
+
+// Instrumented loop calls debugger hooks, the other one is used when there is no
+// debugger and checks nothing but the stop status
+template <bool kInstrumented>
+uint64_t Cpu::ExecuteReference(uint64_t count) {
+    // Instruction which stopped at breakpoint runs when execution is resumed
+    bool skip_breakpoint = ClearStop() == ExecutionStatus::Breakpoint;
+    for (uint64_t i = 0; i < count; ++i) {
+        if constexpr (kInstrumented) {
+            if (!skip_breakpoint && debugger->IsBreakpoint(reg.program_counter)) {
+                Stop(ExecutionStatus::Breakpoint);
+                return i;
+            }
+            skip_breakpoint = false;
+            debugger->OnNextInstruction(reg);
+        }
+
+        auto opcode = dispatch->fetch_next_byte(this);
+        auto handler = (*instruction_handlers)[opcode];
+        if constexpr (kInstrumented) {
+            if (handler == nullptr) {
+                if (verbose_stream != nullptr) {
+                    (*verbose_stream) << fmt::format("Unknown opcode {:02x} at {:04x}\n",
+                                                     opcode, reg.program_counter - 1);
+                }
+                throw std::runtime_error(
+                    fmt::format("Invalid opcode {:02x} at address {:04x}", opcode,
+                                reg.program_counter));
+            }
+        }
+
+        struct CycleFlush {
+            Cpu *cpu;
+            ~CycleFlush() { cpu->dispatch->flush_cycles(cpu); }
+        } cycle_flush{this};
+
+        ++executed_instructions;
+        pending_cycles += dispatch->cycles[opcode];
+        handler(this);
+
+        if (ExecutedCycles() >= scheduler.NextEventCycle()) {
+            HandleEvents();
+        }
+        if (stop_status != ExecutionStatus::Running) {
+            return i + 1;
+        }
+    }
+    return count;
+}
+
+void Cpu::HandleEvents() {
+    if (native_call != nullptr) {
+        RunNativeRoutine(*std::exchange(native_call, nullptr));
+    }
+    scheduler.RunDue(ExecutedCycles());
 
     if (pending_interrupt != Interrupt::None) {
-        if (verbose_stream != nullptr) {
-            (*verbose_stream) << fmt::format("{} is pending: {}\n",
-                                             to_string(pending_interrupt), reg.Dump());
+        EnterInterrupt(std::exchange(pending_interrupt, Interrupt::None));
+    } else if (nmi_pending) {
+        nmi_pending = false;
+        EnterInterrupt(Interrupt::Nmi);
+    } else if ((irq_lines & irq_source_mask) != 0 &&
+               !reg.TestFlag(Registers::Flags::IRQB)) {
+        EnterInterrupt(Interrupt::Irq);
+    }
+
+    // NMI which can not be taken yet (after BRK) is looked at again after the next
+    // instruction. IRQ held back by I flag waits for CLI, PLP or RTI to clear it.
+    if (nmi_pending) {
+        scheduler.Wake();
+    }
+}
+
+bool Cpu::WaitForInterrupt() {
+    for (;;) {
+        if (nmi_pending || (irq_lines & irq_source_mask) != 0) {
+            // Interrupt is taken after WAI, with I flag set execution goes on with the
+            // next instruction
+            scheduler.Wake();
+            return true;
+        }
+
+        auto now = ExecutedCycles();
+        auto next = scheduler.NextEventCycle();
+        if (next == EventScheduler::kNever || next > wait_limit) {
+            if (wait_limit != EventScheduler::kNever && wait_limit > now) {
+                pending_cycles += wait_limit - now;
+                FlushCycles();
+            }
+            // WAI runs again when execution is resumed
+            Stop(ExecutionStatus::Waiting);
+            return false;
+        }
+        if (next > now) {
+            pending_cycles += next - now;
         }
-        // if (debugger != nullptr) {
-        // debugger->OnInterrupt(pending_interrupt);
-        // }
-        instructions::HandleInterrupt(this, pending_interrupt);
-        pending_interrupt = Interrupt::None;
+        // Clock sleeps until the event is due, devices see the time which has passed
+        FlushCycles();
+        scheduler.RunDue(ExecutedCycles());
     }
 }
 
-void Cpu::WaitForNextCycle() const {
-    if (clock != nullptr) {
-        clock->WaitForNextCycle();
+void Cpu::EnterInterrupt(Interrupt interrupt) {
+    if (verbose_stream != nullptr) {
+        (*verbose_stream) << fmt::format("{} is pending: {}\n", to_string(interrupt),
+                                         reg.Dump());
     }
+    // if (debugger != nullptr) {
+    // debugger->OnInterrupt(interrupt);
+    // }
+    pending_cycles += kInterruptCycles;
+    if (interrupt != Interrupt::Brk) {
+        pending_cycles += kInterruptFetchCycles;
+    }
+    dispatch->handle_interrupt(this, interrupt);
+}
+
+void Cpu::SetIrq(unsigned source, bool asserted) {
+    if (source >= 32) {
+        throw std::runtime_error(fmt::format("Invalid IRQ source {}", source));
+    }
+    if (asserted) {
+        irq_lines |= 1u << source;
+        scheduler.Wake();
+    } else {
+        irq_lines &= ~(1u << source);
+    }
+}
+
+void Cpu::TriggerNmi() {
+    nmi_pending = true;
+    scheduler.Wake();
+}
+
+void Cpu::SetIrqSourceMask(uint32_t mask) {
+    irq_source_mask = mask;
+    scheduler.Wake();
+}
+
+//-----------------------------------------------------------------------------
+
+uint64_t Cpu::ExecuteBatch(uint64_t count) {
+    if (debugger != nullptr) {
+        // Debugger hooks are per instruction, so there is nothing to thread
+        return ExecuteReference<true>(count);
+    }
+    if (engine == ExecutionEngine::CycleExact) {
+        return ExecuteReference<false>(count);
+    }
+
+    ClearStop();
+    if (block_cache != nullptr) {
+        return (this->*dispatch->execute_cached)(count);
+    }
+    return (this->*dispatch->execute_threaded)(count);
+}
+
+template <typename MemoryT, typename ClockT>
+uint64_t Cpu::ExecuteCached(uint64_t count) {
+    using B = instructions::Bus<MemoryT, ClockT>;
+
+    uint64_t remaining = count;
+    struct StateUpdate {
+        Cpu *cpu;
+        const uint64_t &remaining;
+        uint64_t count;
+        ~StateUpdate() {
+            cpu->decoded_operand = nullptr;
+            cpu->executed_instructions += count - remaining;
+            B::FlushCycles(cpu);
+        }
+    } state_update{this, remaining, count};
+
+    // Instructions which stop the cpu end blocks, so it is enough to check once per block
+    while (remaining > 0 && stop_status == ExecutionStatus::Running) {
+        if (jit_compiler != nullptr && jit_compiler->IsFull()) {
+            // Blocks hold pointers into jit code memory, both start over
+            block_cache->Clear();
+            jit_compiler->Reset();
+        }
+
+        // Recompiled code runs without looking at events, like jit code it is entered
+        // only when the next one is due after the block
+        if (recompiled_code != nullptr) {
+            const auto *recompiled =
+                recompiled_code->Lookup(reg.program_counter, code_page_generation);
+            if (recompiled != nullptr && remaining >= recompiled->instructions &&
+                ExecutedCycles() + recompiled->max_cycles < scheduler.NextEventCycle()) {
+                uint32_t executed = 0;
+                try {
+                    recompiled->function(this, &executed);
+                } catch (...) {
+                    remaining -= executed;
+                    throw;
+                }
+                remaining -= executed;
+                if (ExecutedCycles() >= scheduler.NextEventCycle()) {
+                    HandleEvents();
+                }
+                B::FlushCycles(this);
+                continue;
+            }
+        }
+
+        auto *block = block_cache->Lookup(reg.program_counter, code_page_generation);
+        if (block == nullptr) {
+            // Code is not readable without side effects, fetch it the usual way
+            --remaining;
+            auto opcode = instructions::FetchOpcode<B>(this);
+            pending_cycles += dispatch->cycles[opcode];
+            (*instruction_handlers)[opcode](this);
+            if (ExecutedCycles() >= scheduler.NextEventCycle()) {
+                HandleEvents();
+            }
+            B::FlushCycles(this);
+            continue;
+        }
+
+        if (jit_compiler != nullptr && block->jit_function == nullptr &&
+            !block->jit_rejected && ++block->entry_count >= kJitHotBlockThreshold) {
+            block->jit_function = jit_compiler->Compile(*block);
+            block->jit_rejected = block->jit_function == nullptr;
+        }
+        // Jit code runs without looking at events, it is entered only when the next one
+        // is due after the block. The interpreter below stops at it otherwise.
+        if (block->jit_function != nullptr && remaining >= block->instructions.size() &&
+            ExecutedCycles() + block->max_cycles < scheduler.NextEventCycle()) {
+            // Jit code keeps flags as plain byte
+            reg.flags.Materialize();
+            auto exit = jit::JitCompiler::Run(block->jit_function, this, &reg);
+            remaining -= exit.instructions;
+            if (exit.failed) {
+                jit::JitCompiler::RethrowPendingError();
+            }
+            if (exit.instructions > 0) {
+                if (ExecutedCycles() >= scheduler.NextEventCycle()) {
+                    HandleEvents();
+                }
+                B::FlushCycles(this);
+                continue;
+            }
+            // Jit code left before its first instruction (decimal mode ADC/SBC), block
+            // is interpreted so execution moves on
+        }
+
+        const auto &instructions = block->instructions;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            const auto &instruction = instructions[i];
+            // Pair does not look at events between its halves, it runs as two
+            // instructions when one may be due after the first
+            if (instruction.fused_handler != nullptr && remaining >= 2 &&
+                ExecutedCycles() + instruction.cycles + kMaxPenaltyCycles <
+                    scheduler.NextEventCycle()) {
+                instruction.fused_handler(this, &instruction, remaining);
+                ++fused_pair_counts[instruction.fused_pair];
+                ++i;
+            } else {
+                --remaining;
+                pending_cycles += instruction.cycles;
+                ++reg.program_counter;
+                decoded_operand = instruction.operand.data();
+                instruction.handler(this);
+                decoded_operand = nullptr;
+            }
+
+            if (ExecutedCycles() >= scheduler.NextEventCycle()) {
+                HandleEvents();
+                break;
+            }
+            if (remaining == 0 || !block->IsValid(code_page_generation)) {
+                break;
+            }
+        }
+        B::FlushCycles(this);
+    }
+
+    return count - remaining;
 }
 
+// Expands M(0x00) M(0x01) ... M(0xFF)
+#define EMU6502_OPCODE_ROW(M, hi)                                                        \
+    M(hi##0) M(hi##1) M(hi##2) M(hi##3) M(hi##4) M(hi##5) M(hi##6) M(hi##7) M(hi##8)     \
+        M(hi##9) M(hi##A) M(hi##B) M(hi##C) M(hi##D) M(hi##E) M(hi##F)
+#define EMU6502_FOR_EACH_OPCODE(M)                                                       \
+    EMU6502_OPCODE_ROW(M, 0x0) EMU6502_OPCODE_ROW(M, 0x1) EMU6502_OPCODE_ROW(M, 0x2)     \
+    EMU6502_OPCODE_ROW(M, 0x3) EMU6502_OPCODE_ROW(M, 0x4) EMU6502_OPCODE_ROW(M, 0x5)     \
+    EMU6502_OPCODE_ROW(M, 0x6) EMU6502_OPCODE_ROW(M, 0x7) EMU6502_OPCODE_ROW(M, 0x8)     \
+    EMU6502_OPCODE_ROW(M, 0x9) EMU6502_OPCODE_ROW(M, 0xA) EMU6502_OPCODE_ROW(M, 0xB)     \
+    EMU6502_OPCODE_ROW(M, 0xC) EMU6502_OPCODE_ROW(M, 0xD) EMU6502_OPCODE_ROW(M, 0xE)     \
+    EMU6502_OPCODE_ROW(M, 0xF)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EMU6502_COMPUTED_GOTO 1
+#else
+#define EMU6502_COMPUTED_GOTO 0
+#endif
+
+template <InstructionSet kInstructionSet, typename MemoryT, typename ClockT>
+uint64_t Cpu::ExecuteThreaded(uint64_t count) {
+    using B = instructions::Bus<MemoryT, ClockT>;
+    // Handlers come from a constexpr table, so each opcode body below is a direct
+    // (and usually inlined) call instead of an indirect one through instruction_handlers
+    constexpr const RegisterHandlerArray &kHandlers =
+        kRegisterHandlers<kInstructionSet, B>;
+    constexpr const InstructionCycleArray &kCycles = kInstructionCycles<kInstructionSet>;
+    constexpr const auto &kStops = kStopOpcodes<kInstructionSet, B>;
+
+    uint64_t remaining = count;
+    struct CountUpdate {
+        Cpu *cpu;
+        const uint64_t &remaining;
+        uint64_t count;
+        ~CountUpdate() {
+            cpu->executed_instructions += count - remaining;
+            B::FlushCycles(cpu);
+        }
+    } count_update{this, remaining, count};
+
+    if (remaining == 0) {
+        return 0;
+    }
+
+    // Handlers work on this copy of the registers. They, the addressing functions and the
+    // register methods are EMU6502_ALWAYS_INLINE, so its address does not escape and the
+    // compiler keeps it in host registers instead of reloading reg after every store to
+    // memory. reg is brought up to date for events, which enter interrupts and run
+    // native routines, and whenever the loop is left.
+    Registers regs = reg;
+    try {
+#if EMU6502_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+#define EMU6502_LABEL_ADDRESS(op) &&opcode_##op,
+        static const std::array<void *, 256> kLabels = {
+            EMU6502_FOR_EACH_OPCODE(EMU6502_LABEL_ADDRESS)};
+#undef EMU6502_LABEL_ADDRESS
+
+#define EMU6502_DISPATCH()                                                               \
+    goto *kLabels[instructions::FetchNextByte<B>(this, regs)] // NOLINT
+
+#define EMU6502_OPCODE_BODY(op)                                                          \
+    opcode_##op : --remaining;                                                           \
+    pending_cycles += kCycles[op];                                                       \
+    kHandlers[op](this, regs);                                                           \
+    if (ExecutedCycles() >= scheduler.NextEventCycle()) {                                \
+        reg = regs;                                                                      \
+        HandleEvents();                                                                  \
+        regs = reg;                                                                      \
+    }                                                                                    \
+    if constexpr (kStops[op]) {                                                          \
+        if (stop_status != ExecutionStatus::Running) {                                   \
+            goto done; /* NOLINT */                                                      \
+        }                                                                                \
+    }                                                                                    \
+    if (remaining == 0) {                                                                \
+        goto done; /* NOLINT */                                                          \
+    }                                                                                    \
+    EMU6502_DISPATCH();
+
+        EMU6502_DISPATCH();
+        EMU6502_FOR_EACH_OPCODE(EMU6502_OPCODE_BODY)
+
+#undef EMU6502_OPCODE_BODY
+#undef EMU6502_DISPATCH
+
+    done:;
+#pragma GCC diagnostic pop
+
+#else
+#define EMU6502_OPCODE_CASE(op)                                                          \
+    case op:                                                                             \
+        pending_cycles += kCycles[op];                                                   \
+        kHandlers[op](this, regs);                                                       \
+        break;
+
+        while (remaining > 0) {
+            auto opcode = instructions::FetchNextByte<B>(this, regs);
+            --remaining;
+            switch (opcode) {
+                EMU6502_FOR_EACH_OPCODE(EMU6502_OPCODE_CASE)
+            }
+            if (ExecutedCycles() >= scheduler.NextEventCycle()) {
+                reg = regs;
+                HandleEvents();
+                regs = reg;
+            }
+            if (kStops[opcode] && stop_status != ExecutionStatus::Running) {
+                break;
+            }
+        }
+
+#undef EMU6502_OPCODE_CASE
+#endif
+    } catch (...) {
+        // State of the instruction which failed, as the reference loop leaves it
+        reg = regs;
+        throw;
+    }
+
+    reg = regs;
+    return count - remaining;
+}
+
+void Cpu::FlushCycles() {
+    dispatch->flush_cycles(this);
+}
+
+std::vector<FusedPairCount> Cpu::FusedPairCounts() const {
+    std::vector<FusedPairCount> r;
+    for (size_t i = 0; i < kFusedPairs.size(); ++i) {
+        if (fused_pair_counts[i] > 0) {
+            r.emplace_back(FusedPairCount{kFusedPairs[i].name, fused_pair_counts[i]});
+        }
+    }
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+
+template const InstructionDispatch &
+Cpu::GetInstructionDispatch<Memory16, Clock>(InstructionSet, ExecutionEngine);
+template const InstructionDispatch &
+Cpu::GetInstructionDispatch<memory::MemoryBlock16, ClockSimple>(InstructionSet,
+                                                                ExecutionEngine);
+template const InstructionDispatch &
+Cpu::GetInstructionDispatch<memory::MemoryBlock16, ClockSteady>(InstructionSet,
+                                                                ExecutionEngine);
+template const InstructionDispatch &
+Cpu::GetInstructionDispatch<memory::MemorySparse16, ClockSimple>(InstructionSet,
+                                                                 ExecutionEngine);
+
 } // namespace emu::emu6502::cpu
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "emu_6502/cpu/decimal_arithmetic.hpp"
+
+namespace emu::emu6502::cpu {
+
+namespace {
+
+using Flags = Registers::Flags;
+
+Reg8 Flag(Flags f, bool state) {
+    return state ? static_cast<Reg8>(f) : 0;
+}
+
+// Sequences follow "Decimal Mode" tutorial by Bruce Clark, appendix A
+DecimalResult Add(int a, int b, int c) {
+    int low = (a & 0x0F) + (b & 0x0F) + c;
+    if (low >= 0x0A) {
+        low = ((low + 0x06) & 0x0F) + 0x10;
+    }
+
+    // N and V see the high digits before they are adjusted, as signed values
+    int signed_sum = static_cast<int8_t>(a & 0xF0) + static_cast<int8_t>(b & 0xF0) + low;
+
+    int sum = (a & 0xF0) + (b & 0xF0) + low;
+    if (sum >= 0xA0) {
+        sum += 0x60;
+    }
+
+    return {
+        .value = static_cast<uint8_t>(sum),
+        .flags = static_cast<Reg8>(Flag(Flags::Negative, (signed_sum & 0x80) != 0) |
+                                   Flag(Flags::Overflow, signed_sum < -128 ||
+                                                             signed_sum > 127) |
+                                   Flag(Flags::Zero, ((a + b + c) & 0xFF) == 0) |
+                                   Flag(Flags::Carry, sum >= 0x100)),
+    };
+}
+
+DecimalResult Subtract(int a, int b, int c) {
+    int low = (a & 0x0F) - (b & 0x0F) + c - 1;
+    if (low < 0) {
+        low = ((low - 0x06) & 0x0F) - 0x10;
+    }
+    int difference = (a & 0xF0) - (b & 0xF0) + low;
+    if (difference < 0) {
+        difference -= 0x60;
+    }
+
+    int binary = a - b + c - 1;
+    bool overflow = ((a ^ b) & 0x80) != 0 && ((a ^ binary) & 0x80) != 0;
+    return {
+        .value = static_cast<uint8_t>(difference),
+        .flags = static_cast<Reg8>(Flag(Flags::Negative, (binary & 0x80) != 0) |
+                                   Flag(Flags::Overflow, overflow) |
+                                   Flag(Flags::Zero, (binary & 0xFF) == 0) |
+                                   Flag(Flags::Carry, binary >= 0)),
+    };
+}
+
+template <DecimalResult (*op)(int, int, int)>
+DecimalTable MakeTable() {
+    DecimalTable r{};
+    for (int c = 0; c < 2; ++c) {
+        for (int a = 0; a < 256; ++a) {
+            for (int b = 0; b < 256; ++b) {
+                r[(c << 16) | (a << 8) | b] = op(a, b, c);
+            }
+        }
+    }
+    return r;
+}
+
+} // namespace
+
+const DecimalTable kDecimalAddTable = MakeTable<&Add>();
+const DecimalTable kDecimalSubtractTable = MakeTable<&Subtract>();
+
+} // namespace emu::emu6502::cpu
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "emu_6502/cpu/opcode.hpp"
+#include <array>
+#include <optional>
+#include <string_view>
+
+namespace emu::emu6502::cpu {
+
+// Instruction pairs which dominate guest loops. Block cache marks every pair found in
+// a decoded block and the cached loop runs it as one fused handler, with the same
+// register, flag and cycle results as two separate handlers.
+struct FusedPairInfo {
+    Opcode first;
+    Opcode second;
+    std::string_view name;
+    // First instruction stores to zero page, pair is not fused in a block which may
+    // overwrite its own code that way
+    bool first_stores_zero_page;
+};
+
+constexpr std::array<FusedPairInfo, 8> kFusedPairs = {{
+    {opcode::INS_DEX, opcode::INS_BNE, "DEX/BNE", false},
+    {opcode::INS_DEY, opcode::INS_BNE, "DEY/BNE", false},
+    {opcode::INS_CMP, opcode::INS_BNE, "CMP #/BNE", false},
+    {opcode::INS_LDA_ZP, opcode::INS_STA_ABS, "LDA zp/STA abs", false},
+    {opcode::INS_INC_ZP, opcode::INS_BNE, "INC zp/BNE", true},
+    {opcode::INS_LDA_ABSY, opcode::INS_STA_ZP, "LDA abs,Y/STA zp", false},
+    {opcode::INS_LDA_ABSY, opcode::INS_STA_ABS, "LDA abs,Y/STA abs", false},
+    {opcode::INS_LDA_ABSY, opcode::INS_STA_ABSX, "LDA abs,Y/STA abs,X", false},
+}};
+
+constexpr std::optional<size_t> FindFusedPair(Opcode first, Opcode second) {
+    for (size_t i = 0; i < kFusedPairs.size(); ++i) {
+        if (kFusedPairs[i].first == first && kFusedPairs[i].second == second) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace emu::emu6502::cpu
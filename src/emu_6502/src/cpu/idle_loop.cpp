@@ -0,0 +1,176 @@
+#include "idle_loop.hpp"
+#include <algorithm>
+#include <string_view>
+
+namespace emu::emu6502::cpu {
+
+namespace {
+
+using namespace std::string_view_literals;
+
+// Instructions which change nothing but registers and flags, with any address mode
+constexpr std::array kReadMnemonics = {
+    "LDA"sv, "LDX"sv, "LDY"sv, "LAX"sv, "CMP"sv, "CPX"sv, "CPY"sv, "BIT"sv, "AND"sv,
+    "ORA"sv, "EOR"sv, "ADC"sv, "SBC"sv, "NOP"sv, "CLC"sv, "SEC"sv, "CLV"sv, "CLD"sv,
+    "SED"sv, "TAX"sv, "TAY"sv, "TXA"sv, "TYA"sv, "TSX"sv, "INX"sv, "INY"sv, "DEX"sv,
+    "DEY"sv,
+};
+
+// Read-modify-write instructions, which change registers only in accumulator mode
+constexpr std::array kAccumulatorMnemonics = {"ASL"sv, "LSR"sv, "ROL"sv,
+                                              "ROR"sv, "INC"sv, "DEC"sv};
+
+bool IsMemoryRead(AddressMode mode) {
+    switch (mode) {
+    case AddressMode::Immediate:
+    case AddressMode::Implied:
+    case AddressMode::ACC:
+    case AddressMode::REL:
+        return false;
+    default:
+        return true;
+    }
+}
+
+} // namespace
+
+IdleLoopDetector::IdleLoopDetector(const Memory16 *memory, InstructionSet instruction_set)
+    : memory(memory) {
+    kinds.fill(Kind::Other);
+    lengths.fill(1);
+    modes.fill(AddressMode::Implied);
+
+    for (const auto &[opcode, info] : GetInstructionSet(instruction_set)) {
+        lengths[opcode] = 1 + ArgumentByteSize(info.addres_mode);
+        modes[opcode] = info.addres_mode;
+        auto contains = [&](const auto &list) {
+            return std::ranges::find(list, info.mnemonic) != list.end();
+        };
+
+        if (info.mnemonic == "BRA"sv ||
+            (info.mnemonic == "JMP"sv && info.addres_mode == AddressMode::ABS)) {
+            kinds[opcode] = Kind::Jump;
+        } else if (info.addres_mode == AddressMode::REL) {
+            kinds[opcode] = Kind::Branch;
+        } else if (contains(kReadMnemonics) ||
+                   (info.addres_mode == AddressMode::ACC &&
+                    contains(kAccumulatorMnemonics))) {
+            kinds[opcode] = Kind::Read;
+        }
+    }
+}
+
+void IdleLoopDetector::AddDeviceArea(MemPtr offset, size_t size) {
+    if (size > 0) {
+        device_areas.emplace_back(offset, static_cast<MemPtr>(offset + size - 1));
+    }
+}
+
+std::optional<IdleLoop> IdleLoopDetector::Find(MemPtr pc) const {
+    // Look for the jump back first, program counter can be anywhere in the loop
+    std::optional<MemPtr> head;
+    MemPtr end = pc;
+    for (uint32_t i = 0; i < kMaxLoopInstructions && !head.has_value(); ++i) {
+        auto d = Decode(end);
+        if (!d.has_value() || d->kind == Kind::Other) {
+            return std::nullopt;
+        }
+        if ((d->kind == Kind::Branch || d->kind == Kind::Jump) && d->target <= end) {
+            if (d->target > pc) {
+                return std::nullopt;
+            }
+            head = d->target;
+            break;
+        }
+        if (d->kind == Kind::Jump) {
+            return std::nullopt;
+        }
+        end += d->length;
+    }
+    if (!head.has_value()) {
+        return std::nullopt;
+    }
+
+    IdleLoop loop{
+        .head = *head,
+        .instructions = 0,
+        .instructions_left = 0,
+        .reads_device = false,
+    };
+    std::optional<uint32_t> pc_index;
+    MemPtr address = *head;
+    for (;;) {
+        auto d = Decode(address);
+        if (!d.has_value() || d->kind == Kind::Other ||
+            ++loop.instructions > kMaxLoopInstructions) {
+            return std::nullopt;
+        }
+        if (address == pc) {
+            pc_index = loop.instructions - 1;
+        }
+        loop.reads_device = loop.reads_device || ReadsDevice(*d);
+        if (address == end) {
+            break;
+        }
+        if (d->kind == Kind::Jump || (d->kind == Kind::Branch && d->target <= end)) {
+            return std::nullopt;
+        }
+        address += d->length;
+        if (address > end) {
+            return std::nullopt;
+        }
+    }
+    if (!pc_index.has_value()) {
+        return std::nullopt;
+    }
+    loop.instructions_left = pc == loop.head ? 0 : loop.instructions - *pc_index;
+    return loop;
+}
+
+std::optional<IdleLoopDetector::Decoded> IdleLoopDetector::Decode(MemPtr pc) const {
+    auto opcode = memory->DebugRead(pc);
+    if (!opcode.has_value() || IsDevice(pc)) {
+        return std::nullopt;
+    }
+
+    Decoded d{.kind = kinds[*opcode],
+              .mode = modes[*opcode],
+              .length = lengths[*opcode],
+              .target = 0,
+              .operand = 0};
+    for (uint8_t i = 1; i < d.length; ++i) {
+        auto address = static_cast<MemPtr>(pc + i);
+        auto byte = memory->DebugRead(address);
+        if (!byte.has_value() || IsDevice(address)) {
+            return std::nullopt;
+        }
+        d.operand |= static_cast<MemPtr>(*byte << (8 * (i - 1)));
+    }
+
+    auto next = static_cast<MemPtr>(pc + d.length);
+    if (d.kind == Kind::Jump && d.mode == AddressMode::ABS) {
+        d.target = d.operand;
+    } else if (d.kind == Kind::Branch || d.kind == Kind::Jump) {
+        d.target = static_cast<MemPtr>(next + static_cast<int8_t>(d.operand));
+    }
+    return d;
+}
+
+bool IdleLoopDetector::IsDevice(MemPtr address) const {
+    return std::ranges::any_of(device_areas, [address](const auto &area) {
+        return area.first <= address && address <= area.second;
+    });
+}
+
+bool IdleLoopDetector::ReadsDevice(const Decoded &d) const {
+    if (d.kind != Kind::Read || !IsMemoryRead(d.mode)) {
+        return false;
+    }
+    if (d.mode == AddressMode::ZP || d.mode == AddressMode::ABS) {
+        return IsDevice(d.operand);
+    }
+    // Indexed and indirect reads depend on registers
+    return !device_areas.empty();
+}
+
+} // namespace emu::emu6502::cpu
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/memory.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace emu::emu6502::cpu {
+
+// Straight-line loop which only reads memory, e.g. LDA TTY_IN_SIZE / BEQ loop. Once an
+// iteration leaves registers as they were, the next ones do the same until an
+// interrupt is taken or a value read from a device changes.
+struct IdleLoop {
+    MemPtr head;                // target of the jump back
+    uint32_t instructions;      // from head up to and including the jump back
+    uint32_t instructions_left; // from program counter to the end of the iteration
+    bool reads_device;          // some read may hit an area added by AddDeviceArea
+};
+
+class IdleLoopDetector {
+public:
+    static constexpr uint32_t kMaxLoopInstructions = 8;
+
+    IdleLoopDetector(const Memory16 *memory, InstructionSet instruction_set);
+
+    // Reads from a device area are not assumed to return the same value each time
+    void AddDeviceArea(MemPtr offset, size_t size);
+
+    // Idle loop which contains program counter. Loop must not contain other jumps back,
+    // forward branches must leave it.
+    [[nodiscard]] std::optional<IdleLoop> Find(MemPtr pc) const;
+
+private:
+    enum class Kind : uint8_t {
+        Other, // writes memory, changes stack or flow in other way, or unknown
+        Read,  // changes registers and flags only
+        Branch,
+        Jump, // JMP abs or BRA
+    };
+
+    struct Decoded {
+        Kind kind;
+        AddressMode mode;
+        uint8_t length;
+        MemPtr target;  // Branch and Jump
+        MemPtr operand; // address read by Read with zero page or absolute argument
+    };
+
+    const Memory16 *const memory;
+    std::array<Kind, 256> kinds{};
+    std::array<uint8_t, 256> lengths{};
+    std::array<AddressMode, 256> modes{};
+    std::vector<std::pair<MemPtr, MemPtr>> device_areas; // first and last address
+
+    [[nodiscard]] std::optional<Decoded> Decode(MemPtr pc) const;
+    [[nodiscard]] bool IsDevice(MemPtr address) const;
+    [[nodiscard]] bool ReadsDevice(const Decoded &d) const;
+};
+
+} // namespace emu::emu6502::cpu
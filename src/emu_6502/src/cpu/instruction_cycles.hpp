@@ -0,0 +1,335 @@
+#pragma once
+
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/cpu/opcode.hpp"
+#include "emu_6502/instruction_set.hpp"
+
+namespace emu::emu6502::cpu {
+
+// Cycle model of the cpu. Each instruction costs its base cycles from the table below,
+// which cover opcode and operand fetch and all bus accesses. Handlers add only
+// penalties which depend on run time values:
+// - indexed reads (a,x a,y (zp),y) take one cycle more when page is crossed,
+//   indexed stores and read-modify-write instructions always pay it in base cost,
+//   except 65C02 shifts a,x which pay it like reads
+// - taken branch takes one cycle more, and one more when target is in other page,
+//   BRA and BBR/BBS (65C02) pay it the same way
+// - 65C02 ADC and SBC take one cycle more in decimal mode
+// Interrupt entry sequence (three pushes and vector read) costs kInterruptCycles, BRK
+// costs its base cycles plus the sequence. IRQ and NMI read the opcode at PC and drop
+// it in kInterruptFetchCycles before the sequence, 7 cycles like BRK. Reset reads
+// reset vector in kResetCycles.
+// Memory accesses do not tick the clock, accumulated cycles are passed to it with
+// Clock::Advance once per instruction, block or batch depending on execution engine.
+// Cycle-exact engine runs handlers which also make the dummy accesses of each cycle,
+// every access ticks the clock, see CycleExactBus. Both ways charge the same cycles.
+
+constexpr uint8_t kInterruptCycles = 5;
+constexpr uint8_t kInterruptFetchCycles = 2;
+constexpr uint8_t kResetCycles = 2;
+constexpr uint8_t kInvalidOpcodeCycles = 1;
+// Longest instruction including penalties, budget loops size batches with it.
+// Undocumented read-modify-write (zp,x)/(zp),y take 8.
+constexpr uint8_t kMaxInstructionCycles = 8;
+
+constexpr InstructionCycleArray GenInstructionCycleArray(InstructionSet instruction_set) {
+    InstructionCycleArray r{};
+    r.fill(kInvalidOpcodeCycles);
+
+    using namespace opcode;
+
+    //LDA
+    r[INS_LDA_IM] = 2;
+    r[INS_LDA_ZP] = 3;
+    r[INS_LDA_ZPX] = 4;
+    r[INS_LDA_ABS] = 4;
+    r[INS_LDA_ABSX] = 4;
+    r[INS_LDA_ABSY] = 4;
+    r[INS_LDA_INDX] = 6;
+    r[INS_LDA_INDY] = 5;
+    //LDX
+    r[INS_LDX_IM] = 2;
+    r[INS_LDX_ZP] = 3;
+    r[INS_LDX_ZPY] = 4;
+    r[INS_LDX_ABS] = 4;
+    r[INS_LDX_ABSY] = 4;
+    //LDY
+    r[INS_LDY_IM] = 2;
+    r[INS_LDY_ZP] = 3;
+    r[INS_LDY_ZPX] = 4;
+    r[INS_LDY_ABS] = 4;
+    r[INS_LDY_ABSX] = 4;
+    //STA
+    r[INS_STA_ZP] = 3;
+    r[INS_STA_ZPX] = 4;
+    r[INS_STA_ABS] = 4;
+    r[INS_STA_ABSX] = 5;
+    r[INS_STA_ABSY] = 5;
+    r[INS_STA_INDX] = 6;
+    r[INS_STA_INDY] = 6;
+    //STX
+    r[INS_STX_ZP] = 3;
+    r[INS_STX_ZPY] = 4;
+    r[INS_STX_ABS] = 4;
+    //STY
+    r[INS_STY_ZP] = 3;
+    r[INS_STY_ZPX] = 4;
+    r[INS_STY_ABS] = 4;
+
+    //Stack
+    r[INS_TSX] = 2;
+    r[INS_TXS] = 2;
+    r[INS_PHA] = 3;
+    r[INS_PLA] = 4;
+    r[INS_PHP] = 3;
+    r[INS_PLP] = 4;
+
+    //Jumps
+    r[INS_JMP_ABS] = 3;
+    r[INS_JMP_IND] = 5;
+    r[INS_JSR] = 6;
+    r[INS_RTS] = 6;
+
+    //Logical Ops
+    //AND
+    r[INS_AND_IM] = 2;
+    r[INS_AND_ZP] = 3;
+    r[INS_AND_ZPX] = 4;
+    r[INS_AND_ABS] = 4;
+    r[INS_AND_ABSX] = 4;
+    r[INS_AND_ABSY] = 4;
+    r[INS_AND_INDX] = 6;
+    r[INS_AND_INDY] = 5;
+    //OR
+    r[INS_ORA_IM] = 2;
+    r[INS_ORA_ZP] = 3;
+    r[INS_ORA_ZPX] = 4;
+    r[INS_ORA_ABS] = 4;
+    r[INS_ORA_ABSX] = 4;
+    r[INS_ORA_ABSY] = 4;
+    r[INS_ORA_INDX] = 6;
+    r[INS_ORA_INDY] = 5;
+    //EOR
+    r[INS_EOR_IM] = 2;
+    r[INS_EOR_ZP] = 3;
+    r[INS_EOR_ZPX] = 4;
+    r[INS_EOR_ABS] = 4;
+    r[INS_EOR_ABSX] = 4;
+    r[INS_EOR_ABSY] = 4;
+    r[INS_EOR_INDX] = 6;
+    r[INS_EOR_INDY] = 5;
+    //BIT
+    r[INS_BIT_ZP] = 3;
+    r[INS_BIT_ABS] = 4;
+    //Transfer Registers
+    r[INS_TAX] = 2;
+    r[INS_TAY] = 2;
+    r[INS_TXA] = 2;
+    r[INS_TYA] = 2;
+    //Increments, Decrements
+    r[INS_INX] = 2;
+    r[INS_INY] = 2;
+    r[INS_DEX] = 2;
+    r[INS_DEY] = 2;
+    r[INS_DEC_ZP] = 5;
+    r[INS_DEC_ZPX] = 6;
+    r[INS_DEC_ABS] = 6;
+    r[INS_DEC_ABSX] = 7;
+    r[INS_INC_ZP] = 5;
+    r[INS_INC_ZPX] = 6;
+    r[INS_INC_ABS] = 6;
+    r[INS_INC_ABSX] = 7;
+    //branches
+    r[INS_BEQ] = 2;
+    r[INS_BNE] = 2;
+    r[INS_BCS] = 2;
+    r[INS_BCC] = 2;
+    r[INS_BMI] = 2;
+    r[INS_BPL] = 2;
+    r[INS_BVC] = 2;
+    r[INS_BVS] = 2;
+    //status flag changes
+    r[INS_CLC] = 2;
+    r[INS_SEC] = 2;
+    r[INS_CLD] = 2;
+    r[INS_SED] = 2;
+    r[INS_CLI] = 2;
+    r[INS_SEI] = 2;
+    r[INS_CLV] = 2;
+    //Arithmetic
+    r[INS_ADC] = 2;
+    r[INS_ADC_ZP] = 3;
+    r[INS_ADC_ZPX] = 4;
+    r[INS_ADC_ABS] = 4;
+    r[INS_ADC_ABSX] = 4;
+    r[INS_ADC_ABSY] = 4;
+    r[INS_ADC_INDX] = 6;
+    r[INS_ADC_INDY] = 5;
+    r[INS_SBC] = 2;
+    r[INS_SBC_ABS] = 4;
+    r[INS_SBC_ZP] = 3;
+    r[INS_SBC_ZPX] = 4;
+    r[INS_SBC_ABSX] = 4;
+    r[INS_SBC_ABSY] = 4;
+    r[INS_SBC_INDX] = 6;
+    r[INS_SBC_INDY] = 5;
+    // Register Comparison
+    r[INS_CMP] = 2;
+    r[INS_CMP_ZP] = 3;
+    r[INS_CMP_ZPX] = 4;
+    r[INS_CMP_ABS] = 4;
+    r[INS_CMP_ABSX] = 4;
+    r[INS_CMP_ABSY] = 4;
+    r[INS_CMP_INDX] = 6;
+    r[INS_CMP_INDY] = 5;
+    r[INS_CPX] = 2;
+    r[INS_CPY] = 2;
+    r[INS_CPX_ZP] = 3;
+    r[INS_CPY_ZP] = 3;
+    r[INS_CPX_ABS] = 4;
+    r[INS_CPY_ABS] = 4;
+    // shifts
+    r[INS_ASL] = 2;
+    r[INS_ASL_ZP] = 5;
+    r[INS_ASL_ZPX] = 6;
+    r[INS_ASL_ABS] = 6;
+    r[INS_ASL_ABSX] = 7;
+    r[INS_LSR] = 2;
+    r[INS_LSR_ZP] = 5;
+    r[INS_LSR_ZPX] = 6;
+    r[INS_LSR_ABS] = 6;
+    r[INS_LSR_ABSX] = 7;
+    r[INS_ROL] = 2;
+    r[INS_ROL_ZP] = 5;
+    r[INS_ROL_ZPX] = 6;
+    r[INS_ROL_ABS] = 6;
+    r[INS_ROL_ABSX] = 7;
+    r[INS_ROR] = 2;
+    r[INS_ROR_ZP] = 5;
+    r[INS_ROR_ZPX] = 6;
+    r[INS_ROR_ABS] = 6;
+    r[INS_ROR_ABSX] = 7;
+    //misc
+    r[INS_NOP] = 2;
+    r[INS_BRK] = 2;
+    r[INS_RTI] = 6;
+
+    if (instruction_set == InstructionSet::NMOS6502Emu) {
+        r[INS_HLT_ACC] = 1;
+        r[INS_HLT_IM] = 2;
+    }
+
+    if (instruction_set == InstructionSet::CMOS65C02) {
+        r[INS_BRA] = 2;
+        r[INS_JMP_IND] = 6;
+        r[INS_JMP_ABSX_IND] = 6;
+
+        r[INS_PHX] = 3;
+        r[INS_PHY] = 3;
+        r[INS_PLX] = 4;
+        r[INS_PLY] = 4;
+
+        r[INS_STZ_ZP] = 3;
+        r[INS_STZ_ZPX] = 4;
+        r[INS_STZ_ABS] = 4;
+        r[INS_STZ_ABSX] = 5;
+
+        r[INS_TRB_ZP] = 5;
+        r[INS_TRB_ABS] = 6;
+        r[INS_TSB_ZP] = 5;
+        r[INS_TSB_ABS] = 6;
+
+        for (auto op : {INS_ORA_INDZP, INS_AND_INDZP, INS_EOR_INDZP, INS_ADC_INDZP,
+                        INS_STA_INDZP, INS_LDA_INDZP, INS_CMP_INDZP, INS_SBC_INDZP}) {
+            r[op] = 5;
+        }
+
+        r[INS_INC_ACC] = 2;
+        r[INS_DEC_ACC] = 2;
+
+        // Page cross penalty like indexed reads
+        r[INS_ASL_ABSX] = 6;
+        r[INS_LSR_ABSX] = 6;
+        r[INS_ROL_ABSX] = 6;
+        r[INS_ROR_ABSX] = 6;
+
+        r[INS_BIT_IM] = 2;
+        r[INS_BIT_ZPX] = 4;
+        r[INS_BIT_ABSX] = 4;
+
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            r[BitOpcode(INS_RMB0, bit)] = 5;
+            r[BitOpcode(INS_SMB0, bit)] = 5;
+            r[BitOpcode(INS_BBR0, bit)] = 5;
+            r[BitOpcode(INS_BBS0, bit)] = 5;
+        }
+
+        // WAI skips cycles until an interrupt, see Cpu::WaitForInterrupt
+        r[INS_WAI] = 3;
+        r[INS_STP] = 3;
+    }
+
+    if (instruction_set == InstructionSet::NMOS6502Undocumented) {
+        // Read-modify-write, indexed modes pay the page crossing cycle in base cost
+        for (auto [zp, zpx, abs, absx, absy, indx, indy] : {
+                 std::array{INS_SLO_ZP, INS_SLO_ZPX, INS_SLO_ABS, INS_SLO_ABSX,
+                            INS_SLO_ABSY, INS_SLO_INDX, INS_SLO_INDY},
+                 std::array{INS_RLA_ZP, INS_RLA_ZPX, INS_RLA_ABS, INS_RLA_ABSX,
+                            INS_RLA_ABSY, INS_RLA_INDX, INS_RLA_INDY},
+                 std::array{INS_SRE_ZP, INS_SRE_ZPX, INS_SRE_ABS, INS_SRE_ABSX,
+                            INS_SRE_ABSY, INS_SRE_INDX, INS_SRE_INDY},
+                 std::array{INS_RRA_ZP, INS_RRA_ZPX, INS_RRA_ABS, INS_RRA_ABSX,
+                            INS_RRA_ABSY, INS_RRA_INDX, INS_RRA_INDY},
+                 std::array{INS_DCP_ZP, INS_DCP_ZPX, INS_DCP_ABS, INS_DCP_ABSX,
+                            INS_DCP_ABSY, INS_DCP_INDX, INS_DCP_INDY},
+                 std::array{INS_ISC_ZP, INS_ISC_ZPX, INS_ISC_ABS, INS_ISC_ABSX,
+                            INS_ISC_ABSY, INS_ISC_INDX, INS_ISC_INDY},
+             }) {
+            r[zp] = 5;
+            r[zpx] = 6;
+            r[abs] = 6;
+            r[absx] = 7;
+            r[absy] = 7;
+            r[indx] = 8;
+            r[indy] = 8;
+        }
+
+        r[INS_SAX_ZP] = 3;
+        r[INS_SAX_ZPY] = 4;
+        r[INS_SAX_ABS] = 4;
+        r[INS_SAX_INDX] = 6;
+
+        r[INS_LAX_ZP] = 3;
+        r[INS_LAX_ZPY] = 4;
+        r[INS_LAX_ABS] = 4;
+        r[INS_LAX_ABSY] = 4;
+        r[INS_LAX_INDX] = 6;
+        r[INS_LAX_INDY] = 5;
+
+        for (auto op : {INS_ANC_IM, INS_ANC_IM2, INS_ALR_IM, INS_ARR_IM, INS_SBX_IM,
+                        INS_SBC_IM2}) {
+            r[op] = 2;
+        }
+
+        for (auto op : kNopImplied) {
+            r[op] = 2;
+        }
+        for (auto op : kNopIM) {
+            r[op] = 2;
+        }
+        for (auto op : kNopZP) {
+            r[op] = 3;
+        }
+        for (auto op : kNopZPX) {
+            r[op] = 4;
+        }
+        r[INS_NOP_ABS] = 4;
+        for (auto op : kNopABSX) {
+            r[op] = 4;
+        }
+    }
+
+    return r;
+}
+
+} // namespace emu::emu6502::cpu
@@ -1,16 +1,23 @@
 #pragma once
 
 #include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/cpu/decimal_arithmetic.hpp"
 #include "emu_core/memory.hpp"
 #include "memory_addressing.hpp"
+#include <array>
 #include <emu_core/clock.hpp>
 
 namespace emu::emu6502::cpu::instructions {
 
 using Flags = Registers::Flags;
 
-using MemAddrFunc = MemPtr (*)(Cpu *cpu);
-using MemReadFunc = uint8_t (*)(Cpu *cpu);
+// Handlers get the register file to work on, registers of the cpu or a copy which an
+// execution loop keeps in locals
+using RegisterHandlerPtr = void (*)(Cpu *cpu, Registers &reg);
+using RegisterHandlerArray = std::array<RegisterHandlerPtr, 256>;
+
+using MemAddrFunc = MemPtr (*)(Cpu *cpu, Registers &reg);
+using MemReadFunc = uint8_t (*)(Cpu *cpu, Registers &reg);
 using Reg8Ptr = Reg8(Registers::*);
 
 //-----------------------------------------------------------------------------
@@ -25,83 +32,134 @@ bool IsAcrossPage(MemPtr base, OffType inc) {
 
 //-----------------------------------------------------------------------------
 
-void NOP(Cpu *cpu) {
-    cpu->WaitForNextCycle();
+template <typename B>
+EMU6502_ALWAYS_INLINE void NOP(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
 }
 
-template <MemReadFunc read_func>
-void HLT(Cpu *cpu) {
-    auto value = read_func(cpu);
-    throw ExecutionHalted(cpu->reg, value);
+template <typename B, MemReadFunc read_func>
+EMU6502_ALWAYS_INLINE void HLT(Cpu *cpu, Registers &reg) {
+    auto value = read_func(cpu, reg);
+    cpu->Stop(ExecutionStatus::Halted, value);
 }
 
 template <uint8_t opcode>
-void InvalidOpcode(Cpu *cpu) {
-    throw InvalidOpcodeException(cpu->reg, opcode);
+EMU6502_ALWAYS_INLINE void InvalidOpcode(Cpu *cpu, Registers & /*reg*/) {
+    cpu->Stop(ExecutionStatus::InvalidOpcode, opcode);
+}
+
+template <typename B>
+EMU6502_ALWAYS_INLINE void STP(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    ImpliedCycle<B>(cpu, reg);
+    cpu->Stop(ExecutionStatus::Halted);
+}
+
+template <typename B>
+EMU6502_ALWAYS_INLINE void WAI(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    ImpliedCycle<B>(cpu, reg);
+    if (!cpu->WaitForInterrupt()) {
+        --reg.program_counter;
+    }
 }
 
 //-----------------------------------------------------------------------------
 
-template <Reg8Ptr target, MemReadFunc read_func>
-void Register8Load(Cpu *cpu) {
-    auto value = read_func(cpu);
-    cpu->reg.*target = value;
-    cpu->reg.SetNegativeZeroFlag(value);
+template <typename B, Reg8Ptr target, MemReadFunc read_func>
+EMU6502_ALWAYS_INLINE void Register8Load(Cpu *cpu, Registers &reg) {
+    auto value = read_func(cpu, reg);
+    reg.*target = value;
+    reg.SetNegativeZeroFlag(value);
 }
 
-template <Reg8Ptr target, MemAddrFunc addr_func>
-void Register8Store(Cpu *cpu) {
-    auto value = cpu->reg.*target;
-    cpu->memory->Store(addr_func(cpu), value);
+template <typename B, Reg8Ptr target, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void Register8Store(Cpu *cpu, Registers &reg) {
+    auto value = reg.*target;
+    StoreOperand<B, addr_func>(cpu, addr_func(cpu, reg), value);
 }
 
-template <Reg8Ptr source, Reg8Ptr target, bool set_flags = true>
-void Register8Transfer(Cpu *cpu) {
-    auto value = cpu->reg.*source;
+template <typename B, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void StoreZero(Cpu *cpu, Registers &reg) {
+    StoreOperand<B, addr_func>(cpu, addr_func(cpu, reg), 0);
+}
+
+template <typename B, Reg8Ptr source, Reg8Ptr target, bool set_flags = true>
+EMU6502_ALWAYS_INLINE void Register8Transfer(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    auto value = reg.*source;
     if constexpr (set_flags) {
-        cpu->reg.SetNegativeZeroFlag(value);
+        reg.SetNegativeZeroFlag(value);
     }
-    cpu->reg.*target = value;
-    cpu->WaitForNextCycle();
+    reg.*target = value;
 }
 
-template <Reg8Ptr source, int8_t direction>
-void Register8Increment(Cpu *cpu) {
-    auto value = cpu->reg.*source;
+template <typename B, Reg8Ptr source, int8_t direction>
+EMU6502_ALWAYS_INLINE void Register8Increment(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    auto value = reg.*source;
     if constexpr (direction > 0) {
         ++value;
     } else {
         --value;
     }
-    cpu->reg.SetNegativeZeroFlag(value);
-    cpu->reg.*source = value;
-    cpu->WaitForNextCycle();
+    reg.SetNegativeZeroFlag(value);
+    reg.*source = value;
 }
 
 //-----------------------------------------------------------------------------
 
-template <MemAddrFunc addr_func, int8_t direction>
-void MemoryIncrement(Cpu *cpu) {
-    auto addr = addr_func(cpu);
-    auto value = cpu->memory->Load(addr);
+template <typename B, MemAddrFunc addr_func, int8_t direction>
+EMU6502_ALWAYS_INLINE void MemoryIncrement(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto value = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, value);
     if constexpr (direction > 0) {
         ++value;
     } else {
         --value;
     }
-    cpu->reg.SetNegativeZeroFlag(value);
-    cpu->WaitForNextCycle();
-    cpu->memory->Store(addr, value);
+    reg.SetNegativeZeroFlag(value);
+    StoreOperand<B, addr_func>(cpu, addr, value);
+}
+
+// TSB/TRB, Z flag is set from A & memory before bits of A are set or reset
+template <typename B, MemAddrFunc addr_func, bool set>
+EMU6502_ALWAYS_INLINE void TestAndModifyBits(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto value = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, value);
+    reg.SetFlag(Flags::Zero, (reg.a & value) == 0);
+    if constexpr (set) {
+        value |= reg.a;
+    } else {
+        value &= ~reg.a;
+    }
+    StoreOperand<B, addr_func>(cpu, addr, value);
+}
+
+// RMB/SMB
+template <typename B, uint8_t bit, bool set>
+EMU6502_ALWAYS_INLINE void MemoryBit(Cpu *cpu, Registers &reg) {
+    auto addr = kAddressZP<B>(cpu, reg);
+    auto value = B::LoadDirect(cpu, addr);
+    ModifyCycle<B>(cpu, addr, value);
+    if constexpr (set) {
+        value |= 1 << bit;
+    } else {
+        value &= ~(1 << bit);
+    }
+    B::StoreDirect(cpu, addr, value);
 }
 
 //-----------------------------------------------------------------------------
 
-template <Reg8Ptr source, MemReadFunc read_func>
-void Register8Compare(Cpu *cpu) {
-    auto src = cpu->reg.*source;
-    auto operand = read_func(cpu);
-    cpu->reg.SetNegativeZeroFlag(src - operand);
-    cpu->reg.SetFlag(Flags::Carry, src >= operand);
+template <typename B, Reg8Ptr source, MemReadFunc read_func>
+EMU6502_ALWAYS_INLINE void Register8Compare(Cpu *cpu, Registers &reg) {
+    auto src = reg.*source;
+    auto operand = read_func(cpu, reg);
+    reg.SetNegativeZeroFlag(src - operand);
+    reg.SetFlag(Flags::Carry, src >= operand);
 }
 
 //-----------------------------------------------------------------------------
@@ -133,228 +191,436 @@ struct Operation {
     }
 };
 
-template <LogicFunc op, MemReadFunc read_func>
-void LogicalOperation(Cpu *cpu) {
-    auto operand = read_func(cpu);
-    auto result = op(cpu->reg.a, operand);
-    cpu->reg.SetNegativeZeroFlag(result);
-    cpu->reg.a = result;
-}
-
-template <LogicFunc op, MemReadFunc read_func>
-void BitOperation(Cpu *cpu) {
-    auto operand = read_func(cpu);
-    auto result = op(cpu->reg.a, operand);
-    cpu->reg.SetNegativeZeroFlag(result);
-    cpu->reg.SetFlag(Registers::Flags::Zero, result == 0);
-    cpu->reg.SetFlag(Registers::Flags::Negative, (operand & 0x80) > 0);
-    cpu->reg.SetFlag(Registers::Flags::Overflow, (operand & 0x40) > 0);
-}
-
-template <Reg8Ptr source, ShiftFunc op>
-void Register8Shift(Cpu *cpu) {
-    auto operand = cpu->reg.*source;
-    cpu->WaitForNextCycle();
-    auto [result, new_carry] = op(operand, cpu->reg.TestFlag(Flags::Carry));
-    cpu->reg.SetNegativeZeroFlag(result);
-    cpu->reg.SetFlag(Flags::Carry, new_carry);
-    cpu->reg.*source = result;
-}
-
-template <ShiftFunc op, MemAddrFunc addr_func>
-void MemoryShift(Cpu *cpu) {
-    auto addr = addr_func(cpu);
-    auto operand = cpu->memory->Load(addr);
-    cpu->WaitForNextCycle();
-    auto [result, new_carry] = op(operand, cpu->reg.TestFlag(Flags::Carry));
-    cpu->reg.SetNegativeZeroFlag(result);
-    cpu->reg.SetFlag(Flags::Carry, new_carry);
-    cpu->memory->Store(addr, result);
+template <typename B, LogicFunc op, MemReadFunc read_func>
+EMU6502_ALWAYS_INLINE void LogicalOperation(Cpu *cpu, Registers &reg) {
+    auto operand = read_func(cpu, reg);
+    auto result = op(reg.a, operand);
+    reg.SetNegativeZeroFlag(result);
+    reg.a = result;
+}
+
+// Immediate BIT (65C02) sets only Z flag
+template <typename B, LogicFunc op, MemReadFunc read_func, bool immediate = false>
+EMU6502_ALWAYS_INLINE void BitOperation(Cpu *cpu, Registers &reg) {
+    auto operand = read_func(cpu, reg);
+    auto result = op(reg.a, operand);
+    reg.SetFlag(Registers::Flags::Zero, result == 0);
+    if constexpr (!immediate) {
+        reg.SetFlag(Registers::Flags::Negative, (operand & 0x80) > 0);
+        reg.SetFlag(Registers::Flags::Overflow, (operand & 0x40) > 0);
+    }
+}
+
+template <typename B, Reg8Ptr source, ShiftFunc op>
+EMU6502_ALWAYS_INLINE void Register8Shift(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    auto operand = reg.*source;
+    auto [result, new_carry] = op(operand, reg.TestFlag(Flags::Carry));
+    reg.SetNegativeZeroFlag(result);
+    reg.SetFlag(Flags::Carry, new_carry);
+    reg.*source = result;
+}
+
+template <typename B, ShiftFunc op, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void MemoryShift(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto operand = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, operand);
+    auto [result, new_carry] = op(operand, reg.TestFlag(Flags::Carry));
+    reg.SetNegativeZeroFlag(result);
+    reg.SetFlag(Flags::Carry, new_carry);
+    StoreOperand<B, addr_func>(cpu, addr, result);
 }
 
 //-----------------------------------------------------------------------------
 
-template <MemReadFunc read_func, bool subtract = false>
-void ArithmeticOperation(Cpu *cpu) {
-    auto operand = read_func(cpu);
-    if (cpu->reg.TestFlag(Flags::DecimalMode)) {
-        throw std::runtime_error("Decimal mode is not implemented (yet)");
+template <bool subtract>
+EMU6502_ALWAYS_INLINE void AddWithCarry(Registers &reg, uint8_t operand) {
+    if (reg.TestFlag(Flags::DecimalMode)) {
+        const auto &result =
+            subtract ? DecimalSubtract(reg.a, operand, reg.CarryValue())
+                     : DecimalAdd(reg.a, operand, reg.CarryValue());
+        reg.a = result.value;
+        reg.SetArithmeticFlags(result.flags);
     } else {
-        uint16_t result = cpu->reg.a;
+        // a - operand - borrow == a + ~operand + carry
         if constexpr (subtract) {
-            result -= operand;
-            result -= (1 - cpu->reg.CarryValue());
             operand = ~operand;
-        } else {
-            result += operand;
-            result += cpu->reg.CarryValue();
         }
+        const uint8_t a = reg.a;
+        const uint16_t sum = a + operand + reg.CarryValue();
+        reg.a = sum & 0xFF;
+        reg.SetAdditionFlags(a, operand, sum);
+    }
+}
 
-        bool overflow = ((cpu->reg.a ^ operand) & kNegativeBit) == 0 &&
-                        ((result ^ operand) & kNegativeBit) != 0;
-
-        cpu->reg.a = result & 0xFF;
-        cpu->reg.SetNegativeZeroFlag(cpu->reg.a);
-        cpu->reg.SetFlag(Flags::Negative, (result & 0x80) != 0);
-        cpu->reg.SetFlag(Flags::Carry, subtract != (result > 0xFF));
-        cpu->reg.SetFlag(Flags::Overflow, overflow);
+// 65C02 spends one cycle more in decimal mode (decimal_cycle), it reads the next byte
+template <typename B, MemReadFunc read_func, bool subtract = false,
+          bool decimal_cycle = false>
+EMU6502_ALWAYS_INLINE void ArithmeticOperation(Cpu *cpu, Registers &reg) {
+    AddWithCarry<subtract>(reg, read_func(cpu, reg));
+    if constexpr (decimal_cycle) {
+        if (reg.TestFlag(Flags::DecimalMode)) {
+            cpu->AddCycles(1);
+            B::DummyLoad(cpu, reg.program_counter);
+        }
     }
 }
 
 //-----------------------------------------------------------------------------
+// NMOS undocumented
+
+// SLO, RLA, SRE: shift memory, then combine the result with the accumulator
+template <typename B, ShiftFunc shift, LogicFunc op, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void ShiftLogical(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto operand = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, operand);
+    auto [value, new_carry] = shift(operand, reg.TestFlag(Flags::Carry));
+    StoreOperand<B, addr_func>(cpu, addr, value);
+    reg.SetFlag(Flags::Carry, new_carry);
+    reg.a = op(reg.a, value);
+    reg.SetNegativeZeroFlag(reg.a);
+}
+
+// RRA: ROR memory, then ADC with the carry shifted out
+template <typename B, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void RotateAdd(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto operand = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, operand);
+    auto [value, new_carry] = Operation::ROR(operand, reg.TestFlag(Flags::Carry));
+    StoreOperand<B, addr_func>(cpu, addr, value);
+    reg.SetFlag(Flags::Carry, new_carry);
+    AddWithCarry<false>(reg, value);
+}
+
+// DCP: DEC memory, then CMP
+template <typename B, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void DecrementCompare(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto operand = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, operand);
+    uint8_t value = operand - 1;
+    StoreOperand<B, addr_func>(cpu, addr, value);
+    reg.SetNegativeZeroFlag(reg.a - value);
+    reg.SetFlag(Flags::Carry, reg.a >= value);
+}
+
+// ISC: INC memory, then SBC
+template <typename B, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void IncrementSubtract(Cpu *cpu, Registers &reg) {
+    auto addr = addr_func(cpu, reg);
+    auto operand = LoadOperand<B, addr_func>(cpu, addr);
+    ModifyCycle<B>(cpu, addr, operand);
+    uint8_t value = operand + 1;
+    StoreOperand<B, addr_func>(cpu, addr, value);
+    AddWithCarry<true>(reg, value);
+}
+
+template <typename B, MemReadFunc read_func>
+EMU6502_ALWAYS_INLINE void LoadAX(Cpu *cpu, Registers &reg) {
+    auto value = read_func(cpu, reg);
+    reg.SetNegativeZeroFlag(value);
+    reg.a = value;
+    reg.x = value;
+}
+
+template <typename B, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE void StoreAX(Cpu *cpu, Registers &reg) {
+    StoreOperand<B, addr_func>(cpu, addr_func(cpu, reg), reg.a & reg.x);
+}
+
+// ANC: AND, carry is a copy of the negative flag
+template <typename B>
+EMU6502_ALWAYS_INLINE void AndCarry(Cpu *cpu, Registers &reg) {
+    reg.a &= FetchNextByte<B>(cpu, reg);
+    reg.SetNegativeZeroFlag(reg.a);
+    reg.SetFlag(Flags::Carry, (reg.a & kMSB) != 0);
+}
+
+// ALR: AND, then LSR A
+template <typename B>
+EMU6502_ALWAYS_INLINE void AndShiftRight(Cpu *cpu, Registers &reg) {
+    auto [value, new_carry] = Operation::LSR(reg.a & FetchNextByte<B>(cpu, reg), false);
+    reg.SetNegativeZeroFlag(value);
+    reg.SetFlag(Flags::Carry, new_carry);
+    reg.a = value;
+}
 
-template <Flags flag, bool state>
-void SetFlag(Cpu *cpu) {
-    cpu->WaitForNextCycle();
-    cpu->reg.SetFlag(flag, state);
+// ARR: AND, then ROR A, C and V come from bits 6 and 5 of the result. Decimal mode
+// variant is not modelled.
+template <typename B>
+EMU6502_ALWAYS_INLINE void AndRotateRight(Cpu *cpu, Registers &reg) {
+    auto [value, new_carry] = Operation::ROR(reg.a & FetchNextByte<B>(cpu, reg),
+                                             reg.TestFlag(Flags::Carry));
+    reg.SetNegativeZeroFlag(value);
+    reg.SetFlag(Flags::Carry, (value & 0x40) != 0);
+    reg.SetFlag(Flags::Overflow, (((value >> 6) ^ (value >> 5)) & 1) != 0);
+    reg.a = value;
+}
+
+// SBX: X = (A & X) - operand, flags as CMP
+template <typename B>
+EMU6502_ALWAYS_INLINE void SubtractX(Cpu *cpu, Registers &reg) {
+    uint8_t ax = reg.a & reg.x;
+    auto operand = FetchNextByte<B>(cpu, reg);
+    reg.x = ax - operand;
+    reg.SetNegativeZeroFlag(reg.x);
+    reg.SetFlag(Flags::Carry, ax >= operand);
+}
+
+// NOP with an operand, the read is done as on the hardware
+template <typename B, MemReadFunc read_func>
+EMU6502_ALWAYS_INLINE void ReadNOP(Cpu *cpu, Registers &reg) {
+    (void)read_func(cpu, reg);
 }
 
 //-----------------------------------------------------------------------------
 
-template <bool reuse_cycle = false>
-void StackPushByte(Cpu *cpu, uint8_t v) {
-    cpu->memory->Store(cpu->reg.StackPointerMemoryAddress(), v);
-    if (!reuse_cycle) {
-        cpu->WaitForNextCycle();
-    }
-    cpu->reg.stack_pointer--;
+template <typename B, Flags flag, bool state>
+EMU6502_ALWAYS_INLINE void SetFlag(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    reg.SetFlag(flag, state);
 }
 
-template <bool reuse_cycle = false>
-uint8_t StackPullByte(Cpu *cpu) {
-    cpu->reg.stack_pointer++;
-    auto operand = cpu->memory->Load(cpu->reg.StackPointerMemoryAddress());
-    if (!reuse_cycle) {
-        cpu->WaitForNextCycle();
-    }
-    return operand;
+template <typename B>
+EMU6502_ALWAYS_INLINE void ClearInterruptFlag(Cpu *cpu, Registers &reg) {
+    SetFlag<B, Flags::IRQB, false>(cpu, reg);
+    cpu->OnInterruptFlagCleared();
 }
 
 //-----------------------------------------------------------------------------
 
-template <Reg8Ptr source>
-void StackPush(Cpu *cpu) {
-    StackPushByte(cpu, cpu->reg.*source);
+template <typename B>
+EMU6502_ALWAYS_INLINE void StackPushByte(Cpu *cpu, Registers &reg, uint8_t v) {
+    B::StoreDirect(cpu, reg.StackPointerMemoryAddress(), v);
+    reg.stack_pointer--;
 }
 
-template <Reg8Ptr source>
-void StackPull(Cpu *cpu) {
-    auto operand = StackPullByte(cpu);
-    cpu->WaitForNextCycle();
-    cpu->reg.SetNegativeZeroFlag(operand);
-    cpu->reg.*source = operand;
+template <typename B>
+EMU6502_ALWAYS_INLINE uint8_t StackPullByte(Cpu *cpu, Registers &reg) {
+    reg.stack_pointer++;
+    return B::LoadDirect(cpu, reg.StackPointerMemoryAddress());
 }
 
-void PushFlags(Cpu *cpu) {
-    uint8_t operand = cpu->reg.flags | static_cast<uint8_t>(Flags::Brk) |
+// Pulls read the stack before the stack pointer is incremented
+template <typename B>
+EMU6502_ALWAYS_INLINE void StackPullCycles(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    B::DummyLoad(cpu, reg.StackPointerMemoryAddress());
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename B, Reg8Ptr source>
+EMU6502_ALWAYS_INLINE void StackPush(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    StackPushByte<B>(cpu, reg, reg.*source);
+}
+
+template <typename B, Reg8Ptr source>
+EMU6502_ALWAYS_INLINE void StackPull(Cpu *cpu, Registers &reg) {
+    StackPullCycles<B>(cpu, reg);
+    auto operand = StackPullByte<B>(cpu, reg);
+    reg.SetNegativeZeroFlag(operand);
+    reg.*source = operand;
+}
+
+template <typename B>
+EMU6502_ALWAYS_INLINE void PushFlags(Cpu *cpu, Registers &reg) {
+    ImpliedCycle<B>(cpu, reg);
+    uint8_t operand = reg.flags | static_cast<uint8_t>(Flags::Brk) |
                       static_cast<uint8_t>(Flags::NotUsed);
-    StackPushByte(cpu, operand);
+    StackPushByte<B>(cpu, reg, operand);
 }
 
-template <bool reuse_cycle = false>
-void PullFlags(Cpu *cpu) {
-    auto operand = StackPullByte(cpu);
-    cpu->reg.flags = operand;
-    cpu->reg.SetFlag(Flags::Brk, false);
-    cpu->reg.SetFlag(Flags::NotUsed, false);
-    if (!reuse_cycle) {
-        cpu->WaitForNextCycle();
+template <typename B>
+EMU6502_ALWAYS_INLINE void PullFlagsByte(Cpu *cpu, Registers &reg) {
+    auto operand = StackPullByte<B>(cpu, reg);
+    reg.flags = operand;
+    reg.SetFlag(Flags::Brk, false);
+    reg.SetFlag(Flags::NotUsed, false);
+    if (!reg.TestFlag(Flags::IRQB)) {
+        cpu->OnInterruptFlagCleared();
     }
 }
 
+template <typename B>
+EMU6502_ALWAYS_INLINE void PullFlags(Cpu *cpu, Registers &reg) {
+    StackPullCycles<B>(cpu, reg);
+    PullFlagsByte<B>(cpu, reg);
+}
+
 //-----------------------------------------------------------------------------
 
-template <Registers::Flags flag, bool state>
-void Branch(Cpu *cpu) {
-    auto offset_address = static_cast<int8_t>(FetchNextByte(cpu));
-    if (cpu->reg.TestFlag(flag) == state) {
-        cpu->WaitForNextCycle();
-        if (IsAcrossPage(cpu->reg.program_counter, offset_address)) {
-            cpu->WaitForNextCycle();
-        }
-        cpu->reg.program_counter += offset_address;
+template <typename B>
+EMU6502_ALWAYS_INLINE void TakeBranch(Cpu *cpu, Registers &reg, int8_t offset) {
+    const MemPtr target = reg.program_counter + offset;
+    B::DummyLoad(cpu, reg.program_counter);
+    if (IsAcrossPage(reg.program_counter, offset)) {
+        cpu->AddCycles(2);
+        B::DummyLoad(cpu, (reg.program_counter & 0xFF00) | (target & 0x00FF));
+    } else {
+        cpu->AddCycles(1);
     }
+    reg.program_counter = target;
 }
 
-void JumpABS(Cpu *cpu) {
-    auto addr = GetAbsoluteAddress(cpu);
-    cpu->reg.program_counter = addr;
+template <typename B, Registers::Flags flag, bool state>
+EMU6502_ALWAYS_INLINE void Branch(Cpu *cpu, Registers &reg) {
+    auto offset_address = static_cast<int8_t>(FetchNextByte<B>(cpu, reg));
+    if (reg.TestFlag(flag) == state) {
+        TakeBranch<B>(cpu, reg, offset_address);
+    }
 }
 
-void JumpIND(Cpu *cpu) {
-    auto addr = GetAbsoluteAddress(cpu);
-    MemPtr fetched_address = cpu->memory->Load(addr);
-    addr = (addr & 0xFF00) | ((addr + 1) & 0xFF);
-    fetched_address |= cpu->memory->Load(addr) << 8;
-    cpu->reg.program_counter = fetched_address;
-}
-
-void JSR(Cpu *cpu) {
-    auto addr = GetAbsoluteAddress(cpu);
-    cpu->reg.program_counter -= 1;
-    StackPushByte<false>(cpu, cpu->reg.program_counter >> 8);
-    StackPushByte<true>(cpu, cpu->reg.program_counter & 0xff);
-    cpu->reg.program_counter = addr;
-}
-
-template <bool inc_pc = true, bool reuse_cycle = false>
-void RTS(Cpu *cpu) {
-    uint16_t low = StackPullByte<reuse_cycle>(cpu);
-    uint16_t hi = StackPullByte<reuse_cycle>(cpu);
-    cpu->WaitForNextCycle();
-    cpu->reg.program_counter = (hi << 8 | low);
-    if (inc_pc) {
-        ++cpu->reg.program_counter;
+template <typename B>
+EMU6502_ALWAYS_INLINE void BranchAlways(Cpu *cpu, Registers &reg) {
+    TakeBranch<B>(cpu, reg, static_cast<int8_t>(FetchNextByte<B>(cpu, reg)));
+}
+
+// BBR/BBS, branch when bit of the zero page byte has the state
+template <typename B, uint8_t bit, bool state>
+EMU6502_ALWAYS_INLINE void BranchOnBit(Cpu *cpu, Registers &reg) {
+    auto addr = kAddressZP<B>(cpu, reg);
+    auto value = B::LoadDirect(cpu, addr);
+    B::DummyLoad(cpu, addr);
+    auto offset_address = static_cast<int8_t>(FetchNextByte<B>(cpu, reg));
+    if (((value & (1 << bit)) != 0) == state) {
+        TakeBranch<B>(cpu, reg, offset_address);
+    }
+}
+
+template <typename B>
+EMU6502_ALWAYS_INLINE void JumpABS(Cpu *cpu, Registers &reg) {
+    auto addr = GetAbsoluteAddress<B>(cpu, reg);
+    reg.program_counter = addr;
+}
+
+// NMOS cpu does not carry into the high byte of the pointer, 65C02 does
+template <typename B, bool page_wrap = true>
+EMU6502_ALWAYS_INLINE void JumpIND(Cpu *cpu, Registers &reg) {
+    if constexpr (!page_wrap) {
+        reg.program_counter = GetAddressAbsoluteIndirect<B>(cpu, reg);
+        return;
     }
+    auto addr = GetAbsoluteAddress<B>(cpu, reg);
+    MemPtr fetched_address = B::Load(cpu, addr);
+    addr = (addr & 0xFF00) | ((addr + 1) & 0xFF);
+    fetched_address |= B::Load(cpu, addr) << 8;
+    reg.program_counter = fetched_address;
+}
+
+template <typename B>
+EMU6502_ALWAYS_INLINE void JumpABSXIND(Cpu *cpu, Registers &reg) {
+    reg.program_counter = GetAddressAbsoluteIndexedIndirectWithX<B>(cpu, reg);
+}
+
+// Return address (high byte of the target) is pushed before the high byte is fetched
+template <typename B>
+EMU6502_ALWAYS_INLINE void JSR(Cpu *cpu, Registers &reg) {
+    MemPtr addr = FetchNextByte<B>(cpu, reg);
+    B::DummyLoad(cpu, reg.StackPointerMemoryAddress());
+    StackPushByte<B>(cpu, reg, reg.program_counter >> 8);
+    StackPushByte<B>(cpu, reg, reg.program_counter & 0xff);
+    addr |= FetchNextByte<B>(cpu, reg) << 8;
+    reg.program_counter = addr;
+    cpu->OnSubroutineCall(addr);
+}
+
+template <typename B>
+EMU6502_ALWAYS_INLINE void PullProgramCounter(Cpu *cpu, Registers &reg) {
+    uint16_t low = StackPullByte<B>(cpu, reg);
+    uint16_t hi = StackPullByte<B>(cpu, reg);
+    reg.program_counter = (hi << 8 | low);
+}
+
+// Pulled address is read once more before it is incremented
+template <typename B>
+EMU6502_ALWAYS_INLINE void RTS(Cpu *cpu, Registers &reg) {
+    StackPullCycles<B>(cpu, reg);
+    PullProgramCounter<B>(cpu, reg);
+    B::DummyLoad(cpu, reg.program_counter);
+    ++reg.program_counter;
 }
 
-void RTI(Cpu *cpu) {
-    PullFlags<true>(cpu);
-    RTS<false, true>(cpu);
+template <typename B>
+EMU6502_ALWAYS_INLINE void RTI(Cpu *cpu, Registers &reg) {
+    StackPullCycles<B>(cpu, reg);
+    PullFlagsByte<B>(cpu, reg);
+    PullProgramCounter<B>(cpu, reg);
 }
 
-void BRK(Cpu *cpu) {
-    (void)FetchNextByte(cpu);
+template <typename B>
+EMU6502_ALWAYS_INLINE void BRK(Cpu *cpu, Registers &reg) {
+    (void)FetchNextByte<B>(cpu, reg);
     cpu->SetInterruptPending(Interrupt::Brk);
 }
 
+// 65C02 also clears D flag, so handlers start in binary mode
+template <typename B, InstructionSet kInstructionSet>
 void HandleInterrupt(Cpu *cpu, const Interrupt &interrupt) {
-    StackPushByte<true>(cpu, cpu->reg.program_counter >> 8);
-    StackPushByte<true>(cpu, cpu->reg.program_counter & 0xff);
+    auto &reg = cpu->reg;
+    if (interrupt != Interrupt::Brk) {
+        // Opcode fetch which is dropped, PC is not incremented. BRK has made these
+        // reads itself.
+        B::DummyLoad(cpu, reg.program_counter);
+        B::DummyLoad(cpu, reg.program_counter);
+    }
+    StackPushByte<B>(cpu, reg, reg.program_counter >> 8);
+    StackPushByte<B>(cpu, reg, reg.program_counter & 0xff);
     auto mode = interrupt;
-    uint8_t operand = cpu->reg.flags | static_cast<uint8_t>(Flags::NotUsed);
+    uint8_t operand = reg.flags | static_cast<uint8_t>(Flags::NotUsed);
     if (mode == Interrupt::Brk) {
         operand |= static_cast<uint8_t>(Flags::Brk);
     }
-    StackPushByte<true>(cpu, operand);
+    StackPushByte<B>(cpu, reg, operand);
     auto addr = InterruptHandlerAddress(mode);
 
-    cpu->reg.SetFlag(Flags::IRQB, true);
-    cpu->reg.program_counter = addr;
-    JumpABS(cpu);
+    reg.SetFlag(Flags::IRQB, true);
+    if constexpr (kInstructionSet == InstructionSet::CMOS65C02) {
+        reg.SetFlag(Flags::DecimalMode, false);
+    }
+    reg.program_counter = addr;
+    JumpABS<B>(cpu, reg);
 }
 
 //-----------------------------------------------------------------------------
 
-template <MemAddrFunc addr_func>
-uint8_t FetchMemory(Cpu *cpu) {
-    return cpu->memory->Load(addr_func(cpu));
+template <typename B, MemAddrFunc addr_func>
+EMU6502_ALWAYS_INLINE uint8_t FetchMemory(Cpu *cpu, Registers &reg) {
+    return LoadOperand<B, addr_func>(cpu, addr_func(cpu, reg));
 }
 
-constexpr auto kFetchIM = &FetchNextByte;
-constexpr auto kFetchZP = &FetchMemory<kAddressZP>;
-constexpr auto kFetchZPX = &FetchMemory<kAddressZPX>;
-constexpr auto kFetchZPY = &FetchMemory<kAddressZPY>;
-constexpr auto kFetchABS = &FetchMemory<kAddressABS>;
-
-constexpr auto kFetchABSX = &FetchMemory<kAddressABSX>;
-constexpr auto kFetchABSY = &FetchMemory<kAddressABSY>;
-constexpr auto kFetchFastABSX = &FetchMemory<kAddressFastABSX>;
-constexpr auto kFetchFastABSY = &FetchMemory<kAddressFastABSY>;
-
-constexpr auto kFetchINDX = &FetchMemory<kAddressINDX>;
-constexpr auto kFetchINDY = &FetchMemory<kAddressINDY>;
-
-constexpr auto kFetchAcc = &FetchAccumulator;
+template <typename B>
+constexpr auto kFetchIM = &FetchNextByte<B>;
+template <typename B>
+constexpr auto kFetchZP = &FetchMemory<B, kAddressZP<B>>;
+template <typename B>
+constexpr auto kFetchZPX = &FetchMemory<B, kAddressZPX<B>>;
+template <typename B>
+constexpr auto kFetchZPY = &FetchMemory<B, kAddressZPY<B>>;
+template <typename B>
+constexpr auto kFetchABS = &FetchMemory<B, kAddressABS<B>>;
+
+template <typename B>
+constexpr auto kFetchABSX = &FetchMemory<B, kAddressABSX<B>>;
+template <typename B>
+constexpr auto kFetchABSY = &FetchMemory<B, kAddressABSY<B>>;
+template <typename B>
+constexpr auto kFetchFastABSX = &FetchMemory<B, kAddressFastABSX<B>>;
+template <typename B>
+constexpr auto kFetchFastABSY = &FetchMemory<B, kAddressFastABSY<B>>;
+
+template <typename B>
+constexpr auto kFetchINDX = &FetchMemory<B, kAddressINDX<B>>;
+template <typename B>
+constexpr auto kFetchINDY = &FetchMemory<B, kAddressINDY<B>>;
+template <typename B>
+constexpr auto kFetchZPIND = &FetchMemory<B, kAddressZPIND<B>>;
+
+template <typename B>
+constexpr auto kFetchAcc = &FetchAccumulator<B>;
 
 } // namespace emu::emu6502::cpu::instructions
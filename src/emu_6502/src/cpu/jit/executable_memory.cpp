@@ -0,0 +1,67 @@
+#include "executable_memory.hpp"
+#include "jit_compiler.hpp"
+#include <cstring>
+#include <fmt/format.h>
+#include <stdexcept>
+
+#if EMU6502_JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+namespace emu::emu6502::cpu::jit {
+
+namespace {
+constexpr size_t kCodeAlignment = 16;
+constexpr size_t kPageSize = 4096;
+}
+
+ExecutableMemory::ExecutableMemory(size_t capacity) : capacity(capacity) {
+#if EMU6502_JIT_SUPPORTED
+    void *mem = mmap(nullptr, capacity, PROT_READ | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw std::runtime_error(
+            fmt::format("Failed to allocate {} bytes of executable memory", capacity));
+    }
+    base = static_cast<uint8_t *>(mem);
+#else
+    throw std::runtime_error("Executable memory is not supported on this platform");
+#endif
+}
+
+ExecutableMemory::~ExecutableMemory() {
+#if EMU6502_JIT_SUPPORTED
+    munmap(base, capacity);
+#endif
+}
+
+const void *ExecutableMemory::Append(const std::vector<uint8_t> &code) {
+    auto offset = (used + kCodeAlignment - 1) & ~(kCodeAlignment - 1);
+    if (offset + code.size() > capacity) {
+        full = true;
+        return nullptr;
+    }
+
+#if EMU6502_JIT_SUPPORTED
+    // Only pages touched by the new code change protection
+    auto first_page = offset & ~(kPageSize - 1);
+    auto length = offset + code.size() - first_page;
+    if (mprotect(base + first_page, length, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("Failed to make generated code writable");
+    }
+    std::memcpy(base + offset, code.data(), code.size());
+    if (mprotect(base + first_page, length, PROT_READ | PROT_EXEC) != 0) {
+        throw std::runtime_error("Failed to make generated code executable");
+    }
+#endif
+
+    used = offset + code.size();
+    return base + offset;
+}
+
+void ExecutableMemory::Clear() {
+    used = 0;
+    full = false;
+}
+
+} // namespace emu::emu6502::cpu::jit
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace emu::emu6502::cpu::jit {
+
+// Fixed size arena for generated code. Pages are writable only while code is appended.
+class ExecutableMemory {
+public:
+    explicit ExecutableMemory(size_t capacity);
+    ~ExecutableMemory();
+
+    ExecutableMemory(const ExecutableMemory &) = delete;
+    ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+
+    // Returns executable copy of the code or nullptr if there is no space left
+    const void *Append(const std::vector<uint8_t> &code);
+    void Clear();
+
+    [[nodiscard]] size_t Used() const { return used; }
+    [[nodiscard]] bool IsFull() const { return full; }
+
+private:
+    uint8_t *base = nullptr;
+    size_t capacity;
+    size_t used = 0;
+    bool full = false;
+};
+
+} // namespace emu::emu6502::cpu::jit
@@ -0,0 +1,960 @@
+#include "jit_compiler.hpp"
+#include "cpu/memory_addressing.hpp"
+#include "emu_6502/cpu/opcode.hpp"
+#include "executable_memory.hpp"
+#include "x86_64_emitter.hpp"
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace emu::emu6502::cpu::jit {
+
+namespace {
+
+using Reg = X86Emitter::Reg;
+using Flags = Registers::Flags;
+
+constexpr size_t kCodeMemorySize = 4 * 1024 * 1024;
+
+// Host register assignment, all of them are callee saved so they survive helper calls
+constexpr Reg kCpu = X86Emitter::RBX;
+constexpr Reg kRegisters = X86Emitter::R12;
+constexpr Reg kA = X86Emitter::R13;
+constexpr Reg kX = X86Emitter::R14;
+constexpr Reg kY = X86Emitter::R15;
+constexpr Reg kP = X86Emitter::RBP;
+
+// Stack slots for values which have to survive helper calls
+constexpr int32_t kAddressSlot = 0;
+constexpr int32_t kValueSlot = 4;
+constexpr int32_t kLowByteSlot = 8;
+constexpr int32_t kEventSlot = 12; // kHelperEventDue of helper calls in the block
+constexpr uint8_t kFrameSize = 24; // keeps rsp 16 byte aligned at helper calls
+
+constexpr uint32_t kHelperFailed = 0x100;
+constexpr uint32_t kHelperEventDue = 0x200;
+
+constexpr uint8_t Flag(Flags flag) {
+    return static_cast<uint8_t>(flag);
+}
+
+// Mask which clears given flags
+template <typename... T>
+constexpr uint32_t ClearMask(T... flags) {
+    return ~static_cast<uint32_t>((Flag(flags) | ...));
+}
+
+//-----------------------------------------------------------------------------
+
+thread_local std::exception_ptr pending_error;
+// Next event when the block was entered, see JitCompiler::Run
+thread_local uint64_t entry_event_cycle = 0;
+
+// Memory access has raised an IRQ, woken the scheduler or scheduled an event inside
+// the block
+uint32_t EventDue(Cpu *cpu) {
+    return cpu->Scheduler().NextEventCycle() < entry_event_cycle ? kHelperEventDue : 0;
+}
+
+uint32_t JitLoad(Cpu *cpu, uint32_t address) noexcept {
+    try {
+        return instructions::ErasedBus::LoadDirect(cpu, static_cast<MemPtr>(address)) |
+               EventDue(cpu);
+    } catch (...) {
+        pending_error = std::current_exception();
+        return kHelperFailed;
+    }
+}
+
+uint32_t JitStore(Cpu *cpu, uint32_t address, uint32_t value) noexcept {
+    try {
+        instructions::ErasedBus::StoreDirect(cpu, static_cast<MemPtr>(address),
+                                             static_cast<uint8_t>(value));
+        return EventDue(cpu);
+    } catch (...) {
+        pending_error = std::current_exception();
+        return kHelperFailed;
+    }
+}
+
+uint32_t JitInterruptFlagCleared(Cpu *cpu) noexcept {
+    return cpu->OnInterruptFlagCleared() ? kHelperEventDue : 0;
+}
+
+void JitAddCycles(Cpu *cpu, uint32_t cycles) noexcept {
+    cpu->AddCycles(cycles);
+}
+
+//-----------------------------------------------------------------------------
+
+enum class Mode {
+    Implied,
+    Immediate,
+    ZP,
+    ZPX,
+    ZPY,
+    ABS,
+    ABSX,
+    ABSY,
+    INDX,
+    INDY,
+    Relative,
+};
+
+enum class Op {
+    Load,
+    Store,
+    Adc,
+    Sbc,
+    And,
+    Ora,
+    Eor,
+    Compare,
+    Bit,
+    MemoryIncrement,
+    MemoryDecrement,
+    Asl,
+    Lsr,
+    Rol,
+    Ror,
+    Transfer,
+    TransferFromStack,
+    TransferToStack,
+    Increment,
+    Decrement,
+    SetFlag,
+    ClearFlag,
+    Push,
+    PushFlags,
+    Pull,
+    PullFlags,
+    Nop,
+    Branch,
+    Jump,
+};
+
+struct Translation {
+    Op op;
+    Mode mode = Mode::Implied;
+    Reg reg = kA;    // register which is loaded, stored, compared, incremented, ...
+    Reg source = kA; // source register of Transfer
+    uint8_t flag = 0;
+    bool state = false;      // Branch is taken when flag is in this state
+    bool slow_index = false; // index cycle is in base cost, no page cross penalty
+};
+
+// Mirrors handler table from cpu.cpp
+std::optional<Translation> GetTranslation(Opcode opcode,
+                                          InstructionSet instruction_set) {
+    using namespace opcode;
+    using enum Op;
+    using M = Mode;
+    // 65C02 shifts a,x pay the index cycle only when page is crossed
+    const bool nmos = instruction_set != InstructionSet::CMOS65C02;
+
+    switch (opcode) {
+    // clang-format off
+    case INS_LDA_IM: return Translation{Load, M::Immediate, kA};
+    case INS_LDA_ZP: return Translation{Load, M::ZP, kA};
+    case INS_LDA_ZPX: return Translation{Load, M::ZPX, kA};
+    case INS_LDA_ABS: return Translation{Load, M::ABS, kA};
+    case INS_LDA_ABSX: return Translation{Load, M::ABSX, kA};
+    case INS_LDA_ABSY: return Translation{Load, M::ABSY, kA};
+    case INS_LDA_INDX: return Translation{Load, M::INDX, kA};
+    case INS_LDA_INDY: return Translation{Load, M::INDY, kA};
+    case INS_LDX_IM: return Translation{Load, M::Immediate, kX};
+    case INS_LDX_ZP: return Translation{Load, M::ZP, kX};
+    case INS_LDX_ZPY: return Translation{Load, M::ZPY, kX};
+    case INS_LDX_ABS: return Translation{Load, M::ABS, kX};
+    case INS_LDX_ABSY: return Translation{Load, M::ABSY, kX};
+    case INS_LDY_IM: return Translation{Load, M::Immediate, kY};
+    case INS_LDY_ZP: return Translation{Load, M::ZP, kY};
+    case INS_LDY_ZPX: return Translation{Load, M::ZPX, kY};
+    case INS_LDY_ABS: return Translation{Load, M::ABS, kY};
+    case INS_LDY_ABSX: return Translation{Load, M::ABSX, kY};
+
+    case INS_STA_ZP: return Translation{Store, M::ZP, kA};
+    case INS_STA_ZPX: return Translation{Store, M::ZPX, kA};
+    case INS_STA_ABS: return Translation{Store, M::ABS, kA};
+    case INS_STA_ABSX: return Translation{.op = Store, .mode = M::ABSX, .slow_index = true};
+    case INS_STA_ABSY: return Translation{.op = Store, .mode = M::ABSY, .slow_index = true};
+    case INS_STA_INDX: return Translation{Store, M::INDX, kA};
+    case INS_STA_INDY: return Translation{.op = Store, .mode = M::INDY, .slow_index = true};
+    case INS_STX_ZP: return Translation{Store, M::ZP, kX};
+    case INS_STX_ZPY: return Translation{Store, M::ZPY, kX};
+    case INS_STX_ABS: return Translation{Store, M::ABS, kX};
+    case INS_STY_ZP: return Translation{Store, M::ZP, kY};
+    case INS_STY_ZPX: return Translation{Store, M::ZPX, kY};
+    case INS_STY_ABS: return Translation{Store, M::ABS, kY};
+
+    case INS_DEC_ZP: return Translation{MemoryDecrement, M::ZP};
+    case INS_DEC_ZPX: return Translation{MemoryDecrement, M::ZPX};
+    case INS_DEC_ABS: return Translation{MemoryDecrement, M::ABS};
+    case INS_DEC_ABSX: return Translation{.op = MemoryDecrement, .mode = M::ABSX, .slow_index = true};
+    case INS_INC_ZP: return Translation{MemoryIncrement, M::ZP};
+    case INS_INC_ZPX: return Translation{MemoryIncrement, M::ZPX};
+    case INS_INC_ABS: return Translation{MemoryIncrement, M::ABS};
+    case INS_INC_ABSX: return Translation{.op = MemoryIncrement, .mode = M::ABSX, .slow_index = true};
+
+    case INS_TAX: return Translation{.op = Transfer, .reg = kX, .source = kA};
+    case INS_TAY: return Translation{.op = Transfer, .reg = kY, .source = kA};
+    case INS_TXA: return Translation{.op = Transfer, .reg = kA, .source = kX};
+    case INS_TYA: return Translation{.op = Transfer, .reg = kA, .source = kY};
+    case INS_TSX: return Translation{.op = TransferFromStack, .reg = kX};
+    case INS_TXS: return Translation{.op = TransferToStack, .reg = kX};
+
+    case INS_INX: return Translation{.op = Increment, .reg = kX};
+    case INS_INY: return Translation{.op = Increment, .reg = kY};
+    case INS_DEX: return Translation{.op = Decrement, .reg = kX};
+    case INS_DEY: return Translation{.op = Decrement, .reg = kY};
+
+    case INS_ADC: return Translation{Adc, M::Immediate};
+    case INS_ADC_ZP: return Translation{Adc, M::ZP};
+    case INS_ADC_ZPX: return Translation{Adc, M::ZPX};
+    case INS_ADC_ABS: return Translation{Adc, M::ABS};
+    case INS_ADC_ABSX: return Translation{Adc, M::ABSX};
+    case INS_ADC_ABSY: return Translation{Adc, M::ABSY};
+    case INS_ADC_INDX: return Translation{Adc, M::INDX};
+    case INS_ADC_INDY: return Translation{Adc, M::INDY};
+    case INS_SBC: return Translation{Sbc, M::Immediate};
+    case INS_SBC_ZP: return Translation{Sbc, M::ZP};
+    case INS_SBC_ZPX: return Translation{Sbc, M::ZPX};
+    case INS_SBC_ABS: return Translation{Sbc, M::ABS};
+    case INS_SBC_ABSX: return Translation{Sbc, M::ABSX};
+    case INS_SBC_ABSY: return Translation{Sbc, M::ABSY};
+    case INS_SBC_INDX: return Translation{Sbc, M::INDX};
+    case INS_SBC_INDY: return Translation{Sbc, M::INDY};
+
+    case INS_CMP: return Translation{Compare, M::Immediate, kA};
+    case INS_CMP_ZP: return Translation{Compare, M::ZP, kA};
+    case INS_CMP_ZPX: return Translation{Compare, M::ZPX, kA};
+    case INS_CMP_ABS: return Translation{Compare, M::ABS, kA};
+    case INS_CMP_ABSX: return Translation{Compare, M::ABSX, kA};
+    case INS_CMP_ABSY: return Translation{Compare, M::ABSY, kA};
+    case INS_CMP_INDX: return Translation{Compare, M::INDX, kA};
+    case INS_CMP_INDY: return Translation{Compare, M::INDY, kA};
+    case INS_CPX: return Translation{Compare, M::Immediate, kX};
+    case INS_CPX_ZP: return Translation{Compare, M::ZP, kX};
+    case INS_CPX_ABS: return Translation{Compare, M::ABS, kX};
+    case INS_CPY: return Translation{Compare, M::Immediate, kY};
+    case INS_CPY_ZP: return Translation{Compare, M::ZP, kY};
+    case INS_CPY_ABS: return Translation{Compare, M::ABS, kY};
+
+    case INS_BCC: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Carry), .state = false};
+    case INS_BCS: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Carry), .state = true};
+    case INS_BEQ: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Zero), .state = true};
+    case INS_BNE: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Zero), .state = false};
+    case INS_BMI: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Negative), .state = true};
+    case INS_BPL: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Negative), .state = false};
+    case INS_BVC: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Overflow), .state = false};
+    case INS_BVS: return Translation{.op = Branch, .mode = M::Relative, .flag = Flag(Flags::Overflow), .state = true};
+    case INS_JMP_ABS: return Translation{Jump, M::ABS};
+
+    case INS_AND_IM: return Translation{And, M::Immediate};
+    case INS_AND_ZP: return Translation{And, M::ZP};
+    case INS_AND_ZPX: return Translation{And, M::ZPX};
+    case INS_AND_ABS: return Translation{And, M::ABS};
+    case INS_AND_ABSX: return Translation{And, M::ABSX};
+    case INS_AND_ABSY: return Translation{And, M::ABSY};
+    case INS_AND_INDX: return Translation{And, M::INDX};
+    case INS_AND_INDY: return Translation{And, M::INDY};
+    case INS_ORA_IM: return Translation{Ora, M::Immediate};
+    case INS_ORA_ZP: return Translation{Ora, M::ZP};
+    case INS_ORA_ZPX: return Translation{Ora, M::ZPX};
+    case INS_ORA_ABS: return Translation{Ora, M::ABS};
+    case INS_ORA_ABSX: return Translation{Ora, M::ABSX};
+    case INS_ORA_ABSY: return Translation{Ora, M::ABSY};
+    case INS_ORA_INDX: return Translation{Ora, M::INDX};
+    case INS_ORA_INDY: return Translation{Ora, M::INDY};
+    case INS_EOR_IM: return Translation{Eor, M::Immediate};
+    case INS_EOR_ZP: return Translation{Eor, M::ZP};
+    case INS_EOR_ZPX: return Translation{Eor, M::ZPX};
+    case INS_EOR_ABS: return Translation{Eor, M::ABS};
+    case INS_EOR_ABSX: return Translation{Eor, M::ABSX};
+    case INS_EOR_ABSY: return Translation{Eor, M::ABSY};
+    case INS_EOR_INDX: return Translation{Eor, M::INDX};
+    case INS_EOR_INDY: return Translation{Eor, M::INDY};
+
+    case INS_CLC: return Translation{.op = ClearFlag, .flag = Flag(Flags::Carry)};
+    case INS_SEC: return Translation{.op = SetFlag, .flag = Flag(Flags::Carry)};
+    case INS_CLD: return Translation{.op = ClearFlag, .flag = Flag(Flags::DecimalMode)};
+    case INS_SED: return Translation{.op = SetFlag, .flag = Flag(Flags::DecimalMode)};
+    case INS_CLI: return Translation{.op = ClearFlag, .flag = Flag(Flags::IRQB)};
+    case INS_SEI: return Translation{.op = SetFlag, .flag = Flag(Flags::IRQB)};
+    case INS_CLV: return Translation{.op = ClearFlag, .flag = Flag(Flags::Overflow)};
+
+    case INS_ASL: return Translation{Asl};
+    case INS_ASL_ZP: return Translation{Asl, M::ZP};
+    case INS_ASL_ZPX: return Translation{Asl, M::ZPX};
+    case INS_ASL_ABS: return Translation{Asl, M::ABS};
+    case INS_ASL_ABSX: return Translation{.op = Asl, .mode = M::ABSX, .slow_index = nmos};
+    case INS_LSR: return Translation{Lsr};
+    case INS_LSR_ZP: return Translation{Lsr, M::ZP};
+    case INS_LSR_ZPX: return Translation{Lsr, M::ZPX};
+    case INS_LSR_ABS: return Translation{Lsr, M::ABS};
+    case INS_LSR_ABSX: return Translation{.op = Lsr, .mode = M::ABSX, .slow_index = nmos};
+    case INS_ROL: return Translation{Rol};
+    case INS_ROL_ZP: return Translation{Rol, M::ZP};
+    case INS_ROL_ZPX: return Translation{Rol, M::ZPX};
+    case INS_ROL_ABS: return Translation{Rol, M::ABS};
+    case INS_ROL_ABSX: return Translation{.op = Rol, .mode = M::ABSX, .slow_index = nmos};
+    case INS_ROR: return Translation{Ror};
+    case INS_ROR_ZP: return Translation{Ror, M::ZP};
+    case INS_ROR_ZPX: return Translation{Ror, M::ZPX};
+    case INS_ROR_ABS: return Translation{Ror, M::ABS};
+    case INS_ROR_ABSX: return Translation{.op = Ror, .mode = M::ABSX, .slow_index = nmos};
+
+    case INS_PHA: return Translation{Push};
+    case INS_PLA: return Translation{Pull};
+    case INS_PHP: return Translation{PushFlags};
+    case INS_PLP: return Translation{PullFlags};
+
+    case INS_BIT_ZP: return Translation{Bit, M::ZP};
+    case INS_BIT_ABS: return Translation{Bit, M::ABS};
+
+    case INS_NOP: return Translation{Nop};
+        // clang-format on
+
+    default:
+        return std::nullopt;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+class BlockTranslator {
+public:
+    BlockTranslator(const DecodedBlock &block, InstructionSet instruction_set)
+        : block(block), instruction_set(instruction_set) {}
+
+    // Returns false when not even the first instruction has a translation
+    bool Translate() {
+        EmitPrologue();
+
+        pc = block.start;
+        for (const auto &decoded : block.instructions) {
+            auto translation = GetTranslation(decoded.opcode, instruction_set);
+            if (!translation.has_value()) {
+                break;
+            }
+            instruction = &decoded;
+            next_pc = pc + decoded.length;
+            EmitInstruction(*translation);
+            ++index;
+            pc = next_pc;
+            if (translation->op == Op::Branch || translation->op == Op::Jump) {
+                break;
+            }
+        }
+        if (index == 0) {
+            return false;
+        }
+        if (!terminated) {
+            ExitAlways(pc, index, pending_cycles);
+        }
+
+        EmitExits();
+        EmitEpilogue();
+        return true;
+    }
+
+    [[nodiscard]] const std::vector<uint8_t> &Code() const { return e.Code(); }
+
+private:
+    struct Exit {
+        X86Emitter::Label label;
+        MemPtr pc;
+        uint32_t instructions;
+        uint32_t cycles;
+        bool failed;
+    };
+
+    X86Emitter e;
+    const DecodedBlock &block;
+    const InstructionSet instruction_set;
+    std::deque<Exit> exits;
+    X86Emitter::Label epilogue;
+
+    const DecodedInstruction *instruction = nullptr;
+    MemPtr pc = 0;
+    MemPtr next_pc = 0;
+    uint32_t index = 0;
+    uint32_t pending_cycles = 0;
+    bool store_done = false;
+    bool memory_accessed = false;
+    bool terminated = false;
+
+    [[nodiscard]] uint8_t Operand() const { return instruction->operand[0]; }
+    [[nodiscard]] MemPtr AbsoluteOperand() const {
+        return instruction->operand[0] | (instruction->operand[1] << 8);
+    }
+
+    //-------------------------------------------------------------------------
+
+    void EmitPrologue() {
+        using X = X86Emitter;
+        for (auto reg : {X::RBX, X::RBP, X::R12, X::R13, X::R14, X::R15}) {
+            e.Push(reg);
+        }
+        e.SubRsp(kFrameSize);
+        e.Alu(X::kXor, X::RAX, X::RAX);
+        e.StoreDword(X::RSP, kEventSlot, X::RAX);
+        e.Mov64(kCpu, X86Emitter::RDI);
+        e.Mov64(kRegisters, X86Emitter::RSI);
+        e.LoadByte(kA, kRegisters, offsetof(Registers, a));
+        e.LoadByte(kX, kRegisters, offsetof(Registers, x));
+        e.LoadByte(kY, kRegisters, offsetof(Registers, y));
+        e.LoadByte(kP, kRegisters, offsetof(Registers, flags));
+    }
+
+    void EmitEpilogue() {
+        e.Bind(epilogue);
+        e.StoreByte(kRegisters, offsetof(Registers, a), kA);
+        e.StoreByte(kRegisters, offsetof(Registers, x), kX);
+        e.StoreByte(kRegisters, offsetof(Registers, y), kY);
+        e.StoreByte(kRegisters, offsetof(Registers, flags), kP);
+        e.AddRsp(kFrameSize);
+        using X = X86Emitter;
+        for (auto reg : {X::R15, X::R14, X::R13, X::R12, X::RBP, X::RBX}) {
+            e.Pop(reg);
+        }
+        e.Ret();
+    }
+
+    Exit &AddExit(MemPtr exit_pc, uint32_t instructions, uint32_t cycles,
+                  bool failed = false) {
+        return exits.emplace_back(Exit{
+            .label = {},
+            .pc = exit_pc,
+            .instructions = instructions,
+            .cycles = cycles,
+            .failed = failed,
+        });
+    }
+
+    void ExitIf(X86Emitter::Condition condition, MemPtr exit_pc, uint32_t instructions,
+                uint32_t cycles, bool failed = false) {
+        e.JumpIf(condition, AddExit(exit_pc, instructions, cycles, failed).label);
+    }
+
+    void ExitAlways(MemPtr exit_pc, uint32_t instructions, uint32_t cycles) {
+        e.Jump(AddExit(exit_pc, instructions, cycles).label);
+        terminated = true;
+    }
+
+    void EmitExits() {
+        for (auto &exit : exits) {
+            e.Bind(exit.label);
+            if (exit.cycles > 0) {
+                e.Mov64(X86Emitter::RDI, kCpu);
+                e.MovImm(X86Emitter::RSI, exit.cycles);
+                e.Call(&JitAddCycles);
+            }
+            e.StoreWordImm(kRegisters, offsetof(Registers, program_counter), exit.pc);
+            e.MovImm(X86Emitter::RAX,
+                     exit.instructions | (exit.failed ? JitExit::kFailedBit : 0));
+            e.Jump(epilogue);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+
+    // Flushes pending cycles plus one more when low byte of indexed address in ecx has
+    // crossed the page
+    void FlushWithPageCross() {
+        e.AluImm(X86Emitter::kCmp, X86Emitter::RCX, 0x100);
+        e.MovImm(X86Emitter::RSI, pending_cycles);
+        // rsi += 1 - carry, carry is set when ecx < 0x100
+        e.AluImm(X86Emitter::kSbb, X86Emitter::RSI, 0xFFFFFFFF);
+        e.Mov64(X86Emitter::RDI, kCpu);
+        e.Call(&JitAddCycles);
+        pending_cycles = 0;
+    }
+
+    void FailOnHelperError() {
+        e.TestImm(X86Emitter::RAX, kHelperFailed);
+        ExitIf(X86Emitter::kNotZero, next_pc, index + 1, pending_cycles, true);
+    }
+
+    // Keeps kHelperEventDue of helper result in eax in the event slot
+    void RecordEventDue() {
+        using X = X86Emitter;
+        e.Mov(X::RCX, X::RAX);
+        e.AluImm(X::kAnd, X::RCX, kHelperEventDue);
+        e.LoadDword(X::RDX, X::RSP, kEventSlot);
+        e.Alu(X::kOr, X::RDX, X::RCX);
+        e.StoreDword(X::RSP, kEventSlot, X::RDX);
+        memory_accessed = true;
+    }
+
+    // Loads byte from address in esi into eax
+    void EmitLoad() {
+        e.Mov64(X86Emitter::RDI, kCpu);
+        e.Call(&JitLoad);
+        FailOnHelperError();
+        RecordEventDue();
+        e.AluImm(X86Emitter::kAnd, X86Emitter::RAX, 0xFF);
+    }
+
+    // Stores value to address in esi
+    void EmitStore(Reg value) {
+        e.Mov(X86Emitter::RDX, value);
+        e.Mov64(X86Emitter::RDI, kCpu);
+        e.Call(&JitStore);
+        FailOnHelperError();
+        RecordEventDue();
+        store_done = true;
+    }
+
+    // Leaves the block after the current instruction when it has written into the
+    // block's own code pages, so the interpreter decodes it again
+    void EmitCodeStoreCheck() {
+        e.LoadDword(X86Emitter::RCX, X86Emitter::RSP, kAddressSlot);
+        e.Shr(X86Emitter::RCX, 8);
+        e.AluImm(X86Emitter::kCmp, X86Emitter::RCX, block.FirstPage());
+        ExitIf(X86Emitter::kZero, next_pc, index + 1, pending_cycles);
+        e.AluImm(X86Emitter::kCmp, X86Emitter::RCX, block.NextPage());
+        ExitIf(X86Emitter::kZero, next_pc, index + 1, pending_cycles);
+    }
+
+    // Leaves the block after the current instruction when one of its memory accesses
+    // has brought the next event forward, the cpu loop handles it
+    void EmitEventCheck() {
+        e.LoadDword(X86Emitter::RCX, X86Emitter::RSP, kEventSlot);
+        e.TestImm(X86Emitter::RCX, kHelperEventDue);
+        ExitIf(X86Emitter::kNotZero, next_pc, index + 1, pending_cycles);
+    }
+
+    // CLI and PLP which leave I flag clear end the block after the instruction when an
+    // IRQ has waited for it
+    void EmitInterruptFlagCheck() {
+        X86Emitter::Label flag_set;
+        e.TestImm(kP, Flag(Flags::IRQB));
+        e.JumpIf(X86Emitter::kNotZero, flag_set);
+        e.Mov64(X86Emitter::RDI, kCpu);
+        e.Call(&JitInterruptFlagCleared);
+        e.TestImm(X86Emitter::RAX, kHelperEventDue);
+        ExitIf(X86Emitter::kNotZero, next_pc, index + 1, pending_cycles);
+        e.Bind(flag_set);
+    }
+
+    // Effective address goes to esi and to the address slot
+    void EmitAddress(const Translation &t) {
+        using X = X86Emitter;
+        auto index_reg = (t.mode == Mode::ZPY || t.mode == Mode::ABSY) ? kY : kX;
+
+        switch (t.mode) {
+        case Mode::ZP:
+            e.MovImm(X::RSI, Operand());
+            break;
+        case Mode::ZPX:
+        case Mode::ZPY:
+            e.Mov(X::RSI, index_reg);
+            e.AluImm(X::kAdd, X::RSI, Operand());
+            e.AluImm(X::kAnd, X::RSI, 0xFF);
+            break;
+        case Mode::ABS:
+            e.MovImm(X::RSI, AbsoluteOperand());
+            break;
+        case Mode::ABSX:
+        case Mode::ABSY:
+            if (!t.slow_index) {
+                e.Mov(X::RCX, index_reg);
+                e.AluImm(X::kAdd, X::RCX, AbsoluteOperand() & 0xFF);
+                FlushWithPageCross();
+            }
+            e.Mov(X::RSI, index_reg);
+            e.AluImm(X::kAdd, X::RSI, AbsoluteOperand());
+            e.AluImm(X::kAnd, X::RSI, 0xFFFF);
+            break;
+        case Mode::INDX:
+            e.Mov(X::RSI, kX);
+            e.AluImm(X::kAdd, X::RSI, Operand());
+            e.AluImm(X::kAnd, X::RSI, 0xFF);
+            e.StoreDword(X::RSP, kAddressSlot, X::RSI);
+            EmitLoad();
+            e.StoreDword(X::RSP, kLowByteSlot, X::RAX);
+            e.LoadDword(X::RSI, X::RSP, kAddressSlot);
+            e.Inc(X::RSI);
+            e.AluImm(X::kAnd, X::RSI, 0xFF);
+            EmitLoad();
+            e.Shl(X::RAX, 8);
+            e.LoadDword(X::RCX, X::RSP, kLowByteSlot);
+            e.Alu(X::kOr, X::RAX, X::RCX);
+            e.Mov(X::RSI, X::RAX);
+            break;
+        case Mode::INDY:
+            e.MovImm(X::RSI, Operand());
+            EmitLoad();
+            e.StoreDword(X::RSP, kLowByteSlot, X::RAX);
+            e.MovImm(X::RSI, (Operand() + 1) & 0xFF);
+            EmitLoad();
+            e.Shl(X::RAX, 8);
+            e.LoadDword(X::RCX, X::RSP, kLowByteSlot);
+            e.Alu(X::kOr, X::RAX, X::RCX);
+            e.StoreDword(X::RSP, kAddressSlot, X::RAX);
+            if (!t.slow_index) {
+                e.LoadDword(X::RCX, X::RSP, kLowByteSlot);
+                e.Alu(X::kAdd, X::RCX, kY);
+                FlushWithPageCross();
+            }
+            e.LoadDword(X::RSI, X::RSP, kAddressSlot);
+            e.Alu(X::kAdd, X::RSI, kY);
+            e.AluImm(X::kAnd, X::RSI, 0xFFFF);
+            break;
+        case Mode::Implied:
+        case Mode::Immediate:
+        case Mode::Relative:
+            break;
+        }
+        e.StoreDword(X::RSP, kAddressSlot, X::RSI);
+    }
+
+    // Operand value goes to eax
+    void EmitOperand(const Translation &t) {
+        if (t.mode == Mode::Immediate) {
+            e.MovImm(X86Emitter::RAX, Operand());
+            return;
+        }
+        EmitAddress(t);
+        EmitLoad();
+    }
+
+    // Stores value kept in the value slot back to the address slot, used by
+    // read-modify-write instructions
+    void EmitWriteBack() {
+        e.LoadDword(X86Emitter::RSI, X86Emitter::RSP, kAddressSlot);
+        e.LoadDword(X86Emitter::RCX, X86Emitter::RSP, kValueSlot);
+        EmitStore(X86Emitter::RCX);
+    }
+
+    //-------------------------------------------------------------------------
+
+    // Updates N and Z from value (0-255), uses edx
+    void SetNegativeZero(Reg value) {
+        using X = X86Emitter;
+        e.AluImm(X::kAnd, kP, ClearMask(Flags::Negative, Flags::Zero));
+        e.Mov(X::RDX, value);
+        e.AluImm(X::kAnd, X::RDX, Flag(Flags::Negative));
+        e.Alu(X::kOr, kP, X::RDX);
+        e.Alu(X::kXor, X::RDX, X::RDX);
+        e.Test(value, value);
+        e.Set(X::kZero, X::RDX);
+        e.Shl(X::RDX, 1);
+        e.Alu(X::kOr, kP, X::RDX);
+    }
+
+    // Replaces carry with bit 0 of ecx
+    void SetCarryFromRcx() {
+        e.AluImm(X86Emitter::kAnd, kP, ClearMask(Flags::Carry));
+        e.Alu(X86Emitter::kOr, kP, X86Emitter::RCX);
+    }
+
+    // Arithmetic of A and eax, r8 = carry out, r9 = overflow
+    void EmitArithmetic(bool subtract) {
+        using X = X86Emitter;
+        e.Alu(X::kXor, X::R8, X::R8);
+        e.Alu(X::kXor, X::R9, X::R9);
+        e.Mov(X::RCX, kA);
+        e.BitTest(kP, 0);
+        if (subtract) {
+            e.Cmc();
+            e.Alu8(X::kSbb, X::RCX, X::RAX);
+            e.Set(X::kNoCarry, X::R8);
+        } else {
+            e.Alu8(X::kAdc, X::RCX, X::RAX);
+            e.Set(X::kCarry, X::R8);
+        }
+        e.Set(X::kOverflow, X::R9);
+        e.MovzxByte(kA, X::RCX);
+        e.AluImm(X::kAnd, kP, ClearMask(Flags::Carry, Flags::Overflow));
+        e.Alu(X::kOr, kP, X::R8);
+        e.Shl(X::R9, 6);
+        e.Alu(X::kOr, kP, X::R9);
+        SetNegativeZero(kA);
+    }
+
+    void EmitShift(Op op, Reg value) {
+        using X = X86Emitter;
+        switch (op) {
+        case Op::Asl:
+            e.Mov(X::RCX, value);
+            e.Shr(X::RCX, 7);
+            e.Shl(value, 1);
+            break;
+        case Op::Lsr:
+            e.Mov(X::RCX, value);
+            e.AluImm(X::kAnd, X::RCX, 1);
+            e.Shr(value, 1);
+            break;
+        case Op::Rol:
+            e.Mov(X::R8, kP);
+            e.AluImm(X::kAnd, X::R8, 1);
+            e.Mov(X::RCX, value);
+            e.Shr(X::RCX, 7);
+            e.Shl(value, 1);
+            e.Alu(X::kOr, value, X::R8);
+            break;
+        case Op::Ror:
+            e.Mov(X::R8, kP);
+            e.AluImm(X::kAnd, X::R8, 1);
+            e.Shl(X::R8, 7);
+            e.Mov(X::RCX, value);
+            e.AluImm(X::kAnd, X::RCX, 1);
+            e.Shr(value, 1);
+            e.Alu(X::kOr, value, X::R8);
+            break;
+        default:
+            break;
+        }
+        e.AluImm(X::kAnd, value, 0xFF);
+        SetCarryFromRcx();
+        SetNegativeZero(value);
+    }
+
+    void EmitStackAddress() {
+        e.MovzxByte(X86Emitter::RSI, X86Emitter::RCX);
+        e.AluImm(X86Emitter::kOr, X86Emitter::RSI, kStackBase);
+        e.StoreDword(X86Emitter::RSP, kAddressSlot, X86Emitter::RSI);
+    }
+
+    void EmitInstruction(const Translation &t) {
+        using X = X86Emitter;
+
+        if (t.op == Op::Adc || t.op == Op::Sbc) {
+            // Decimal mode is left to the interpreter
+            e.TestImm(kP, Flag(Flags::DecimalMode));
+            ExitIf(X::kNotZero, pc, index, pending_cycles);
+        }
+
+        // Base cost from the cycle table, like the cached engine does
+        pending_cycles += instruction->cycles;
+        store_done = false;
+        memory_accessed = false;
+
+        switch (t.op) {
+        case Op::Load:
+            if (t.mode == Mode::Immediate) {
+                e.MovImm(t.reg, Operand());
+            } else {
+                EmitOperand(t);
+                e.Mov(t.reg, X::RAX);
+            }
+            SetNegativeZero(t.reg);
+            break;
+        case Op::Store:
+            EmitAddress(t);
+            EmitStore(t.reg);
+            break;
+        case Op::Adc:
+        case Op::Sbc:
+            EmitOperand(t);
+            EmitArithmetic(t.op == Op::Sbc);
+            break;
+        case Op::And:
+        case Op::Ora:
+        case Op::Eor: {
+            EmitOperand(t);
+            auto alu = t.op == Op::And ? X::kAnd : (t.op == Op::Ora ? X::kOr : X::kXor);
+            e.Alu(alu, kA, X::RAX);
+            SetNegativeZero(kA);
+            break;
+        }
+        case Op::Compare:
+            EmitOperand(t);
+            e.Alu(X::kXor, X::R8, X::R8);
+            e.Mov(X::RCX, t.reg);
+            e.Alu8(X::kSub, X::RCX, X::RAX);
+            e.Set(X::kNoCarry, X::R8);
+            e.MovzxByte(X::RCX, X::RCX);
+            e.AluImm(X::kAnd, kP, ClearMask(Flags::Carry));
+            e.Alu(X::kOr, kP, X::R8);
+            SetNegativeZero(X::RCX);
+            break;
+        case Op::Bit:
+            EmitOperand(t);
+            e.AluImm(X::kAnd, kP,
+                     ClearMask(Flags::Negative, Flags::Overflow, Flags::Zero));
+            e.Mov(X::RCX, X::RAX);
+            e.AluImm(X::kAnd, X::RCX, Flag(Flags::Negative) | Flag(Flags::Overflow));
+            e.Alu(X::kOr, kP, X::RCX);
+            e.Alu(X::kXor, X::RDX, X::RDX);
+            e.Mov(X::RCX, X::RAX);
+            e.Alu(X::kAnd, X::RCX, kA);
+            e.Set(X::kZero, X::RDX);
+            e.Shl(X::RDX, 1);
+            e.Alu(X::kOr, kP, X::RDX);
+            break;
+        case Op::MemoryIncrement:
+        case Op::MemoryDecrement:
+            EmitAddress(t);
+            EmitLoad();
+            if (t.op == Op::MemoryIncrement) {
+                e.Inc(X::RAX);
+            } else {
+                e.Dec(X::RAX);
+            }
+            e.AluImm(X::kAnd, X::RAX, 0xFF);
+            SetNegativeZero(X::RAX);
+            e.StoreDword(X::RSP, kValueSlot, X::RAX);
+            EmitWriteBack();
+            break;
+        case Op::Asl:
+        case Op::Lsr:
+        case Op::Rol:
+        case Op::Ror:
+            if (t.mode == Mode::Implied) {
+                EmitShift(t.op, kA);
+            } else {
+                EmitAddress(t);
+                EmitLoad();
+                EmitShift(t.op, X::RAX);
+                e.StoreDword(X::RSP, kValueSlot, X::RAX);
+                EmitWriteBack();
+            }
+            break;
+        case Op::Transfer:
+            e.Mov(t.reg, t.source);
+            SetNegativeZero(t.reg);
+            break;
+        case Op::TransferFromStack:
+            e.LoadByte(t.reg, kRegisters, offsetof(Registers, stack_pointer));
+            SetNegativeZero(t.reg);
+            break;
+        case Op::TransferToStack:
+            e.StoreByte(kRegisters, offsetof(Registers, stack_pointer), t.reg);
+            break;
+        case Op::Increment:
+        case Op::Decrement:
+            if (t.op == Op::Increment) {
+                e.Inc(t.reg);
+            } else {
+                e.Dec(t.reg);
+            }
+            e.AluImm(X::kAnd, t.reg, 0xFF);
+            SetNegativeZero(t.reg);
+            break;
+        case Op::SetFlag:
+            e.AluImm(X::kOr, kP, t.flag);
+            break;
+        case Op::ClearFlag:
+            e.AluImm(X::kAnd, kP, ~static_cast<uint32_t>(t.flag));
+            if (t.flag == Flag(Flags::IRQB)) {
+                EmitInterruptFlagCheck();
+            }
+            break;
+        case Op::Push:
+        case Op::PushFlags:
+            e.LoadByte(X::RCX, kRegisters, offsetof(Registers, stack_pointer));
+            EmitStackAddress();
+            if (t.op == Op::Push) {
+                EmitStore(kA);
+            } else {
+                e.Mov(X::RCX, kP);
+                e.AluImm(X::kOr, X::RCX, Flag(Flags::Brk) | Flag(Flags::NotUsed));
+                EmitStore(X::RCX);
+            }
+            e.LoadByte(X::RCX, kRegisters, offsetof(Registers, stack_pointer));
+            e.Dec(X::RCX);
+            e.StoreByte(kRegisters, offsetof(Registers, stack_pointer), X::RCX);
+            break;
+        case Op::Pull:
+        case Op::PullFlags:
+            e.LoadByte(X::RCX, kRegisters, offsetof(Registers, stack_pointer));
+            e.Inc(X::RCX);
+            e.StoreByte(kRegisters, offsetof(Registers, stack_pointer), X::RCX);
+            EmitStackAddress();
+            EmitLoad();
+            if (t.op == Op::Pull) {
+                e.Mov(kA, X::RAX);
+                SetNegativeZero(kA);
+            } else {
+                e.Mov(kP, X::RAX);
+                e.AluImm(X::kAnd, kP, ClearMask(Flags::Brk, Flags::NotUsed));
+                EmitInterruptFlagCheck();
+            }
+            break;
+        case Op::Nop:
+            break;
+        case Op::Branch: {
+            MemPtr target = next_pc + static_cast<int8_t>(Operand());
+            bool page_crossed = (target >> 8) != (next_pc >> 8);
+            uint32_t taken_cycles = pending_cycles + 1 + (page_crossed ? 1 : 0);
+            e.TestImm(kP, t.flag);
+            ExitIf(t.state ? X::kNotZero : X::kZero, target, index + 1, taken_cycles);
+            ExitAlways(next_pc, index + 1, pending_cycles);
+            break;
+        }
+        case Op::Jump:
+            ExitAlways(AbsoluteOperand(), index + 1, pending_cycles);
+            break;
+        }
+
+        if (store_done) {
+            EmitCodeStoreCheck();
+        }
+        if (memory_accessed) {
+            EmitEventCheck();
+        }
+    }
+};
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+JitCompiler::JitCompiler(InstructionSet instruction_set)
+    : instruction_set(instruction_set),
+      code_memory(std::make_unique<ExecutableMemory>(kCodeMemorySize)) {
+}
+
+JitCompiler::~JitCompiler() = default;
+
+JitFunction JitCompiler::Compile(const DecodedBlock &block) {
+    // Translated opcodes are the NMOS ones, 65C02 runs them the same way but for shift
+    // cycles, see GetTranslation
+    switch (instruction_set) {
+    case InstructionSet::NMOS6502:
+    case InstructionSet::NMOS6502Emu:
+    case InstructionSet::CMOS65C02:
+    case InstructionSet::NMOS6502Undocumented:
+        break;
+    default:
+        return nullptr;
+    }
+
+    BlockTranslator translator{block, instruction_set};
+    if (!translator.Translate()) {
+        return nullptr;
+    }
+
+    const auto *code = code_memory->Append(translator.Code());
+    if (code == nullptr) {
+        return nullptr;
+    }
+    ++compiled_blocks;
+    return reinterpret_cast<JitFunction>(code);
+}
+
+void JitCompiler::Reset() {
+    code_memory->Clear();
+}
+
+bool JitCompiler::IsFull() const {
+    return code_memory->IsFull();
+}
+
+JitExit JitCompiler::Run(JitFunction function, Cpu *cpu, Registers *reg) {
+    entry_event_cycle = cpu->Scheduler().NextEventCycle();
+    return JitExit::Unpack(function(cpu, reg));
+}
+
+void JitCompiler::RethrowPendingError() {
+    if (pending_error) {
+        std::rethrow_exception(std::exchange(pending_error, nullptr));
+    }
+}
+
+} // namespace emu::emu6502::cpu::jit
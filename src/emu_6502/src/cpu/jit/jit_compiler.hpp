@@ -0,0 +1,67 @@
+#pragma once
+
+#include "cpu/block_cache.hpp"
+#include "emu_6502/instruction_set.hpp"
+
+#include <cstdint>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define EMU6502_JIT_SUPPORTED 1
+#else
+#define EMU6502_JIT_SUPPORTED 0
+#endif
+
+namespace emu::emu6502::cpu::jit {
+
+class ExecutableMemory;
+
+// Value returned by JitFunction
+struct JitExit {
+    uint32_t instructions; // executed instructions, including the one which failed
+    bool failed;           // memory access or clock has thrown, see RethrowPendingError
+
+    static constexpr uint32_t kFailedBit = 0x10000;
+
+    static JitExit Unpack(uint32_t v) {
+        return {.instructions = v & 0xFFFF, .failed = (v & kFailedBit) != 0};
+    }
+};
+
+// Translates hot blocks to x86-64 code. A/X/Y and flags live in host registers for the
+// whole block, memory and clock are reached through calls to Memory16 and Clock, so
+// timing matches the cached engine. Translation stops before the first instruction
+// without native version (JSR, RTS, RTI, JMP (ind), BRK, HLT, invalid opcodes), those
+// are left to the interpreter together with decimal mode ADC/SBC.
+class JitCompiler {
+public:
+    explicit JitCompiler(InstructionSet instruction_set);
+    ~JitCompiler();
+
+    [[nodiscard]] static bool IsSupported() { return EMU6502_JIT_SUPPORTED != 0; }
+
+    // Returns nullptr when first instruction of the block can not be translated or
+    // when code memory is full
+    JitFunction Compile(const DecodedBlock &block);
+
+    // All functions returned so far become invalid
+    void Reset();
+
+    [[nodiscard]] bool IsFull() const;
+    [[nodiscard]] uint64_t CompiledBlocks() const { return compiled_blocks; }
+
+    // Runs compiled block. Block leaves after an instruction whose memory access has
+    // brought the next event forward (raised IRQ, woke the scheduler).
+    static JitExit Run(JitFunction function, Cpu *cpu, Registers *reg);
+
+    // Memory and clock exceptions can not unwind through generated code, they are
+    // stored and thrown again after the JitFunction returns
+    static void RethrowPendingError();
+
+private:
+    const InstructionSet instruction_set;
+    std::unique_ptr<ExecutableMemory> code_memory;
+    uint64_t compiled_blocks = 0;
+};
+
+} // namespace emu::emu6502::cpu::jit
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace emu::emu6502::cpu::jit {
+
+// Minimal x86-64 machine code writer, covers only what JitCompiler emits. All register
+// operations are 32 bit wide unless the name says otherwise.
+class X86Emitter {
+public:
+    enum Reg : uint8_t {
+        RAX = 0,
+        RCX,
+        RDX,
+        RBX,
+        RSP,
+        RBP,
+        RSI,
+        RDI,
+        R8,
+        R9,
+        R10,
+        R11,
+        R12,
+        R13,
+        R14,
+        R15,
+    };
+
+    enum Condition : uint8_t {
+        kOverflow = 0x0,
+        kCarry = 0x2,
+        kNoCarry = 0x3,
+        kZero = 0x4,
+        kNotZero = 0x5,
+        kSign = 0x8,
+    };
+
+    // Opcode of the "op r/m32, r32" form, the immediate form uses (op >> 3) as extension
+    enum AluOp : uint8_t {
+        kAdd = 0x01,
+        kOr = 0x09,
+        kAdc = 0x11,
+        kSbb = 0x19,
+        kAnd = 0x21,
+        kSub = 0x29,
+        kXor = 0x31,
+        kCmp = 0x39,
+    };
+
+    struct Label {
+        std::optional<size_t> position;
+        std::vector<size_t> fixups;
+    };
+
+    [[nodiscard]] const std::vector<uint8_t> &Code() const { return code; }
+
+    void Alu(AluOp op, Reg dst, Reg src) { RegReg(op, src, dst); }
+    void Alu8(AluOp op, Reg dst, Reg src) {
+        RegReg(op - 1, src, dst, IsByteRexReg(src) || IsByteRexReg(dst));
+    }
+    void AluImm(AluOp op, Reg dst, uint32_t imm) {
+        RegReg(0x81, static_cast<Reg>(op >> 3), dst);
+        Dword(imm);
+    }
+    void Test(Reg dst, Reg src) { RegReg(0x85, src, dst); }
+    void TestImm(Reg dst, uint32_t imm) {
+        RegReg(0xF7, RAX, dst);
+        Dword(imm);
+    }
+
+    void Mov(Reg dst, Reg src) { RegReg(0x89, src, dst); }
+    void Mov64(Reg dst, Reg src) { RegReg(0x89, src, dst, false, true); }
+    void MovImm(Reg dst, uint32_t imm) {
+        Rex(false, RAX, dst);
+        Byte(0xB8 + (dst & 7));
+        Dword(imm);
+    }
+    void MovImm64(Reg dst, uint64_t imm) {
+        Rex(true, RAX, dst);
+        Byte(0xB8 + (dst & 7));
+        Dword(static_cast<uint32_t>(imm));
+        Dword(static_cast<uint32_t>(imm >> 32));
+    }
+    void MovzxByte(Reg dst, Reg src) {
+        Rex(false, dst, src, IsByteRexReg(src));
+        Byte(0x0F);
+        Byte(0xB6);
+        ModRm(dst, src);
+    }
+
+    void Shl(Reg dst, uint8_t count) { Shift(4, dst, count); }
+    void Shr(Reg dst, uint8_t count) { Shift(5, dst, count); }
+    void Inc(Reg dst) { RegReg(0xFF, RAX, dst); }
+    void Dec(Reg dst) { RegReg(0xFF, RCX, dst); }
+
+    // bt dst, bit: copies the bit into the carry flag
+    void BitTest(Reg dst, uint8_t bit) {
+        Rex(false, RAX, dst);
+        Byte(0x0F);
+        Byte(0xBA);
+        ModRm(RSP, dst); // extension 4
+        Byte(bit);
+    }
+    void Cmc() { Byte(0xF5); }
+    void Set(Condition condition, Reg dst) {
+        Rex(false, RAX, dst, IsByteRexReg(dst));
+        Byte(0x0F);
+        Byte(0x90 + condition);
+        ModRm(RAX, dst);
+    }
+
+    // movzx dst, byte [base + disp]
+    void LoadByte(Reg dst, Reg base, int32_t disp) {
+        Rex(false, dst, base);
+        Byte(0x0F);
+        Byte(0xB6);
+        Memory(dst, base, disp);
+    }
+    // mov byte [base + disp], src
+    void StoreByte(Reg base, int32_t disp, Reg src) {
+        Rex(false, src, base, IsByteRexReg(src));
+        Byte(0x88);
+        Memory(src, base, disp);
+    }
+    // mov word [base + disp], imm
+    void StoreWordImm(Reg base, int32_t disp, uint16_t imm) {
+        Byte(0x66);
+        Rex(false, RAX, base);
+        Byte(0xC7);
+        Memory(RAX, base, disp);
+        Byte(imm & 0xFF);
+        Byte(imm >> 8);
+    }
+    void LoadDword(Reg dst, Reg base, int32_t disp) {
+        Rex(false, dst, base);
+        Byte(0x8B);
+        Memory(dst, base, disp);
+    }
+    void StoreDword(Reg base, int32_t disp, Reg src) {
+        Rex(false, src, base);
+        Byte(0x89);
+        Memory(src, base, disp);
+    }
+
+    void Push(Reg reg) {
+        Rex(false, RAX, reg);
+        Byte(0x50 + (reg & 7));
+    }
+    void Pop(Reg reg) {
+        Rex(false, RAX, reg);
+        Byte(0x58 + (reg & 7));
+    }
+    void AddRsp(uint8_t imm) { RspImm8(0, imm); }
+    void SubRsp(uint8_t imm) { RspImm8(5, imm); }
+    void Ret() { Byte(0xC3); }
+
+    // mov rax, target; call rax
+    template <typename Function>
+    void Call(Function *target) {
+        MovImm64(RAX, reinterpret_cast<uint64_t>(target));
+        Byte(0xFF);
+        Byte(0xD0);
+    }
+
+    void Jump(Label &label) {
+        Byte(0xE9);
+        Rel32(label);
+    }
+    void JumpIf(Condition condition, Label &label) {
+        Byte(0x0F);
+        Byte(0x80 + condition);
+        Rel32(label);
+    }
+    void Bind(Label &label) {
+        label.position = code.size();
+        for (auto fixup : label.fixups) {
+            Patch(fixup, *label.position);
+        }
+        label.fixups.clear();
+    }
+
+private:
+    std::vector<uint8_t> code;
+
+    // spl, bpl, sil and dil are only addressable with a REX prefix
+    static bool IsByteRexReg(Reg reg) { return reg >= RSP && reg <= RDI; }
+
+    void Byte(uint8_t v) { code.push_back(v); }
+    void Dword(uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            Byte(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+
+    void Rex(bool wide, Reg reg, Reg rm, bool force = false) {
+        uint8_t rex = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) != 0 ? 0x04 : 0) |
+                      ((rm & 8) != 0 ? 0x01 : 0);
+        if (rex != 0x40 || force) {
+            Byte(rex);
+        }
+    }
+    void ModRm(Reg reg, Reg rm) { Byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+    void Memory(Reg reg, Reg base, int32_t disp) {
+        Byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == RSP) {
+            Byte(0x24); // SIB: no index, rsp/r12 base
+        }
+        Dword(static_cast<uint32_t>(disp));
+    }
+    void RegReg(uint8_t opcode, Reg reg, Reg rm, bool force_rex = false,
+                bool wide = false) {
+        Rex(wide, reg, rm, force_rex);
+        Byte(opcode);
+        ModRm(reg, rm);
+    }
+    void Shift(uint8_t extension, Reg dst, uint8_t count) {
+        RegReg(0xC1, static_cast<Reg>(extension), dst);
+        Byte(count);
+    }
+    void RspImm8(uint8_t extension, uint8_t imm) {
+        RegReg(0x83, static_cast<Reg>(extension), RSP, false, true);
+        Byte(imm);
+    }
+
+    void Rel32(Label &label) {
+        auto position = code.size();
+        Dword(0);
+        if (label.position.has_value()) {
+            Patch(position, *label.position);
+        } else {
+            label.fixups.push_back(position);
+        }
+    }
+    void Patch(size_t position, size_t target) {
+        auto rel = static_cast<uint32_t>(static_cast<int64_t>(target) -
+                                         static_cast<int64_t>(position + 4));
+        for (int i = 0; i < 4; ++i) {
+            code[position + i] = static_cast<uint8_t>(rel >> (8 * i));
+        }
+    }
+};
+
+} // namespace emu::emu6502::cpu::jit
@@ -0,0 +1,170 @@
+#include "emu_6502/cpu/lockstep_validator.hpp"
+#include "emu_6502/cpu/verbose_debugger.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace emu::emu6502::cpu {
+
+namespace {
+
+// Stops which the engine finds on its own, reference runs single instructions and never
+// sees them
+bool EndsValidation(ExecutionStatus status) {
+    switch (status) {
+    case ExecutionStatus::Breakpoint:
+    case ExecutionStatus::StopRequested:
+    case ExecutionStatus::Waiting:
+    case ExecutionStatus::Trapped:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::string DescribeResult(const ExecutionResult &result) {
+    switch (result.status) {
+    case ExecutionStatus::Halted:
+        return fmt::format("{} with code {:02x}", to_string(result.status),
+                           result.halt_code);
+    case ExecutionStatus::InvalidOpcode:
+        return fmt::format("{} {:02x}", to_string(result.status), result.opcode);
+    default:
+        return to_string(result.status);
+    }
+}
+
+} // namespace
+
+std::string LockstepDivergence::Describe() const {
+    std::string r = fmt::format("Divergence after {} instructions: {}\n", instructions,
+                                difference);
+    r += fmt::format("Last {} instructions of reference:\n", history.size());
+    for (const auto &line : history) {
+        r += line;
+    }
+    return r;
+}
+
+LockstepValidator::LockstepValidator(InstructionSet instruction_set, Cpu *reference,
+                                     Cpu *candidate, size_t history_size)
+    : instruction_set(instruction_set), reference(reference), candidate(candidate),
+      history_size(history_size) {
+    // Skipped idle loop leaves no instructions to compare with
+    reference->SetIdleLoopSkip(false);
+    candidate->SetIdleLoopSkip(false);
+}
+
+std::optional<LockstepDivergence> LockstepValidator::Run(uint64_t max_instructions,
+                                                         uint64_t step) {
+    if (step == 0) {
+        throw std::runtime_error("Step of lockstep validation can not be zero");
+    }
+
+    std::ostringstream line;
+    VerboseDebugger formatter{instruction_set, reference->memory, reference->clock,
+                              &line};
+    reference_pages = reference->CodePageGenerations();
+    candidate_pages = candidate->CodePageGenerations();
+    history.clear();
+    validated = 0;
+    candidate_result = {};
+
+    while (validated < max_instructions) {
+        const uint64_t start = candidate->ExecutedInstructions();
+        candidate_result =
+            candidate->ExecuteInstructions(std::min(step, max_instructions - validated));
+        const uint64_t ran = candidate->ExecutedInstructions() - start;
+        if (EndsValidation(candidate_result.status)) {
+            return std::nullopt;
+        }
+
+        ExecutionResult reference_result{.status = ExecutionStatus::BudgetExhausted};
+        const uint64_t reference_start = reference->ExecutedInstructions();
+        auto behind = [&] {
+            const uint64_t done = reference->ExecutedInstructions() - reference_start;
+            // Instruction which stopped the candidate may not be counted
+            return done < ran ||
+                   (done == 0 &&
+                    candidate_result.status != ExecutionStatus::BudgetExhausted);
+        };
+        while (reference_result.status == ExecutionStatus::BudgetExhausted && behind()) {
+            line.str({});
+            formatter.OnNextInstruction(reference->reg);
+            history.emplace_back(line.str());
+            if (history.size() > history_size) {
+                history.pop_front();
+            }
+            reference_result = reference->ExecuteInstructions(1);
+        }
+        validated += reference->ExecutedInstructions() - reference_start;
+
+        if (auto difference = Compare(reference_result)) {
+            return Diverged(std::move(*difference));
+        }
+        if (candidate_result.status != ExecutionStatus::BudgetExhausted) {
+            return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string>
+LockstepValidator::Compare(const ExecutionResult &reference_result) {
+    if (reference_result.status != candidate_result.status ||
+        reference_result.halt_code != candidate_result.halt_code ||
+        reference_result.opcode != candidate_result.opcode) {
+        return fmt::format("reference stopped as {}, candidate as {}",
+                           DescribeResult(reference_result),
+                           DescribeResult(candidate_result));
+    }
+    if (reference->reg != candidate->reg) {
+        return fmt::format("registers differ\n  reference: {}\n  candidate: {}",
+                           reference->reg.Dump(), candidate->reg.Dump());
+    }
+    if (reference->ExecutedCycles() != candidate->ExecutedCycles()) {
+        return fmt::format("executed cycles differ, reference {} candidate {}",
+                           reference->ExecutedCycles(), candidate->ExecutedCycles());
+    }
+    return CompareStoredPages();
+}
+
+std::optional<std::string> LockstepValidator::CompareStoredPages() {
+    const auto &reference_now = reference->CodePageGenerations();
+    const auto &candidate_now = candidate->CodePageGenerations();
+    std::optional<std::string> difference;
+    for (size_t page = 0; page < reference_now.size() && !difference; ++page) {
+        if (reference_now[page] == reference_pages[page] &&
+            candidate_now[page] == candidate_pages[page]) {
+            continue;
+        }
+
+        const auto address = static_cast<MemPtr>(page << 8);
+        auto expected = reference->memory->DebugReadRange(address, 256);
+        auto actual = candidate->memory->DebugReadRange(address, 256);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (expected[i] != actual[i]) {
+                auto format = [](std::optional<uint8_t> byte) -> std::string {
+                    return byte.has_value() ? fmt::format("{:02x}", *byte) : "--";
+                };
+                difference = fmt::format("memory at {:04x} differs, reference {} "
+                                         "candidate {}",
+                                         address + i, format(expected[i]),
+                                         format(actual[i]));
+                break;
+            }
+        }
+    }
+    reference_pages = reference_now;
+    candidate_pages = candidate_now;
+    return difference;
+}
+
+LockstepDivergence LockstepValidator::Diverged(std::string difference) const {
+    return LockstepDivergence{
+        .instructions = validated,
+        .difference = std::move(difference),
+        .history = {history.begin(), history.end()},
+    };
+}
+
+} // namespace emu::emu6502::cpu
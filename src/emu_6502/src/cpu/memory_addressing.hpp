@@ -2,143 +2,364 @@
 
 #include "emu_6502/cpu/cpu.hpp"
 #include "emu_core/memory.hpp"
+#include <algorithm>
 #include <emu_core/clock.hpp>
+#include <stdexcept>
+#include <type_traits>
 
 namespace emu::emu6502::cpu::instructions {
 
-template <bool wrap_address = true, bool add_cycle = false>
-MemPtr AdvanceAddress(Cpu *cpu, MemPtr base, uint8_t v) {
+// Memory and clock of the BasicCpu instantiation handlers are compiled for. Calls into
+// concrete types are qualified, so they are direct and can be inlined. Abstract types
+// (plain Cpu) go through virtual calls as before.
+template <typename MemoryT, typename ClockT>
+struct Bus {
+    // Dummy accesses and per access clock ticks, see CycleExactBus
+    static constexpr bool kCycleExact = false;
+
+    static uint8_t Load(Cpu *cpu, MemPtr address) {
+        const auto *memory = static_cast<const MemoryT *>(cpu->memory);
+        if constexpr (std::is_abstract_v<MemoryT>) {
+            return memory->Load(address);
+        } else {
+            return memory->MemoryT::Load(address);
+        }
+    }
+
+    static void Store(Cpu *cpu, MemPtr address, uint8_t value) {
+        auto *memory = static_cast<MemoryT *>(cpu->memory);
+        if constexpr (std::is_abstract_v<MemoryT>) {
+            memory->Store(address, value);
+        } else {
+            memory->MemoryT::Store(address, value);
+        }
+        cpu->OnMemoryStore(address);
+    }
+
+    // Zero page and stack page of plain RAM are accessed in host memory, everything else
+    // through the memory, see Cpu::direct_pages
+    static uint8_t LoadDirect(Cpu *cpu, MemPtr address) {
+        if (const uint8_t *byte = cpu->direct_pages.Byte(address); byte != nullptr) {
+            return *byte;
+        }
+        return Load(cpu, address);
+    }
+
+    static void StoreDirect(Cpu *cpu, MemPtr address, uint8_t value) {
+        if (uint8_t *byte = cpu->direct_pages.Byte(address); byte != nullptr) {
+            *byte = value;
+            cpu->OnMemoryStore(address);
+            return;
+        }
+        Store(cpu, address, value);
+    }
+
+    // Passes cycles accumulated by the cpu to the clock
+    static void FlushCycles(Cpu *cpu) {
+        auto *clock = static_cast<ClockT *>(cpu->clock);
+        if (clock != nullptr) {
+            if constexpr (std::is_abstract_v<ClockT>) {
+                clock->Advance(cpu->pending_cycles);
+            } else {
+                clock->ClockT::Advance(cpu->pending_cycles);
+            }
+        }
+        cpu->flushed_cycles += cpu->pending_cycles;
+        cpu->pending_cycles = 0;
+    }
+
+    // Bus cycles whose value the cpu throws away, only cycle-exact bus makes them
+    static void DummyLoad(Cpu * /*cpu*/, MemPtr /*address*/) {}
+    static void DummyStore(Cpu * /*cpu*/, MemPtr /*address*/, uint8_t /*value*/) {}
+};
+
+using ErasedBus = Bus<Memory16, Clock>;
+
+// Bus of the cycle-exact engine. Every access, dummy ones included, advances the clock
+// by one cycle once it is done, so devices see each access at its own cycle. Cycles
+// are still charged from the cycle table, flush passes to the clock only the ones no
+// access has ticked. Handlers make as many accesses as the instruction has cycles.
+// Memory and clock are always reached through their interfaces, the engine is not
+// about speed. 65C02 reads the last operand byte instead of the unfixed indexed address
+// and reads again instead of writing the unmodified value of read-modify-write.
+template <bool kCmos65C02>
+struct CycleExactBus {
+    static constexpr bool kCycleExact = true;
+    static constexpr bool kCmos = kCmos65C02;
+
+    static uint8_t Load(Cpu *cpu, MemPtr address) {
+        auto value = ErasedBus::Load(cpu, address);
+        Tick(cpu);
+        return value;
+    }
+
+    static void Store(Cpu *cpu, MemPtr address, uint8_t value) {
+        ErasedBus::Store(cpu, address, value);
+        Tick(cpu);
+    }
+
+    static uint8_t LoadDirect(Cpu *cpu, MemPtr address) { return Load(cpu, address); }
+    static void StoreDirect(Cpu *cpu, MemPtr address, uint8_t value) {
+        Store(cpu, address, value);
+    }
+
+    static void FlushCycles(Cpu *cpu) {
+        const uint64_t ticked = std::min(cpu->bus_cycles, cpu->pending_cycles);
+        if (cpu->clock != nullptr) {
+            cpu->clock->Advance(cpu->pending_cycles - ticked);
+        }
+        cpu->flushed_cycles += cpu->pending_cycles;
+        cpu->pending_cycles = 0;
+        cpu->bus_cycles = 0;
+    }
+
+    // Memory which refuses the read (unmapped address) is left alone, hardware reads
+    // open bus there
+    static void DummyLoad(Cpu *cpu, MemPtr address) {
+        try {
+            (void)ErasedBus::Load(cpu, address);
+        } catch (const std::runtime_error &) {
+        }
+        Tick(cpu);
+    }
+    static void DummyStore(Cpu *cpu, MemPtr address, uint8_t value) {
+        Store(cpu, address, value);
+    }
+
+private:
+    static void Tick(Cpu *cpu) {
+        if (cpu->clock != nullptr) {
+            cpu->clock->Advance(1);
+        }
+        ++cpu->bus_cycles;
+    }
+};
+
+// Internal cycle of an implied instruction, the byte after the opcode is read
+template <typename B>
+EMU6502_ALWAYS_INLINE void ImpliedCycle(Cpu *cpu, const Registers &reg) {
+    B::DummyLoad(cpu, reg.program_counter);
+}
+
+// Cycle between read and write of read-modify-write instruction
+template <typename B>
+void ModifyCycle(Cpu *cpu, MemPtr address, uint8_t value) {
+    if constexpr (B::kCycleExact) {
+        if constexpr (B::kCmos) {
+            B::DummyLoad(cpu, address);
+        } else {
+            B::DummyStore(cpu, address, value);
+        }
+    }
+}
+
+// Cycle in which the carry of an indexed address goes into its high byte
+template <typename B>
+EMU6502_ALWAYS_INLINE void IndexFixupCycle(Cpu *cpu, const Registers &reg,
+                                           MemPtr unfixed_address) {
+    if constexpr (B::kCycleExact) {
+        if constexpr (B::kCmos) {
+            B::DummyLoad(cpu, reg.program_counter - 1);
+        } else {
+            B::DummyLoad(cpu, unfixed_address);
+        }
+    }
+}
+
+// Indexed reads with add_cycle take one cycle more than their base cost when page is
+// crossed, other indexed accesses always pay the fixup cycle in base cost
+template <typename B, bool wrap_address = true, bool add_cycle = false>
+EMU6502_ALWAYS_INLINE MemPtr AdvanceAddress(Cpu *cpu, const Registers &reg, MemPtr base,
+                                            uint8_t v) {
     if constexpr (wrap_address) {
         return (base & 0xFF00) | ((base + v) & 0x00FF);
     } else {
+        const MemPtr unfixed = (base & 0xFF00) | ((base + v) & 0x00FF);
         if constexpr (add_cycle) {
             if ((((base & 0xFF) + v) & 0xFF00) != 0) {
-                cpu->WaitForNextCycle();
+                cpu->AddCycles(1);
+                IndexFixupCycle<B>(cpu, reg, unfixed);
             }
+        } else {
+            IndexFixupCycle<B>(cpu, reg, unfixed);
         }
         return base + v;
     }
 }
 
-uint8_t FetchNextByte(Cpu *cpu) { // mode #
-    return cpu->memory->Load(cpu->reg.program_counter++);
+template <typename B>
+EMU6502_ALWAYS_INLINE uint8_t FetchNextByte(Cpu *cpu, Registers &reg) { // mode #
+    if (cpu->decoded_operand != nullptr) {
+        ++reg.program_counter;
+        return *cpu->decoded_operand++;
+    }
+    return B::Load(cpu, reg.program_counter++);
 }
 
-MemPtr GetAbsoluteAddress(Cpu *cpu) { // mode: a
-    MemPtr addr = FetchNextByte(cpu);
-    return addr | FetchNextByte(cpu) << 8;
+// Fetch for loops which work on registers of the cpu instead of a copy of their own
+template <typename B>
+uint8_t FetchOpcode(Cpu *cpu) {
+    return FetchNextByte<B>(cpu, cpu->reg);
 }
 
-MemPtr GetAddressAbsoluteIndexedIndirectWithX(Cpu *cpu) { // mode (a,x)
-    MemPtr location = GetAbsoluteAddress(cpu);
-    location += cpu->reg.x;
-    cpu->WaitForNextCycle();
-    MemPtr addr = cpu->memory->Load(location++);
-    return addr | cpu->memory->Load(location) << 8;
+template <typename B>
+EMU6502_ALWAYS_INLINE MemPtr GetAbsoluteAddress(Cpu *cpu, Registers &reg) { // mode: a
+    MemPtr addr = FetchNextByte<B>(cpu, reg);
+    return addr | FetchNextByte<B>(cpu, reg) << 8;
 }
 
-template <bool fast>
-MemPtr GetAddressAbsoluteIndexedWithX(Cpu *cpu) { // mode a,x
-    auto r = GetAbsoluteAddress(cpu);
-    if constexpr (!fast) {
-        cpu->WaitForNextCycle();
-    }
-    return AdvanceAddress<false, fast>(cpu, r, cpu->reg.x);
+template <typename B> // mode (a,x)
+EMU6502_ALWAYS_INLINE MemPtr GetAddressAbsoluteIndexedIndirectWithX(Cpu *cpu,
+                                                                    Registers &reg) {
+    MemPtr location = GetAbsoluteAddress<B>(cpu, reg);
+    B::DummyLoad(cpu, reg.program_counter - 1);
+    location += reg.x;
+    MemPtr addr = B::Load(cpu, location++);
+    return addr | B::Load(cpu, location) << 8;
 }
 
-template <bool fast>
-MemPtr GetAddressAbsoluteIndexedWithY(Cpu *cpu) { // mode a,y
-    auto r = GetAbsoluteAddress(cpu);
-    if constexpr (!fast) {
-        cpu->WaitForNextCycle();
-    }
-    return AdvanceAddress<false, fast>(cpu, r, cpu->reg.y);
+template <typename B, bool fast> // mode a,x
+EMU6502_ALWAYS_INLINE MemPtr GetAddressAbsoluteIndexedWithX(Cpu *cpu, Registers &reg) {
+    auto r = GetAbsoluteAddress<B>(cpu, reg);
+    return AdvanceAddress<B, false, fast>(cpu, reg, r, reg.x);
+}
+
+template <typename B, bool fast> // mode a,y
+EMU6502_ALWAYS_INLINE MemPtr GetAddressAbsoluteIndexedWithY(Cpu *cpu, Registers &reg) {
+    auto r = GetAbsoluteAddress<B>(cpu, reg);
+    return AdvanceAddress<B, false, fast>(cpu, reg, r, reg.y);
 }
 
-MemPtr GetAddressAbsoluteIndirect(Cpu *cpu) { // mode (a)
-    auto location = GetAbsoluteAddress(cpu);
-    MemPtr addr = cpu->memory->Load(location++);
-    return addr | cpu->memory->Load(location) << 8;
+template <typename B> // mode (a)
+EMU6502_ALWAYS_INLINE MemPtr GetAddressAbsoluteIndirect(Cpu *cpu, Registers &reg) {
+    auto location = GetAbsoluteAddress<B>(cpu, reg);
+    B::DummyLoad(cpu, reg.program_counter - 1);
+    MemPtr addr = B::Load(cpu, location++);
+    return addr | B::Load(cpu, location) << 8;
 }
 
-uint8_t FetchAccumulator(Cpu *cpu) { // mode A
-    return cpu->reg.a;
+template <typename B>
+EMU6502_ALWAYS_INLINE uint8_t FetchAccumulator(Cpu * /*cpu*/, Registers &reg) { // mode A
+    return reg.a;
 }
 
-MemPtr GetAddressProgramCounterRelative(Cpu *cpu) { // mode r
-    auto offset = FetchNextByte(cpu);
-    cpu->WaitForNextCycle();
-    return cpu->reg.program_counter + offset;
+template <typename B> // mode r
+EMU6502_ALWAYS_INLINE MemPtr GetAddressProgramCounterRelative(Cpu *cpu, Registers &reg) {
+    auto offset = FetchNextByte<B>(cpu, reg);
+    return reg.program_counter + offset;
 }
 
-MemPtr GetStackAddress(Cpu *cpu) { // mode s
-    return cpu->reg.StackPointerMemoryAddress();
+template <typename B>
+EMU6502_ALWAYS_INLINE MemPtr GetStackAddress(Cpu * /*cpu*/, Registers &reg) { // mode s
+    return reg.StackPointerMemoryAddress();
 }
 
-MemPtr GetZeroPageAddress(Cpu *cpu) { //mode zp
-    return FetchNextByte(cpu);
+template <typename B>
+EMU6502_ALWAYS_INLINE MemPtr GetZeroPageAddress(Cpu *cpu, Registers &reg) { //mode zp
+    return FetchNextByte<B>(cpu, reg);
 }
 
-template <bool wrap_address = true>
-MemPtr GetAddresZeroPageIndexedIndirectWithX(Cpu *cpu) { // mode (zp,x)
+template <typename B, bool wrap_address = true> // mode (zp,x)
+EMU6502_ALWAYS_INLINE MemPtr GetAddresZeroPageIndexedIndirectWithX(Cpu *cpu,
+                                                                   Registers &reg) {
     //addr = PEEK((arg + X) % 256) +
     //       PEEK((arg + X + 1) % 256) * 256
-    MemPtr arg = FetchNextByte(cpu);
-    auto ind0 = AdvanceAddress<wrap_address, false>(cpu, arg, cpu->reg.x);
-    auto low = cpu->memory->Load(ind0);
+    MemPtr arg = FetchNextByte<B>(cpu, reg);
+    B::DummyLoad(cpu, arg);
+    auto ind0 = AdvanceAddress<B, wrap_address, false>(cpu, reg, arg, reg.x);
+    auto low = B::LoadDirect(cpu, ind0);
 
-    cpu->WaitForNextCycle();
-    auto ind1 = AdvanceAddress<wrap_address, false>(cpu, ind0, 1);
-    auto hi = cpu->memory->Load(ind1);
+    auto ind1 = AdvanceAddress<B, wrap_address, false>(cpu, reg, ind0, 1);
+    auto hi = B::LoadDirect(cpu, ind1);
     MemPtr addr = (hi << 8) | low;
     return addr;
 }
 
-template <bool wrap_address = true>
-MemPtr GetZeroPageIndirectAddressWithX(Cpu *cpu) { // mode zp,x
-    MemPtr zp = FetchNextByte(cpu);
-    cpu->WaitForNextCycle();
-    return AdvanceAddress<wrap_address>(cpu, zp, cpu->reg.x);
+template <typename B, bool wrap_address = true> // mode zp,x
+EMU6502_ALWAYS_INLINE MemPtr GetZeroPageIndirectAddressWithX(Cpu *cpu, Registers &reg) {
+    MemPtr zp = FetchNextByte<B>(cpu, reg);
+    B::DummyLoad(cpu, zp);
+    return AdvanceAddress<B, wrap_address>(cpu, reg, zp, reg.x);
 }
 
-template <bool wrap_address = true>
-MemPtr GetZeroPageIndirectAddressWithY(Cpu *cpu) { // mode zp,y
-    MemPtr zp = FetchNextByte(cpu);
-    cpu->WaitForNextCycle();
-    return AdvanceAddress<wrap_address>(cpu, zp, cpu->reg.y);
+template <typename B, bool wrap_address = true> // mode zp,y
+EMU6502_ALWAYS_INLINE MemPtr GetZeroPageIndirectAddressWithY(Cpu *cpu, Registers &reg) {
+    MemPtr zp = FetchNextByte<B>(cpu, reg);
+    B::DummyLoad(cpu, zp);
+    return AdvanceAddress<B, wrap_address>(cpu, reg, zp, reg.y);
 }
 
-MemPtr GetZeroPageIndirectAddress(Cpu *cpu) { // mode (zp)
-    return cpu->memory->Load(GetZeroPageAddress(cpu));
+template <typename B> // mode (zp)
+EMU6502_ALWAYS_INLINE MemPtr GetZeroPageIndirectAddress(Cpu *cpu, Registers &reg) {
+    auto arg = FetchNextByte<B>(cpu, reg);
+    auto low = B::LoadDirect(cpu, arg);
+    auto hi = B::LoadDirect(cpu, AdvanceAddress<B, true, false>(cpu, reg, arg, 1));
+    return (hi << 8) | low;
 }
 
-template <bool always_add_cycle = false>
-MemPtr GetAddresZeroPageIndirectIndexedWithY(Cpu *cpu) { // mode (zp),y
+template <typename B, bool always_add_cycle = false> // mode (zp),y
+EMU6502_ALWAYS_INLINE MemPtr GetAddresZeroPageIndirectIndexedWithY(Cpu *cpu,
+                                                                   Registers &reg) {
     // addr = PEEK(arg) +
     //        PEEK((arg + 1) % 256) * 256 +
     //        Y
-    auto arg = FetchNextByte(cpu);
-    auto low = cpu->memory->Load(arg);
-    auto hi = cpu->memory->Load(AdvanceAddress<true, false>(cpu, arg, 1));
-    if constexpr (always_add_cycle) {
-        cpu->WaitForNextCycle();
-    }
+    auto arg = FetchNextByte<B>(cpu, reg);
+    auto low = B::LoadDirect(cpu, arg);
+    auto hi = B::LoadDirect(cpu, AdvanceAddress<B, true, false>(cpu, reg, arg, 1));
     MemPtr ind = (hi << 8) | low;
-    return AdvanceAddress<false, !always_add_cycle>(cpu, ind, cpu->reg.y);
+    return AdvanceAddress<B, false, !always_add_cycle>(cpu, reg, ind, reg.y);
 }
 
-constexpr auto kAddressZP = &GetZeroPageAddress;
-constexpr auto kAddressZPX = &GetZeroPageIndirectAddressWithX<true>;
-constexpr auto kAddressZPY = &GetZeroPageIndirectAddressWithY<true>;
-constexpr auto kAddressABS = &GetAbsoluteAddress;
+template <typename B>
+constexpr auto kAddressZP = &GetZeroPageAddress<B>;
+template <typename B>
+constexpr auto kAddressZPX = &GetZeroPageIndirectAddressWithX<B, true>;
+template <typename B>
+constexpr auto kAddressZPY = &GetZeroPageIndirectAddressWithY<B, true>;
+template <typename B>
+constexpr auto kAddressABS = &GetAbsoluteAddress<B>;
+
+template <typename B>
+constexpr auto kAddressFastABSX = &GetAddressAbsoluteIndexedWithX<B, true>;
+template <typename B>
+constexpr auto kAddressFastABSY = &GetAddressAbsoluteIndexedWithY<B, true>;
+template <typename B>
+constexpr auto kAddressABSX = &GetAddressAbsoluteIndexedWithX<B, false>;
+template <typename B>
+constexpr auto kAddressABSY = &GetAddressAbsoluteIndexedWithY<B, false>;
+
+// Modes whose address never leaves zero page
+template <typename B, auto addr_func>
+constexpr bool kZeroPageMode = addr_func == kAddressZP<B> ||
+                                addr_func == kAddressZPX<B> ||
+                                addr_func == kAddressZPY<B>;
 
-constexpr auto kAddressFastABSX = &GetAddressAbsoluteIndexedWithX<true>;
-constexpr auto kAddressFastABSY = &GetAddressAbsoluteIndexedWithY<true>;
-constexpr auto kAddressABSX = &GetAddressAbsoluteIndexedWithX<false>;
-constexpr auto kAddressABSY = &GetAddressAbsoluteIndexedWithY<false>;
+// Operand accesses of instructions with addressing mode addr_func
+template <typename B, auto addr_func>
+uint8_t LoadOperand(Cpu *cpu, MemPtr address) {
+    if constexpr (kZeroPageMode<B, addr_func>) {
+        return B::LoadDirect(cpu, address);
+    } else {
+        return B::Load(cpu, address);
+    }
+}
+
+template <typename B, auto addr_func>
+void StoreOperand(Cpu *cpu, MemPtr address, uint8_t value) {
+    if constexpr (kZeroPageMode<B, addr_func>) {
+        B::StoreDirect(cpu, address, value);
+    } else {
+        B::Store(cpu, address, value);
+    }
+}
 
-constexpr auto kAddressINDX = &GetAddresZeroPageIndexedIndirectWithX<>;
-constexpr auto kAddressINDY = &GetAddresZeroPageIndirectIndexedWithY<false>;
-constexpr auto kAddressStoreINDY = &GetAddresZeroPageIndirectIndexedWithY<true>;
+template <typename B>
+constexpr auto kAddressINDX = &GetAddresZeroPageIndexedIndirectWithX<B>;
+template <typename B>
+constexpr auto kAddressINDY = &GetAddresZeroPageIndirectIndexedWithY<B, false>;
+template <typename B>
+constexpr auto kAddressStoreINDY = &GetAddresZeroPageIndirectIndexedWithY<B, true>;
+template <typename B>
+constexpr auto kAddressZPIND = &GetZeroPageIndirectAddress<B>;
 
 } // namespace emu::emu6502::cpu::instructions
@@ -0,0 +1,22 @@
+#include "emu_6502/cpu/native_routine.hpp"
+#include <fmt/format.h>
+#include <stdexcept>
+
+namespace emu::emu6502::cpu {
+
+MemPtr RoutineAddress(const SymbolMap &symbols, const std::string &name) {
+    auto it = symbols.find(name);
+    if (it == symbols.end()) {
+        throw std::runtime_error(fmt::format("Routine symbol '{}' is not defined", name));
+    }
+    const auto &offset = it->second->offset;
+    if (std::holds_alternative<uint8_t>(offset)) {
+        return std::get<uint8_t>(offset);
+    }
+    if (!HasValue(offset)) {
+        throw std::runtime_error(fmt::format("Routine symbol '{}' has no address", name));
+    }
+    return std::get<uint16_t>(offset);
+}
+
+} // namespace emu::emu6502::cpu
@@ -0,0 +1,54 @@
+#include "recompiled_code.hpp"
+#include <fmt/format.h>
+#include <stdexcept>
+
+namespace emu::emu6502::cpu {
+
+RecompiledCode::RecompiledCode(const Memory16 *memory, const RecompiledProgram *program)
+    : memory(memory), entries(0x10000) {
+    if (program->abi_version != kRecompiledAbiVersion) {
+        throw std::runtime_error(
+            fmt::format("Recompiled program has abi version {}, expected {}",
+                        program->abi_version, kRecompiledAbiVersion));
+    }
+    for (size_t i = 0; i < program->block_count; ++i) {
+        const auto &block = program->blocks[i];
+        entries[block.address].block = &block;
+    }
+}
+
+const RecompiledBlock *RecompiledCode::Lookup(MemPtr address,
+                                              const CodePageGenerationArray &pages) {
+    auto &entry = entries[address];
+    if (entry.block == nullptr) {
+        return nullptr;
+    }
+
+    uint8_t first_page = address >> 8;
+    uint8_t next_page = first_page + 1;
+    std::array<CodePageGeneration, 2> generation{pages[first_page], pages[next_page]};
+    if (!entry.verified || entry.verified_generation != generation) {
+        entry.matches = MatchesMemory(*entry.block);
+        entry.verified_generation = generation;
+        entry.verified = true;
+    }
+    return entry.matches ? entry.block : nullptr;
+}
+
+void RecompiledCode::Invalidate() {
+    for (auto &entry : entries) {
+        entry.verified = false;
+    }
+}
+
+bool RecompiledCode::MatchesMemory(const RecompiledBlock &block) const {
+    for (uint16_t i = 0; i < block.code_size; ++i) {
+        auto byte = memory->DebugRead(static_cast<MemPtr>(block.address + i));
+        if (!byte.has_value() || *byte != block.code[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace emu::emu6502::cpu
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/cpu/recompiled_program.hpp"
+#include "emu_core/memory.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace emu::emu6502::cpu {
+
+// Index of blocks from a recompiled module. Code can change after the image was
+// recompiled (self modifying code, different image), so every block is compared with
+// memory before first use and again after each store into its pages.
+class RecompiledCode {
+public:
+    RecompiledCode(const Memory16 *memory, const RecompiledProgram *program);
+
+    // Returns nullptr when there is no block at address or memory does not match it
+    const RecompiledBlock *Lookup(MemPtr address, const CodePageGenerationArray &pages);
+
+    // Forces verification of all blocks, memory could have been reloaded
+    void Invalidate();
+
+private:
+    struct Entry {
+        const RecompiledBlock *block = nullptr;
+        std::array<CodePageGeneration, 2> verified_generation{};
+        bool verified = false;
+        bool matches = false;
+    };
+
+    const Memory16 *const memory;
+    std::vector<Entry> entries;
+
+    [[nodiscard]] bool MatchesMemory(const RecompiledBlock &block) const;
+};
+
+} // namespace emu::emu6502::cpu
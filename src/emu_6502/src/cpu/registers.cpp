@@ -7,7 +7,7 @@ namespace emu::emu6502::cpu {
 
 std::string Registers::DumpFlags() const {
     std::string r;
-    r += fmt::format("{:02x}[", flags);
+    r += fmt::format("{:02x}[", flags.Get());
     r += TestFlag(Flags::Negative) ? "N" : "-";
     r += TestFlag(Flags::Overflow) ? "V" : "-";
     r += TestFlag(Flags::NotUsed) ? "?" : "-";
@@ -37,6 +37,15 @@ std::string FormatAddressMode(AddressMode addres_mode, const Registers &regs,
     }
     case AddressMode::ABS_IND:
         return fmt::format("(${:02x}{:02x})", byte_hi.value(), byte_low.value());
+    case AddressMode::ZP_IND:
+        return fmt::format("(${:02x})", byte_low.value());
+    case AddressMode::ABS_INDX:
+        return fmt::format("(${:02x}{:02x},X)", byte_hi.value(), byte_low.value());
+    case AddressMode::ZP_REL: {
+        auto s8 = static_cast<int8_t>(byte_hi.value());
+        return fmt::format("${:02x},{} (${:04x})", byte_low.value(), s8,
+                           regs.program_counter + 3 + s8);
+    }
     }
 
     return "?";
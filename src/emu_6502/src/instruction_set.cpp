@@ -1,7 +1,10 @@
 #include "emu_6502/instruction_set.hpp"
 #include "emu_6502/cpu/opcode.hpp"
+#include <array>
 #include <fmt/format.h>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 
 namespace emu::emu6502 {
 
@@ -122,25 +125,25 @@ OpcodeInstructionMap GenArithmeticInstructions(InstructionSet instruction_set) {
 OpcodeInstructionMap GenShiftsInstructions(InstructionSet instruction_set) {
     return {
         // shifts
-        {INS_ASL, {INS_ASL, "ASL"sv, AddressMode::Immediate}},
+        {INS_ASL, {INS_ASL, "ASL"sv, AddressMode::ACC}},
         {INS_ASL_ZP, {INS_ASL_ZP, "ASL"sv, AddressMode::ZP}},
         {INS_ASL_ZPX, {INS_ASL_ZPX, "ASL"sv, AddressMode::ZPX}},
         {INS_ASL_ABS, {INS_ASL_ABS, "ASL"sv, AddressMode::ABS}},
         {INS_ASL_ABSX, {INS_ASL_ABSX, "ASL"sv, AddressMode::ABSX}},
 
-        {INS_LSR, {INS_LSR, "LSR"sv, AddressMode::Immediate}},
+        {INS_LSR, {INS_LSR, "LSR"sv, AddressMode::ACC}},
         {INS_LSR_ZP, {INS_LSR_ZP, "LSR"sv, AddressMode::ZP}},
         {INS_LSR_ZPX, {INS_LSR_ZPX, "LSR"sv, AddressMode::ZPX}},
         {INS_LSR_ABS, {INS_LSR_ABS, "LSR"sv, AddressMode::ABS}},
         {INS_LSR_ABSX, {INS_LSR_ABSX, "LSR"sv, AddressMode::ABSX}},
 
-        {INS_ROL, {INS_ROL, "ROL"sv, AddressMode::Immediate}},
+        {INS_ROL, {INS_ROL, "ROL"sv, AddressMode::ACC}},
         {INS_ROL_ZP, {INS_ROL_ZP, "ROL"sv, AddressMode::ZP}},
         {INS_ROL_ZPX, {INS_ROL_ZPX, "ROL"sv, AddressMode::ZPX}},
         {INS_ROL_ABS, {INS_ROL_ABS, "ROL"sv, AddressMode::ABS}},
         {INS_ROL_ABSX, {INS_ROL_ABSX, "ROL"sv, AddressMode::ABSX}},
 
-        {INS_ROR, {INS_ROR, "ROR"sv, AddressMode::Immediate}},
+        {INS_ROR, {INS_ROR, "ROR"sv, AddressMode::ACC}},
         {INS_ROR_ZP, {INS_ROR_ZP, "ROR"sv, AddressMode::ZP}},
         {INS_ROR_ZPX, {INS_ROR_ZPX, "ROR"sv, AddressMode::ZPX}},
         {INS_ROR_ABS, {INS_ROR_ABS, "ROR"sv, AddressMode::ABS}},
@@ -272,11 +275,132 @@ OpcodeInstructionMap GenEmuInstructions(InstructionSet instruction_set) {
     };
 }
 
-// OpcodeInstructionMap GenArithmeticInstructions(InstructionSet instruction_set) {
-//     return {
-//         //
-//     };
-// }
+OpcodeInstructionMap Gen65C02Instructions(InstructionSet instruction_set) {
+    OpcodeInstructionMap r = {
+        {INS_BRA, {INS_BRA, "BRA"sv, AddressMode::REL}},
+
+        {INS_PHX, {INS_PHX, "PHX"sv, AddressMode::Implied}},
+        {INS_PHY, {INS_PHY, "PHY"sv, AddressMode::Implied}},
+        {INS_PLX, {INS_PLX, "PLX"sv, AddressMode::Implied}},
+        {INS_PLY, {INS_PLY, "PLY"sv, AddressMode::Implied}},
+
+        {INS_STZ_ZP, {INS_STZ_ZP, "STZ"sv, AddressMode::ZP}},
+        {INS_STZ_ZPX, {INS_STZ_ZPX, "STZ"sv, AddressMode::ZPX}},
+        {INS_STZ_ABS, {INS_STZ_ABS, "STZ"sv, AddressMode::ABS}},
+        {INS_STZ_ABSX, {INS_STZ_ABSX, "STZ"sv, AddressMode::ABSX}},
+
+        {INS_TRB_ZP, {INS_TRB_ZP, "TRB"sv, AddressMode::ZP}},
+        {INS_TRB_ABS, {INS_TRB_ABS, "TRB"sv, AddressMode::ABS}},
+        {INS_TSB_ZP, {INS_TSB_ZP, "TSB"sv, AddressMode::ZP}},
+        {INS_TSB_ABS, {INS_TSB_ABS, "TSB"sv, AddressMode::ABS}},
+
+        {INS_ORA_INDZP, {INS_ORA_INDZP, "ORA"sv, AddressMode::ZP_IND}},
+        {INS_AND_INDZP, {INS_AND_INDZP, "AND"sv, AddressMode::ZP_IND}},
+        {INS_EOR_INDZP, {INS_EOR_INDZP, "EOR"sv, AddressMode::ZP_IND}},
+        {INS_ADC_INDZP, {INS_ADC_INDZP, "ADC"sv, AddressMode::ZP_IND}},
+        {INS_STA_INDZP, {INS_STA_INDZP, "STA"sv, AddressMode::ZP_IND}},
+        {INS_LDA_INDZP, {INS_LDA_INDZP, "LDA"sv, AddressMode::ZP_IND}},
+        {INS_CMP_INDZP, {INS_CMP_INDZP, "CMP"sv, AddressMode::ZP_IND}},
+        {INS_SBC_INDZP, {INS_SBC_INDZP, "SBC"sv, AddressMode::ZP_IND}},
+
+        {INS_INC_ACC, {INS_INC_ACC, "INC"sv, AddressMode::ACC}},
+        {INS_DEC_ACC, {INS_DEC_ACC, "DEC"sv, AddressMode::ACC}},
+
+        {INS_BIT_IM, {INS_BIT_IM, "BIT"sv, AddressMode::Immediate}},
+        {INS_BIT_ZPX, {INS_BIT_ZPX, "BIT"sv, AddressMode::ZPX}},
+        {INS_BIT_ABSX, {INS_BIT_ABSX, "BIT"sv, AddressMode::ABSX}},
+
+        {INS_JMP_ABSX_IND, {INS_JMP_ABSX_IND, "JMP"sv, AddressMode::ABS_INDX}},
+
+        {INS_WAI, {INS_WAI, "WAI"sv, AddressMode::Implied}},
+        {INS_STP, {INS_STP, "STP"sv, AddressMode::Implied}},
+    };
+
+    constexpr std::array kRmb = {"RMB0"sv, "RMB1"sv, "RMB2"sv, "RMB3"sv,
+                                 "RMB4"sv, "RMB5"sv, "RMB6"sv, "RMB7"sv};
+    constexpr std::array kSmb = {"SMB0"sv, "SMB1"sv, "SMB2"sv, "SMB3"sv,
+                                 "SMB4"sv, "SMB5"sv, "SMB6"sv, "SMB7"sv};
+    constexpr std::array kBbr = {"BBR0"sv, "BBR1"sv, "BBR2"sv, "BBR3"sv,
+                                 "BBR4"sv, "BBR5"sv, "BBR6"sv, "BBR7"sv};
+    constexpr std::array kBbs = {"BBS0"sv, "BBS1"sv, "BBS2"sv, "BBS3"sv,
+                                 "BBS4"sv, "BBS5"sv, "BBS6"sv, "BBS7"sv};
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        for (auto [base, mnemonic, mode] :
+             {std::tuple{INS_RMB0, kRmb[bit], AddressMode::ZP},
+              std::tuple{INS_SMB0, kSmb[bit], AddressMode::ZP},
+              std::tuple{INS_BBR0, kBbr[bit], AddressMode::ZP_REL},
+              std::tuple{INS_BBS0, kBbs[bit], AddressMode::ZP_REL}}) {
+            auto opcode = BitOpcode(base, bit);
+            r.emplace(opcode, OpcodeInfo{opcode, mnemonic, mode});
+        }
+    }
+    return r;
+}
+
+OpcodeInstructionMap GenUndocumentedInstructions(InstructionSet instruction_set) {
+    OpcodeInstructionMap r = {
+        {INS_SAX_ZP, {INS_SAX_ZP, "SAX"sv, AddressMode::ZP}},
+        {INS_SAX_ZPY, {INS_SAX_ZPY, "SAX"sv, AddressMode::ZPY}},
+        {INS_SAX_ABS, {INS_SAX_ABS, "SAX"sv, AddressMode::ABS}},
+        {INS_SAX_INDX, {INS_SAX_INDX, "SAX"sv, AddressMode::INDX}},
+
+        {INS_LAX_ZP, {INS_LAX_ZP, "LAX"sv, AddressMode::ZP}},
+        {INS_LAX_ZPY, {INS_LAX_ZPY, "LAX"sv, AddressMode::ZPY}},
+        {INS_LAX_ABS, {INS_LAX_ABS, "LAX"sv, AddressMode::ABS}},
+        {INS_LAX_ABSY, {INS_LAX_ABSY, "LAX"sv, AddressMode::ABSY}},
+        {INS_LAX_INDX, {INS_LAX_INDX, "LAX"sv, AddressMode::INDX}},
+        {INS_LAX_INDY, {INS_LAX_INDY, "LAX"sv, AddressMode::INDY}},
+
+        {INS_ANC_IM, {INS_ANC_IM, "ANC"sv, AddressMode::Immediate}},
+        {INS_ANC_IM2, {INS_ANC_IM2, "ANC"sv, AddressMode::Immediate}},
+        {INS_ALR_IM, {INS_ALR_IM, "ALR"sv, AddressMode::Immediate}},
+        {INS_ARR_IM, {INS_ARR_IM, "ARR"sv, AddressMode::Immediate}},
+        {INS_SBX_IM, {INS_SBX_IM, "SBX"sv, AddressMode::Immediate}},
+        {INS_SBC_IM2, {INS_SBC_IM2, "SBC"sv, AddressMode::Immediate}},
+
+        {INS_NOP_ABS, {INS_NOP_ABS, "NOP"sv, AddressMode::ABS}},
+    };
+
+    // Read-modify-write instructions, all of them have the same seven modes
+    for (auto [mnemonic, zp, zpx, abs, absx, absy, indx, indy] : {
+             std::tuple{"SLO"sv, INS_SLO_ZP, INS_SLO_ZPX, INS_SLO_ABS, INS_SLO_ABSX,
+                        INS_SLO_ABSY, INS_SLO_INDX, INS_SLO_INDY},
+             std::tuple{"RLA"sv, INS_RLA_ZP, INS_RLA_ZPX, INS_RLA_ABS, INS_RLA_ABSX,
+                        INS_RLA_ABSY, INS_RLA_INDX, INS_RLA_INDY},
+             std::tuple{"SRE"sv, INS_SRE_ZP, INS_SRE_ZPX, INS_SRE_ABS, INS_SRE_ABSX,
+                        INS_SRE_ABSY, INS_SRE_INDX, INS_SRE_INDY},
+             std::tuple{"RRA"sv, INS_RRA_ZP, INS_RRA_ZPX, INS_RRA_ABS, INS_RRA_ABSX,
+                        INS_RRA_ABSY, INS_RRA_INDX, INS_RRA_INDY},
+             std::tuple{"DCP"sv, INS_DCP_ZP, INS_DCP_ZPX, INS_DCP_ABS, INS_DCP_ABSX,
+                        INS_DCP_ABSY, INS_DCP_INDX, INS_DCP_INDY},
+             std::tuple{"ISC"sv, INS_ISC_ZP, INS_ISC_ZPX, INS_ISC_ABS, INS_ISC_ABSX,
+                        INS_ISC_ABSY, INS_ISC_INDX, INS_ISC_INDY},
+         }) {
+        for (auto [opcode, mode] : {
+                 std::pair{zp, AddressMode::ZP},
+                 std::pair{zpx, AddressMode::ZPX},
+                 std::pair{abs, AddressMode::ABS},
+                 std::pair{absx, AddressMode::ABSX},
+                 std::pair{absy, AddressMode::ABSY},
+                 std::pair{indx, AddressMode::INDX},
+                 std::pair{indy, AddressMode::INDY},
+             }) {
+            r.emplace(opcode, OpcodeInfo{opcode, mnemonic, mode});
+        }
+    }
+
+    auto add_nops = [&r](const auto &opcodes, AddressMode mode) {
+        for (auto opcode : opcodes) {
+            r.emplace(opcode, OpcodeInfo{opcode, "NOP"sv, mode});
+        }
+    };
+    add_nops(kNopImplied, AddressMode::Implied);
+    add_nops(kNopIM, AddressMode::Immediate);
+    add_nops(kNopZP, AddressMode::ZP);
+    add_nops(kNopZPX, AddressMode::ZPX);
+    add_nops(kNopABSX, AddressMode::ABSX);
+    return r;
+}
 
 OpcodeInstructionMap GenerateInstructionSet(InstructionSet instruction_set) {
     OpcodeInstructionMap r;
@@ -297,11 +421,44 @@ OpcodeInstructionMap GenerateInstructionSet(InstructionSet instruction_set) {
     if (instruction_set == InstructionSet::NMOS6502Emu) {
         MergeInstructionMap(r, GenEmuInstructions(instruction_set));
     }
+    if (instruction_set == InstructionSet::CMOS65C02) {
+        MergeInstructionMap(r, Gen65C02Instructions(instruction_set));
+    }
+    if (instruction_set == InstructionSet::NMOS6502Undocumented) {
+        MergeInstructionMap(r, GenUndocumentedInstructions(instruction_set));
+    }
     return r;
 }
 
 } // namespace
 
+std::string to_string(InstructionSet instruction_set) {
+    switch (instruction_set) {
+    case InstructionSet::NMOS6502:
+        return "nmos6502";
+    case InstructionSet::NMOS6502Emu:
+        return "nmos6502emu";
+    case InstructionSet::CMOS65C02:
+        return "cmos65c02";
+    case InstructionSet::NMOS6502Undocumented:
+        return "nmos6502undocumented";
+    case InstructionSet::Unknown:
+        break;
+    }
+    return fmt::format("[Invalid instruction set {}]", static_cast<int>(instruction_set));
+}
+
+InstructionSet ParseInstructionSet(const std::string &name) {
+    for (auto instruction_set : {InstructionSet::NMOS6502, InstructionSet::NMOS6502Emu,
+                                 InstructionSet::CMOS65C02,
+                                 InstructionSet::NMOS6502Undocumented}) {
+        if (to_string(instruction_set) == name) {
+            return instruction_set;
+        }
+    }
+    throw std::runtime_error(fmt::format("Invalid instruction set: {}", name));
+}
+
 std::string to_string(AddressMode mode) {
     switch (mode) {
     case AddressMode::IM:
@@ -330,6 +487,12 @@ std::string to_string(AddressMode mode) {
         return "Implied";
     case AddressMode::ABS_IND:
         return "ABS_IND";
+    case AddressMode::ZP_IND:
+        return "ZP_IND";
+    case AddressMode::ABS_INDX:
+        return "ABS_INDX";
+    case AddressMode::ZP_REL:
+        return "ZP_REL";
     }
     throw std::runtime_error(
         fmt::format("Invalid address mode: {}", static_cast<int>(mode)));
@@ -347,11 +510,14 @@ size_t ArgumentByteSize(AddressMode mode) {
     case AddressMode::INDY:
     case AddressMode::INDX:
     case AddressMode::REL:
+    case AddressMode::ZP_IND:
         return 1;
     case AddressMode::ABS:
     case AddressMode::ABSX:
     case AddressMode::ABSY:
     case AddressMode::ABS_IND:
+    case AddressMode::ABS_INDX:
+    case AddressMode::ZP_REL:
         return 2;
     }
     throw std::runtime_error(
@@ -364,6 +530,10 @@ const OpcodeInstructionMap &GetInstructionSet(InstructionSet instruction_set) {
         return Get6502InstructionSet();
     case InstructionSet::NMOS6502Emu:
         return Get6502EmuInstructionSet();
+    case InstructionSet::CMOS65C02:
+        return Get65C02InstructionSet();
+    case InstructionSet::NMOS6502Undocumented:
+        return Get6502UndocumentedInstructionSet();
     case InstructionSet::Unknown:
         break;
     }
@@ -381,6 +551,17 @@ const OpcodeInstructionMap &Get6502EmuInstructionSet() {
     return instruction_set;
 }
 
+const OpcodeInstructionMap &Get65C02InstructionSet() {
+    static auto instruction_set = GenerateInstructionSet(InstructionSet::CMOS65C02);
+    return instruction_set;
+}
+
+const OpcodeInstructionMap &Get6502UndocumentedInstructionSet() {
+    static auto instruction_set =
+        GenerateInstructionSet(InstructionSet::NMOS6502Undocumented);
+    return instruction_set;
+}
+
 std::string to_string(Interrupt interrupt) {
     switch (interrupt) {
     case Interrupt::Nmi:
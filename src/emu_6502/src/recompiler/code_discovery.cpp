@@ -0,0 +1,188 @@
+#include "emu_6502/recompiler/recompiler.hpp"
+#include <deque>
+#include <optional>
+#include <string_view>
+
+namespace emu::emu6502::recompiler {
+
+namespace {
+
+using namespace std::string_view_literals;
+
+constexpr size_t kMaxBlockInstructions = 64;
+
+enum class Flow {
+    Next,     // continues with the following instruction
+    Branch,   // target or the following instruction
+    Jump,     // target only
+    Call,     // target, then the following instruction on return
+    Break,    // interrupt handler, then the following instruction on return
+    Indirect, // target is known only at run time
+    Stop,     // HLT, STP
+};
+
+Flow GetFlow(const Instruction &instruction) {
+    const auto &info = instruction.info;
+    // BRA is taken always, following instruction is decoded as if it was not
+    if (info.addres_mode == AddressMode::REL || info.addres_mode == AddressMode::ZP_REL) {
+        return Flow::Branch;
+    }
+    if (info.mnemonic == "JMP"sv) {
+        return info.addres_mode == AddressMode::ABS ? Flow::Jump : Flow::Indirect;
+    }
+    if (info.mnemonic == "JSR"sv) {
+        return Flow::Call;
+    }
+    if (info.mnemonic == "RTS"sv || info.mnemonic == "RTI"sv) {
+        return Flow::Indirect;
+    }
+    if (info.mnemonic == "BRK"sv) {
+        return Flow::Break;
+    }
+    if (info.mnemonic == "HLT"sv || info.mnemonic == "STP"sv) {
+        return Flow::Stop;
+    }
+    return Flow::Next;
+}
+
+class Decoder {
+public:
+    Decoder(const Memory16 &memory, InstructionSet instruction_set) : memory(memory) {
+        for (const auto &[opcode, info] : GetInstructionSet(instruction_set)) {
+            known_opcodes[opcode] = info;
+        }
+    }
+
+    [[nodiscard]] std::optional<Instruction> Decode(MemPtr address) const {
+        auto opcode = memory.DebugRead(address);
+        if (!opcode.has_value() || !known_opcodes[*opcode].has_value()) {
+            return std::nullopt;
+        }
+        Instruction instruction{
+            .address = address,
+            .info = *known_opcodes[*opcode],
+            .length = 1,
+            .operand = {},
+        };
+        auto size = ArgumentByteSize(instruction.info.addres_mode);
+        for (size_t i = 0; i < size; ++i) {
+            auto byte = memory.DebugRead(static_cast<MemPtr>(address + 1 + i));
+            if (!byte.has_value()) {
+                return std::nullopt;
+            }
+            instruction.operand[i] = *byte;
+            ++instruction.length;
+        }
+        return instruction;
+    }
+
+private:
+    const Memory16 &memory;
+    std::array<std::optional<OpcodeInfo>, 256> known_opcodes;
+};
+
+} // namespace
+
+uint16_t CodeBlock::CodeSize() const {
+    uint16_t r = 0;
+    for (const auto &instruction : instructions) {
+        r += instruction.length;
+    }
+    return r;
+}
+
+std::vector<MemPtr> GetVectorEntryPoints(const Memory16 &memory) {
+    std::vector<MemPtr> r;
+    for (auto vector : {kResetVector, kIrqVector, kNmibVector}) {
+        auto low = memory.DebugRead(vector);
+        auto hi = memory.DebugRead(static_cast<MemPtr>(vector + 1));
+        if (low.has_value() && hi.has_value()) {
+            r.emplace_back(static_cast<MemPtr>(*low | (*hi << 8)));
+        }
+    }
+    return r;
+}
+
+CodeMap DiscoverCode(const Memory16 &memory, InstructionSet instruction_set,
+                     const std::vector<MemPtr> &entry_points) {
+    Decoder decoder{memory, instruction_set};
+    CodeMap r;
+
+    std::set<MemPtr> leaders{entry_points.begin(), entry_points.end()};
+    std::set<MemPtr> visited;
+    std::deque<MemPtr> pending{entry_points.begin(), entry_points.end()};
+    auto add_leader = [&](MemPtr address) {
+        leaders.insert(address);
+        pending.emplace_back(address);
+    };
+
+    while (!pending.empty()) {
+        auto address = pending.front();
+        pending.pop_front();
+
+        for (;;) {
+            if (visited.contains(address)) {
+                break;
+            }
+            auto instruction = decoder.Decode(address);
+            if (!instruction.has_value()) {
+                break;
+            }
+            visited.insert(address);
+
+            auto flow = GetFlow(*instruction);
+            if (flow == Flow::Next) {
+                address = instruction->NextAddress();
+                continue;
+            }
+
+            switch (flow) {
+            case Flow::Branch:
+                add_leader(instruction->BranchTarget());
+                add_leader(instruction->NextAddress());
+                break;
+            case Flow::Jump:
+                add_leader(instruction->AbsoluteOperand());
+                break;
+            case Flow::Call:
+                add_leader(instruction->AbsoluteOperand());
+                add_leader(instruction->NextAddress());
+                break;
+            case Flow::Break:
+                add_leader(instruction->NextAddress());
+                break;
+            case Flow::Indirect:
+                r.indirect_jumps.insert(address);
+                break;
+            case Flow::Next:
+            case Flow::Stop:
+                break;
+            }
+            break;
+        }
+    }
+
+    for (auto leader : leaders) {
+        CodeBlock block{.address = leader, .instructions = {}};
+        auto address = leader;
+        while (block.instructions.size() < kMaxBlockInstructions) {
+            auto instruction = decoder.Decode(address);
+            if (!instruction.has_value()) {
+                break;
+            }
+            block.instructions.emplace_back(*instruction);
+            address = instruction->NextAddress();
+            if (GetFlow(*instruction) != Flow::Next || leaders.contains(address) ||
+                (address >> 8) != (leader >> 8)) {
+                break;
+            }
+        }
+        if (!block.instructions.empty()) {
+            r.blocks.emplace(leader, std::move(block));
+        }
+    }
+
+    return r;
+}
+
+} // namespace emu::emu6502::recompiler
@@ -0,0 +1,346 @@
+#include "cpu/block_cache.hpp"
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/cpu/recompiled_program.hpp"
+#include "emu_6502/recompiler/recompiler.hpp"
+#include <fmt/format.h>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace emu::emu6502::recompiler {
+
+namespace {
+
+using namespace std::string_view_literals;
+
+struct FlagTest {
+    std::string_view flag;
+    bool state;
+};
+
+// Branches and flag changes, see Branch and SetFlag handlers of the cpu
+const std::unordered_map<std::string_view, FlagTest> kFlagInstructions = {
+    {"BCC"sv, {"Carry"sv, false}},      {"BCS"sv, {"Carry"sv, true}},
+    {"BEQ"sv, {"Zero"sv, true}},        {"BNE"sv, {"Zero"sv, false}},
+    {"BMI"sv, {"Negative"sv, true}},    {"BPL"sv, {"Negative"sv, false}},
+    {"BVC"sv, {"Overflow"sv, false}},   {"BVS"sv, {"Overflow"sv, true}},
+    {"CLC"sv, {"Carry"sv, false}},      {"SEC"sv, {"Carry"sv, true}},
+    {"CLD"sv, {"DecimalMode"sv, false}}, {"SED"sv, {"DecimalMode"sv, true}},
+    {"CLI"sv, {"IRQB"sv, false}},       {"SEI"sv, {"IRQB"sv, true}},
+    {"CLV"sv, {"Overflow"sv, false}},
+};
+
+// Source and target registers of transfers, increments, loads, stores and compares
+const std::unordered_map<std::string_view, std::pair<std::string_view, std::string_view>>
+    kRegisterInstructions = {
+        {"TAX"sv, {"a"sv, "x"sv}},   {"TAY"sv, {"a"sv, "y"sv}},
+        {"TXA"sv, {"x"sv, "a"sv}},   {"TYA"sv, {"y"sv, "a"sv}},
+        {"TSX"sv, {"stack_pointer"sv, "x"sv}},
+        {"TXS"sv, {"x"sv, "stack_pointer"sv}},
+        {"INX"sv, {"x"sv, "x"sv}},   {"INY"sv, {"y"sv, "y"sv}},
+        {"DEX"sv, {"x"sv, "x"sv}},   {"DEY"sv, {"y"sv, "y"sv}},
+        {"LDA"sv, {""sv, "a"sv}},    {"LDX"sv, {""sv, "x"sv}},
+        {"LDY"sv, {""sv, "y"sv}},    {"STA"sv, {"a"sv, ""sv}},
+        {"STX"sv, {"x"sv, ""sv}},    {"STY"sv, {"y"sv, ""sv}},
+        {"CMP"sv, {"a"sv, ""sv}},    {"CPX"sv, {"x"sv, ""sv}},
+        {"CPY"sv, {"y"sv, ""sv}},
+};
+
+const std::unordered_map<std::string_view, std::string_view> kLogicOperators = {
+    {"AND"sv, "&"sv},
+    {"ORA"sv, "|"sv},
+    {"EOR"sv, "^"sv},
+};
+
+std::string_view InstructionSetName(InstructionSet instruction_set) {
+    switch (instruction_set) {
+    case InstructionSet::NMOS6502:
+        return "NMOS6502";
+    case InstructionSet::NMOS6502Emu:
+        return "NMOS6502Emu";
+    case InstructionSet::CMOS65C02:
+        return "CMOS65C02";
+    case InstructionSet::NMOS6502Undocumented:
+        return "NMOS6502Undocumented";
+    case InstructionSet::Unknown:
+        break;
+    }
+    throw std::runtime_error(
+        fmt::format("Invalid instruction set: {}", static_cast<int>(instruction_set)));
+}
+
+std::string Hex8(uint8_t v) {
+    return fmt::format("0x{:02x}", v);
+}
+
+std::string Hex16(MemPtr v) {
+    return fmt::format("0x{:04x}", v);
+}
+
+class BlockEmitter {
+public:
+    BlockEmitter(std::string &out, const cpu::InstructionCycleArray &cycles)
+        : out(out), cycles(cycles) {}
+
+    void Emit(const CodeBlock &block) {
+        out += fmt::format("void Block_{:04x}(Cpu *cpu, uint32_t *executed) {{\n",
+                           block.address);
+        out += "    auto &reg = cpu->reg;\n";
+        out += "    (void)reg;\n";
+        for (const auto &instruction : block.instructions) {
+            EmitInstruction(instruction);
+        }
+        out += "}\n\n";
+    }
+
+private:
+    std::string &out;
+    const cpu::InstructionCycleArray &cycles;
+
+    void Line(const std::string &text) {
+        out += "    ";
+        out += text;
+        out += "\n";
+    }
+
+    // Program counter is already at the next instruction
+    void ReturnOnInterrupt() {
+        Line("if (InterruptFlagCleared(cpu)) {");
+        Line("    return;");
+        Line("}");
+    }
+
+    // Address of a memory operand. Stores and read-modify-write instructions have the
+    // extra indexing cycle in their base cost (slow), reads spend it when page is
+    // crossed.
+    static std::string Address(const Instruction &instruction, bool slow) {
+        auto zp = Hex8(instruction.operand[0]);
+        auto abs = Hex16(instruction.AbsoluteOperand());
+        auto fast = slow ? "false" : "true";
+        switch (instruction.info.addres_mode) {
+        case AddressMode::ZP:
+            return zp;
+        case AddressMode::ZPX:
+            return fmt::format("ZeroPageIndexed(cpu, {}, reg.x)", zp);
+        case AddressMode::ZPY:
+            return fmt::format("ZeroPageIndexed(cpu, {}, reg.y)", zp);
+        case AddressMode::ABS:
+            return abs;
+        case AddressMode::ABSX:
+            return fmt::format("AbsoluteIndexed<{}>(cpu, {}, reg.x)", fast, abs);
+        case AddressMode::ABSY:
+            return fmt::format("AbsoluteIndexed<{}>(cpu, {}, reg.y)", fast, abs);
+        case AddressMode::INDX:
+            return fmt::format("ZeroPageIndexedIndirect(cpu, {}, reg.x)", zp);
+        case AddressMode::INDY:
+            return fmt::format("ZeroPageIndirectIndexed<{}>(cpu, {}, reg.y)", fast, zp);
+        default:
+            break;
+        }
+        throw std::runtime_error(fmt::format("{:04x}: {} has no memory operand",
+                                             instruction.address,
+                                             instruction.info.mnemonic));
+    }
+
+    // Zero page operands go through direct page of the cpu
+    static bool IsZeroPage(const Instruction &instruction) {
+        auto mode = instruction.info.addres_mode;
+        return mode == AddressMode::ZP || mode == AddressMode::ZPX ||
+               mode == AddressMode::ZPY;
+    }
+
+    static std::string Read(const Instruction &instruction) {
+        if (instruction.info.addres_mode == AddressMode::Immediate) {
+            return Hex8(instruction.operand[0]);
+        }
+        return fmt::format("{}(cpu, {})",
+                           IsZeroPage(instruction) ? "LoadDirect" : "Load",
+                           Address(instruction, false));
+    }
+
+    void EmitInstruction(const Instruction &instruction) {
+        const auto mnemonic = instruction.info.mnemonic;
+        const auto mode = instruction.info.addres_mode;
+
+        Line(fmt::format("// {:04x}: {} {}", instruction.address, mnemonic,
+                         to_string(mode)));
+        Line("++*executed;");
+        Line(fmt::format("Fetch(cpu, {}, {});", Hex16(instruction.NextAddress()),
+                         cycles[instruction.info.opcode]));
+
+        if (auto it = kFlagInstructions.find(mnemonic); it != kFlagInstructions.end()) {
+            const auto &[flag, state] = it->second;
+            if (mode == AddressMode::REL) {
+                auto target = instruction.BranchTarget();
+                bool page_crossed = (target >> 8) != (instruction.NextAddress() >> 8);
+                Line(fmt::format("Branch(cpu, reg.TestFlag(Flags::{}) == {}, {}, {});",
+                                 flag, state, Hex16(target), page_crossed ? 2 : 1));
+            } else {
+                Line(fmt::format("reg.SetFlag(Flags::{}, {});", flag, state));
+            }
+            if (mnemonic == "CLI"sv) {
+                ReturnOnInterrupt();
+            }
+            return;
+        }
+
+        if (auto it = kLogicOperators.find(mnemonic); it != kLogicOperators.end()) {
+            Line(fmt::format("LoadRegister(reg, reg.a, reg.a {} {});", it->second,
+                             Read(instruction)));
+            return;
+        }
+
+        std::string_view source;
+        std::string_view target;
+        if (auto it = kRegisterInstructions.find(mnemonic);
+            it != kRegisterInstructions.end()) {
+            std::tie(source, target) = it->second;
+        }
+
+        const auto shift = fmt::format("Shift::{}", mnemonic);
+
+        if (mnemonic == "LDA"sv || mnemonic == "LDX"sv || mnemonic == "LDY"sv) {
+            Line(fmt::format("LoadRegister(reg, reg.{}, {});", target,
+                             Read(instruction)));
+        } else if (mnemonic == "STA"sv || mnemonic == "STX"sv || mnemonic == "STY"sv) {
+            Line(fmt::format("{}(cpu, {}, reg.{});",
+                             IsZeroPage(instruction) ? "StoreDirect" : "Store",
+                             Address(instruction, true), source));
+        } else if (mnemonic == "CMP"sv || mnemonic == "CPX"sv || mnemonic == "CPY"sv) {
+            Line(fmt::format("Compare(cpu, reg.{}, {});", source, Read(instruction)));
+        } else if (mnemonic == "TXS"sv) {
+            Line(fmt::format("Transfer(cpu, reg.{}, reg.{}, false);", source, target));
+        } else if (mnemonic.starts_with("T"sv)) {
+            Line(fmt::format("Transfer(cpu, reg.{}, reg.{});", source, target));
+        } else if (mnemonic == "INX"sv || mnemonic == "INY"sv) {
+            Line(fmt::format("Increment(cpu, reg.{}, 1);", target));
+        } else if (mnemonic == "DEX"sv || mnemonic == "DEY"sv) {
+            Line(fmt::format("Increment(cpu, reg.{}, -1);", target));
+        } else if (mnemonic == "INC"sv) {
+            Line(fmt::format("MemoryIncrement(cpu, {}, 1);", Address(instruction, true)));
+        } else if (mnemonic == "DEC"sv) {
+            Line(fmt::format("MemoryIncrement(cpu, {}, -1);",
+                             Address(instruction, true)));
+        } else if (mnemonic == "ADC"sv) {
+            Line(fmt::format("Arithmetic<false>(cpu, {});", Read(instruction)));
+        } else if (mnemonic == "SBC"sv) {
+            Line(fmt::format("Arithmetic<true>(cpu, {});", Read(instruction)));
+        } else if (mnemonic == "BIT"sv) {
+            Line(fmt::format("Bit(cpu, {});", Read(instruction)));
+        } else if (mnemonic == "ASL"sv || mnemonic == "LSR"sv || mnemonic == "ROL"sv ||
+                   mnemonic == "ROR"sv) {
+            if (mode == AddressMode::ACC) {
+                Line(fmt::format("ShiftAccumulator<{}>(cpu);", shift));
+            } else {
+                Line(fmt::format("ShiftMemory<{}>(cpu, {});", shift,
+                                 Address(instruction, true)));
+            }
+        } else if (mnemonic == "PHA"sv) {
+            Line("Push(cpu, reg.a);");
+        } else if (mnemonic == "PHP"sv) {
+            Line("PushFlags(cpu);");
+        } else if (mnemonic == "PLA"sv) {
+            Line("PullAccumulator(cpu);");
+        } else if (mnemonic == "PLP"sv) {
+            Line("PullFlags(cpu);");
+            ReturnOnInterrupt();
+        } else if (mnemonic == "NOP"sv) {
+            // base cost only
+        } else if (mnemonic == "JMP"sv) {
+            if (mode == AddressMode::ABS) {
+                Line(fmt::format("reg.program_counter = {};",
+                                 Hex16(instruction.AbsoluteOperand())));
+            } else {
+                Line(fmt::format("JumpIndirect(cpu, {});",
+                                 Hex16(instruction.AbsoluteOperand())));
+            }
+        } else if (mnemonic == "JSR"sv) {
+            Line(fmt::format("JumpSubroutine(cpu, {});",
+                             Hex16(instruction.AbsoluteOperand())));
+        } else if (mnemonic == "RTS"sv) {
+            Line("ReturnFromSubroutine(cpu);");
+        } else if (mnemonic == "RTI"sv) {
+            Line("ReturnFromInterrupt(cpu);");
+        } else if (mnemonic == "BRK"sv) {
+            Line("Break(cpu);");
+        } else if (mnemonic == "HLT"sv) {
+            Line(fmt::format("Halt(cpu, {});",
+                             mode == AddressMode::ACC ? "reg.a" : Read(instruction)));
+        } else {
+            throw std::runtime_error(fmt::format("{:04x}: {} can not be recompiled",
+                                                 instruction.address, mnemonic));
+        }
+    }
+};
+
+} // namespace
+
+std::string GenerateCpp(const CodeMap &code, InstructionSet instruction_set,
+                        const std::string &source_name) {
+    if (instruction_set == InstructionSet::CMOS65C02) {
+        // Runtime helpers and the emitter cover NMOS instructions only
+        throw std::runtime_error("65C02 code can not be recompiled");
+    }
+
+    std::string out;
+    out += fmt::format("// Generated by emu_6502_recompile from {}, do not edit\n",
+                       source_name);
+    out += fmt::format("// {} blocks, indirect jumps at:", code.blocks.size());
+    for (auto address : code.indirect_jumps) {
+        out += fmt::format(" {:04x}", address);
+    }
+    out += "\n\n";
+    out += "#include \"emu_6502/recompiler/runtime.hpp\"\n";
+    out += "#include <cstdint>\n";
+    out += "#include <iterator>\n\n";
+    out += "namespace {\n\n";
+    out += "using namespace emu::emu6502;\n";
+    out += "using namespace emu::emu6502::recompiler::runtime;\n\n";
+
+    const auto &cycles = cpu::Cpu::GetInstructionCycleArray(instruction_set);
+    BlockEmitter emitter{out, cycles};
+    for (const auto &[address, block] : code.blocks) {
+        emitter.Emit(block);
+    }
+
+    for (const auto &[address, block] : code.blocks) {
+        out += fmt::format("const uint8_t kCode_{:04x}[] = {{", address);
+        for (const auto &instruction : block.instructions) {
+            out += fmt::format("0x{:02x}, ", instruction.info.opcode);
+            for (uint8_t i = 1; i < instruction.length; ++i) {
+                out += fmt::format("0x{:02x}, ", instruction.operand[i - 1]);
+            }
+        }
+        out += "};\n";
+    }
+    out += "\n";
+
+    out += "const cpu::RecompiledBlock kBlocks[] = {\n";
+    for (const auto &[address, block] : code.blocks) {
+        uint32_t max_cycles = 0;
+        for (const auto &instruction : block.instructions) {
+            max_cycles += cycles[instruction.info.opcode] + cpu::kMaxPenaltyCycles;
+        }
+        out += fmt::format(
+            "    {{0x{0:04x}, {1}, {2}, {3}, kCode_{0:04x}, &Block_{0:04x}}},\n",
+            address, block.instructions.size(), block.CodeSize(), max_cycles);
+    }
+    out += "};\n\n";
+
+    out += "const cpu::RecompiledProgram kProgram{\n";
+    out += "    cpu::kRecompiledAbiVersion,\n";
+    out += fmt::format("    InstructionSet::{},\n", InstructionSetName(instruction_set));
+    out += "    kBlocks,\n";
+    out += "    std::size(kBlocks),\n";
+    out += "};\n\n";
+    out += "} // namespace\n\n";
+
+    out += fmt::format("EMU6502_RECOMPILED_EXPORT const "
+                       "emu::emu6502::cpu::RecompiledProgram *{}() {{\n",
+                       cpu::kRecompiledProgramSymbol);
+    out += "    return &kProgram;\n";
+    out += "}\n";
+    return out;
+}
+
+} // namespace emu::emu6502::recompiler
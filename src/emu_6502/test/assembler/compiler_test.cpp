@@ -242,6 +242,52 @@ LDA #ALIAS
     return {"alias", code, expected, InstructionSet::Default};
 }
 
+AssemblerTestArg GetCmosTest() {
+    auto L1 = std::make_shared<SymbolInfo>(SymbolInfo{"L1", 0_addr, std::nullopt, false});
+    auto L2 = std::make_shared<SymbolInfo>(SymbolInfo{"L2", 9_addr, std::nullopt, false});
+    Program expected = {
+        .sparse_binary_code =
+            SparseBinaryCode({INS_BBR0, 0x12_u8, 0x06_u8, INS_LDA_INDZP, 0x12_u8,
+                              INS_STZ_ZP, 0x34_u8, INS_BRA, 0xf7_u8, INS_NOP}),
+        .symbols = {{"L1", L1}, {"L2", L2}},
+        .relocations =
+            {
+                std::make_shared<RelocationInfo>(
+                    RelocationInfo{L2, 2_addr, RelocationMode::Relative}),
+                std::make_shared<RelocationInfo>(
+                    RelocationInfo{L1, 8_addr, RelocationMode::Relative}),
+            },
+    };
+    auto code = R"==(
+L1:
+    BBR0 $12,L2
+    LDA ($12)
+    STZ $34
+    BRA L1
+L2:
+    NOP
+)=="s;
+    return {"cmos", code, expected, InstructionSet::CMOS65C02};
+}
+
+AssemblerTestArg GetUndocumentedTest() {
+    Program expected = {
+        .sparse_binary_code =
+            SparseBinaryCode({INS_NOP, INS_SBC, 0x01_u8, INS_LAX_ZP, 0x12_u8,
+                              kNopZP[0], 0x12_u8, INS_DCP_ABSY, 0x00_u8, 0x20_u8}),
+        .symbols = {},
+        .relocations = {},
+    };
+    auto code = R"==(
+    NOP
+    SBC #$01
+    LAX $12
+    NOP $12
+    DCP $2000,Y
+)=="s;
+    return {"undocumented", code, expected, InstructionSet::NMOS6502Undocumented};
+}
+
 INSTANTIATE_TEST_SUITE_P(positive, CompilerTest,
                          ::testing::ValuesIn({
                              GetAbsoluteAddressingTest(),
@@ -254,6 +300,8 @@ INSTANTIATE_TEST_SUITE_P(positive, CompilerTest,
                              GetImmediateTest(),
                              GetZPTest(),
                              GetAliasTest(),
+                             GetCmosTest(),
+                             GetUndocumentedTest(),
                          }),
                          [](auto &info) { return std::get<0>(info.param); });
 
@@ -266,6 +314,11 @@ INSTANTIATE_TEST_SUITE_P(
                          InstructionSet::Default},
         AssemblerTestArg{"invalid_abs_ind_mode", "INC ($1234)", std::nullopt,
                          InstructionSet::Default},
+        AssemblerTestArg{"nmos_zp_ind_mode", "LDA ($12)", std::nullopt,
+                         InstructionSet::Default},
+        AssemblerTestArg{"nmos_bbr", "L1:\nBBR0 $12,L1", std::nullopt,
+                         InstructionSet::Default},
+        AssemblerTestArg{"nmos_lax", "LAX $12", std::nullopt, InstructionSet::Default},
     }),
     [](auto &info) { return std::get<0>(info.param); });
 
@@ -71,10 +71,12 @@ std::vector<ArgumentParseTestArg> GetTestCases() {
         ArgumentParseTestArg{"#byte"s, InstructionArgument{{AM::Immediate}, u8v{1}}}, //
         ArgumentParseTestArg{"#word"s, std::nullopt},                                 //
         // | Indirect Absolute   |          (aaaa)          |
-        ArgumentParseTestArg{"(LABEL)"s, InstructionArgument{{AM::ABS_IND}, "LABEL"s}}, //
+        // | Zero Page Indirect  |          (aa)            |
+        ArgumentParseTestArg{"(LABEL)"s,
+                             InstructionArgument{{AM::ABS_IND, AM::ZP_IND}, "LABEL"s}}, //
         ArgumentParseTestArg{"($55aa)"s,
-                             InstructionArgument{{AM::ABS_IND}, u8v{0xaa, 0x55}}}, //
-        ArgumentParseTestArg{"($55)"s, std::nullopt},                              //
+                             InstructionArgument{{AM::ABS_IND}, u8v{0xaa, 0x55}}},   //
+        ArgumentParseTestArg{"($55)"s, InstructionArgument{{AM::ZP_IND}, u8v{0x55}}}, //
 
         // | Absolute Indexed,X  |          aaaa,X          |
         ArgumentParseTestArg{"$55aa,X"s,
@@ -116,10 +118,13 @@ std::vector<ArgumentParseTestArg> GetTestCases() {
         ArgumentParseTestArg{"word"s, InstructionArgument{{AM::ABS}, u8v{1, 2}}}, //
 
         // | Indexed Indirect    |          (aa,X)          |
-        ArgumentParseTestArg{"($FF,X)"s, InstructionArgument{{AM::INDX}, u8v{0xFF}}},  //
-        ArgumentParseTestArg{"(LABEL,X)"s, InstructionArgument{{AM::INDX}, "LABEL"s}}, //
-        ArgumentParseTestArg{"(byte,X)"s, InstructionArgument{{AM::INDX}, u8v{1}}},    //
-        ArgumentParseTestArg{"(word,X)"s, std::nullopt},                               //
+        // | Abs Indexed Indirect|          (aaaa,X)        |
+        ArgumentParseTestArg{"($FF,X)"s, InstructionArgument{{AM::INDX}, u8v{0xFF}}}, //
+        ArgumentParseTestArg{"(LABEL,X)"s,
+                             InstructionArgument{{AM::INDX, AM::ABS_INDX}, "LABEL"s}}, //
+        ArgumentParseTestArg{"(byte,X)"s, InstructionArgument{{AM::INDX}, u8v{1}}},  //
+        ArgumentParseTestArg{"(word,X)"s,
+                             InstructionArgument{{AM::ABS_INDX}, u8v{1, 2}}}, //
 
         // | Indirect Indexed    |          (aa),Y          |
         ArgumentParseTestArg{"($FF),Y"s, InstructionArgument{{AM::INDY}, u8v{0xFF}}},  //
@@ -127,6 +132,18 @@ std::vector<ArgumentParseTestArg> GetTestCases() {
         ArgumentParseTestArg{"(byte),Y"s, InstructionArgument{{AM::INDY}, u8v{1}}},    //
         ArgumentParseTestArg{"(word,Y)"s, std::nullopt},                               //
 
+        // | Zero Page Relative  |          aa,label        |
+        ArgumentParseTestArg{
+            "$12,LABEL"s,
+            InstructionArgument{{AM::ZP_REL},
+                                ZeroPageRelativeArgument{u8v{0x12}, "LABEL"s}}}, //
+        ArgumentParseTestArg{
+            "byte,LABEL"s,
+            InstructionArgument{{AM::ZP_REL},
+                                ZeroPageRelativeArgument{u8v{1}, "LABEL"s}}}, //
+        ArgumentParseTestArg{"word,LABEL"s, std::nullopt}, //
+        ArgumentParseTestArg{"$12,$34"s, std::nullopt},    //
+
         // | Implied             |                          |
         ArgumentParseTestArg{""s, InstructionArgument{{AM::Implied}, nullptr}}, //
         // | Accumulator         |          A               |
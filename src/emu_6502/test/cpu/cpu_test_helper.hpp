@@ -0,0 +1,62 @@
+#pragma once
+
+#include "emu_6502/assembler/compiler.hpp"
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/clock.hpp"
+#include "emu_core/memory/memory_sparse.hpp"
+#include "emu_core/program.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace emu::emu6502::test {
+
+// Sparse memory which throws on access to an address never written, areas a program
+// uses besides its code have to be filled
+struct StrictMemory : public memory::MemorySparse16 {
+    explicit StrictMemory(Clock *clock) : memory::MemorySparse16(clock, true) {}
+};
+
+// Clock, memory and cpu of a test. Memory gets the clock first when it takes one, then
+// the extra constructor arguments.
+template <typename MemoryT = StrictMemory, typename CpuT = cpu::Cpu>
+struct BasicCpuState {
+    ClockSimple clock;
+    MemoryT memory;
+    const InstructionSet instruction_set;
+    CpuT cpu;
+
+    template <typename... MemoryArgs>
+    BasicCpuState(cpu::ExecutionEngine engine, InstructionSet instruction_set,
+                  MemoryArgs &&...memory_args)
+        : memory{MakeMemory(std::forward<MemoryArgs>(memory_args)...)},
+          instruction_set(instruction_set),
+          cpu{&clock, &memory, nullptr, instruction_set, nullptr, engine} {}
+
+    // Assembles code into memory, program is returned for its symbols
+    std::unique_ptr<Program> Load(const std::string &code) {
+        auto program = assembler::CompileString(code, instruction_set);
+        memory.WriteSparse(program->sparse_binary_code.sparse_map);
+        return program;
+    }
+
+    // Runs until the program stops, time limit only ends a test which hangs
+    cpu::ExecutionResult Run() { return cpu.ExecuteFor(std::chrono::seconds{10}); }
+
+private:
+    template <typename... Args>
+    MemoryT MakeMemory(Args &&...args) {
+        if constexpr (std::is_constructible_v<MemoryT, Clock *, Args...>) {
+            return MemoryT{&clock, std::forward<Args>(args)...};
+        } else {
+            return MemoryT{std::forward<Args>(args)...};
+        }
+    }
+};
+
+using CpuState = BasicCpuState<>;
+
+} // namespace emu::emu6502::test
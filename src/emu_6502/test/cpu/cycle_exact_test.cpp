@@ -0,0 +1,242 @@
+#include "cpu_test_helper.hpp"
+#include "emu_core/memory.hpp"
+#include <array>
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/opcode.hpp>
+#include <emu_core/clock.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace emu::emu6502::test {
+namespace {
+
+struct BusAccess {
+    uint64_t cycle;
+    MemPtr address;
+    bool write;
+    uint8_t value;
+
+    bool operator==(const BusAccess &) const = default;
+};
+
+std::ostream &operator<<(std::ostream &o, const BusAccess &access) {
+    return o << fmt::format("{} {} {:04x} {:02x}", access.cycle, access.write ? "W" : "R",
+                            access.address, access.value);
+}
+
+// Flat memory which notes every access with the cycle of the clock it was made in
+class RecordingMemory : public Memory16 {
+public:
+    explicit RecordingMemory(const Clock *clock) : clock(clock) { bytes.fill(kFill); }
+
+    [[nodiscard]] uint8_t Load(MemPtr address) const override {
+        accesses.emplace_back(
+            BusAccess{clock->CurrentCycle(), address, false, bytes[address]});
+        return bytes[address];
+    }
+    void Store(MemPtr address, uint8_t value) override {
+        accesses.emplace_back(BusAccess{clock->CurrentCycle(), address, true, value});
+        bytes[address] = value;
+    }
+    [[nodiscard]] std::optional<uint8_t> DebugRead(MemPtr address) const override {
+        return bytes[address];
+    }
+
+    // Operands, pointers, vectors and pulled bytes are all 0x2020
+    static constexpr uint8_t kFill = 0x20;
+
+    std::array<uint8_t, 0x10000> bytes{};
+    mutable std::vector<BusAccess> accesses;
+
+private:
+    const Clock *const clock;
+};
+
+struct CycleExactState : public BasicCpuState<RecordingMemory> {
+    explicit CycleExactState(InstructionSet instruction_set)
+        : BasicCpuState(cpu::ExecutionEngine::CycleExact, instruction_set) {
+        cpu.Reset();
+    }
+
+    // Accesses of the single instruction at address
+    std::vector<BusAccess> Run(MemPtr address, std::initializer_list<uint8_t> code,
+                               uint8_t index = 0, uint8_t flags = 0) {
+        for (auto byte : code) {
+            memory.bytes[address++] = byte;
+        }
+        cpu.reg.program_counter = address - code.size();
+        cpu.reg.x = index;
+        cpu.reg.y = index;
+        cpu.reg.flags = flags;
+        memory.accesses.clear();
+        cpu.ExecuteNextInstruction();
+        return memory.accesses;
+    }
+};
+
+class CycleExactTest : public testing::TestWithParam<InstructionSet> {};
+
+// Every opcode, with and without page crossing and taken branches
+TEST_P(CycleExactTest, EveryCycleIsBusAccess) {
+    for (unsigned opcode = 0; opcode < 0x100; ++opcode) {
+        for (MemPtr address : {0x2000, 0x20F0}) {
+            for (uint8_t index : {0x00, 0xF0}) {
+                for (uint8_t flags : {0x00, 0xFF}) {
+                    SCOPED_TRACE(fmt::format("opcode {:02x} at {:04x} index {:02x} "
+                                             "flags {:02x}",
+                                             opcode, address, index, flags));
+                    CycleExactState state{GetParam()};
+                    const uint64_t start = state.cpu.ExecutedCycles();
+                    auto accesses =
+                        state.Run(address, {static_cast<uint8_t>(opcode)}, index, flags);
+                    const uint64_t cycles = state.cpu.ExecutedCycles() - start;
+
+                    EXPECT_EQ(accesses.size(), cycles);
+                    for (size_t i = 0; i < accesses.size(); ++i) {
+                        EXPECT_EQ(accesses[i].cycle, start + i);
+                    }
+                    EXPECT_EQ(state.clock.CurrentCycle(), state.cpu.ExecutedCycles());
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(, CycleExactTest,
+                         testing::Values(InstructionSet::NMOS6502,
+                                         InstructionSet::NMOS6502Emu,
+                                         InstructionSet::CMOS65C02,
+                                         InstructionSet::NMOS6502Undocumented),
+                         [](const auto &info) { return to_string(info.param); });
+
+TEST(CycleExactBusTest, ReadModifyWriteWritesTwice) {
+    CycleExactState state{InstructionSet::NMOS6502};
+    state.memory.bytes[0x10] = 0x41;
+    auto accesses = state.Run(0x2000, {cpu::opcode::INS_INC_ZP, 0x10});
+
+    const uint64_t c = accesses.front().cycle;
+    EXPECT_EQ(accesses, (std::vector<BusAccess>{
+                            {c + 0, 0x2000, false, cpu::opcode::INS_INC_ZP},
+                            {c + 1, 0x2001, false, 0x10},
+                            {c + 2, 0x0010, false, 0x41},
+                            {c + 3, 0x0010, true, 0x41},
+                            {c + 4, 0x0010, true, 0x42},
+                        }));
+}
+
+TEST(CycleExactBusTest, ReadModifyWriteReadsTwiceOn65C02) {
+    CycleExactState state{InstructionSet::CMOS65C02};
+    state.memory.bytes[0x10] = 0x41;
+    auto accesses = state.Run(0x2000, {cpu::opcode::INS_INC_ZP, 0x10});
+
+    const uint64_t c = accesses.front().cycle;
+    EXPECT_EQ(accesses, (std::vector<BusAccess>{
+                            {c + 0, 0x2000, false, cpu::opcode::INS_INC_ZP},
+                            {c + 1, 0x2001, false, 0x10},
+                            {c + 2, 0x0010, false, 0x41},
+                            {c + 3, 0x0010, false, 0x41},
+                            {c + 4, 0x0010, true, 0x42},
+                        }));
+}
+
+TEST(CycleExactBusTest, IndexedStoreReadsUnfixedAddress) {
+    CycleExactState state{InstructionSet::NMOS6502};
+    state.cpu.reg.a = 0x55;
+    auto accesses = state.Run(0x2000, {cpu::opcode::INS_STA_ABSX, 0xF0, 0x30}, 0x20);
+
+    ASSERT_EQ(accesses.size(), 5);
+    EXPECT_EQ(accesses[3].address, 0x3010);
+    EXPECT_FALSE(accesses[3].write);
+    EXPECT_EQ(accesses[4].address, 0x3110);
+    EXPECT_TRUE(accesses[4].write);
+}
+
+TEST(CycleExactBusTest, IndexedReadWithinPageHasNoDummyRead) {
+    CycleExactState state{InstructionSet::NMOS6502};
+    auto accesses = state.Run(0x2000, {cpu::opcode::INS_LDA_ABSX, 0x10, 0x30}, 0x20);
+
+    ASSERT_EQ(accesses.size(), 4);
+    EXPECT_EQ(accesses[3].address, 0x3030);
+}
+
+TEST(CycleExactBusTest, TakenBranchAcrossPage) {
+    CycleExactState state{InstructionSet::NMOS6502};
+    // BNE +0x20 from 0x20F2 lands in the next page
+    auto accesses = state.Run(0x20F0, {cpu::opcode::INS_BNE, 0x20});
+
+    ASSERT_EQ(accesses.size(), 4);
+    EXPECT_EQ(accesses[2].address, 0x20F2);
+    EXPECT_EQ(accesses[3].address, 0x2012);
+    EXPECT_EQ(state.cpu.reg.program_counter, 0x2112);
+}
+
+// IRQ and NMI read the opcode at PC twice, push PC and flags and read the vector
+TEST(CycleExactBusTest, InterruptEntryIsSevenAccesses) {
+    for (auto interrupt : {Interrupt::Irq, Interrupt::Nmi}) {
+        SCOPED_TRACE(to_string(interrupt));
+        CycleExactState state{InstructionSet::NMOS6502};
+        if (interrupt == Interrupt::Irq) {
+            state.cpu.SetIrq(0, true);
+        } else {
+            state.cpu.TriggerNmi();
+        }
+        const MemPtr stack = kStackBase | state.cpu.reg.stack_pointer;
+        const uint64_t start = state.cpu.ExecutedCycles();
+        auto accesses = state.Run(0x2000, {cpu::opcode::INS_NOP});
+
+        const uint64_t c = accesses.front().cycle;
+        const MemPtr vector = InterruptHandlerAddress(interrupt);
+        EXPECT_EQ(accesses, (std::vector<BusAccess>{
+                                {c + 0, 0x2000, false, cpu::opcode::INS_NOP},
+                                {c + 1, 0x2001, false, RecordingMemory::kFill},
+                                {c + 2, 0x2001, false, RecordingMemory::kFill},
+                                {c + 3, 0x2001, false, RecordingMemory::kFill},
+                                {c + 4, stack, true, 0x20},
+                                {c + 5, static_cast<MemPtr>(stack - 1), true, 0x01},
+                                {c + 6, static_cast<MemPtr>(stack - 2), true, 0x20},
+                                {c + 7, vector, false, RecordingMemory::kFill},
+                                {c + 8, static_cast<MemPtr>(vector + 1), false,
+                                 RecordingMemory::kFill},
+                            }));
+        EXPECT_EQ(state.cpu.ExecutedCycles() - start, accesses.size());
+        EXPECT_EQ(state.clock.CurrentCycle(), state.cpu.ExecutedCycles());
+        EXPECT_EQ(state.cpu.reg.program_counter, 0x2020);
+    }
+}
+
+TEST(CycleExactBusTest, MatchesFastEngine) {
+    for (auto engine :
+         {cpu::ExecutionEngine::Reference, cpu::ExecutionEngine::Threaded}) {
+        CycleExactState exact{InstructionSet::NMOS6502};
+        ClockSimple clock;
+        RecordingMemory memory{&clock};
+        cpu::Cpu fast{&clock,  &memory, nullptr, InstructionSet::NMOS6502,
+                      nullptr, engine};
+        fast.Reset();
+
+        // INC $3000,X; ROR $10; JSR $2020 over and over
+        for (auto *bytes : {&exact.memory.bytes, &memory.bytes}) {
+            (*bytes)[0x2020] = cpu::opcode::INS_INC_ABSX;
+            (*bytes)[0x2021] = 0x00;
+            (*bytes)[0x2022] = 0x30;
+            (*bytes)[0x2023] = cpu::opcode::INS_ROR_ZP;
+            (*bytes)[0x2024] = 0x10;
+            (*bytes)[0x2025] = cpu::opcode::INS_JSR;
+        }
+        exact.cpu.ExecuteInstructions(300);
+        fast.ExecuteInstructions(300);
+
+        EXPECT_EQ(exact.cpu.reg.Dump(), fast.reg.Dump());
+        EXPECT_EQ(exact.clock.CurrentCycle(), clock.CurrentCycle());
+        EXPECT_EQ(exact.memory.bytes, memory.bytes);
+    }
+}
+
+TEST(CycleExactBusTest, RecompiledProgramIsRejected) {
+    CycleExactState state{InstructionSet::NMOS6502};
+    cpu::RecompiledProgram program{.instruction_set = InstructionSet::NMOS6502};
+    EXPECT_THROW(state.cpu.AttachRecompiledProgram(&program), std::runtime_error);
+}
+
+} // namespace
+} // namespace emu::emu6502::test
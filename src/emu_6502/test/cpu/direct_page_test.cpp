@@ -0,0 +1,97 @@
+#include "cpu_test_helper.hpp"
+#include <algorithm>
+#include <array>
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/opcode.hpp>
+#include <emu_core/clock.hpp>
+#include <gtest/gtest.h>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace emu::emu6502::test {
+namespace {
+
+// Flat memory which notes addresses of accesses made through the interface, low pages
+// are handed out as direct ones on request
+class CountingMemory : public Memory16 {
+public:
+    explicit CountingMemory(bool direct) : direct(direct) {}
+
+    [[nodiscard]] uint8_t Load(MemPtr address) const override {
+        accesses.emplace_back(address);
+        return bytes[address];
+    }
+    void Store(MemPtr address, uint8_t value) override {
+        accesses.emplace_back(address);
+        bytes[address] = value;
+    }
+    [[nodiscard]] std::optional<uint8_t> DebugRead(MemPtr address) const override {
+        return bytes[address];
+    }
+    [[nodiscard]] uint8_t *DirectRange(MemPtr address, size_t len) override {
+        return direct ? bytes.data() + address : nullptr;
+    }
+
+    [[nodiscard]] size_t LowPageAccesses() const {
+        return std::ranges::count_if(accesses, [](MemPtr a) { return a < 0x200; });
+    }
+
+    std::array<uint8_t, 0x10000> bytes{};
+    mutable std::vector<MemPtr> accesses;
+
+private:
+    const bool direct;
+};
+
+using DirectPageParam = std::tuple<cpu::ExecutionEngine, bool>;
+
+class DirectPageTest : public testing::TestWithParam<DirectPageParam> {};
+
+// LDA #$42; PHA; PLA; STA $10; LDA #$30; STA $11; LDY #$01; STA ($10),Y; JSR $2020;
+// HLT #$00; $2020: LDA $10; RTS
+TEST_P(DirectPageTest, LowPagesBypassInterface) {
+    auto [engine, direct] = GetParam();
+    BasicCpuState<CountingMemory> state{engine, InstructionSet::NMOS6502Emu, direct};
+    auto &memory = state.memory;
+    auto &cpu = state.cpu;
+    using namespace cpu::opcode;
+    const std::vector<uint8_t> code{
+        INS_LDA_IM,   0x42, INS_PHA,    INS_PLA, INS_STA_ZP, 0x10,
+        INS_LDA_IM,   0x30, INS_STA_ZP, 0x11,    INS_LDY_IM, 0x01,
+        INS_STA_INDY, 0x10, INS_JSR,    0x20,    0x20,       INS_HLT_IM,
+        0x00,
+    };
+    std::ranges::copy(code, memory.bytes.begin() + 0x2000);
+    memory.bytes[0x2020] = INS_LDA_ZP;
+    memory.bytes[0x2021] = 0x10;
+    memory.bytes[0x2022] = INS_RTS;
+    memory.bytes[0xFFFD] = 0x20;
+
+    cpu.Reset();
+    auto generations = cpu.CodePageGenerations();
+    auto result = cpu.ExecuteInstructions(100);
+
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(cpu.reg.a, 0x42);
+    EXPECT_EQ(memory.bytes[0x10], 0x42);
+    EXPECT_EQ(memory.bytes[0x3043], 0x30);
+    EXPECT_EQ(memory.LowPageAccesses() == 0, direct);
+    // Stores to direct pages still drop decoded code of the page
+    EXPECT_NE(cpu.CodePageGenerations()[0], generations[0]);
+    EXPECT_NE(cpu.CodePageGenerations()[1], generations[1]);
+}
+
+INSTANTIATE_TEST_SUITE_P(, DirectPageTest,
+                         testing::Combine(testing::Values(cpu::ExecutionEngine::Reference,
+                                                          cpu::ExecutionEngine::Threaded,
+                                                          cpu::ExecutionEngine::Cached,
+                                                          cpu::ExecutionEngine::Jit),
+                                          testing::Bool()),
+                         [](const auto &info) {
+                             return to_string(std::get<0>(info.param)) +
+                                    (std::get<1>(info.param) ? "_Direct" : "_Interface");
+                         });
+
+} // namespace
+} // namespace emu::emu6502::test
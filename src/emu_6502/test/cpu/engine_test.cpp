@@ -0,0 +1,407 @@
+#include "cpu_test_helper.hpp"
+#include "emu_core/memory.hpp"
+#include "lockstep_helper.hpp"
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/opcode.hpp>
+#include <emu_core/clock.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <gtest/gtest.h>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace emu::emu6502::test {
+namespace {
+
+using namespace std::string_literals;
+
+const auto kEngineTestCode = R"==(
+.isr reset TEST_ENTRY
+.isr irq IRQ_HANDLER
+
+.org 0x80
+counter: .byte 0
+sum_low: .byte 0
+sum_hi: .byte 0
+pointer: .byte 0x00, 0x30
+
+.org 0x2000
+TEST_ENTRY:
+    LDY #$00
+    LDX #$40
+LOOP:
+    LDA ($83),Y
+    CLC
+    ADC sum_low
+    STA sum_low
+    LDA sum_hi
+    ADC #$00
+    STA sum_hi
+    EOR counter
+    ASL A
+    ASL counter
+    ROL counter
+    BRK #$00
+    INY
+    DEX
+    BNE LOOP
+    LDA counter
+    PHA
+    PLA
+    CMP sum_low
+    BCC DONE
+    SBC sum_hi
+DONE:
+    HLT A
+
+IRQ_HANDLER:
+    INC counter
+    RTI
+
+.org 0x3000
+DATA:
+.byte 0x01, 0x32, 0x74, 0xf0, 0x11, 0x80, 0x7f, 0x55, 0xaa, 0x00, 0xff, 0x12, 0x34, 0x56, 0x78, 0x9a
+)=="s;
+
+// Patches immediate operands of code which already ran and of the next instruction
+// in the same straight-line block
+const auto kSelfModifyingCode = R"==(
+.isr reset TEST_ENTRY
+
+.org 0x80
+sum: .byte 0
+
+.org 0x2000
+TEST_ENTRY:
+    LDY #$00
+LOOP:
+    LDA #$01
+    CLC
+    ADC sum
+    STA sum
+    LDA #$05
+    STA $2003
+    INY
+    CPY #$03
+    BNE LOOP
+    LDA #$10
+    STA $201B
+    LDX #$00
+    TXA
+    CLC
+    ADC sum
+    HLT A
+)=="s;
+
+// Every pair of fused_pairs.hpp at least once
+const auto kFusedPairsCode = R"==(
+.isr reset TEST_ENTRY
+
+.org 0x2000
+TEST_ENTRY:
+    LDX #$20
+    LDY #$00
+OUTER:
+    LDA $3000,Y
+    STA $81
+    LDA $81
+    STA $3080
+    LDA $3000,Y
+    STA $3081
+    LDA $3000,Y
+    STA $30C0,X
+    INC $80
+    BNE NEXT
+NEXT:
+    INY
+    CMP #$55
+    BNE SKIP
+    INC $80
+SKIP:
+    DEX
+    BNE OUTER
+    LDY #$10
+INNER:
+    DEY
+    BNE INNER
+    LDA $80
+    HLT A
+
+.org 0x3000
+DATA:
+.byte 0x01, 0x32, 0x55, 0xf0, 0x11, 0x80, 0x7f, 0x55
+.byte 0xaa, 0x00, 0xff, 0x12, 0x34, 0x56, 0x78, 0x9a
+)=="s;
+
+constexpr MemPtr kDataPage = 0x3000;
+
+template <typename CpuT>
+struct BasicEngineState : public BasicCpuState<StrictMemory, CpuT> {
+    std::optional<uint8_t> halt_code;
+
+    explicit BasicEngineState(cpu::ExecutionEngine engine,
+                              const std::string &code = kEngineTestCode)
+        : BasicCpuState<StrictMemory, CpuT>(engine, InstructionSet::NMOS6502Emu) {
+        this->memory.Fill(kZeroPageBase, kMemoryPageSize);
+        this->memory.Fill(kStackBase, kMemoryPageSize);
+        this->memory.Fill(kDataPage, kMemoryPageSize);
+        this->Load(code);
+    }
+
+    void Run() {
+        auto result = BasicCpuState<StrictMemory, CpuT>::Run();
+        if (result.status == cpu::ExecutionStatus::Halted) {
+            halt_code = result.halt_code;
+        }
+    }
+};
+
+using EngineState = BasicEngineState<cpu::Cpu>;
+using SpecializedEngineState =
+    BasicEngineState<cpu::BasicCpu<memory::MemorySparse16, ClockSimple>>;
+
+// Steps of the tested engine are long enough for whole blocks, fused pairs and jit code
+constexpr uint64_t kLockstepInstructions = 1'000'000;
+constexpr uint64_t kLockstepStep = 256;
+
+void ExpectSameAsReference(cpu::Cpu &tested, const std::string &code = kEngineTestCode) {
+    EngineState reference{cpu::ExecutionEngine::Reference, code};
+    reference.cpu.Reset();
+    tested.Reset();
+    EXPECT_TRUE(RunInLockstep(InstructionSet::NMOS6502Emu, reference.cpu, tested,
+                              kLockstepInstructions, kLockstepStep));
+    EXPECT_EQ(reference.cpu.Status(), cpu::ExecutionStatus::Halted);
+}
+
+class EngineTest : public testing::TestWithParam<cpu::ExecutionEngine> {};
+
+TEST_P(EngineTest, MatchesReference) {
+    EngineState tested{GetParam()};
+    ExpectSameAsReference(tested.cpu);
+}
+
+TEST_P(EngineTest, SpecializedCpuMatchesReference) {
+    SpecializedEngineState tested{GetParam()};
+    ExpectSameAsReference(tested.cpu);
+}
+
+TEST_P(EngineTest, FusedPairsMatchReference) {
+    EngineState tested{GetParam(), kFusedPairsCode};
+    ExpectSameAsReference(tested.cpu, kFusedPairsCode);
+
+    if (GetParam() == cpu::ExecutionEngine::Cached) {
+        std::set<std::string_view> fused;
+        for (const auto &[name, count] : tested.cpu.FusedPairCounts()) {
+            fused.insert(name);
+        }
+        EXPECT_EQ(fused.size(), 8);
+    } else if (GetParam() != cpu::ExecutionEngine::Jit) {
+        EXPECT_TRUE(tested.cpu.FusedPairCounts().empty());
+    }
+}
+
+// Events fall between the halves of fused pairs too, each one sees the state the
+// reference engine sees
+TEST_P(EngineTest, FusedPairsSeeEventsBetweenHalves) {
+    auto run = [](cpu::ExecutionEngine engine) {
+        EngineState state{engine, kFusedPairsCode};
+        std::vector<std::pair<uint64_t, MemPtr>> seen;
+        for (uint64_t cycle = 0; cycle < 3000; cycle += 7) {
+            state.cpu.Scheduler().Schedule(cycle, [&](uint64_t) {
+                seen.emplace_back(state.cpu.ExecutedCycles(),
+                                  state.cpu.reg.program_counter);
+            });
+        }
+        state.Run();
+        EXPECT_TRUE(state.halt_code.has_value());
+        if (engine == cpu::ExecutionEngine::Cached) {
+            // Pairs away from events are still fused
+            EXPECT_FALSE(state.cpu.FusedPairCounts().empty());
+        }
+        return seen;
+    };
+
+    EXPECT_EQ(run(cpu::ExecutionEngine::Reference), run(GetParam()));
+}
+
+TEST_P(EngineTest, SelfModifyingCode) {
+    EngineState tested{GetParam(), kSelfModifyingCode};
+    tested.Run();
+    EXPECT_EQ(tested.halt_code, 0x1B);
+}
+
+INSTANTIATE_TEST_SUITE_P(, EngineTest,
+                         testing::Values(cpu::ExecutionEngine::Reference,
+                                         cpu::ExecutionEngine::Threaded,
+                                         cpu::ExecutionEngine::Cached,
+                                         cpu::ExecutionEngine::Jit,
+                                         cpu::ExecutionEngine::CycleExact),
+                         [](const auto &info) { return to_string(info.param); });
+
+TEST_P(EngineTest, BatchStopsAfterCount) {
+    EngineState tested{GetParam()};
+    tested.cpu.Reset();
+
+    EXPECT_EQ(tested.cpu.ExecuteBatch(2), 2);
+    EXPECT_EQ(tested.cpu.ExecutedInstructions(), 2);
+    EXPECT_EQ(tested.cpu.reg.y, 0x00);
+    EXPECT_EQ(tested.cpu.reg.x, 0x40);
+    EXPECT_EQ(tested.cpu.reg.program_counter, 0x2004);
+}
+
+TEST_P(EngineTest, InvalidOpcodeStopsExecution) {
+    EngineState tested{GetParam()};
+    // 0x02 is not an instruction
+    tested.memory.WriteRange(0x2000, {cpu::opcode::INS_LDA_IM, 0x12, 0x02});
+
+    auto result = tested.cpu.ExecuteFor(std::chrono::seconds{10});
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::InvalidOpcode);
+    EXPECT_EQ(result.opcode, 0x02);
+    EXPECT_EQ(result.regs.a, 0x12);
+    EXPECT_EQ(result.regs.program_counter, 0x2003);
+    EXPECT_EQ(tested.cpu.ExecutedInstructions(), 2);
+}
+
+TEST_P(EngineTest, BatchStopsAtHalt) {
+    EngineState tested{GetParam()};
+    tested.memory.WriteRange(0x2000, {cpu::opcode::INS_LDA_IM, 0x34,
+                                      cpu::opcode::INS_HLT_ACC, cpu::opcode::INS_NOP});
+    tested.cpu.Reset();
+
+    EXPECT_EQ(tested.cpu.ExecuteBatch(100), 2);
+    EXPECT_EQ(tested.cpu.Status(), cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(tested.cpu.Result().halt_code, 0x34);
+
+    // Next call continues after HLT
+    EXPECT_EQ(tested.cpu.ExecuteBatch(1), 1);
+    EXPECT_EQ(tested.cpu.Status(), cpu::ExecutionStatus::Running);
+    EXPECT_EQ(tested.cpu.reg.program_counter, 0x2004);
+}
+
+TEST_P(EngineTest, InstructionBudget) {
+    EngineState reference{cpu::ExecutionEngine::Reference};
+    EngineState tested{GetParam()};
+    reference.Run();
+    tested.cpu.Reset();
+
+    auto result = tested.cpu.ExecuteInstructions(100);
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::BudgetExhausted);
+    EXPECT_EQ(tested.cpu.ExecutedInstructions(), 100);
+
+    // Next call continues where the budget ran out
+    result = tested.cpu.ExecuteInstructions(1'000'000);
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(result.halt_code, reference.halt_code);
+    EXPECT_EQ(reference.cpu.reg.Dump(), tested.cpu.reg.Dump());
+    EXPECT_EQ(reference.cpu.ExecutedInstructions(), tested.cpu.ExecutedInstructions());
+}
+
+TEST_P(EngineTest, CycleBudget) {
+    EngineState tested{GetParam()};
+    tested.cpu.Reset();
+    auto start = tested.clock.CurrentCycle();
+
+    auto result = tested.cpu.ExecuteCycles(1000);
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::BudgetExhausted);
+    auto spent = tested.clock.CurrentCycle() - start;
+    EXPECT_GE(spent, 1000);
+    EXPECT_LT(spent, 1000 + 7);
+    EXPECT_EQ(tested.cpu.ExecutedCycles(), tested.clock.CurrentCycle());
+}
+
+TEST_P(EngineTest, DeadlineStopsEndlessLoop) {
+    EngineState tested{GetParam()};
+    tested.memory.WriteRange(
+        0x2000, {cpu::opcode::INS_INX, cpu::opcode::INS_JMP_ABS, 0x00, 0x20});
+
+    auto result = tested.cpu.ExecuteFor(std::chrono::milliseconds{20});
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::BudgetExhausted);
+    EXPECT_GT(tested.cpu.ExecutedInstructions(), 0);
+}
+
+TEST_P(EngineTest, JumpToItselfIsTrapped) {
+    EngineState tested{GetParam()};
+    tested.memory.WriteRange(0x2000, {cpu::opcode::INS_JMP_ABS, 0x00, 0x20});
+
+    auto result = tested.cpu.ExecuteFor(std::chrono::seconds{10});
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::Trapped);
+    EXPECT_EQ(result.regs.program_counter, 0x2000);
+    EXPECT_LT(tested.cpu.ExecutedInstructions(), 100'000);
+}
+
+TEST_P(EngineTest, BranchToItselfIsTrappedAfterEvents) {
+    EngineState tested{GetParam()};
+    // CLV, BVC * - scheduled event could raise NMI, so loop is not a trap before it runs
+    tested.memory.WriteRange(0x2000, {cpu::opcode::INS_CLV, cpu::opcode::INS_BVC, 0xFE});
+    bool event_done = false;
+    tested.cpu.Scheduler().Schedule(100'000, [&](uint64_t) { event_done = true; });
+
+    auto result = tested.cpu.ExecuteFor(std::chrono::seconds{10});
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::Trapped);
+    EXPECT_EQ(result.regs.program_counter, 0x2001);
+    EXPECT_TRUE(event_done);
+    EXPECT_GE(tested.cpu.ExecutedCycles(), 100'000);
+}
+
+TEST_P(EngineTest, StopRequest) {
+    EngineState tested{GetParam()};
+    tested.cpu.RequestStop();
+
+    auto result = tested.cpu.Execute();
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::StopRequested);
+    EXPECT_EQ(tested.cpu.ExecutedInstructions(), 0);
+
+    // Request is consumed
+    EXPECT_EQ(tested.cpu.Execute().status, cpu::ExecutionStatus::Halted);
+}
+
+TEST_P(EngineTest, ParseEngineName) {
+    EXPECT_EQ(cpu::ParseExecutionEngine(to_string(GetParam())), GetParam());
+}
+
+struct BreakpointDebugger : public cpu::Debugger {
+    MemPtr breakpoint;
+    uint64_t instructions = 0;
+    void OnNextInstruction(const cpu::Registers & /*regs*/) override { ++instructions; }
+    bool IsBreakpoint(MemPtr address) override { return address == breakpoint; }
+};
+
+TEST(BreakpointTest, StopsBeforeInstruction) {
+    EngineState state{cpu::ExecutionEngine::Reference};
+    BreakpointDebugger debugger;
+    debugger.breakpoint = 0x2004;
+    cpu::Cpu cpu{&state.clock, &state.memory, nullptr, InstructionSet::NMOS6502Emu,
+                 &debugger};
+    cpu.Reset();
+
+    EXPECT_EQ(cpu.ExecuteBatch(10), 2);
+    EXPECT_EQ(cpu.Status(), cpu::ExecutionStatus::Breakpoint);
+    EXPECT_EQ(cpu.reg.program_counter, 0x2004);
+
+    // Resumed execution runs the instruction at breakpoint
+    EXPECT_EQ(cpu.ExecuteNextInstruction(), cpu::ExecutionStatus::Running);
+    EXPECT_EQ(cpu.ExecutedInstructions(), 3);
+    EXPECT_EQ(debugger.instructions, 3);
+}
+
+// With debugger attached every engine runs the instrumented loop
+TEST(BreakpointTest, InstrumentedBudget) {
+    EngineState state{cpu::ExecutionEngine::Reference};
+    BreakpointDebugger debugger;
+    debugger.breakpoint = 0;
+    cpu::Cpu cpu{&state.clock, &state.memory, nullptr, InstructionSet::NMOS6502Emu,
+                 &debugger, cpu::ExecutionEngine::Cached};
+    cpu.Reset();
+
+    EXPECT_EQ(cpu.ExecuteInstructions(50).status, cpu::ExecutionStatus::BudgetExhausted);
+    EXPECT_EQ(debugger.instructions, 50);
+}
+
+TEST(EngineNameTest, InvalidName) {
+    EXPECT_THROW(cpu::ParseExecutionEngine("invalid"), std::runtime_error);
+}
+
+} // namespace
+} // namespace emu::emu6502::test
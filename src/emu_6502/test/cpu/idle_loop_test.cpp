@@ -0,0 +1,125 @@
+#include "cpu_test_helper.hpp"
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_core/clock.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace emu::emu6502::test {
+namespace {
+
+using namespace std::string_literals;
+
+// Delay loop changes X, so only the poll loop is idle. NMI handler sets the polled
+// flag.
+const auto kIdleLoopTestCode = R"==(
+.isr reset TEST_ENTRY
+.isr irq NMI_HANDLER
+.isr nmib NMI_HANDLER
+
+.org 0x2000
+TEST_ENTRY:
+    LDX #$20
+DELAY:
+    DEX
+    BNE DELAY
+POLL:
+    LDA $80
+    AND #$01
+    BEQ POLL
+    HLT #$00
+
+NMI_HANDLER:
+    INC $80
+    RTI
+)=="s;
+
+constexpr MemPtr kPolledAddress = 0x80;
+constexpr uint64_t kNmiCycle = 1'000'000;
+
+struct Machine : public CpuState {
+    Machine(cpu::ExecutionEngine engine, bool idle_loop_skip)
+        : CpuState(engine, InstructionSet::NMOS6502Emu) {
+        memory.Fill(0, 0x200);
+        Load(kIdleLoopTestCode);
+        cpu.SetIdleLoopSkip(idle_loop_skip);
+        cpu.Scheduler().Schedule(kNmiCycle, [this](uint64_t) { cpu.TriggerNmi(); });
+    }
+};
+
+class IdleLoopTest : public testing::TestWithParam<cpu::ExecutionEngine> {
+public:
+    Machine skipping{GetParam(), true};
+    Machine reference{GetParam(), false};
+
+    void RunBoth() {
+        for (auto *m : {&skipping, &reference}) {
+            ASSERT_EQ(m->Run().status, cpu::ExecutionStatus::Halted);
+        }
+    }
+
+    void ExpectSameExecution() {
+        EXPECT_EQ(skipping.cpu.ExecutedCycles(), reference.cpu.ExecutedCycles());
+        EXPECT_EQ(skipping.cpu.ExecutedInstructions(),
+                  reference.cpu.ExecutedInstructions());
+        EXPECT_EQ(skipping.clock.CurrentCycle(), reference.clock.CurrentCycle());
+        EXPECT_EQ(reference.cpu.IdleSkippedCycles(), 0);
+    }
+};
+
+TEST_P(IdleLoopTest, SkipsToScheduledEvent) {
+    RunBoth();
+    ExpectSameExecution();
+    EXPECT_GT(skipping.cpu.IdleSkippedCycles(), kNmiCycle * 9 / 10);
+    EXPECT_LT(skipping.cpu.IdleSkippedCycles(), kNmiCycle);
+}
+
+TEST_P(IdleLoopTest, DeviceReadIsSkippedInSteps) {
+    skipping.cpu.AddDeviceArea(kPolledAddress, 1);
+    RunBoth();
+    ExpectSameExecution();
+    EXPECT_GT(skipping.cpu.IdleSkippedCycles(), kNmiCycle * 9 / 10);
+}
+
+TEST_P(IdleLoopTest, CycleBudgetEndsSkip) {
+    skipping.cpu.Reset();
+    auto result = skipping.cpu.ExecuteCycles(kNmiCycle / 2);
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::BudgetExhausted);
+    EXPECT_GE(skipping.cpu.ExecutedCycles(), kNmiCycle / 2);
+    EXPECT_LT(skipping.cpu.ExecutedCycles(), kNmiCycle / 2 + 16);
+    EXPECT_GT(skipping.cpu.IdleSkippedCycles(), 0);
+}
+
+TEST_P(IdleLoopTest, InstructionBudgetEndsSkip) {
+    skipping.cpu.Reset();
+    auto result = skipping.cpu.ExecuteInstructions(10'000);
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::BudgetExhausted);
+    EXPECT_EQ(skipping.cpu.ExecutedInstructions(), 10'000);
+
+    reference.cpu.Reset();
+    reference.cpu.ExecuteInstructions(10'000);
+    ExpectSameExecution();
+}
+
+TEST_P(IdleLoopTest, WaitsWithoutScheduledEvent) {
+    skipping.cpu.Scheduler().Clear();
+    skipping.cpu.Reset();
+    // Like WAI, only unlimited cycle budget stops with Waiting
+    auto result = skipping.cpu.ExecuteInstructions(1'000'000);
+    ASSERT_EQ(result.status, cpu::ExecutionStatus::Waiting);
+
+    skipping.cpu.TriggerNmi();
+    result = skipping.cpu.ExecuteInstructions(1'000'000);
+    ASSERT_EQ(result.status, cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(skipping.memory.Load(kPolledAddress), 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(, IdleLoopTest,
+                         testing::Values(cpu::ExecutionEngine::Reference,
+                                         cpu::ExecutionEngine::Threaded,
+                                         cpu::ExecutionEngine::Cached,
+                                         cpu::ExecutionEngine::Jit),
+                         [](const auto &info) { return to_string(info.param); });
+
+} // namespace
+} // namespace emu::emu6502::test
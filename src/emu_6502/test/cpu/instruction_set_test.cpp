@@ -53,5 +53,17 @@ TEST_F(InstructionSetTest, VerifySupportedInstructionsEmu) {
     CheckInstructionSet(InstructionSet::NMOS6502Emu);
 }
 
+TEST_F(InstructionSetTest, VerifySupportedInstructionsCmos) {
+    auto instructions_map = GetInstructionSet(InstructionSet::CMOS65C02);
+    EXPECT_EQ(instructions_map.size(), 212);
+    CheckInstructionSet(InstructionSet::CMOS65C02);
+}
+
+TEST_F(InstructionSetTest, VerifySupportedInstructionsUndocumented) {
+    auto instructions_map = GetInstructionSet(InstructionSet::NMOS6502Undocumented);
+    EXPECT_EQ(instructions_map.size(), 236);
+    CheckInstructionSet(InstructionSet::NMOS6502Undocumented);
+}
+
 } // namespace
 } // namespace emu::emu6502::test
\ No newline at end of file
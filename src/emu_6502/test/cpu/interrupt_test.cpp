@@ -0,0 +1,405 @@
+#include "cpu_test_helper.hpp"
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/opcode.hpp>
+#include <emu_6502/recompiler/runtime.hpp>
+#include <emu_core/clock.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <array>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace emu::emu6502::test {
+namespace {
+
+using namespace std::string_literals;
+
+// Handlers count interrupts and note the order they were taken in. IRQ handler
+// returns with I flag set, so level triggered line which is still asserted is not
+// taken again.
+const auto kInterruptTestCode = R"==(
+.isr reset TEST_ENTRY
+.isr irq IRQ_HANDLER
+.isr nmib NMI_HANDLER
+
+.org 0x2000
+TEST_ENTRY:
+    SEI
+    LDX #$00
+WAIT:
+    INX
+    CPX #$40
+    BNE WAIT
+    CLI
+    NOP
+    NOP
+    HLT #$00
+
+IRQ_HANDLER:
+    INC $80
+    INC $84
+    LDA $84
+    STA $86
+    STX $83
+    PLA
+    ORA #$04
+    PHA
+    RTI
+
+NMI_HANDLER:
+    INC $82
+    INC $84
+    LDA $84
+    STA $85
+    RTI
+)=="s;
+
+class InterruptTest : public testing::TestWithParam<cpu::ExecutionEngine>,
+                      public CpuState {
+public:
+    InterruptTest() : CpuState(GetParam(), InstructionSet::NMOS6502Emu) {
+        memory.Fill(0, 0x200);
+        Load(kInterruptTestCode);
+    }
+
+    void Run() { ASSERT_EQ(CpuState::Run().status, cpu::ExecutionStatus::Halted); }
+};
+
+TEST_P(InterruptTest, IrqWaitsForClearedFlag) {
+    cpu.Scheduler().Schedule(100, [&](uint64_t) { cpu.SetIrq(0, true); });
+    Run();
+
+    EXPECT_EQ(memory.Load(0x80), 1);
+    // Taken after CLI, not while the loop was running with I flag set
+    EXPECT_EQ(memory.Load(0x83), 0x40);
+}
+
+TEST_P(InterruptTest, MaskedSourceIsIgnored) {
+    cpu.SetIrqSourceMask(~0x2u);
+    cpu.Scheduler().Schedule(100, [&](uint64_t) { cpu.SetIrq(1, true); });
+    Run();
+
+    EXPECT_EQ(memory.Load(0x80), 0);
+}
+
+TEST_P(InterruptTest, NmiAndIrqAreBothTaken) {
+    cpu.Scheduler().Schedule(100, [&](uint64_t) {
+        cpu.SetIrq(0, true);
+        cpu.TriggerNmi();
+    });
+    Run();
+
+    EXPECT_EQ(memory.Load(0x82), 1);
+    EXPECT_EQ(memory.Load(0x80), 1);
+    // NMI first
+    EXPECT_EQ(memory.Load(0x85), 1);
+    EXPECT_EQ(memory.Load(0x86), 2);
+}
+
+// IRQ is raised while I flag is set and the line stays asserted. It waits through the
+// masked DEX/BNE loop, then it is taken after every CLI of the hot loop and after PLP.
+// Handler sums X it was taken with.
+const auto kHeldIrqCode = R"==(
+.isr reset TEST_ENTRY
+.isr irq IRQ_HANDLER
+
+.org 0x2000
+TEST_ENTRY:
+    SEI
+    LDX #$00
+MASKED:
+    DEX
+    BNE MASKED
+    LDY #$40
+LOOP:
+    SEI
+    INX
+    CLI
+    INX
+    DEY
+    BNE LOOP
+    SEI
+    LDA #$00
+    PHA
+    PLP
+    INX
+    HLT #$00
+
+IRQ_HANDLER:
+    INC $80
+    TXA
+    CLC
+    ADC $81
+    STA $81
+    PLA
+    ORA #$04
+    PHA
+    RTI
+)=="s;
+
+struct HeldIrqRun {
+    uint8_t taken;
+    uint8_t x_sum;
+    uint64_t cycles;
+    uint64_t fused_pairs;
+};
+
+HeldIrqRun RunWithHeldIrq(cpu::ExecutionEngine engine) {
+    CpuState state{engine, InstructionSet::NMOS6502Emu};
+    state.memory.Fill(0, 0x200);
+    state.Load(kHeldIrqCode);
+    auto &cpu = state.cpu;
+    cpu.Scheduler().Schedule(100, [&](uint64_t) { cpu.SetIrq(0, true); });
+    EXPECT_EQ(state.Run().status, cpu::ExecutionStatus::Halted);
+
+    uint64_t fused_pairs = 0;
+    for (const auto &pair : cpu.FusedPairCounts()) {
+        fused_pairs += pair.count;
+    }
+    return HeldIrqRun{state.memory.Load(0x80), state.memory.Load(0x81),
+                      cpu.ExecutedCycles(), fused_pairs};
+}
+
+TEST_P(InterruptTest, HeldIrqIsTakenOnceIFlagIsCleared) {
+    auto tested = RunWithHeldIrq(GetParam());
+    auto reference = RunWithHeldIrq(cpu::ExecutionEngine::Reference);
+
+    // Every CLI of the loop and the final PLP
+    EXPECT_EQ(reference.taken, 0x41);
+    EXPECT_EQ(tested.taken, reference.taken);
+    EXPECT_EQ(tested.x_sum, reference.x_sum);
+    EXPECT_EQ(tested.cycles, reference.cycles);
+    if (GetParam() == cpu::ExecutionEngine::Cached) {
+        // Masked line does not force the engine to check events after every
+        // instruction, pairs are still fused
+        EXPECT_GT(tested.fused_pairs, 0x100);
+    }
+}
+
+// Outer loop around a straight-line block of 24 INX, events fall inside the block
+const auto kStraightLineCode = R"==(
+.isr reset TEST_ENTRY
+
+.org 0x2000
+TEST_ENTRY:
+    LDY #$20
+LOOP:
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    INX
+    DEY
+    BNE LOOP
+    HLT #$00
+)=="s;
+
+constexpr std::array<uint64_t, 5> kEventCycles = {50, 151, 300, 1001, 1200};
+
+struct SeenEvent {
+    uint64_t cycle;
+    MemPtr program_counter;
+    uint8_t x;
+    bool operator==(const SeenEvent &) const = default;
+};
+
+std::vector<SeenEvent> RunWithEvents(cpu::ExecutionEngine engine,
+                                     const cpu::RecompiledProgram *recompiled = nullptr) {
+    CpuState state{engine, InstructionSet::NMOS6502Emu};
+    state.Load(kStraightLineCode);
+    auto &cpu = state.cpu;
+    if (recompiled != nullptr) {
+        cpu.AttachRecompiledProgram(recompiled);
+    }
+
+    std::vector<SeenEvent> seen;
+    for (uint64_t cycle : kEventCycles) {
+        cpu.Scheduler().Schedule(cycle, [&](uint64_t) {
+            seen.emplace_back(
+                SeenEvent{cpu.ExecutedCycles(), cpu.reg.program_counter, cpu.reg.x});
+        });
+    }
+    EXPECT_EQ(state.Run().status, cpu::ExecutionStatus::Halted);
+    return seen;
+}
+
+// Each event runs after the instruction which reached its cycle, the same one for
+// every engine
+TEST_P(InterruptTest, EventRunsAtItsCycle) {
+    auto seen = RunWithEvents(GetParam());
+
+    ASSERT_EQ(seen.size(), kEventCycles.size());
+    EXPECT_EQ(seen, RunWithEvents(cpu::ExecutionEngine::Reference));
+    for (size_t i = 0; i < seen.size(); ++i) {
+        // INX and DEY take 2 cycles, BNE 3
+        EXPECT_GE(seen[i].cycle, kEventCycles[i]);
+        EXPECT_LT(seen[i].cycle, kEventCycles[i] + 3);
+    }
+}
+
+// LOOP block of kStraightLineCode the way emu_6502_recompile writes it
+constexpr MemPtr kLoopAddress = 0x2002;
+constexpr int kLoopIncrements = 24;
+
+void StraightLineBlock(cpu::Cpu *cpu, uint32_t *executed) {
+    using namespace recompiler::runtime;
+    auto &reg = cpu->reg;
+    for (int i = 0; i < kLoopIncrements; ++i) {
+        ++*executed;
+        Fetch(cpu, kLoopAddress + i + 1, 2);
+        Increment(cpu, reg.x, 1);
+    }
+    ++*executed;
+    Fetch(cpu, kLoopAddress + kLoopIncrements + 1, 2);
+    Increment(cpu, reg.y, -1);
+    ++*executed;
+    Fetch(cpu, kLoopAddress + kLoopIncrements + 3, 2);
+    Branch(cpu, reg.TestFlag(Flags::Zero) == false, kLoopAddress, 1);
+}
+
+const auto kStraightLineBytes = [] {
+    std::array<uint8_t, kLoopIncrements + 3> code{};
+    code.fill(cpu::opcode::INS_INX);
+    code[kLoopIncrements] = cpu::opcode::INS_DEY;
+    code[kLoopIncrements + 1] = cpu::opcode::INS_BNE;
+    code[kLoopIncrements + 2] = static_cast<uint8_t>(-(kLoopIncrements + 3));
+    return code;
+}();
+
+// Base cost of 2 cycles and at most 2 more for every instruction
+const cpu::RecompiledBlock kStraightLineBlocks[] = {
+    {kLoopAddress, kLoopIncrements + 2, kStraightLineBytes.size(),
+     (kLoopIncrements + 2) * 4, kStraightLineBytes.data(), &StraightLineBlock},
+};
+const cpu::RecompiledProgram kStraightLineProgram{
+    cpu::kRecompiledAbiVersion,
+    InstructionSet::NMOS6502Emu,
+    kStraightLineBlocks,
+    std::size(kStraightLineBlocks),
+};
+
+TEST(RecompiledInterruptTest, EventRunsAtItsCycle) {
+    auto seen = RunWithEvents(cpu::ExecutionEngine::Cached, &kStraightLineProgram);
+
+    ASSERT_EQ(seen.size(), kEventCycles.size());
+    EXPECT_EQ(seen, RunWithEvents(cpu::ExecutionEngine::Reference));
+}
+
+INSTANTIATE_TEST_SUITE_P(, InterruptTest,
+                         testing::Values(cpu::ExecutionEngine::Reference,
+                                         cpu::ExecutionEngine::Threaded,
+                                         cpu::ExecutionEngine::Cached,
+                                         cpu::ExecutionEngine::Jit,
+                                         cpu::ExecutionEngine::CycleExact),
+                         [](const auto &info) { return to_string(info.param); });
+
+// 65C02 WAI with I flag set resumes with the next instruction, the handler is not
+// taken. IRQ handler returns with I flag set, like the one above.
+const auto kWaitTestCode = R"==(
+.isr reset TEST_ENTRY
+.isr irq IRQ_HANDLER
+.isr nmib IRQ_HANDLER
+
+.org 0x2000
+TEST_ENTRY:
+    CLI
+    WAI
+    SEI
+    WAI
+    INC $81
+    STP
+
+IRQ_HANDLER:
+    INC $80
+    PLA
+    ORA #$04
+    PHA
+    RTI
+)=="s;
+
+class WaitTest : public testing::TestWithParam<cpu::ExecutionEngine>, public CpuState {
+public:
+    WaitTest() : CpuState(GetParam(), InstructionSet::CMOS65C02) {
+        memory.Fill(0, 0x200);
+        Load(kWaitTestCode);
+    }
+};
+
+TEST_P(WaitTest, SkipsToScheduledInterrupt) {
+    std::vector<uint64_t> cycles;
+    auto raise = [&](uint64_t) {
+        cycles.push_back(cpu.ExecutedCycles());
+        cpu.SetIrq(0, true);
+    };
+    auto lower = [&](uint64_t) { cpu.SetIrq(0, false); };
+    cpu.Scheduler().Schedule(100'000, raise);
+    cpu.Scheduler().Schedule(100'010, lower);
+    cpu.Scheduler().Schedule(1'000'000, raise);
+
+    ASSERT_EQ(CpuState::Run().status, cpu::ExecutionStatus::Halted);
+
+    EXPECT_EQ(memory.Load(0x80), 1);
+    EXPECT_EQ(memory.Load(0x81), 1);
+    ASSERT_EQ(cycles.size(), 2);
+    // Events run at their cycle, cycles spent in WAI are counted
+    EXPECT_EQ(cycles[0], 100'000);
+    EXPECT_EQ(cycles[1], 1'000'000);
+    EXPECT_GE(cpu.ExecutedCycles(), 1'000'000);
+    EXPECT_LT(cpu.ExecutedCycles(), 1'000'000 + 16);
+}
+
+TEST_P(WaitTest, WaitsForInterruptLine) {
+    // Only unlimited cycle budget stops with Waiting
+    cpu.Reset();
+    auto result = cpu.ExecuteInstructions(100);
+    ASSERT_EQ(result.status, cpu::ExecutionStatus::Waiting);
+
+    cpu.TriggerNmi();
+    result = cpu.ExecuteInstructions(100);
+    ASSERT_EQ(result.status, cpu::ExecutionStatus::Waiting);
+    EXPECT_EQ(memory.Load(0x80), 1);
+
+    cpu.SetIrq(0, true);
+    result = cpu.ExecuteInstructions(100);
+    ASSERT_EQ(result.status, cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(memory.Load(0x80), 1);
+    EXPECT_EQ(memory.Load(0x81), 1);
+}
+
+TEST_P(WaitTest, BudgetEndsWait) {
+    cpu.Reset();
+    auto result = cpu.ExecuteCycles(5'000);
+    EXPECT_EQ(result.status, cpu::ExecutionStatus::BudgetExhausted);
+    EXPECT_GE(cpu.ExecutedCycles(), 5'000);
+    EXPECT_LT(cpu.ExecutedCycles(), 5'000 + 16);
+}
+
+INSTANTIATE_TEST_SUITE_P(, WaitTest,
+                         testing::Values(cpu::ExecutionEngine::Reference,
+                                         cpu::ExecutionEngine::Threaded,
+                                         cpu::ExecutionEngine::Cached,
+                                         cpu::ExecutionEngine::Jit,
+                                         cpu::ExecutionEngine::CycleExact),
+                         [](const auto &info) { return to_string(info.param); });
+
+} // namespace
+} // namespace emu::emu6502::test
@@ -0,0 +1,289 @@
+#include "cpu_test_helper.hpp"
+#include "emu_core/memory.hpp"
+#include "lockstep_helper.hpp"
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/opcode.hpp>
+#include <emu_6502/instruction_set.hpp>
+#include <emu_core/clock.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace emu::emu6502::test {
+namespace {
+
+constexpr MemPtr kCodeBase = 0x2000;
+constexpr MemPtr kDataBase = 0x3000;
+constexpr size_t kProgramInstructions = 40;
+constexpr uint64_t kExecutedInstructions = 20000;
+constexpr uint64_t kLockstepStep = 1000;
+
+// Everything which is not a straight-line instruction or a branch. SED and PLP stay
+// in, decimal ADC/SBC make jit code exit to the interpreter.
+const std::set<Opcode> kExcludedOpcodes = {
+    cpu::opcode::INS_JMP_ABS, cpu::opcode::INS_JMP_IND, cpu::opcode::INS_JSR,
+    cpu::opcode::INS_RTS,     cpu::opcode::INS_RTI,     cpu::opcode::INS_BRK,
+    cpu::opcode::INS_HLT_ACC, cpu::opcode::INS_HLT_IM,
+};
+
+struct Instruction {
+    OpcodeInfo info;
+    std::array<uint8_t, 2> operand;
+    size_t branch_target; // index of the target instruction for REL mode
+};
+
+// Random program which runs in a loop, memory is fully initialized and code page is
+// out of reach of absolute stores
+std::vector<uint8_t> GenerateProgram(std::mt19937 &mt) {
+    std::vector<OpcodeInfo> opcodes;
+    for (const auto &[opcode, info] : GetInstructionSet(InstructionSet::NMOS6502)) {
+        if (!kExcludedOpcodes.contains(opcode)) {
+            opcodes.emplace_back(info);
+        }
+    }
+    std::sort(opcodes.begin(), opcodes.end(),
+              [](const auto &a, const auto &b) { return a.opcode < b.opcode; });
+
+    std::vector<Instruction> program;
+    for (size_t i = 0; i < kProgramInstructions; ++i) {
+        Instruction instruction{
+            .info = opcodes[mt() % opcodes.size()],
+            .operand = {static_cast<uint8_t>(mt()), static_cast<uint8_t>(kDataBase >> 8)},
+            .branch_target = i + 1 + mt() % 8,
+        };
+        program.emplace_back(instruction);
+    }
+
+    std::vector<MemPtr> addresses;
+    MemPtr address = kCodeBase;
+    for (const auto &instruction : program) {
+        addresses.emplace_back(address);
+        address += 1 + ArgumentByteSize(instruction.info.addres_mode);
+    }
+    // Loop back with JMP, branches past the end land on it as well
+    addresses.emplace_back(address);
+
+    std::vector<uint8_t> code;
+    for (size_t i = 0; i < program.size(); ++i) {
+        const auto &instruction = program[i];
+        code.emplace_back(instruction.info.opcode);
+        switch (instruction.info.addres_mode) {
+        case AddressMode::REL: {
+            auto target = addresses[std::min(instruction.branch_target, program.size())];
+            code.emplace_back(static_cast<uint8_t>(target - addresses[i + 1]));
+            break;
+        }
+        default:
+            for (size_t b = 0; b < ArgumentByteSize(instruction.info.addres_mode); ++b) {
+                code.emplace_back(instruction.operand[b]);
+            }
+            break;
+        }
+    }
+    code.emplace_back(cpu::opcode::INS_JMP_ABS);
+    code.emplace_back(kCodeBase & 0xFF);
+    code.emplace_back(kCodeBase >> 8);
+    return code;
+}
+
+// Data in the whole address space, code and reset vector on top of it
+struct JitState : public CpuState {
+    JitState(cpu::ExecutionEngine engine, const std::vector<uint8_t> &data,
+             const std::vector<uint8_t> &code)
+        : CpuState(engine, InstructionSet::NMOS6502) {
+        memory.WriteRange(0, data);
+        memory.WriteRange(kCodeBase, code);
+        memory.WriteRange(kResetVector, {kCodeBase & 0xFF, kCodeBase >> 8, 0, 0});
+        cpu.Reset();
+    }
+};
+
+class JitTest : public testing::TestWithParam<uint32_t> {};
+
+TEST_P(JitTest, RandomProgramMatchesReference) {
+    std::mt19937 mt{GetParam()};
+    // Last bytes are vectors written by JitState
+    std::vector<uint8_t> data(kResetVector);
+    for (auto &v : data) {
+        v = static_cast<uint8_t>(mt());
+    }
+    auto code = GenerateProgram(mt);
+
+    JitState reference{cpu::ExecutionEngine::Reference, data, code};
+    JitState tested{cpu::ExecutionEngine::Jit, data, code};
+    // Steps are long enough for blocks to get hot and run as jit code
+    EXPECT_TRUE(RunInLockstep(InstructionSet::NMOS6502, reference.cpu, tested.cpu,
+                              kExecutedInstructions, kLockstepStep));
+}
+
+INSTANTIATE_TEST_SUITE_P(, JitTest, testing::Range(1u, 101u));
+
+// Loop of 60 INX and JMP back is one block, it is translated after a few runs. Events
+// fall at various places inside it, each one sees the state after the instruction
+// which reached its cycle, as the reference engine does.
+TEST(JitEventTest, EventInsideBlockRunsAtItsCycle) {
+    std::vector<uint8_t> code(60, cpu::opcode::INS_INX);
+    code.insert(code.end(), {cpu::opcode::INS_JMP_ABS, kCodeBase & 0xFF, kCodeBase >> 8});
+    const std::vector<uint8_t> data(kResetVector);
+
+    struct Seen {
+        uint64_t cycle;
+        MemPtr program_counter;
+        uint8_t x;
+        bool operator==(const Seen &) const = default;
+    };
+    auto run = [&](cpu::ExecutionEngine engine) {
+        JitState state{engine, data, code};
+        std::vector<Seen> seen;
+        for (uint64_t cycle : {5000u, 5061u, 5100u, 7777u, 12345u}) {
+            state.cpu.Scheduler().Schedule(cycle, [&](uint64_t) {
+                seen.emplace_back(Seen{state.cpu.ExecutedCycles(),
+                                       state.cpu.reg.program_counter, state.cpu.reg.x});
+            });
+        }
+        state.cpu.ExecuteBatch(kExecutedInstructions);
+        return seen;
+    };
+
+    auto reference = run(cpu::ExecutionEngine::Reference);
+    auto jit = run(cpu::ExecutionEngine::Jit);
+    ASSERT_EQ(reference.size(), 5);
+    EXPECT_EQ(reference, jit);
+    // INX takes 2 cycles, the odd cycles are reached one cycle late
+    EXPECT_LE(jit[1].cycle, 5061u + 1);
+}
+
+// Flat memory with two device registers: a store into the first one asserts IRQ, a
+// store into the second one notes the value and releases it
+class IrqDeviceMemory : public Memory16 {
+public:
+    static constexpr MemPtr kRaise = 0x4000;
+    static constexpr MemPtr kAcknowledge = 0x4001;
+
+    [[nodiscard]] uint8_t Load(MemPtr address) const override { return bytes[address]; }
+    void Store(MemPtr address, uint8_t value) override {
+        if (address == kRaise) {
+            lines->SetIrq(0, true);
+        } else if (address == kAcknowledge) {
+            acknowledged.emplace_back(value);
+            lines->SetIrq(0, false);
+        }
+        bytes[address] = value;
+    }
+    [[nodiscard]] std::optional<uint8_t> DebugRead(MemPtr address) const override {
+        return bytes[address];
+    }
+
+    std::array<uint8_t, 0x10000> bytes{};
+    InterruptLines *lines = nullptr;
+    std::vector<uint8_t> acknowledged;
+};
+
+// Loop block raises IRQ with a store in its middle, handler acknowledges with Y. Jit
+// code leaves the block after the store, so the IRQ is taken before the INYs which
+// follow it, as the reference engine does.
+TEST(JitEventTest, StoreWhichRaisesIrqEndsBlock) {
+    using namespace cpu::opcode;
+    constexpr MemPtr kHandler = 0x2100;
+    constexpr uint8_t kLoopLow = (kCodeBase + 1) & 0xFF;
+    // clang-format off
+    const std::vector<uint8_t> code{
+        INS_CLI,
+        INS_LDY_IM, 0x00, // loop
+        INS_STA_ABS, IrqDeviceMemory::kRaise & 0xFF, IrqDeviceMemory::kRaise >> 8,
+        INS_INY, INS_INY, INS_INY, INS_INY,
+        INS_JMP_ABS, kLoopLow, kCodeBase >> 8,
+    };
+    const std::vector<uint8_t> handler{
+        INS_STY_ABS, IrqDeviceMemory::kAcknowledge & 0xFF,
+        IrqDeviceMemory::kAcknowledge >> 8,
+        INS_RTI,
+    };
+    // clang-format on
+
+    auto run = [&](cpu::ExecutionEngine engine) {
+        BasicCpuState<IrqDeviceMemory> state{engine, InstructionSet::NMOS6502};
+        auto &bytes = state.memory.bytes;
+        std::ranges::copy(code, bytes.begin() + kCodeBase);
+        std::ranges::copy(handler, bytes.begin() + kHandler);
+        std::ranges::copy(std::vector<uint8_t>{kCodeBase & 0xFF, kCodeBase >> 8,
+                                               kHandler & 0xFF, kHandler >> 8},
+                          bytes.begin() + kResetVector);
+        state.memory.lines = &state.cpu;
+        state.cpu.Reset();
+        state.cpu.ExecuteBatch(kExecutedInstructions);
+        return state.memory.acknowledged;
+    };
+
+    auto reference = run(cpu::ExecutionEngine::Reference);
+    auto jit = run(cpu::ExecutionEngine::Jit);
+    ASSERT_GT(reference.size(), 100u);
+    EXPECT_EQ(reference, jit);
+}
+
+// Loop stores through pointer at $10 into data page until its counter runs out, by then
+// it is jit code. Pointer is moved then into the code page: to the operand of LDA which
+// follows the store ($2009) or past the end of the code. Jit code has to leave the
+// block after the store, so the interpreter runs LDA with the new operand.
+constexpr const char *kSelfModifyingCode = R"==(
+.isr reset TEST_ENTRY
+
+.org 0x2000
+TEST_ENTRY:
+    LDY #$00
+    LDA #$20
+    STA $12
+LOOP:
+    STA ($10),Y
+    LDA #$00
+    CLC
+    ADC #$01
+    STA $3000
+    DEC $12
+    BNE LOOP
+    LDA #${:02x}
+    STA $10
+    LDA #$20
+    STA $11
+    STA $12
+    DEC $13
+    BNE LOOP
+    HLT #$00
+)==";
+
+class JitSelfModifyingTest : public testing::TestWithParam<uint8_t> {};
+
+TEST_P(JitSelfModifyingTest, StoreIntoOwnPageMatchesReference) {
+    const auto code = fmt::format(kSelfModifyingCode, GetParam());
+    auto load = [&](CpuState &state) {
+        state.memory.Fill(0, 0x200);
+        state.memory.Fill(kCodeBase, 0x100);
+        state.memory.Fill(kDataBase, 0x100);
+        // Pointer to the data page, two rounds
+        state.memory.WriteRange(0x10, {0x80, kDataBase >> 8, 0x00, 0x02});
+        state.Load(code);
+        state.cpu.Reset();
+    };
+
+    CpuState reference{cpu::ExecutionEngine::Reference, InstructionSet::NMOS6502Emu};
+    CpuState tested{cpu::ExecutionEngine::Jit, InstructionSet::NMOS6502Emu};
+    load(reference);
+    load(tested);
+    EXPECT_TRUE(RunInLockstep(InstructionSet::NMOS6502Emu, reference.cpu, tested.cpu,
+                              kExecutedInstructions, kLockstepStep));
+    // Both rounds are done
+    EXPECT_EQ(reference.memory.Load(0x13), 0);
+}
+
+// Operand of the next instruction, own page outside the code
+INSTANTIATE_TEST_SUITE_P(, JitSelfModifyingTest, testing::Values(0x09, 0xF0));
+
+} // namespace
+} // namespace emu::emu6502::test
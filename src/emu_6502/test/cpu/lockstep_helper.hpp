@@ -0,0 +1,70 @@
+#pragma once
+
+#include "emu_6502/cpu/cpu.hpp"
+#include "emu_6502/cpu/lockstep_validator.hpp"
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/clock.hpp"
+#include "emu_core/memory/memory_block.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace emu::emu6502::test {
+
+// Whole address space of random opcodes of the instruction set, operands and vectors are
+// opcodes as well. Instructions which stop or wait for an interrupt are left out.
+inline std::vector<uint8_t> RandomInstructionStream(InstructionSet instruction_set,
+                                                    uint32_t seed) {
+    std::vector<uint8_t> opcodes;
+    for (const auto &[opcode, info] : GetInstructionSet(instruction_set)) {
+        if (info.mnemonic != std::string_view{"HLT"} &&
+            info.mnemonic != std::string_view{"STP"} &&
+            info.mnemonic != std::string_view{"WAI"}) {
+            opcodes.emplace_back(opcode);
+        }
+    }
+
+    std::mt19937 random{seed};
+    std::uniform_int_distribution<size_t> pick{0, opcodes.size() - 1};
+    std::vector<uint8_t> image(0x10000);
+    for (auto &byte : image) {
+        byte = opcodes[pick(random)];
+    }
+    return image;
+}
+
+// Candidate runs its engine in steps, reference catches up and their states are
+// compared after each step, see cpu::LockstepValidator. Both have to be reset.
+inline testing::AssertionResult RunInLockstep(InstructionSet instruction_set,
+                                              cpu::Cpu &reference, cpu::Cpu &candidate,
+                                              uint64_t instructions, uint64_t step = 1) {
+    cpu::LockstepValidator validator{instruction_set, &reference, &candidate};
+    if (auto divergence = validator.Run(instructions, step)) {
+        return testing::AssertionFailure()
+               << to_string(candidate.Engine()) << " engine: " << divergence->Describe();
+    }
+    return testing::AssertionSuccess();
+}
+
+// Runs image on reference interpreter and on engine, each with own clock and copy of
+// memory
+inline testing::AssertionResult RunsInLockstep(InstructionSet instruction_set,
+                                               cpu::ExecutionEngine engine,
+                                               const std::vector<uint8_t> &image,
+                                               uint64_t instructions, uint64_t step = 1) {
+    ClockSimple reference_clock;
+    ClockSimple candidate_clock;
+    memory::MemoryBlock16 reference_memory{&reference_clock, image};
+    memory::MemoryBlock16 candidate_memory{&candidate_clock, image};
+    cpu::Cpu reference{&reference_clock, &reference_memory, nullptr, instruction_set,
+                       nullptr,          cpu::ExecutionEngine::Reference};
+    cpu::Cpu candidate{&candidate_clock, &candidate_memory, nullptr, instruction_set,
+                       nullptr,          engine};
+    reference.Reset();
+    candidate.Reset();
+    return RunInLockstep(instruction_set, reference, candidate, instructions, step);
+}
+
+} // namespace emu::emu6502::test
@@ -0,0 +1,129 @@
+#include "lockstep_helper.hpp"
+#include <emu_6502/cpu/opcode.hpp>
+#include <tuple>
+
+namespace emu::emu6502::test {
+namespace {
+
+using LockstepParam = std::tuple<InstructionSet, cpu::ExecutionEngine>;
+
+class LockstepTest : public testing::TestWithParam<LockstepParam> {};
+
+constexpr uint64_t kRandomInstructions = 10000;
+
+TEST_P(LockstepTest, RandomInstructionStream) {
+    auto [instruction_set, engine] = GetParam();
+    for (uint32_t seed : {1, 2}) {
+        SCOPED_TRACE(fmt::format("seed {}", seed));
+        auto image = RandomInstructionStream(instruction_set, seed);
+        EXPECT_TRUE(RunsInLockstep(instruction_set, engine, image, kRandomInstructions));
+    }
+}
+
+// Candidate runs whole blocks and traces, reference catches up one by one
+TEST_P(LockstepTest, RandomInstructionStreamInSteps) {
+    auto [instruction_set, engine] = GetParam();
+    auto image = RandomInstructionStream(instruction_set, 4);
+    EXPECT_TRUE(RunsInLockstep(instruction_set, engine, image, kRandomInstructions, 64));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    , LockstepTest,
+    testing::Combine(testing::Values(InstructionSet::NMOS6502, InstructionSet::CMOS65C02,
+                                     InstructionSet::NMOS6502Undocumented),
+                     testing::Values(cpu::ExecutionEngine::Threaded,
+                                     cpu::ExecutionEngine::Cached,
+                                     cpu::ExecutionEngine::Jit,
+                                     cpu::ExecutionEngine::CycleExact)),
+    [](const auto &info) {
+        return to_string(std::get<0>(info.param)) + "_" +
+               to_string(std::get<1>(info.param));
+    });
+
+struct LockstepPair {
+    ClockSimple reference_clock;
+    ClockSimple candidate_clock;
+    memory::MemoryBlock16 reference_memory;
+    memory::MemoryBlock16 candidate_memory;
+    cpu::Cpu reference{&reference_clock, &reference_memory, nullptr,
+                       InstructionSet::NMOS6502Emu, nullptr,
+                       cpu::ExecutionEngine::Reference};
+    cpu::Cpu candidate{&candidate_clock, &candidate_memory, nullptr,
+                       InstructionSet::NMOS6502Emu, nullptr,
+                       cpu::ExecutionEngine::Threaded};
+
+    LockstepPair(std::vector<uint8_t> reference_image,
+                 std::vector<uint8_t> candidate_image)
+        : reference_memory{&reference_clock, std::move(reference_image)},
+          candidate_memory{&candidate_clock, std::move(candidate_image)} {
+        reference.Reset();
+        candidate.Reset();
+    }
+};
+
+// LDA #value; STA $10; INX; HLT #$00 at 0x2000
+std::vector<uint8_t> StoreProgram(uint8_t value) {
+    std::vector<uint8_t> image(0x10000);
+    image[0xFFFD] = 0x20;
+    const std::vector<uint8_t> code{
+        cpu::opcode::INS_LDA_IM, value, cpu::opcode::INS_STA_ZP, 0x10,
+        cpu::opcode::INS_INX,    cpu::opcode::INS_HLT_IM,        0x00,
+    };
+    std::ranges::copy(code, image.begin() + 0x2000);
+    return image;
+}
+
+TEST(LockstepValidatorTest, SameProgramHaltsTogether) {
+    LockstepPair pair{StoreProgram(0x42), StoreProgram(0x42)};
+    cpu::LockstepValidator validator{InstructionSet::NMOS6502Emu, &pair.reference,
+                                     &pair.candidate};
+    EXPECT_FALSE(validator.Run(100).has_value());
+    EXPECT_EQ(validator.ValidatedInstructions(), pair.reference.ExecutedInstructions());
+    EXPECT_EQ(pair.reference_memory.block[0x10], 0x42);
+}
+
+TEST(LockstepValidatorTest, StopsAtFirstDivergence) {
+    // Candidate loads other value, registers differ after first instruction
+    LockstepPair pair{StoreProgram(0x42), StoreProgram(0x43)};
+    cpu::LockstepValidator validator{InstructionSet::NMOS6502Emu, &pair.reference,
+                                     &pair.candidate};
+    auto divergence = validator.Run(100);
+
+    ASSERT_TRUE(divergence.has_value());
+    EXPECT_EQ(divergence->instructions, 1);
+    EXPECT_NE(divergence->difference.find("registers differ"), std::string::npos);
+    ASSERT_EQ(divergence->history.size(), 1);
+    EXPECT_NE(divergence->history.front().find("LDA #$42"), std::string::npos);
+}
+
+TEST(LockstepValidatorTest, ComparesStoredMemory) {
+    auto image = StoreProgram(0x42);
+    // Registers stay the same, only the byte in zero page differs
+    auto candidate_image = image;
+    candidate_image[0x2003] = 0x11;
+    LockstepPair pair{image, candidate_image};
+    cpu::LockstepValidator validator{InstructionSet::NMOS6502Emu, &pair.reference,
+                                     &pair.candidate};
+    auto divergence = validator.Run(100);
+
+    ASSERT_TRUE(divergence.has_value());
+    EXPECT_EQ(divergence->instructions, 2);
+    EXPECT_NE(divergence->difference.find("memory at 0010"), std::string::npos);
+}
+
+TEST(LockstepValidatorTest, HistoryIsLimited) {
+    auto image = StoreProgram(0x42);
+    auto candidate_image = image;
+    candidate_image[0x2003] = 0x11;
+    LockstepPair pair{image, candidate_image};
+    cpu::LockstepValidator validator{InstructionSet::NMOS6502Emu, &pair.reference,
+                                     &pair.candidate, 1};
+    auto divergence = validator.Run(100);
+
+    ASSERT_TRUE(divergence.has_value());
+    ASSERT_EQ(divergence->history.size(), 1);
+    EXPECT_NE(divergence->history.front().find("STA $10"), std::string::npos);
+}
+
+} // namespace
+} // namespace emu::emu6502::test
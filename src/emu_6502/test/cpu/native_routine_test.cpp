@@ -0,0 +1,166 @@
+#include "cpu_test_helper.hpp"
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/native_routine.hpp>
+#include <emu_core/clock.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+namespace emu::emu6502::test {
+namespace {
+
+using namespace std::string_literals;
+using Flags = cpu::Registers::Flags;
+
+// COPY moves Y bytes from ($10) to ($12), no page is crossed
+const auto kNativeRoutineTestCode = R"==(
+.isr reset TEST_ENTRY
+
+.org 0x2000
+TEST_ENTRY:
+    LDX #$08
+NEXT_COPY:
+    LDY #$10
+    JSR COPY
+    INC $12
+    DEX
+    BNE NEXT_COPY
+    HLT #$00
+
+COPY:
+    DEY
+    LDA ($10),Y
+    STA ($12),Y
+    CPY #$00
+    BNE COPY
+    RTS
+)=="s;
+
+constexpr MemPtr kSource = 0x3000;
+constexpr MemPtr kTarget = 0x4000;
+constexpr size_t kCopySize = 0x10;
+
+MemPtr ZeroPagePointer(const Memory16 &memory, MemPtr address) {
+    return static_cast<MemPtr>(memory.Load(address) | (memory.Load(address + 1) << 8));
+}
+
+uint64_t NativeCopy(cpu::Registers &reg, Memory16 &memory) {
+    auto source = ZeroPagePointer(memory, 0x10);
+    auto target = ZeroPagePointer(memory, 0x12);
+    uint64_t iterations = 0;
+    do {
+        --reg.y;
+        reg.a = memory.Load(source + reg.y);
+        memory.Store(target + reg.y, reg.a);
+        ++iterations;
+    } while (reg.y != 0);
+    // Flags of the last CPY #$00
+    reg.SetFlag(Flags::Negative, false);
+    reg.SetFlag(Flags::Zero, true);
+    reg.SetFlag(Flags::Carry, true);
+    // DEY, LDA (zp),Y, STA (zp),Y, CPY #, BNE taken, then BNE not taken and RTS
+    return iterations * (2 + 5 + 6 + 2 + 3) - 1 + 6;
+}
+
+struct Machine : public CpuState {
+    std::unique_ptr<Program> program;
+
+    explicit Machine(cpu::ExecutionEngine engine)
+        : CpuState(engine, InstructionSet::NMOS6502Emu) {
+        memory.Fill(0, 0x200);
+        memory.Fill(kSource, kCopySize);
+        memory.Fill(kTarget, 0x100);
+        for (MemPtr i = 0; i < kCopySize; ++i) {
+            memory.Store(kSource + i, static_cast<uint8_t>(0xA0 + i));
+        }
+        memory.Store(0x10, kSource & 0xFF);
+        memory.Store(0x11, kSource >> 8);
+        memory.Store(0x12, kTarget & 0xFF);
+        memory.Store(0x13, kTarget >> 8);
+        program = Load(kNativeRoutineTestCode);
+    }
+
+    void Run() { ASSERT_EQ(cpu.Execute().status, cpu::ExecutionStatus::Halted); }
+};
+
+class NativeRoutineTest : public testing::TestWithParam<cpu::ExecutionEngine> {
+public:
+    Machine native{GetParam()};
+    Machine reference{GetParam()};
+
+    void SetUp() override { reference.Run(); }
+
+    void ExpectSameResult() {
+        EXPECT_EQ(native.cpu.ExecutedCycles(), reference.cpu.ExecutedCycles());
+        EXPECT_EQ(native.clock.CurrentCycle(), reference.clock.CurrentCycle());
+        EXPECT_EQ(native.cpu.reg.Dump(), reference.cpu.reg.Dump());
+        for (MemPtr i = 0; i < 0x100; ++i) {
+            EXPECT_EQ(native.memory.Load(kTarget + i), reference.memory.Load(kTarget + i))
+                << fmt::format("at {:04x}", kTarget + i);
+        }
+        // Last copy starts 7 bytes further
+        EXPECT_EQ(reference.memory.Load(kTarget + 7 + kCopySize - 1),
+                  0xA0 + kCopySize - 1);
+    }
+};
+
+TEST_P(NativeRoutineTest, ReplacesGuestRoutine) {
+    native.cpu.AddNativeRoutine(cpu::RoutineAddress(native.program->symbols, "COPY"),
+                                &NativeCopy);
+    native.Run();
+    ExpectSameResult();
+    EXPECT_EQ(native.cpu.NativeRoutineCalls(), 8);
+    // Each call counts as one instruction instead of 5 per byte and RTS
+    EXPECT_EQ(native.cpu.ExecutedInstructions() + 8 * 5 * kCopySize,
+              reference.cpu.ExecutedInstructions());
+}
+
+TEST_P(NativeRoutineTest, AddressFromSymbolDump) {
+    auto dump = assembler::GenerateSymbolDump(*native.program);
+    auto symbols = assembler::ParseSymbolDump(dump);
+    native.cpu.AddNativeRoutine(cpu::RoutineAddress(symbols, "COPY"), &NativeCopy);
+    native.Run();
+    ExpectSameResult();
+    EXPECT_EQ(native.cpu.NativeRoutineCalls(), 8);
+}
+
+TEST_P(NativeRoutineTest, VerificationRunsBoth) {
+    native.cpu.AddNativeRoutine(cpu::RoutineAddress(native.program->symbols, "COPY"),
+                                &NativeCopy);
+    native.cpu.SetNativeRoutineVerification(true);
+    native.Run();
+    ExpectSameResult();
+    EXPECT_EQ(native.cpu.NativeRoutineCalls(), 8);
+    EXPECT_EQ(native.cpu.ExecutedInstructions(), reference.cpu.ExecutedInstructions());
+}
+
+TEST_P(NativeRoutineTest, VerificationFindsDifference) {
+    native.cpu.AddNativeRoutine(
+        cpu::RoutineAddress(native.program->symbols, "COPY"),
+        [](cpu::Registers &reg, Memory16 &memory) {
+            auto cycles = NativeCopy(reg, memory);
+            memory.Store(kTarget + 0x80, 0x55);
+            return cycles;
+        });
+    native.cpu.SetNativeRoutineVerification(true);
+    EXPECT_THROW(native.cpu.Execute(), std::runtime_error);
+}
+
+TEST(NativeRoutineAddressTest, UnknownSymbolThrows) {
+    auto program = assembler::CompileString(kNativeRoutineTestCode,
+                                            InstructionSet::NMOS6502Emu);
+    EXPECT_EQ(cpu::RoutineAddress(program->symbols, "TEST_ENTRY"), 0x2000);
+    EXPECT_THROW((void)cpu::RoutineAddress(program->symbols, "MEMCPY"),
+                 std::runtime_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(, NativeRoutineTest,
+                         testing::Values(cpu::ExecutionEngine::Reference,
+                                         cpu::ExecutionEngine::Threaded,
+                                         cpu::ExecutionEngine::Cached,
+                                         cpu::ExecutionEngine::Jit),
+                         [](const auto &info) { return to_string(info.param); });
+
+} // namespace
+} // namespace emu::emu6502::test
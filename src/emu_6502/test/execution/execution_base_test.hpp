@@ -56,15 +56,14 @@ public:
         memory.WriteSparse(program->sparse_binary_code.sparse_map);
         std::cout << "-----------EXECUTION---------------------\n";
         auto start = std::chrono::steady_clock::now();
-        try {
-            clock.Reset();
-            cpu.ExecuteFor(timeout);
-            throw std::runtime_error("Exception was expected");
-        } catch (const cpu::ExecutionHalted &e) {
-            halt_code = e.halt_code;
-            std::cout << "-----------HALTED---------------------\n";
-            // std::cout << e.what() << "\n";
+        clock.Reset();
+        auto result = cpu.ExecuteFor(timeout);
+        if (result.status != cpu::ExecutionStatus::Halted) {
+            throw std::runtime_error(
+                fmt::format("Halt was expected, got {}", to_string(result.status)));
         }
+        halt_code = result.halt_code;
+        std::cout << "-----------HALTED---------------------\n";
         auto end = std::chrono::steady_clock::now();
         auto delta = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
         std::cout << fmt::format("Took {} microseconds\n", delta.count());
@@ -1,4 +1,5 @@
 #include "base_test.hpp"
+#include "emu_6502/cpu/decimal_arithmetic.hpp"
 #include <gtest/gtest.h>
 #include <optional>
 
@@ -130,5 +131,66 @@ std::vector<ArithmeticTestArg> GetTestCases() {
 INSTANTIATE_TEST_SUITE_P(, ArithmeticTest, ::testing::ValuesIn(GetTestCases()),
                          GenTestNameFunc());
 
+//-----------------------------------------------------------------------------
+
+// opcode, a, operand, carry, result, expected N V Z C flags
+using DecimalTestArg = std::tuple<Opcode, uint8_t, uint8_t, bool, uint8_t, uint8_t>;
+
+class DecimalArithmeticTest : public BaseTest,
+                              public ::testing::WithParamInterface<DecimalTestArg> {};
+
+constexpr uint8_t kN = static_cast<uint8_t>(Flags::Negative);
+constexpr uint8_t kV = static_cast<uint8_t>(Flags::Overflow);
+constexpr uint8_t kZ = static_cast<uint8_t>(Flags::Zero);
+constexpr uint8_t kC = static_cast<uint8_t>(Flags::Carry);
+
+TEST_P(DecimalArithmeticTest, immediate) {
+    auto [opcode, a, operand, carry, result, flags] = GetParam();
+    expected_regs.a = a;
+    expected_regs.SetFlag(Flags::DecimalMode, true);
+    expected_regs.SetFlag(Flags::Carry, carry);
+    cpu.reg = expected_regs;
+
+    expected_regs.a = result;
+    expected_regs.flags &= static_cast<uint8_t>(~(kN | kV | kZ | kC));
+    expected_regs.flags |= flags;
+    expected_cycles = 2;
+    expected_code_length = 2;
+    Execute(MakeCode(opcode, operand));
+}
+
+// Flags of NMOS 6502: ADC takes Z from binary sum, N and V from the sum before high
+// digit is adjusted. SBC flags are the same as in binary mode.
+INSTANTIATE_TEST_SUITE_P(
+    , DecimalArithmeticTest,
+    ::testing::Values(DecimalTestArg{INS_ADC, 0x12, 0x34, false, 0x46, 0},
+                      DecimalTestArg{INS_ADC, 0x58, 0x46, true, 0x05, kN | kV | kC},
+                      DecimalTestArg{INS_ADC, 0x99, 0x01, false, 0x00, kN | kC},
+                      DecimalTestArg{INS_ADC, 0x00, 0x00, false, 0x00, kZ},
+                      DecimalTestArg{INS_SBC, 0x46, 0x12, true, 0x34, kC},
+                      DecimalTestArg{INS_SBC, 0x12, 0x21, true, 0x91, kN},
+                      DecimalTestArg{INS_SBC, 0x32, 0x02, false, 0x29, kC},
+                      DecimalTestArg{INS_SBC, 0x00, 0x00, true, 0x00, kZ | kC}));
+
+uint8_t ToBcd(int v) {
+    return static_cast<uint8_t>((v / 10) << 4 | (v % 10));
+}
+
+TEST(DecimalArithmetic, ValidBcdOperands) {
+    for (int a = 0; a < 100; ++a) {
+        for (int b = 0; b < 100; ++b) {
+            for (uint8_t c = 0; c < 2; ++c) {
+                const auto &sum = DecimalAdd(ToBcd(a), ToBcd(b), c);
+                EXPECT_EQ(sum.value, ToBcd((a + b + c) % 100));
+                EXPECT_EQ((sum.flags & kC) != 0, a + b + c >= 100);
+
+                const auto &difference = DecimalSubtract(ToBcd(a), ToBcd(b), c);
+                EXPECT_EQ(difference.value, ToBcd((a - b - (1 - c) + 100) % 100));
+                EXPECT_EQ((difference.flags & kC) != 0, a - b - (1 - c) >= 0);
+            }
+        }
+    }
+}
+
 } // namespace
 } // namespace emu::emu6502::test
\ No newline at end of file
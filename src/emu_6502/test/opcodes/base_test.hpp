@@ -172,6 +172,7 @@ public:
         case AddressMode::INDY:
             return MakeCode(opcode, indirect_address);
         case AddressMode::INDX:
+        case AddressMode::ZP_IND:
             return MakeCode(opcode, indirect_address);
         case AddressMode::ZP:
         case AddressMode::ZPX:
@@ -182,7 +183,9 @@ public:
 
         case AddressMode::Implied:
         case AddressMode::ABS_IND:
+        case AddressMode::ABS_INDX:
         case AddressMode::REL:
+        case AddressMode::ZP_REL:
             EXPECT_FALSE(true) << "Not implented: " << __FUNCTION__;
             break; // TODO
         }
@@ -233,6 +236,10 @@ public:
         case AddressMode::ABSY:
             target_address = test_address + expected_regs.y;
             break;
+        case AddressMode::ZP_IND:
+            WriteMemoryWithWrap(indirect_address, ToBytes(test_address));
+            target_address = test_address;
+            break;
         case AddressMode::INDX:
             WriteMemoryWithWrap(indirect_address + expected_regs.x,
                                 ToBytes(test_address));
@@ -245,7 +252,9 @@ public:
 
         case AddressMode::Implied:
         case AddressMode::ABS_IND:
+        case AddressMode::ABS_INDX:
         case AddressMode::REL:
+        case AddressMode::ZP_REL:
             EXPECT_FALSE(true) << "Not implented: " << __FUNCTION__;
             break; // TODO
         }
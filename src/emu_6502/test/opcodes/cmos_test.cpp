@@ -0,0 +1,272 @@
+#include "base_test.hpp"
+#include <gtest/gtest.h>
+#include <optional>
+
+namespace emu::emu6502::test {
+namespace {
+
+class CmosTest : public BaseTest {
+public:
+    // 65C02 additions to the NMOS instruction set
+
+    CmosTest() : BaseTest(InstructionSet::CMOS65C02) {}
+
+    void SetUp() override {
+        BaseTest::SetUp();
+        random_reg_values = true;
+        SetupTestValues(false);
+    }
+};
+
+TEST_F(CmosTest, BRA) {
+    // MNEMONIC                        HEX TIM
+    // BRA (BRanch Always)             $80  3+
+    is_testing_jumps = true;
+    expected_code_length = 2;
+    expected_cycles = 3;
+    expected_regs.program_counter += 2 + 0x10;
+    Execute(MakeCode(INS_BRA, 0x10_u8));
+}
+
+TEST_F(CmosTest, PHX) {
+    // PHX (PusH X register)           $DA  3
+    target_address = expected_regs.StackPointerMemoryAddress();
+    memory.WriteRange(target_address, {0});
+    expected_regs.stack_pointer--;
+    expected_code_length = 1;
+    expected_cycles = 3;
+    Execute(MakeCode(INS_PHX));
+    VerifyMemory(target_address, {expected_regs.x});
+}
+
+TEST_F(CmosTest, PLY) {
+    // PLY (PuLl Y register)           $7A  4
+    expected_regs.stack_pointer++;
+    target_address = expected_regs.StackPointerMemoryAddress();
+    WriteMemory(target_address, {target_byte});
+    expected_regs.SetFlag(Flags::Negative, (target_byte & 0x80) > 0);
+    expected_regs.SetFlag(Flags::Zero, target_byte == 0);
+    expected_regs.y = target_byte;
+    expected_code_length = 1;
+    expected_cycles = 4;
+    Execute(MakeCode(INS_PLY));
+}
+
+TEST_F(CmosTest, STZ) {
+    // STZ $44                         $64  3
+    target_byte |= 1;
+    expected_code_length = 2;
+    expected_cycles = 3;
+    Execute(MakeCode(INS_STZ_ZP, AddressMode::ZP));
+    VerifyMemory(target_address, {0});
+}
+
+TEST_F(CmosTest, TRB) {
+    // TRB $44                         $14  5
+    expected_regs.SetFlag(Flags::Zero, (expected_regs.a & target_byte) == 0);
+    expected_code_length = 2;
+    expected_cycles = 5;
+    Execute(MakeCode(INS_TRB_ZP, AddressMode::ZP));
+    VerifyMemory(target_address, {static_cast<uint8_t>(target_byte & ~expected_regs.a)});
+}
+
+TEST_F(CmosTest, TSB) {
+    // TSB $4400                       $0C  6
+    expected_regs.SetFlag(Flags::Zero, (expected_regs.a & target_byte) == 0);
+    expected_code_length = 3;
+    expected_cycles = 6;
+    Execute(MakeCode(INS_TSB_ABS, AddressMode::ABS));
+    VerifyMemory(target_address, {static_cast<uint8_t>(target_byte | expected_regs.a)});
+}
+
+TEST_F(CmosTest, ASL_ABSX) {
+    // ASL $4400,X                     $1E  6+
+    auto result = static_cast<uint8_t>(target_byte << 1);
+    expected_regs.SetFlag(Flags::Carry, (target_byte & 0x80) != 0);
+    expected_regs.SetNegativeZeroFlag(result);
+    expected_code_length = 3;
+    expected_cycles = 6;
+    Execute(MakeCode(INS_ASL_ABSX, AddressMode::ABSX));
+    VerifyMemory(target_address, {result});
+}
+
+TEST_F(CmosTest, LSR_ABSXCrossPage) {
+    // LSR $4400,X                     $5E  6+, 7 when page is crossed
+    SetupTestValues(true);
+    auto result = static_cast<uint8_t>(target_byte >> 1);
+    expected_regs.SetFlag(Flags::Carry, (target_byte & 0x01) != 0);
+    expected_regs.SetNegativeZeroFlag(result);
+    expected_code_length = 3;
+    expected_cycles = 6;
+    Execute(MakeCode(INS_LSR_ABSX, AddressMode::ABSX));
+    VerifyMemory(target_address, {result});
+}
+
+TEST_F(CmosTest, ADC_Decimal) {
+    // ADC #$34                        $69  2, 3 in decimal mode
+    expected_regs.a = 0x12;
+    expected_regs.SetFlag(Flags::DecimalMode, true);
+    expected_regs.SetFlag(Flags::Carry, false);
+    cpu.reg = expected_regs;
+    expected_regs.a = 0x46;
+    expected_regs.SetNegativeZeroFlag(expected_regs.a);
+    expected_regs.SetFlag(Flags::Overflow, false);
+    expected_code_length = 2;
+    expected_cycles = 3;
+    Execute(MakeCode(INS_ADC, 0x34_u8));
+}
+
+TEST_F(CmosTest, SBC_Decimal) {
+    // SBC #$12                        $E9  2, 3 in decimal mode
+    expected_regs.a = 0x46;
+    expected_regs.SetFlag(Flags::DecimalMode, true);
+    expected_regs.SetFlag(Flags::Carry, true);
+    cpu.reg = expected_regs;
+    expected_regs.a = 0x34;
+    expected_regs.SetNegativeZeroFlag(expected_regs.a);
+    expected_regs.SetFlag(Flags::Overflow, false);
+    expected_code_length = 2;
+    expected_cycles = 3;
+    Execute(MakeCode(INS_SBC, 0x12_u8));
+}
+
+TEST_F(CmosTest, LDA_INDZP) {
+    // LDA ($44)                       $B2  5
+    expected_regs.a = target_byte;
+    expected_regs.SetFlag(Flags::Negative, (target_byte & 0x80) > 0);
+    expected_regs.SetFlag(Flags::Zero, target_byte == 0);
+    expected_code_length = 2;
+    expected_cycles = 5;
+    Execute(MakeCode(INS_LDA_INDZP, AddressMode::ZP_IND));
+}
+
+TEST_F(CmosTest, INC_ACC) {
+    // INC A                           $1A  2
+    expected_regs.a = static_cast<uint8_t>(expected_regs.a + 1);
+    expected_regs.SetFlag(Flags::Negative, (expected_regs.a & 0x80) > 0);
+    expected_regs.SetFlag(Flags::Zero, expected_regs.a == 0);
+    expected_code_length = 1;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_INC_ACC));
+}
+
+TEST_F(CmosTest, BIT_IM) {
+    // BIT #$44                        $89  2, only Z flag is affected
+    expected_regs.SetFlag(Flags::Zero, (expected_regs.a & target_byte) == 0);
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_BIT_IM, AddressMode::IM));
+}
+
+TEST_F(CmosTest, RMB) {
+    // RMB3 $44                        $37  5
+    target_byte |= 1 << 3;
+    expected_code_length = 2;
+    expected_cycles = 5;
+    Execute(MakeCode(BitOpcode(INS_RMB0, 3), AddressMode::ZP));
+    VerifyMemory(target_address, {static_cast<uint8_t>(target_byte & ~(1 << 3))});
+}
+
+TEST_F(CmosTest, SMB) {
+    // SMB5 $44                        $D7  5
+    target_byte &= ~(1 << 5);
+    expected_code_length = 2;
+    expected_cycles = 5;
+    Execute(MakeCode(BitOpcode(INS_SMB0, 5), AddressMode::ZP));
+    VerifyMemory(target_address, {static_cast<uint8_t>(target_byte | (1 << 5))});
+}
+
+TEST_F(CmosTest, BBRTaken) {
+    // BBR0 $44,LABEL                  $0F  5+
+    WriteMemory(zero_page_address, {0xFE});
+    is_testing_jumps = true;
+    expected_code_length = 3;
+    expected_cycles = 6;
+    expected_regs.program_counter += 3 + 0x10;
+    Execute({INS_BBR0, zero_page_address, 0x10});
+}
+
+TEST_F(CmosTest, BBSNotTaken) {
+    // BBS7 $44,LABEL                  $FF  5+
+    WriteMemory(zero_page_address, {0x7F});
+    expected_code_length = 3;
+    expected_cycles = 5;
+    Execute({BitOpcode(INS_BBS0, 7), zero_page_address, 0x10});
+}
+
+TEST_F(CmosTest, JMP_IND) {
+    // JMP ($44FF)                     $6C  6, pointer does not wrap within the page
+    WriteMemory(0x20FF, {0x34, 0x12});
+    WriteMemory(0x2000, {0x56});
+    is_testing_jumps = true;
+    expected_code_length = 3;
+    expected_cycles = 6;
+    expected_regs.program_counter = 0x1234;
+    Execute(MakeCode(INS_JMP_IND, 0x20FF_u16));
+}
+
+TEST_F(CmosTest, JMP_ABSX_IND) {
+    // JMP ($4400,X)                   $7C  6
+    WriteMemory(0x2000 + expected_regs.x, {0x34, 0x12});
+    is_testing_jumps = true;
+    expected_code_length = 3;
+    expected_cycles = 6;
+    expected_regs.program_counter = 0x1234;
+    Execute(MakeCode(INS_JMP_ABSX_IND, 0x2000_u16));
+}
+
+TEST_F(CmosTest, BRK) {
+    // BRK (BReaK)                     $00  7, clears D flag after pushing it
+    expected_code_length = 2;
+    expected_cycles = 7;
+    is_testing_jumps = true;
+
+    WriteMemory(kIrqVector, ToBytes(test_address));
+    cpu.reg.SetFlag(Flags::DecimalMode, true);
+    uint8_t pushed_flags = cpu.reg.flags | static_cast<uint8_t>(Flags::Brk) |
+                           static_cast<uint8_t>(Flags::NotUsed);
+    MemPtr flags_address = expected_regs.StackPointerMemoryAddress() - 2;
+
+    expected_regs.program_counter = test_address;
+    expected_regs.SetFlag(Flags::IRQB, true);
+    expected_regs.SetFlag(Flags::DecimalMode, false);
+    ExpectStackWrite(3);
+
+    Execute(MakeCode(INS_BRK, 1_u8));
+    VerifyMemory(flags_address, {pushed_flags});
+}
+
+TEST_F(CmosTest, STP) {
+    // STP (SToP)                      $DB  3
+    expected_code_length = 1;
+    expected_cycles = 3;
+    Execute(MakeCode(INS_STP));
+    EXPECT_EQ(cpu.Status(), ExecutionStatus::Halted);
+}
+
+TEST_F(CmosTest, WAI) {
+    // WAI (WAit for Interrupt)        $CB  3
+    // Nothing is scheduled, cpu stays on WAI until an interrupt line is asserted
+    is_testing_jumps = true;
+    expected_code_length = 1;
+    expected_cycles = 3;
+    Execute(MakeCode(INS_WAI));
+    EXPECT_EQ(cpu.Status(), ExecutionStatus::Waiting);
+}
+
+TEST_F(CmosTest, NmosOpcodeReplaced) {
+    // $FA is HLT A in the emulator set and PLX on 65C02
+    expected_regs.stack_pointer++;
+    target_address = expected_regs.StackPointerMemoryAddress();
+    WriteMemory(target_address, {target_byte});
+    expected_regs.SetFlag(Flags::Negative, (target_byte & 0x80) > 0);
+    expected_regs.SetFlag(Flags::Zero, target_byte == 0);
+    expected_regs.x = target_byte;
+    expected_code_length = 1;
+    expected_cycles = 4;
+    Execute(MakeCode(INS_PLX));
+    EXPECT_EQ(cpu.Status(), ExecutionStatus::Running);
+}
+
+} // namespace
+} // namespace emu::emu6502::test
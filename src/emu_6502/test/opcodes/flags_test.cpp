@@ -0,0 +1,92 @@
+#include "base_test.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace emu::emu6502::test {
+namespace {
+
+using LazyFlags = BasicFlagRegister<true>;
+using EagerFlags = BasicFlagRegister<false>;
+
+constexpr std::array kAllFlags = {
+    Flags::Carry, Flags::Zero,     Flags::IRQB,     Flags::DecimalMode,
+    Flags::Brk,   Flags::NotUsed,  Flags::Overflow, Flags::Negative,
+};
+
+void ExpectSameFlags(const LazyFlags &lazy, const EagerFlags &eager, size_t step) {
+    ASSERT_EQ(lazy.Get(), eager.Get()) << "step " << step;
+    for (auto f : kAllFlags) {
+        ASSERT_EQ(lazy.Test(f), eager.Test(f))
+            << "step " << step << " flag " << static_cast<int>(f);
+    }
+}
+
+// Same random sequence of updates applied to both variants, every read has to match
+TEST(LazyFlagsTest, MatchesEagerFlags) {
+    std::mt19937 mt{0x6502};
+    LazyFlags lazy;
+    EagerFlags eager;
+
+    for (size_t step = 0; step < 100000; ++step) {
+        auto v = static_cast<uint8_t>(mt());
+        auto f = kAllFlags[mt() % kAllFlags.size()];
+        switch (mt() % 6) {
+        case 0:
+            lazy.SetNegativeZero(v);
+            eager.SetNegativeZero(v);
+            break;
+        case 1: {
+            // ADC and SBC (inverted operand) with current carry
+            auto operand = static_cast<uint8_t>(mt());
+            uint16_t sum = v + operand + (eager.Test(Flags::Carry) ? 1 : 0);
+            lazy.SetAddition(v, operand, sum);
+            eager.SetAddition(v, operand, sum);
+            break;
+        }
+        case 2:
+            lazy.Set(f, (v & 1) != 0);
+            eager.Set(f, (v & 1) != 0);
+            break;
+        case 3:
+            // PLP
+            lazy = v;
+            eager = v;
+            break;
+        case 4:
+            lazy &= v;
+            eager &= v;
+            break;
+        case 5:
+            lazy.Materialize();
+            eager.Materialize();
+            break;
+        }
+        ExpectSameFlags(lazy, eager, step);
+    }
+}
+
+TEST(LazyFlagsTest, AdditionFlags) {
+    for (int a = 0; a < 256; ++a) {
+        for (int operand = 0; operand < 256; ++operand) {
+            for (int carry = 0; carry < 2; ++carry) {
+                uint16_t sum = a + operand + carry;
+                LazyFlags lazy;
+                EagerFlags eager;
+                lazy.SetAddition(a, operand, sum);
+                eager.SetAddition(a, operand, sum);
+
+                int result =
+                    static_cast<int8_t>(a) + static_cast<int8_t>(operand) + carry;
+                bool overflow = result < -128 || result > 127;
+                EXPECT_EQ(eager.Test(Flags::Overflow), overflow);
+                EXPECT_EQ(eager.Test(Flags::Carry), sum > 0xFF);
+                EXPECT_EQ(eager.Test(Flags::Zero), (sum & 0xFF) == 0);
+                EXPECT_EQ(eager.Test(Flags::Negative), (sum & 0x80) != 0);
+                EXPECT_EQ(lazy.Get(), eager.Get());
+            }
+        }
+    }
+}
+
+} // namespace
+} // namespace emu::emu6502::test
@@ -181,14 +181,18 @@ TEST_F(EmuTest, HLT_IM) {
     expected_code_length = 2;
     expected_cycles = 2;
 
-    EXPECT_THROW(Execute(MakeCode(INS_HLT_IM, 1_u8)), cpu::ExecutionHalted);
+    Execute(MakeCode(INS_HLT_IM, 1_u8));
+    EXPECT_EQ(cpu.Status(), cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(cpu.Result().halt_code, 1);
 }
 
 TEST_F(EmuTest, HLT_ACC) {
     expected_code_length = 1;
     expected_cycles = 1;
 
-    EXPECT_THROW(Execute(MakeCode(INS_HLT_ACC)), cpu::ExecutionHalted);
+    Execute(MakeCode(INS_HLT_ACC));
+    EXPECT_EQ(cpu.Status(), cpu::ExecutionStatus::Halted);
+    EXPECT_EQ(cpu.Result().halt_code, cpu.reg.a);
 }
 
 } // namespace
@@ -0,0 +1,226 @@
+#include "base_test.hpp"
+#include <gtest/gtest.h>
+#include <tuple>
+
+namespace emu::emu6502::test {
+namespace {
+
+class UndocumentedTest : public BaseTest {
+public:
+    // Stable NMOS undocumented opcodes
+
+    UndocumentedTest() : BaseTest(InstructionSet::NMOS6502Undocumented) {}
+
+    void SetUp() override {
+        BaseTest::SetUp();
+        random_reg_values = true;
+        SetupTestValues(false);
+        expected_regs.SetFlag(Flags::DecimalMode, false);
+        cpu.reg = expected_regs;
+    }
+
+    void ExpectNegativeZero(uint8_t v) {
+        expected_regs.SetFlag(Flags::Negative, (v & 0x80) > 0);
+        expected_regs.SetFlag(Flags::Zero, v == 0);
+    }
+
+    void ExpectAddWithCarry(uint8_t operand) {
+        unsigned sum = expected_regs.a + operand + (expected_regs.TestFlag(Flags::Carry));
+        auto result = static_cast<uint8_t>(sum);
+        expected_regs.SetFlag(Flags::Carry, sum > 0xFF);
+        auto overflow = (expected_regs.a ^ result) & (operand ^ result) & 0x80;
+        expected_regs.SetFlag(Flags::Overflow, overflow != 0);
+        expected_regs.a = result;
+        ExpectNegativeZero(result);
+    }
+};
+
+TEST_F(UndocumentedTest, SLO) {
+    // SLO $44                         $07  5
+    uint8_t value = target_byte << 1;
+    expected_regs.SetFlag(Flags::Carry, (target_byte & 0x80) > 0);
+    expected_regs.a |= value;
+    ExpectNegativeZero(expected_regs.a);
+    expected_code_length = 2;
+    expected_cycles = 5;
+    Execute(MakeCode(INS_SLO_ZP, AddressMode::ZP));
+    VerifyMemory(target_address, {value});
+}
+
+TEST_F(UndocumentedTest, RLA) {
+    // RLA $4400                       $2F  6
+    uint8_t value = (target_byte << 1) | (expected_regs.TestFlag(Flags::Carry) ? 1 : 0);
+    expected_regs.SetFlag(Flags::Carry, (target_byte & 0x80) > 0);
+    expected_regs.a &= value;
+    ExpectNegativeZero(expected_regs.a);
+    expected_code_length = 3;
+    expected_cycles = 6;
+    Execute(MakeCode(INS_RLA_ABS, AddressMode::ABS));
+    VerifyMemory(target_address, {value});
+}
+
+TEST_F(UndocumentedTest, SRE) {
+    // SRE ($44),Y                     $53  8
+    uint8_t value = target_byte >> 1;
+    expected_regs.SetFlag(Flags::Carry, (target_byte & 0x01) > 0);
+    expected_regs.a ^= value;
+    ExpectNegativeZero(expected_regs.a);
+    expected_code_length = 2;
+    expected_cycles = 8;
+    Execute(MakeCode(INS_SRE_INDY, AddressMode::INDY));
+    VerifyMemory(target_address, {value});
+}
+
+TEST_F(UndocumentedTest, RRA) {
+    // RRA $44,X                       $77  6
+    uint8_t value =
+        (target_byte >> 1) | (expected_regs.TestFlag(Flags::Carry) ? 0x80 : 0);
+    expected_regs.SetFlag(Flags::Carry, (target_byte & 0x01) > 0);
+    ExpectAddWithCarry(value);
+    expected_code_length = 2;
+    expected_cycles = 6;
+    Execute(MakeCode(INS_RRA_ZPX, AddressMode::ZPX));
+    VerifyMemory(target_address, {value});
+}
+
+TEST_F(UndocumentedTest, ISC) {
+    // ISC $4400,Y                     $FB  7
+    auto value = static_cast<uint8_t>(target_byte + 1);
+    ExpectAddWithCarry(static_cast<uint8_t>(~value));
+    expected_code_length = 3;
+    expected_cycles = 7;
+    Execute(MakeCode(INS_ISC_ABSY, AddressMode::ABSY));
+    VerifyMemory(target_address, {value});
+}
+
+TEST_F(UndocumentedTest, LAX) {
+    // LAX ($44),Y                     $B3  5+
+    expected_regs.a = expected_regs.x = target_byte;
+    ExpectNegativeZero(target_byte);
+    expected_code_length = 2;
+    expected_cycles = 5;
+    Execute(MakeCode(INS_LAX_INDY, AddressMode::INDY));
+}
+
+TEST_F(UndocumentedTest, SAX) {
+    // SAX $44,Y                       $97  4
+    expected_code_length = 2;
+    expected_cycles = 4;
+    Execute(MakeCode(INS_SAX_ZPY, AddressMode::ZPY));
+    VerifyMemory(target_address,
+                 {static_cast<uint8_t>(expected_regs.a & expected_regs.x)});
+}
+
+TEST_F(UndocumentedTest, ANC) {
+    // ANC #$44                        $0B  2
+    expected_regs.a &= target_byte;
+    ExpectNegativeZero(expected_regs.a);
+    expected_regs.SetFlag(Flags::Carry, (expected_regs.a & 0x80) > 0);
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_ANC_IM2, AddressMode::IM));
+}
+
+TEST_F(UndocumentedTest, ALR) {
+    // ALR #$44                        $4B  2
+    uint8_t and_value = expected_regs.a & target_byte;
+    expected_regs.a = and_value >> 1;
+    ExpectNegativeZero(expected_regs.a);
+    expected_regs.SetFlag(Flags::Carry, (and_value & 0x01) > 0);
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_ALR_IM, AddressMode::IM));
+}
+
+TEST_F(UndocumentedTest, ARR) {
+    // ARR #$44                        $6B  2
+    uint8_t and_value = expected_regs.a & target_byte;
+    expected_regs.a =
+        (and_value >> 1) | (expected_regs.TestFlag(Flags::Carry) ? 0x80 : 0x00);
+    ExpectNegativeZero(expected_regs.a);
+    expected_regs.SetFlag(Flags::Carry, (expected_regs.a & 0x40) > 0);
+    expected_regs.SetFlag(Flags::Overflow,
+                          (((expected_regs.a >> 6) ^ (expected_regs.a >> 5)) & 1) > 0);
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_ARR_IM, AddressMode::IM));
+}
+
+TEST_F(UndocumentedTest, SBX) {
+    // SBX #$44                        $CB  2
+    uint8_t ax = expected_regs.a & expected_regs.x;
+    expected_regs.x = ax - target_byte;
+    ExpectNegativeZero(expected_regs.x);
+    expected_regs.SetFlag(Flags::Carry, ax >= target_byte);
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_SBX_IM, AddressMode::IM));
+}
+
+TEST_F(UndocumentedTest, SBC_IM2) {
+    // SBC #$44                        $EB  2, same as $E9
+    ExpectAddWithCarry(static_cast<uint8_t>(~target_byte));
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(INS_SBC_IM2, AddressMode::IM));
+}
+
+TEST_F(UndocumentedTest, NOP_ABSX) {
+    // NOP $4400,X                     $1C  4+
+    expected_code_length = 3;
+    expected_cycles = 4;
+    Execute(MakeCode(kNopABSX[0], AddressMode::ABSX));
+    VerifyMemory(target_address, {target_byte});
+}
+
+TEST_F(UndocumentedTest, NOP_IM) {
+    // NOP #$44                        $80  2
+    expected_code_length = 2;
+    expected_cycles = 2;
+    Execute(MakeCode(kNopIM[0], AddressMode::IM));
+}
+
+//-----------------------------------------------------------------------------
+
+using DcpTestArg = std::tuple<Opcode, AddressMode, uint8_t, uint8_t>;
+
+class DcpTest : public UndocumentedTest,
+                public ::testing::WithParamInterface<DcpTestArg> {
+public:
+    // DCP (DEC memory, then CMP), affects flags: N Z C
+};
+
+TEST_P(DcpTest, ) {
+    auto [opcode, mode, len, cycles] = GetParam();
+    auto value = static_cast<uint8_t>(target_byte - 1);
+    ExpectNegativeZero(static_cast<uint8_t>(expected_regs.a - value));
+    expected_regs.SetFlag(Flags::Carry, expected_regs.a >= value);
+    expected_code_length = len;
+    expected_cycles = cycles;
+    Execute(MakeCode(opcode, mode));
+    VerifyMemory(target_address, {value});
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    , DcpTest,
+    ::testing::ValuesIn(std::vector<DcpTestArg>{
+        // MODE           SYNTAX       HEX LEN TIM
+        // Zero Page     DCP $44       $C7  2   5
+        {INS_DCP_ZP, AddressMode::ZP, 2_u8, 5_u8},
+        // Zero Page,X   DCP $44,X     $D7  2   6
+        {INS_DCP_ZPX, AddressMode::ZPX, 2_u8, 6_u8},
+        // Absolute      DCP $4400     $CF  3   6
+        {INS_DCP_ABS, AddressMode::ABS, 3_u8, 6_u8},
+        // Absolute,X    DCP $4400,X   $DF  3   7
+        {INS_DCP_ABSX, AddressMode::ABSX, 3_u8, 7_u8},
+        // Absolute,Y    DCP $4400,Y   $DB  3   7
+        {INS_DCP_ABSY, AddressMode::ABSY, 3_u8, 7_u8},
+        // Indirect,X    DCP ($44,X)   $C3  2   8
+        {INS_DCP_INDX, AddressMode::INDX, 2_u8, 8_u8},
+        // Indirect,Y    DCP ($44),Y   $D3  2   8
+        {INS_DCP_INDY, AddressMode::INDY, 2_u8, 8_u8},
+    }),
+    [](const auto &info) { return to_string(std::get<1>(info.param)); });
+
+} // namespace
+} // namespace emu::emu6502::test
@@ -0,0 +1,133 @@
+#include <emu_6502/cpu/cpu.hpp>
+#include <emu_6502/cpu/opcode.hpp>
+#include <emu_6502/recompiler/recompiler.hpp>
+#include <emu_6502/recompiler/runtime.hpp>
+#include <emu_core/clock.hpp>
+#include <emu_core/memory/memory_sparse.hpp>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <vector>
+
+namespace emu::emu6502::test {
+namespace {
+
+using namespace cpu::opcode;
+using namespace recompiler::runtime;
+
+constexpr MemPtr kCodeBase = 0x2000;
+
+class RecompilerTest : public testing::Test {
+public:
+    ClockSimple clock;
+    memory::MemorySparse16 memory{&clock, true};
+
+    void SetUp() override {
+        memory.Fill(0, 0x100);
+        memory.Fill(0x100, 0x100); // stack
+        memory.WriteRange(kResetVector, {kCodeBase & 0xFF, kCodeBase >> 8});
+    }
+};
+
+TEST_F(RecompilerTest, DiscoverCode) {
+    memory.WriteRange(kCodeBase, {
+                                     INS_LDX_IM, 0x03,       // 2000
+                                     INS_DEX,                // 2002
+                                     INS_BNE, 0xFD,          // 2003
+                                     INS_JSR, 0x10, 0x20,    // 2005
+                                     INS_HLT_IM, 0x00,       // 2008
+                                 });
+    memory.WriteRange(0x2010, {INS_RTS});
+
+    auto entry_points = recompiler::GetVectorEntryPoints(memory);
+    ASSERT_EQ(entry_points, std::vector<MemPtr>{kCodeBase});
+
+    auto code =
+        recompiler::DiscoverCode(memory, InstructionSet::NMOS6502Emu, entry_points);
+    std::vector<MemPtr> blocks;
+    for (const auto &[address, block] : code.blocks) {
+        blocks.emplace_back(address);
+    }
+    EXPECT_EQ(blocks, (std::vector<MemPtr>{0x2000, 0x2002, 0x2005, 0x2008, 0x2010}));
+    EXPECT_EQ(code.blocks.at(0x2002).instructions.size(), 2);
+    EXPECT_EQ(code.blocks.at(0x2002).CodeSize(), 3);
+    EXPECT_EQ(code.indirect_jumps, std::set<MemPtr>{0x2010});
+
+    auto source = recompiler::GenerateCpp(code, InstructionSet::NMOS6502Emu, "test");
+    EXPECT_NE(source.find("void Block_2002(Cpu *cpu, uint32_t *executed)"),
+              std::string::npos);
+    EXPECT_NE(source.find("Branch(cpu, reg.TestFlag(Flags::Zero) == false, 0x2002, 1);"),
+              std::string::npos);
+    EXPECT_NE(source.find(cpu::kRecompiledProgramSymbol), std::string::npos);
+}
+
+// Marks execution by loading a different value than the code it replaces
+void LoadMarker(cpu::Cpu *cpu, uint32_t *executed) {
+    ++*executed;
+    Fetch(cpu, kCodeBase + 2, 2);
+    LoadRegister(cpu->reg, cpu->reg.a, 0x55);
+}
+
+const uint8_t kMarkerCode[] = {INS_LDA_IM, 0x42};
+const cpu::RecompiledBlock kMarkerBlocks[] = {
+    {kCodeBase, 1, 2, 4, kMarkerCode, &LoadMarker},
+};
+const cpu::RecompiledProgram kMarkerProgram{
+    cpu::kRecompiledAbiVersion,
+    InstructionSet::NMOS6502Emu,
+    kMarkerBlocks,
+    std::size(kMarkerBlocks),
+};
+
+uint8_t RunUntilHalt(cpu::Cpu &cpu) {
+    cpu.Reset();
+    cpu.ExecuteBatch(100);
+    if (cpu.Status() != cpu::ExecutionStatus::Halted) {
+        ADD_FAILURE() << "Cpu did not halt";
+        return 0;
+    }
+    return cpu.Result().regs.a;
+}
+
+TEST_F(RecompilerTest, RecompiledBlockReplacesInterpretedCode) {
+    memory.WriteRange(kCodeBase, {INS_LDA_IM, 0x42, INS_HLT_ACC});
+    cpu::Cpu cpu{&clock,  &memory, nullptr, InstructionSet::NMOS6502Emu,
+                 nullptr, cpu::ExecutionEngine::Cached};
+    cpu.AttachRecompiledProgram(&kMarkerProgram);
+    EXPECT_EQ(RunUntilHalt(cpu), 0x55);
+    EXPECT_EQ(cpu.ExecutedInstructions(), 2);
+}
+
+TEST_F(RecompilerTest, ChangedCodeIsInterpreted) {
+    memory.WriteRange(kCodeBase, {INS_LDA_IM, 0x41, INS_HLT_ACC});
+    cpu::Cpu cpu{&clock,  &memory, nullptr, InstructionSet::NMOS6502Emu,
+                 nullptr, cpu::ExecutionEngine::Cached};
+    cpu.AttachRecompiledProgram(&kMarkerProgram);
+    EXPECT_EQ(RunUntilHalt(cpu), 0x41);
+    EXPECT_EQ(cpu.ExecutedInstructions(), 2);
+}
+
+TEST_F(RecompilerTest, StoreIntoCodeIsDetected) {
+    // Second pass runs with the operand stored by the first one
+    memory.WriteRange(kCodeBase, {
+                                     INS_LDA_IM, 0x42,        // 2000
+                                     INS_CMP, 0x55,           // 2002
+                                     INS_BNE, 0x08,           // 2004
+                                     INS_LDX_IM, 0x33,        // 2006
+                                     INS_STX_ABS, 0x01, 0x20, // 2008
+                                     INS_JMP_ABS, 0x00, 0x20, // 200b
+                                     INS_HLT_ACC,             // 200e
+                                 });
+    cpu::Cpu cpu{&clock,  &memory, nullptr, InstructionSet::NMOS6502Emu,
+                 nullptr, cpu::ExecutionEngine::Cached};
+    cpu.AttachRecompiledProgram(&kMarkerProgram);
+    EXPECT_EQ(RunUntilHalt(cpu), 0x33);
+}
+
+TEST_F(RecompilerTest, ReferenceEngineIsRejected) {
+    cpu::Cpu cpu{&clock,  &memory, nullptr, InstructionSet::NMOS6502Emu,
+                 nullptr, cpu::ExecutionEngine::Reference};
+    EXPECT_THROW(cpu.AttachRecompiledProgram(&kMarkerProgram), std::runtime_error);
+}
+
+} // namespace
+} // namespace emu::emu6502::test
@@ -39,6 +39,7 @@ struct Options {
             ;
 
         cpu_options.add_options()
+            ("instruction-set", po::value<std::string>()->default_value(to_string(InstructionSet::NMOS6502Emu)), "CPU instruction set: nmos6502, nmos6502emu, cmos65c02, nmos6502undocumented")
             // ("cpu", po::value<uint64_t>()->default_value(1'000'000), "CPU clock speed in Hz. Use 0 for unlimited.")
             ;
 
@@ -93,6 +94,8 @@ struct Options {
 protected:
     void ReadVariableMap(const po::variables_map &vm, ExecArguments &args) {
         args.verbose = vm.count("verbose") > 0;
+        args.cpu_options.instruction_set =
+            ParseInstructionSet(vm["instruction-set"].as<std::string>());
 
         ReadInputOptions(args.streams, args.input_options, vm);
         ReadOutputOptions(args.streams, args.output_options, vm);
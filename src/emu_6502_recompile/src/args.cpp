@@ -0,0 +1,138 @@
+#include "args.hpp"
+#include "emu_core/file_search.hpp"
+#include "emu_core/package/package_fs.hpp"
+#include "emu_core/package/package_zip.hpp"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <fmt/format.h>
+#include <iostream>
+#include <stdexcept>
+
+namespace emu::recompile {
+
+namespace po = boost::program_options;
+
+namespace {
+
+struct Options {
+    po::options_description all_options;
+    po::options_description code_options{"Code options"};
+    po::options_description out_options{"Output options"};
+    po::options_description image_options{"Image load options"};
+    po::positional_options_description image_positional_opt;
+
+    std::shared_ptr<FileSearch> file_search = FileSearch::CreateDefault();
+
+    Options() {
+        // clang-format off
+
+        all_options.add_options()
+            ("help", "Produce help message")
+            ;
+
+        code_options.add_options()
+            ("entry", po::value<std::vector<std::string>>(), "Additional code entry point, hex address. Reset, irq and nmi vectors are always used.")
+            ;
+
+        out_options.add_options()
+            ("output,o", po::value<std::string>()->required(), "Output C++ file")
+            ;
+
+        image_positional_opt.add("image", -1);
+        image_options.add_options()
+            ("image", po::value<std::string>()->required(), "Image to recompile")
+            ;
+
+        // clang-format on
+
+        all_options             //
+            .add(code_options)  //
+            .add(out_options)   //
+            .add(image_options) //
+            ;
+    }
+
+    ExecArguments ParseComandline(int argc, char **argv) {
+        try {
+            po::variables_map vm;
+            po::store(po::command_line_parser(argc, argv) //
+                          .options(all_options)
+                          .positional(image_positional_opt)
+                          .run(),
+                      vm);
+            if (vm.count("help") > 0) {
+                PrintHelp(0);
+            }
+            po::notify(vm);
+            ExecArguments exec_args;
+            ReadVariableMap(vm, exec_args);
+            return exec_args;
+        } catch (const std::logic_error &e) {
+            std::cout << "Error: " << e.what() << "\n";
+            std::cout << "\n";
+            PrintHelp(1);
+        }
+    }
+
+protected:
+    void ReadVariableMap(const po::variables_map &vm, ExecArguments &args) {
+        args.output_path = vm["output"].as<std::string>();
+        if (vm.count("entry") > 0) {
+            for (const auto &entry : vm["entry"].as<std::vector<std::string>>()) {
+                auto address = std::stoul(entry, nullptr, 16);
+                if (address > 0xFFFF) {
+                    throw std::logic_error(fmt::format("{} is not valid address", entry));
+                }
+                args.entry_points.emplace_back(static_cast<emu6502::MemPtr>(address));
+            }
+        }
+        OpenPackage(args, vm);
+    }
+
+    void OpenPackage(ExecArguments &args, const po::variables_map &vm) {
+        auto config = vm["image"].as<std::string>();
+
+        auto path = std::filesystem::path(config);
+        if (!std::filesystem::is_regular_file(path)) {
+            throw std::runtime_error(fmt::format("file {} is not valid", config));
+        }
+        args.image_name = path.filename().generic_string();
+        auto ext = path.extension().generic_string();
+        std::shared_ptr<FileSearch> searcher =
+            file_search->PrependPath(path.parent_path().generic_string());
+
+        if (ext == ".yaml") {
+            args.package = std::make_unique<package::FsPackage>(config, searcher);
+        } else if (ext == package::kEmuImageExtension) {
+            args.package = std::make_unique<package::ZipPackage>(config);
+        } else {
+            MemoryConfigEntry area;
+            area.offset = 0;
+            area.name = config;
+            area.entry_variant = MemoryConfigEntry::RamArea{
+                .image = MemoryConfigEntry::RamArea::Image{.file = args.image_name,
+                                                           .offset = 0},
+                .writable = true,
+            };
+            MemoryConfig mem_config;
+            mem_config.entries.emplace_back(area);
+            args.package = std::make_unique<package::FsPackage>(mem_config, searcher);
+        }
+    }
+
+    [[noreturn]] void PrintHelp(int exit_code) const {
+        std::cout << "Emu 6502 recompiler, converts code of an image to C++ module";
+        std::cout << "\n";
+        std::cout << all_options;
+        std::cout << "\n";
+        exit(exit_code);
+    }
+};
+
+} // namespace
+
+ExecArguments ParseComandline(int argc, char **argv) {
+    return Options().ParseComandline(argc, argv);
+}
+
+} // namespace emu::recompile
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "emu_6502/instruction_set.hpp"
+#include "emu_core/package/package.hpp"
+#include "emu_core/stream_container.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace emu::recompile {
+
+struct ExecArguments {
+    emu6502::InstructionSet instruction_set = emu6502::InstructionSet::NMOS6502Emu;
+    // In addition to reset, irq and nmi vectors
+    std::vector<emu6502::MemPtr> entry_points;
+    std::string image_name;
+    std::unique_ptr<package::IPackage> package;
+
+    StreamContainer streams;
+    std::string output_path;
+};
+
+ExecArguments ParseComandline(int argc, char **argv);
+
+} // namespace emu::recompile
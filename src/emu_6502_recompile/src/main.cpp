@@ -0,0 +1,17 @@
+#include "args.hpp"
+#include "runner.hpp"
+#include <iostream>
+#include <memory>
+
+int main(int argc, char **argv) {
+    using namespace emu::recompile;
+
+    try {
+        auto runner = std::make_shared<Runner>();
+        auto args = ParseComandline(argc, argv);
+        return runner->Recompile(args);
+    } catch (const std::exception &e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+    }
+    return 1;
+}
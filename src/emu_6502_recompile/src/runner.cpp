@@ -0,0 +1,52 @@
+#include "runner.hpp"
+#include "emu_6502/recompiler/recompiler.hpp"
+#include <fmt/format.h>
+#include <iostream>
+
+namespace emu::recompile {
+
+int Runner::Recompile(const ExecArguments &exec_args) {
+    for (const auto &entry : exec_args.package->LoadMemoryConfig().entries) {
+        std::visit(
+            [&](const auto &value) { LoadEntry(*exec_args.package, entry, value); },
+            entry.entry_variant);
+    }
+
+    auto entry_points = emu6502::recompiler::GetVectorEntryPoints(memory);
+    entry_points.insert(entry_points.end(), exec_args.entry_points.begin(),
+                        exec_args.entry_points.end());
+    if (entry_points.empty()) {
+        throw std::runtime_error("Image has no entry points");
+    }
+
+    auto code = emu6502::recompiler::DiscoverCode(memory, exec_args.instruction_set,
+                                                  entry_points);
+    auto source = emu6502::recompiler::GenerateCpp(code, exec_args.instruction_set,
+                                                   exec_args.image_name);
+
+    StreamContainer streams;
+    auto *output = streams.OpenTextOutput(exec_args.output_path);
+    (*output) << source;
+
+    std::cout << fmt::format("Recompiled {} blocks, {} indirect jumps\n",
+                             code.blocks.size(), code.indirect_jumps.size());
+    return 0;
+}
+
+void Runner::LoadEntry(const package::IPackage &package, const MemoryConfigEntry &entry,
+                       const MemoryConfigEntry::RamArea &ra) {
+    if (!ra.image.has_value()) {
+        return;
+    }
+    auto bytes = package.LoadFile(ra.image->file, ra.image->offset, ra.size);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        memory.memory_map[static_cast<emu6502::MemPtr>(entry.offset + i)] = bytes[i];
+    }
+}
+
+void Runner::LoadEntry(const package::IPackage &package, const MemoryConfigEntry &entry,
+                       const MemoryConfigEntry::MappedDevice &md) {
+    // nothing
+}
+
+} // namespace emu::recompile
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "args.hpp"
+#include "emu_core/memory/memory_sparse.hpp"
+#include "emu_core/memory_configuration_file.hpp"
+
+namespace emu::recompile {
+
+struct Runner {
+    Runner() {}
+    int Recompile(const ExecArguments &exec_args);
+
+protected:
+    // Only preloaded ram areas are visible to code discovery, mapped devices are not
+    memory::MemorySparse16 memory{nullptr};
+
+    void LoadEntry(const package::IPackage &package, const MemoryConfigEntry &entry,
+                   const MemoryConfigEntry::RamArea &ra);
+    void LoadEntry(const package::IPackage &package, const MemoryConfigEntry &entry,
+                   const MemoryConfigEntry::MappedDevice &md);
+};
+
+} // namespace emu::recompile
@@ -66,6 +66,14 @@ struct Options {
 
         cpu_options.add_options()
             ("frequency", po::value<uint64_t>()->default_value(emu::k1MhzFrequency), "CPU clock speed in Hz. Use 0 for unlimited.")
+            ("instruction-set", po::value<std::string>()->default_value(to_string(emu6502::InstructionSet::NMOS6502Emu)), "CPU instruction set: nmos6502, nmos6502emu, cmos65c02, nmos6502undocumented")
+            ("engine", po::value<std::string>()->default_value(to_string(emu6502::cpu::ExecutionEngine::Default)), "CPU execution engine: reference, threaded, cached, jit, cycle_exact")
+            ("recompiled", po::value<std::string>(), "Module built from emu_6502_recompile output. Used by engines other than reference and cycle_exact.")
+            ("max-cycles", po::value<uint64_t>()->default_value(0), "Stop after this many CPU cycles. Use 0 for unlimited.")
+            ("max-instructions", po::value<uint64_t>()->default_value(0), "Stop after this many instructions. Use 0 for unlimited.")
+            ("idle-loop-skip", po::value<bool>()->default_value(true), "Fast-forward loops which only poll memory, up to the next device event.")
+            ("validate", "Run reference interpreter next to the engine on own copy of memory and devices, stop with instruction history at first difference in registers, cycles or memory. Idle loops are not skipped.")
+            ("validate-step", po::value<uint64_t>()->default_value(1), "Instructions the engine runs between comparisons of validation.")
             // ("cpu", po::value<uint64_t>()->default_value(1'000'000), "CPU clock speed in Hz. Use 0 for unlimited.")
             ;
 
@@ -140,6 +148,17 @@ protected:
     void ReadCpuOptions(StreamContainer &streams, ExecArguments::CpuOptions &opts,
                         const po::variables_map &vm) {
         opts.frequency = vm["frequency"].as<uint64_t>();
+        opts.instruction_set =
+            emu6502::ParseInstructionSet(vm["instruction-set"].as<std::string>());
+        opts.engine = emu6502::cpu::ParseExecutionEngine(vm["engine"].as<std::string>());
+        if (vm.count("recompiled") > 0) {
+            opts.recompiled_module = vm["recompiled"].as<std::string>();
+        }
+        opts.max_cycles = vm["max-cycles"].as<uint64_t>();
+        opts.max_instructions = vm["max-instructions"].as<uint64_t>();
+        opts.idle_loop_skip = vm["idle-loop-skip"].as<bool>();
+        opts.validate = vm.count("validate") > 0;
+        opts.validate_step = vm["validate-step"].as<uint64_t>();
     }
 
     void OpenPackage(ExecArguments &args, const po::variables_map &vm) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "emu_6502/cpu/cpu.hpp"
 #include "emu_6502/instruction_set.hpp"
 #include "emu_core/memory_configuration_file.hpp"
 #include "emu_core/package/package.hpp"
@@ -25,6 +26,13 @@ struct ExecArguments {
     struct CpuOptions {
         uint64_t frequency = 0;
         emu6502::InstructionSet instruction_set = emu6502::InstructionSet::NMOS6502Emu;
+        emu6502::cpu::ExecutionEngine engine = emu6502::cpu::ExecutionEngine::Default;
+        std::string recompiled_module;
+        uint64_t max_cycles = 0;       // 0 - no limit
+        uint64_t max_instructions = 0; // 0 - no limit
+        bool idle_loop_skip = true;
+        bool validate = false;      // run in lockstep with reference interpreter
+        uint64_t validate_step = 1; // instructions of engine between comparisons
     };
 
     std::set<Verbose> verbose;
@@ -1,14 +1,20 @@
 #include "runner.hpp"
+#include "emu_6502/cpu/lockstep_validator.hpp"
 #include "emu_6502/cpu/verbose_debugger.hpp"
 #include "emu_core/clock_steady.hpp"
 #include "emu_core/memory/memory_block.hpp"
 #include "emu_core/simulation/simulation_builder.hpp"
 #include "emu_core/string_file.hpp"
+#include <limits>
 
 namespace emu::runner {
 
 void Runner::Setup(const ExecArguments &exec_args) {
     result_verbose = exec_args.GetVerboseStream(Verbose::Result);
+    limits = EmuSimulation::Limits{
+        .max_cycles = exec_args.cpu_options.max_cycles,
+        .max_instructions = exec_args.cpu_options.max_instructions,
+    };
 
     auto vc = SimulationBuildVerboseConfig{
         .memory = exec_args.GetVerboseStream(Verbose::Memory),
@@ -21,15 +27,56 @@ void Runner::Setup(const ExecArguments &exec_args) {
     auto cpu = SimulationBuildCpuConfig{
         .frequency = exec_args.cpu_options.frequency,
         .instruction_set = exec_args.cpu_options.instruction_set,
+        .engine = exec_args.cpu_options.engine,
+        .idle_loop_skip = exec_args.cpu_options.idle_loop_skip,
     };
+    if (!exec_args.cpu_options.recompiled_module.empty()) {
+        cpu.recompiled = LoadRecompiledModule(exec_args.cpu_options.recompiled_module);
+    }
+
+    if (exec_args.cpu_options.validate) {
+        if (limits.max_cycles > 0) {
+            throw std::runtime_error("Validation is limited by instructions, not cycles");
+        }
+        // Pace of the clock means nothing in lockstep, debugger would replace the
+        // engine with instrumented loop
+        cpu.frequency = 0;
+        vc.cpu = nullptr;
+        instruction_set = cpu.instruction_set;
+        validate_step = exec_args.cpu_options.validate_step;
+
+        auto reference_cpu = cpu;
+        reference_cpu.engine = emu6502::cpu::ExecutionEngine::Reference;
+        reference_cpu.recompiled = nullptr;
+        reference = BuildEmuSimulation(device_factory, exec_args.package.get(),
+                                       reference_cpu, SimulationBuildVerboseConfig{});
+    }
 
     simulation = BuildEmuSimulation(device_factory, exec_args.package.get(), cpu, vc);
 }
 
+const emu6502::cpu::RecompiledProgram *
+Runner::LoadRecompiledModule(const std::string &path) {
+    using GetProgram_t = const emu6502::cpu::RecompiledProgram *();
+    try {
+        recompiled_module = std::make_unique<boost::dll::shared_library>(path);
+        auto &get_program =
+            recompiled_module->get<GetProgram_t>(emu6502::cpu::kRecompiledProgramSymbol);
+        return get_program();
+    } catch (const std::exception &e) {
+        throw std::runtime_error(
+            fmt::format("Failed to load recompiled module {}: {}", path, e.what()));
+    }
+}
+
 int Runner::Start() {
+    if (reference) {
+        return StartValidation();
+    }
+
     std::optional<EmuSimulation::Result> result;
     try {
-        result = simulation->Run();
+        result = simulation->Run(limits);
     } catch (const EmuSimulation::SimulationFailedException &e) {
         if (result_verbose != nullptr) {
             (*result_verbose) << "FATAL: " << e.what() << "\n";
@@ -47,6 +94,21 @@ int Runner::Start() {
 
     const auto &r = *result;
     if (result_verbose != nullptr) {
+        if (r.execution.status == emu6502::cpu::ExecutionStatus::InvalidOpcode) {
+            (*result_verbose) << fmt::format("FATAL: Invalid opcode {:02x} at {:04x}\n",
+                                             r.execution.opcode,
+                                             r.execution.regs.program_counter - 1);
+        }
+        if (r.execution.status == emu6502::cpu::ExecutionStatus::BudgetExhausted) {
+            (*result_verbose) << "Stopped: budget exhausted\n";
+        }
+        if (r.execution.status == emu6502::cpu::ExecutionStatus::Waiting) {
+            (*result_verbose) << "Stopped: WAI with no scheduled event\n";
+        }
+        if (r.execution.status == emu6502::cpu::ExecutionStatus::Trapped) {
+            (*result_verbose) << fmt::format("Stopped: trapped at {:04x}\n",
+                                             r.execution.regs.program_counter);
+        }
         std::string halt_code = "-";
         if (r.halt_code.has_value()) {
             halt_code = std::to_string(r.halt_code.value_or(0));
@@ -55,9 +117,60 @@ int Runner::Start() {
         (*result_verbose) << fmt::format("Took {:.6f} seconds\n", r.duration);
         (*result_verbose) << fmt::format("Cpu cycles: {} ({:.3f} Hz)\n", r.cpu_cycles,
                                          static_cast<double>(r.cpu_cycles) / r.duration);
+        (*result_verbose) << fmt::format("Instructions: {} ({:.3f} MIPS)\n",
+                                         r.instructions, r.Mips());
+        (*result_verbose) << fmt::format("Idle loop cycles skipped: {}\n",
+                                         simulation->cpu->IdleSkippedCycles());
+        for (const auto &[name, count] : simulation->cpu->FusedPairCounts()) {
+            (*result_verbose) << fmt::format("Fused {}: {}\n", name, count);
+        }
     }
 
     return r.halt_code.value_or(0);
 }
 
+int Runner::StartValidation() {
+    reference->Reset();
+    simulation->Reset();
+    emu6502::cpu::LockstepValidator validator{instruction_set, reference->cpu.get(),
+                                              simulation->cpu.get()};
+    std::optional<emu6502::cpu::LockstepDivergence> divergence;
+    try {
+        divergence = validator.Run(limits.max_instructions > 0
+                                       ? limits.max_instructions
+                                       : std::numeric_limits<uint64_t>::max(),
+                                   validate_step);
+    } catch (const std::exception &e) {
+        if (result_verbose != nullptr) {
+            (*result_verbose) << fmt::format(
+                "FATAL: {} after {} validated instructions\n", e.what(),
+                validator.ValidatedInstructions());
+        }
+        return -1;
+    }
+
+    if (divergence.has_value()) {
+        if (result_verbose != nullptr) {
+            (*result_verbose) << "FATAL: " << divergence->Describe();
+        }
+        return -1;
+    }
+
+    const auto &result = validator.CandidateResult();
+    std::optional<int> halt_code;
+    if (result.status == emu6502::cpu::ExecutionStatus::Halted) {
+        halt_code = result.halt_code;
+    }
+    if (result_verbose != nullptr) {
+        (*result_verbose) << fmt::format("Stopped: {}\n", to_string(result.status));
+        (*result_verbose) << fmt::format(
+            "Halt code {}\n", halt_code.has_value() ? std::to_string(*halt_code) : "-");
+        (*result_verbose) << fmt::format("Validated instructions: {}\n",
+                                         validator.ValidatedInstructions());
+        (*result_verbose) << fmt::format("Cpu cycles: {}\n",
+                                         simulation->cpu->ExecutedCycles());
+    }
+    return halt_code.value_or(0);
+}
+
 } // namespace emu::runner
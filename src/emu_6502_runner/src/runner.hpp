@@ -8,6 +8,7 @@
 #include "emu_core/memory/memory_mapper.hpp"
 #include "emu_core/memory_configuration_file.hpp"
 #include "emu_core/simulation/simulation.hpp"
+#include <boost/dll/shared_library.hpp>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -26,8 +27,19 @@ struct Runner {
 protected:
     const std::shared_ptr<DeviceFactory> device_factory;
     std::ostream *result_verbose = nullptr;
+    EmuSimulation::Limits limits;
 
+    // Declared before simulation, cpu uses code of the module until it is destroyed
+    std::unique_ptr<boost::dll::shared_library> recompiled_module;
     std::unique_ptr<EmuSimulation> simulation;
+
+    // Validation mode only, simulation runs the candidate engine
+    std::unique_ptr<EmuSimulation> reference;
+    emu6502::InstructionSet instruction_set = emu6502::InstructionSet::Default;
+    uint64_t validate_step = 1;
+
+    const emu6502::cpu::RecompiledProgram *LoadRecompiledModule(const std::string &path);
+    int StartValidation();
 };
 
 } // namespace emu::runner
@@ -16,6 +16,13 @@ struct Clock {
     virtual void WaitForNextCycle() = 0;
     virtual void Reset() = 0;
 
+    // Passes given number of cycles at once
+    virtual void Advance(uint64_t cycles) {
+        for (uint64_t i = 0; i < cycles; ++i) {
+            WaitForNextCycle();
+        }
+    }
+
     [[nodiscard]] virtual uint64_t CurrentCycle() const { return 0; };
     [[nodiscard]] virtual uint64_t Frequency() const { return 0; };
     [[nodiscard]] virtual uint64_t LostCycles() const { return 0; };
@@ -25,6 +32,7 @@ struct Clock {
 
 struct ClockSimple : public Clock {
     void WaitForNextCycle() override { ++current_cycle; }
+    void Advance(uint64_t cycles) override { current_cycle += cycles; }
     void Reset() override { current_cycle = 0; }
     [[nodiscard]] uint64_t CurrentCycle() const override { return current_cycle; }
     [[nodiscard]] double Time() const override {
@@ -43,6 +51,7 @@ private:
 namespace emu {
 struct ClockMock : public Clock {
     MOCK_METHOD(void, WaitForNextCycle, ());
+    MOCK_METHOD(void, Advance, (uint64_t));
     MOCK_METHOD(void, Reset, ());
     MOCK_METHOD(uint64_t, CurrentCycle, (), (const));
     MOCK_METHOD(uint64_t, Frequency, (), (const));
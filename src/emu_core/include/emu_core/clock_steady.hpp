@@ -1,6 +1,7 @@
 #pragma once
 
 #include "emu_core/clock.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <fmt/format.h>
@@ -17,6 +18,7 @@ struct ClockSteadyException : public std::runtime_error {
 struct ClockSteady final : public Clock {
     static constexpr uint64_t kMaxFrequency = 100'000'000llu;
     static constexpr uint64_t kNanosecondsPerSecond = 1'000'000'000llu;
+    static constexpr std::chrono::milliseconds kSpinThreshold{1};
 
     using steady_clock = std::chrono::steady_clock;
 
@@ -55,6 +57,30 @@ struct ClockSteady final : public Clock {
         next_cycle += tick;
     }
 
+    void Advance(uint64_t cycles) override {
+        if (cycles == 0) {
+            return;
+        }
+        current_cycle += cycles;
+        auto last_cycle = next_cycle + tick * (cycles - 1);
+        auto now = steady_clock::now();
+        if (now > next_cycle) {
+            // Cycles which should have ended already are lost
+            auto late = static_cast<uint64_t>((now - next_cycle) / tick) + 1;
+            lost_cycles += std::min(late, cycles);
+        }
+
+        // Long waits (65C02 WAI) give the host thread away, only the tail is spun
+        if (last_cycle - now > kSpinThreshold) {
+            std::this_thread::sleep_until(last_cycle - kSpinThreshold);
+        }
+        while (last_cycle > steady_clock::now()) {
+            // busy loop
+        }
+
+        next_cycle = last_cycle + tick;
+    }
+
     void Reset() override {
         current_cycle = 0;
         start_time = steady_clock::now();
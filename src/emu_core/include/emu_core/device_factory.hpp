@@ -1,6 +1,7 @@
 #pragma once
 
 #include "clock.hpp"
+#include "event_scheduler.hpp"
 #include "memory.hpp"
 #include "memory_configuration_file.hpp"
 #include <iostream>
@@ -13,6 +14,10 @@ struct Device {
     virtual ~Device() = default;
     virtual std::shared_ptr<Memory16> GetMemory() = 0;
     virtual size_t GetMemorySize() = 0;
+
+    // Called once the cpu is built. Devices which raise interrupts or do their work at
+    // given cycles keep the pointers, both live as long as the simulation.
+    virtual void AttachCpu(EventScheduler * /*scheduler*/, InterruptLines * /*lines*/) {}
 };
 
 struct DeviceFactory {
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace emu {
+
+// Callbacks keyed by absolute cycle, kept in a min-heap. Cycles are the ones counted
+// by the cpu since its reset, the clock shows the same number once the cpu has passed
+// its cycles to it. Cpu checks only NextEventCycle while it runs instructions, so work
+// which can wait for a known cycle should be scheduled instead of being done on every
+// memory access. Events due at the same cycle run in the order they were scheduled.
+class EventScheduler {
+public:
+    using EventId = uint64_t;
+    using Callback = std::function<void(uint64_t cycle)>;
+
+    static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+    // Callback may schedule further events, including ones due immediately
+    EventId Schedule(uint64_t cycle, Callback callback);
+    bool Cancel(EventId id);
+
+    // Runs every event due at or before cycle
+    void RunDue(uint64_t cycle);
+
+    // Forces the owner to look at its state before the next instruction, until the
+    // next RunDue, Cancel and Clear keep it
+    void Wake() {
+        woken = true;
+        next_cycle = 0;
+    }
+
+    void Clear();
+
+    [[nodiscard]] uint64_t NextEventCycle() const { return next_cycle; }
+    [[nodiscard]] size_t Size() const { return heap.size(); }
+
+private:
+    struct Event {
+        uint64_t cycle;
+        EventId id;
+        Callback callback;
+    };
+
+    std::vector<Event> heap;
+    EventId next_id = 0;
+    uint64_t next_cycle = kNever;
+    bool woken = false;
+
+    static bool Later(const Event &a, const Event &b);
+    void UpdateNextCycle();
+};
+
+// Interrupt inputs of a cpu, used by devices which do not know the cpu type. IRQ is
+// level triggered, each source (0..31) keeps its own line asserted until the device
+// releases it. NMI is edge triggered.
+struct InterruptLines {
+    virtual ~InterruptLines() = default;
+
+    virtual void SetIrq(unsigned source, bool asserted) = 0;
+    virtual void TriggerNmi() = 0;
+};
+
+} // namespace emu
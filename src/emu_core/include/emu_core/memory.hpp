@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <concepts>
 #include <cstdint>
 #include <fmt/format.h>
@@ -33,6 +34,9 @@ public:
               fmt::format("Memory write attempt error: {}: offset={:x} limit={:x}", msg,
                           offset, limit)) {}
 };
+// Accesses do not advance the clock, bus cycles are part of the cost of the instruction
+// which does them (see cycle table of the cpu). Cycle-exact engine of the cpu advances
+// it after each access.
 template <std::unsigned_integral _Address_t>
 class MemoryInterface {
 public:
@@ -49,6 +53,13 @@ public:
 
     [[nodiscard]] virtual std::optional<uint8_t> DebugRead(Address_t address) const = 0;
 
+    // Host bytes behind len bytes from address when loads and stores there only read and
+    // write them (plain RAM, no logging), nullptr otherwise. Valid until the memory is
+    // remapped or destroyed.
+    [[nodiscard]] virtual uint8_t *DirectRange(Address_t address, size_t len) {
+        return nullptr;
+    }
+
     [[nodiscard]] virtual std::vector<std::optional<uint8_t>>
     DebugReadRange(Address_t address, size_t len) const {
         std::vector<std::optional<uint8_t>> r;
@@ -69,6 +80,34 @@ public:
 
 using Memory16 = MemoryInterface<uint16_t>;
 
+// Host memory of the first kPages pages as DirectRange of the memory hands it out.
+// Accesses of a page without one go through the memory interface.
+template <std::unsigned_integral _Address_t, size_t kPages>
+class DirectPages {
+public:
+    using Address_t = _Address_t;
+    static constexpr size_t kPageSize = 0x100;
+
+    void Update(MemoryInterface<Address_t> *memory) {
+        for (size_t page = 0; page < kPages; ++page) {
+            pages[page] =
+                memory->DirectRange(static_cast<Address_t>(page * kPageSize), kPageSize);
+        }
+    }
+
+    // Host byte behind address, nullptr when the memory interface has to be used
+    [[nodiscard]] uint8_t *Byte(Address_t address) const {
+        const size_t page = address / kPageSize;
+        if (page >= kPages || pages[page] == nullptr) {
+            return nullptr;
+        }
+        return pages[page] + address % kPageSize;
+    }
+
+private:
+    std::array<uint8_t *, kPages> pages{};
+};
+
 } // namespace emu
 
 #ifdef WANTS_GTEST_MOCKS
@@ -36,14 +36,12 @@ struct MemoryBlock : public MemoryInterface<_Address_t> {
         if (address >= block.size()) {
             throw MemoryOutOfBoundAccessException(address, block.size(), "MemoryBlock");
         }
-        WaitForNextCycle();
         auto v = block[address];
         AccessLog(address, v, false);
         return v;
     }
 
     void Store(Address_t address, uint8_t value) override {
-        WaitForNextCycle();
         AccessLog(address, value, true);
         if (CanWrite(address)) {
             block[address] = value;
@@ -57,6 +55,14 @@ struct MemoryBlock : public MemoryInterface<_Address_t> {
         return block[address];
     }
 
+    [[nodiscard]] uint8_t *DirectRange(Address_t address, size_t len) override {
+        if (verbose_stream != nullptr || mode != MemoryMode::kReadWrite ||
+            address + len > block.size()) {
+            return nullptr;
+        }
+        return block.data() + address;
+    }
+
 private:
     [[nodiscard]] bool CanWrite(Address_t address) {
         if (address >= block.size()) {
@@ -80,12 +86,6 @@ private:
                                   "");
         }
     }
-
-    void WaitForNextCycle() const {
-        if (clock != nullptr) {
-            clock->WaitForNextCycle();
-        }
-    }
 };
 
 using MemoryBlock16 = MemoryBlock<uint16_t>;
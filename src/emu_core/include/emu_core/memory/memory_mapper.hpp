@@ -74,7 +74,6 @@ struct MemoryMapper : public MemoryInterface<_Address_t> {
     }
 
     uint8_t Load(Address_t address) const override {
-        WaitForNextCycle();
         auto area = LookupAddress(address);
         if (area.has_value()) {
             auto [min, max] = area->first;
@@ -90,7 +89,6 @@ struct MemoryMapper : public MemoryInterface<_Address_t> {
     }
 
     void Store(Address_t address, uint8_t value) override {
-        WaitForNextCycle();
         auto area = LookupAddress(address);
         if (area.has_value()) {
             AccessLog(address, value, true, false);
@@ -114,6 +112,19 @@ struct MemoryMapper : public MemoryInterface<_Address_t> {
         return area->second->DebugRead(relative);
     }
 
+    // Range has to lie in a single area
+    [[nodiscard]] uint8_t *DirectRange(Address_t address, size_t len) override {
+        auto area = LookupAddress(address);
+        if (verbose_stream != nullptr || !area.has_value() || len == 0) {
+            return nullptr;
+        }
+        auto [min, max] = area->first;
+        if (address + len - 1 > max) {
+            return nullptr;
+        }
+        return area->second->DirectRange(address - min, len);
+    }
+
 private:
     AreaSet areas;
 
@@ -137,12 +148,6 @@ private:
                                   (not_mapped ? "NOT MAPPED" : ""));
         }
     }
-
-    void WaitForNextCycle() const {
-        if (clock != nullptr) {
-            clock->WaitForNextCycle();
-        }
-    }
 };
 
 using MemoryMapper16 = MemoryMapper<uint16_t>;
@@ -34,7 +34,6 @@ struct MemorySparse : public MemoryInterface<_Address_t> {
         : clock(clock), strict_access(strict_access), verbose_stream(verbose_stream) {}
 
     uint8_t Load(Address_t address) const override {
-        WaitForNextCycle();
         if (auto it = memory_map.find(address); it == memory_map.end()) {
             if (strict_access) {
                 throw std::runtime_error(
@@ -51,7 +50,6 @@ struct MemorySparse : public MemoryInterface<_Address_t> {
     }
 
     void Store(Address_t address, uint8_t value) override {
-        WaitForNextCycle();
         bool is_null = memory_map.find(address) == memory_map.end();
         if (is_null && strict_access) {
             throw std::runtime_error(fmt::format(
@@ -106,12 +104,6 @@ private:
                                              (not_init ? "NOT INITIALIZED" : ""));
         }
     }
-
-    void WaitForNextCycle() const {
-        if (clock != nullptr) {
-            clock->WaitForNextCycle();
-        }
-    }
 };
 
 using MemorySparse16 = MemorySparse<uint16_t>;
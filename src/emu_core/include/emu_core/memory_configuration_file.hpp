@@ -6,6 +6,7 @@
 #include <map>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -69,8 +70,18 @@ struct MemoryConfigEntry {
     bool operator==(const MemoryConfigEntry &o) const = default;
 };
 
+struct MemoryConfigCpu {
+    std::string name;
+    // Private to this cpu, mapped next to the shared entries of MemoryConfig
+    std::vector<MemoryConfigEntry> entries;
+
+    bool operator==(const MemoryConfigCpu &o) const = default;
+};
+
 struct MemoryConfig {
+    // Memory of the single cpu, or memory shared by all cpus when there are some
     std::vector<MemoryConfigEntry> entries;
+    std::vector<MemoryConfigCpu> cpus;
 
     bool operator==(const MemoryConfig &o) const = default;
 };
@@ -84,6 +95,11 @@ MemoryConfig LoadMemoryConfigurationFromString(const std::string &text,
                                                FileSearch *searcher = nullptr,
                                                const ConfigOverrides &overrides = {});
 
+// Fills $name placeholders which were left in a config loaded without overrides: names,
+// image files and device config values. Class names are split on load, so they can not
+// be overridden here.
+MemoryConfig ApplyConfigOverrides(MemoryConfig config, const ConfigOverrides &overrides);
+
 std::string StoreMemoryConfigurationToString(const MemoryConfig &config);
 
 } // namespace emu
@@ -0,0 +1,59 @@
+#include "emu_core/event_scheduler.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace emu {
+
+bool EventScheduler::Later(const Event &a, const Event &b) {
+    if (a.cycle != b.cycle) {
+        return a.cycle > b.cycle;
+    }
+    return a.id > b.id;
+}
+
+EventScheduler::EventId EventScheduler::Schedule(uint64_t cycle, Callback callback) {
+    auto id = next_id++;
+    heap.emplace_back(Event{cycle, id, std::move(callback)});
+    std::push_heap(heap.begin(), heap.end(), &Later);
+    next_cycle = std::min(next_cycle, cycle);
+    return id;
+}
+
+bool EventScheduler::Cancel(EventId id) {
+    auto it = std::find_if(heap.begin(), heap.end(),
+                           [id](const auto &event) { return event.id == id; });
+    if (it == heap.end()) {
+        return false;
+    }
+    *it = std::move(heap.back());
+    heap.pop_back();
+    std::make_heap(heap.begin(), heap.end(), &Later);
+    UpdateNextCycle();
+    return true;
+}
+
+void EventScheduler::RunDue(uint64_t cycle) {
+    woken = false;
+    while (!heap.empty() && heap.front().cycle <= cycle) {
+        std::pop_heap(heap.begin(), heap.end(), &Later);
+        auto event = std::move(heap.back());
+        heap.pop_back();
+        event.callback(event.cycle);
+    }
+    UpdateNextCycle();
+}
+
+void EventScheduler::Clear() {
+    heap.clear();
+    UpdateNextCycle();
+}
+
+void EventScheduler::UpdateNextCycle() {
+    if (woken) {
+        next_cycle = 0;
+    } else {
+        next_cycle = heap.empty() ? kNever : heap.front().cycle;
+    }
+}
+
+} // namespace emu
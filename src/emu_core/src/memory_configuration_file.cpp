@@ -135,17 +135,7 @@ namespace emu {
 
 namespace {
 
-MemoryConfigEntry::ValueVariant LoadValueVariant(const YAML::Node &node,
-                                                 const ConfigOverrides &overrides) {
-    if (node.IsNull()) {
-        return std::monostate{};
-    }
-
-    if (!node.IsScalar()) {
-        return false;
-    }
-
-    auto v = HandleOverride(node.as<std::string>(), overrides);
+MemoryConfigEntry::ValueVariant ParseValueVariant(const std::string &v) {
     if (v == "true") {
         return true;
     }
@@ -173,6 +163,19 @@ MemoryConfigEntry::ValueVariant LoadValueVariant(const YAML::Node &node,
     return v;
 }
 
+MemoryConfigEntry::ValueVariant LoadValueVariant(const YAML::Node &node,
+                                                 const ConfigOverrides &overrides) {
+    if (node.IsNull()) {
+        return std::monostate{};
+    }
+
+    if (!node.IsScalar()) {
+        return false;
+    }
+
+    return ParseValueVariant(HandleOverride(node.as<std::string>(), overrides));
+}
+
 std::map<std::string, MemoryConfigEntry::ValueVariant>
 LoadValueVariantMap(const YAML::Node &node, const ConfigOverrides &overrides) {
     if (!node.IsMap()) {
@@ -296,11 +299,54 @@ LoadMemoryConfigEntryVector(const YAML::Node &node, FileSearch *searcher,
     return rhs;
 }
 
+MemoryConfigCpu LoadMemoryConfigCpu(const YAML::Node &node, FileSearch *searcher,
+                                    const ConfigOverrides &overrides) {
+    if (!node.IsMap()) {
+        throw std::runtime_error("Invalid cpu config entry type");
+    }
+    return MemoryConfigCpu{
+        .name = ReadString("name", node, false, overrides),
+        .entries = LoadMemoryConfigEntryVector(node["memory"], searcher, overrides),
+    };
+}
+
 MemoryConfig Load(YAML::Node config, FileSearch *searcher,
                   const ConfigOverrides &overrides) {
-    return MemoryConfig{
-        .entries = LoadMemoryConfigEntryVector(config["memory"], searcher, overrides),
-    };
+    MemoryConfig r;
+    auto cpus = config["cpus"];
+    if (cpus) {
+        if (!cpus.IsSequence()) {
+            throw std::runtime_error("Malformed cpu list configuration");
+        }
+        for (auto cpu : cpus) {
+            r.cpus.emplace_back(LoadMemoryConfigCpu(cpu, searcher, overrides));
+        }
+    }
+    // Shared memory list is optional in multi cpu config
+    if (!cpus || config["memory"]) {
+        r.entries = LoadMemoryConfigEntryVector(config["memory"], searcher, overrides);
+    }
+    return r;
+}
+
+void ApplyEntryOverrides(std::vector<MemoryConfigEntry> &entries,
+                         const ConfigOverrides &overrides) {
+    for (auto &entry : entries) {
+        entry.name = HandleOverride(entry.name, overrides);
+        auto *ram_area = std::get_if<MemoryConfigEntry::RamArea>(&entry.entry_variant);
+        if (ram_area != nullptr && ram_area->image.has_value()) {
+            ram_area->image->file = HandleOverride(ram_area->image->file, overrides);
+        }
+        auto *device = std::get_if<MemoryConfigEntry::MappedDevice>(&entry.entry_variant);
+        if (device == nullptr) {
+            continue;
+        }
+        for (auto &[key, value] : device->config) {
+            if (const auto *text = std::get_if<std::string>(&value)) {
+                value = ParseValueVariant(HandleOverride(*text, overrides));
+            }
+        }
+    }
 }
 
 } // namespace
@@ -310,9 +356,7 @@ MemoryConfig LoadMemoryConfigurationFromFile(const std::string &file_name,
                                              const ConfigOverrides &overrides) {
     auto yaml = YAML::LoadFile(file_name);
     auto s = searcher->PrependPath(file_name);
-    return MemoryConfig{
-        .entries = LoadMemoryConfigEntryVector(yaml["memory"], s.get(), overrides),
-    };
+    return Load(yaml, s.get(), overrides);
 }
 
 MemoryConfig LoadMemoryConfigurationFromString(const std::string &text,
@@ -321,9 +365,24 @@ MemoryConfig LoadMemoryConfigurationFromString(const std::string &text,
     return Load(YAML::Load(text), searcher, overrides);
 }
 
+MemoryConfig ApplyConfigOverrides(MemoryConfig config, const ConfigOverrides &overrides) {
+    ApplyEntryOverrides(config.entries, overrides);
+    for (auto &cpu : config.cpus) {
+        cpu.name = HandleOverride(cpu.name, overrides);
+        ApplyEntryOverrides(cpu.entries, overrides);
+    }
+    return config;
+}
+
 std::string StoreMemoryConfigurationToString(const MemoryConfig &config) {
     YAML::Node node;
     node["memory"] = config.entries;
+    for (const auto &cpu : config.cpus) {
+        YAML::Node cpu_node;
+        cpu_node["name"] = cpu.name;
+        cpu_node["memory"] = cpu.entries;
+        node["cpus"].push_back(cpu_node);
+    }
     std::stringstream ss;
     ss << node << "\n";
     return ss.str();
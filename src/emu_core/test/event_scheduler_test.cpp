@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "emu_core/event_scheduler.hpp"
+#include <vector>
+
+namespace emu::test {
+namespace {
+
+TEST(EventSchedulerTest, RunsEventsInCycleOrder) {
+    EventScheduler scheduler;
+    std::vector<int> order;
+    scheduler.Schedule(30, [&](uint64_t) { order.push_back(3); });
+    scheduler.Schedule(10, [&](uint64_t) { order.push_back(1); });
+    scheduler.Schedule(20, [&](uint64_t) { order.push_back(2); });
+    scheduler.Schedule(10, [&](uint64_t) { order.push_back(4); });
+    EXPECT_EQ(scheduler.NextEventCycle(), 10);
+
+    scheduler.RunDue(9);
+    EXPECT_TRUE(order.empty());
+
+    scheduler.RunDue(20);
+    EXPECT_EQ(order, (std::vector<int>{1, 4, 2}));
+    EXPECT_EQ(scheduler.NextEventCycle(), 30);
+
+    scheduler.RunDue(100);
+    EXPECT_EQ(order, (std::vector<int>{1, 4, 2, 3}));
+    EXPECT_EQ(scheduler.NextEventCycle(), EventScheduler::kNever);
+}
+
+TEST(EventSchedulerTest, CallbackGetsScheduledCycle) {
+    EventScheduler scheduler;
+    std::vector<uint64_t> cycles;
+    // Periodic timer, next period is scheduled from the callback
+    std::function<void(uint64_t)> timer = [&](uint64_t cycle) {
+        cycles.push_back(cycle);
+        scheduler.Schedule(cycle + 100, timer);
+    };
+    scheduler.Schedule(100, timer);
+
+    scheduler.RunDue(350);
+    EXPECT_EQ(cycles, (std::vector<uint64_t>{100, 200, 300}));
+    EXPECT_EQ(scheduler.NextEventCycle(), 400);
+}
+
+TEST(EventSchedulerTest, Cancel) {
+    EventScheduler scheduler;
+    int fired = 0;
+    auto first = scheduler.Schedule(10, [&](uint64_t) { fired += 1; });
+    scheduler.Schedule(20, [&](uint64_t) { fired += 10; });
+
+    EXPECT_TRUE(scheduler.Cancel(first));
+    EXPECT_FALSE(scheduler.Cancel(first));
+    EXPECT_EQ(scheduler.NextEventCycle(), 20);
+
+    scheduler.RunDue(100);
+    EXPECT_EQ(fired, 10);
+}
+
+TEST(EventSchedulerTest, Wake) {
+    EventScheduler scheduler;
+    scheduler.Schedule(50, [](uint64_t) {});
+    scheduler.Wake();
+    EXPECT_EQ(scheduler.NextEventCycle(), 0);
+
+    scheduler.RunDue(10);
+    EXPECT_EQ(scheduler.NextEventCycle(), 50);
+    EXPECT_EQ(scheduler.Size(), 1);
+}
+
+TEST(EventSchedulerTest, WakeSurvivesCancelAndClear) {
+    EventScheduler scheduler;
+    auto id = scheduler.Schedule(50, [](uint64_t) {});
+    scheduler.Wake();
+    EXPECT_TRUE(scheduler.Cancel(id));
+    EXPECT_EQ(scheduler.NextEventCycle(), 0);
+
+    scheduler.Schedule(60, [](uint64_t) {});
+    scheduler.Clear();
+    EXPECT_EQ(scheduler.NextEventCycle(), 0);
+
+    scheduler.RunDue(10);
+    EXPECT_EQ(scheduler.NextEventCycle(), EventScheduler::kNever);
+}
+
+} // namespace
+} // namespace emu::test
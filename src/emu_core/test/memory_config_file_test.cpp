@@ -181,5 +181,97 @@ memory:
     }
 }
 
+TEST_F(MemoryConfigFileTest, apply_overrides) {
+    auto t = R"==(
+memory:
+- rom:
+  offset: 0x0200
+  size: 0x0200
+  image:
+    file: $image_file
+- device:
+  offset: 0xF000
+  name: $dev_name
+  class: random.mt19937
+  config:
+    seed: $seed
+    a: $dev_arg_text
+    b: $dev_arg_bool
+    c: $not_overridden
+)=="s;
+
+    const auto overrides = ConfigOverrides{
+        {"image_file", "test.bin"}, //
+        {"dev_name", "rng"},        //
+        {"seed", "0x1234"},         //
+        {"dev_arg_text", "b"},      //
+        {"dev_arg_bool", "true"},
+    };
+
+    auto loaded = LoadMemoryConfigurationFromString(t, search_mock.get());
+    auto config = ApplyConfigOverrides(loaded, overrides);
+    EXPECT_EQ(config, LoadMemoryConfigurationFromString(t, search_mock.get(), overrides));
+
+    const auto &device = std::get<MemoryConfigEntry::MappedDevice>(
+        config.entries.at(1).entry_variant);
+    EXPECT_EQ(config.entries.at(1).name, "rng");
+    EXPECT_EQ(device.GetConfigItem<int64_t>("seed", 0), 0x1234);
+    EXPECT_EQ(device.GetConfigItem("c", ""s), "$not_overridden");
+}
+
+TEST_F(MemoryConfigFileTest, cpus) {
+    auto t = R"==(
+memory:
+- ram:
+  offset: 0x8000
+  size: 0x1000
+  name: shared
+cpus:
+- name: cpu0
+  memory:
+  - ram:
+    offset: 0
+    size: 0x0200
+  - rom:
+    offset: 0xF000
+    image:
+      file: $image_file
+- name: $second_cpu
+  memory:
+  - ram:
+    offset: 0
+    size: 0x0400
+)=="s;
+
+    auto config = LoadMemoryConfigurationFromString(t, search_mock.get(),
+                                                    {{"second_cpu", "cpu1"}});
+    ASSERT_EQ(config.entries.size(), 1);
+    EXPECT_EQ(config.entries.at(0).name, "shared");
+    ASSERT_EQ(config.cpus.size(), 2);
+    EXPECT_EQ(config.cpus.at(0).name, "cpu0");
+    EXPECT_EQ(config.cpus.at(0).entries.size(), 2);
+    EXPECT_EQ(config.cpus.at(1).name, "cpu1");
+    EXPECT_EQ(config.cpus.at(1).entries.size(), 1);
+
+    auto applied = ApplyConfigOverrides(config, {{"image_file", "cpu0.bin"}});
+    const auto &rom = std::get<MemoryConfigEntry::RamArea>(
+        applied.cpus.at(0).entries.at(1).entry_variant);
+    EXPECT_EQ(rom.image->file, "cpu0.bin");
+
+    auto stored = StoreMemoryConfigurationToString(applied);
+    EXPECT_EQ(LoadMemoryConfigurationFromString(stored, search_mock.get()), applied);
+
+    auto no_shared = LoadMemoryConfigurationFromString(R"==(
+cpus:
+- name: cpu0
+  memory:
+  - ram:
+    offset: 0
+)=="s,
+                                                       search_mock.get());
+    EXPECT_TRUE(no_shared.entries.empty());
+    EXPECT_EQ(no_shared.cpus.size(), 1);
+}
+
 } // namespace
 } // namespace emu::test
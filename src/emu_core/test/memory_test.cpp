@@ -69,5 +69,32 @@ TEST_F(MemoryTest, MemoryMapper16) {
     EXPECT_NO_THROW(mapper.Store(40_addr, 8_u8));
 }
 
+TEST_F(MemoryTest, DirectRange) {
+    MemoryBlock16 ram{&clock, MemoryBlock16::VectorType(0x200)};
+    MemoryBlock16 rom{&clock, MemoryBlock16::VectorType(0x100), MemoryMode::kReadOnly};
+    MemoryBlock16 logged{&clock, MemoryBlock16::VectorType(0x100),
+                         MemoryMode::kReadWrite, &std::cout, "ut"};
+
+    EXPECT_EQ(ram.DirectRange(0x100_addr, 0x100), ram.block.data() + 0x100);
+    EXPECT_EQ(ram.DirectRange(0x180_addr, 0x100), nullptr);
+    EXPECT_EQ(rom.DirectRange(0_addr, 0x100), nullptr);
+    EXPECT_EQ(logged.DirectRange(0_addr, 0x100), nullptr);
+
+    MemoryMapper16 mapper{&clock, {}, false};
+    mapper.MapArea(0x0000_addr, 0x0200_addr, &ram);
+    mapper.MapArea(0x0200_addr, 0x0010_addr, &mock_a);
+
+    EXPECT_EQ(mapper.DirectRange(0x0100_addr, 0x100), ram.block.data() + 0x100);
+    EXPECT_EQ(mapper.DirectRange(0x0180_addr, 0x100), nullptr);
+    EXPECT_EQ(mapper.DirectRange(0x0200_addr, 0x10), nullptr);
+    EXPECT_EQ(mapper.DirectRange(0x0300_addr, 0x10), nullptr);
+
+    DirectPages<Address_t, 3> pages;
+    pages.Update(&mapper);
+    EXPECT_EQ(pages.Byte(0x0123_addr), ram.block.data() + 0x123);
+    EXPECT_EQ(pages.Byte(0x0201_addr), nullptr);
+    EXPECT_EQ(pages.Byte(0x0301_addr), nullptr);
+}
+
 } // namespace
 } // namespace emu::test
@@ -15,6 +15,7 @@
 struct TestCase {
     std::string name;
     std::string image;
+    emu::emu6502::cpu::ExecutionEngine engine;
 };
 
 const std::filesystem::path executable_path =
@@ -41,10 +42,17 @@ std::vector<TestCase> FindTestCases() {
             if (name.ends_with("_image")) {
                 name.resize(name.size() - strlen("_image"));
             }
-            r.emplace_back(TestCase{
-                .name = name,
-                .image = file_name,
-            });
+            for (auto engine : {emu6502::cpu::ExecutionEngine::Reference,
+                                emu6502::cpu::ExecutionEngine::Threaded,
+                                emu6502::cpu::ExecutionEngine::Cached,
+                                emu6502::cpu::ExecutionEngine::Jit,
+                                emu6502::cpu::ExecutionEngine::CycleExact}) {
+                r.emplace_back(TestCase{
+                    .name = name + "_" + to_string(engine),
+                    .image = file_name,
+                    .engine = engine,
+                });
+            }
         }
     }
     return r;
@@ -71,6 +79,7 @@ TEST_P(FunctionalTest, ) {
     auto cpu = SimulationBuildCpuConfig{
         .frequency = 0,
         .instruction_set = emu6502::InstructionSet::NMOS6502Emu,
+        .engine = test_param.engine,
     };
 
     auto simulation = BuildEmuSimulation(device_factory, package.get(), cpu, vc);
@@ -102,7 +111,13 @@ TEST_P(FunctionalTest, ) {
     std::cout << fmt::format("Took {:.6f} seconds\n", result->duration);
     std::cout << fmt::format("Cpu cycles: {} ({:.3f} Hz)\n", result->cpu_cycles,
                              static_cast<double>(result->cpu_cycles) / result->duration);
+    std::cout << fmt::format("Instructions: {} ({:.3f} MIPS, {} engine)\n",
+                             result->instructions, result->Mips(),
+                             to_string(test_param.engine));
 
+    EXPECT_EQ(result->execution.status, emu6502::cpu::ExecutionStatus::Halted)
+        << to_string(result->execution.status)
+        << fmt::format(" at {:04x}", result->execution.regs.program_counter);
     EXPECT_EQ(result->halt_code.value_or(0u), 0u);
 }
 
@@ -120,6 +120,7 @@ protected:
     void ReadConfigOptions(StreamContainer &streams, MemoryConfig &opts,
                            const po::variables_map &vm) {
         opts.entries.clear();
+        opts.cpus.clear();
 
         if (vm.count("config") > 0) {
             auto &image_file = vm["config"].as<std::string>();
@@ -127,9 +128,10 @@ protected:
                                                         value_overrides);
             opts.entries.insert(opts.entries.end(), conf.entries.begin(),
                                 conf.entries.end());
+            opts.cpus.insert(opts.cpus.end(), conf.cpus.begin(), conf.cpus.end());
         }
 
-        if (opts.entries.empty()) {
+        if (opts.entries.empty() && opts.cpus.empty()) {
             throw std::logic_error("Config to use was not provided");
         }
     }
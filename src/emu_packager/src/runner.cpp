@@ -19,6 +19,15 @@ int Runner::Pack(const ExecArguments &exec_args) {
         std::visit([this, &entry](auto &value) { HandleEntry(entry, value); },
                    entry.entry_variant);
     }
+    for (auto &cpu : memory_options.cpus) {
+        // Cpus map their images at the same offsets
+        file_prefix = cpu.name + "_";
+        for (auto &entry : cpu.entries) {
+            std::visit([this, &entry](auto &value) { HandleEntry(entry, value); },
+                       entry.entry_variant);
+        }
+    }
+    file_prefix.clear();
 
     package_builder->SetMemoryConfig(memory_options);
     package_builder.reset();
@@ -49,7 +58,7 @@ void Runner::HandleEntry(MemoryConfigEntry &entry, MemoryConfigEntry::RamArea &r
     }
     ra.size = file_size;
 
-    auto file_name = fmt::format("{:04x}_{:04x}", entry.offset, file_size);
+    auto file_name = fmt::format("{}{:04x}_{:04x}", file_prefix, entry.offset, file_size);
 
     if (!entry.name.empty()) {
         file_name += "_" + entry.name;
@@ -22,6 +22,7 @@ protected:
     StreamContainer streams;
 
     std::unique_ptr<package::IPackageBuilder> package_builder;
+    std::string file_prefix;
 
     void HandleEntry(MemoryConfigEntry &entry, MemoryConfigEntry::RamArea &ra);
     void HandleEntry(MemoryConfigEntry &entry, MemoryConfigEntry::MappedDevice &md);
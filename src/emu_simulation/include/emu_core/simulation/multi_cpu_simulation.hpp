@@ -0,0 +1,53 @@
+#pragma once
+
+#include "emu_core/clock.hpp"
+#include "emu_core/device_factory.hpp"
+#include "simulation.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace emu {
+
+// Cpus of one system, see MemoryConfigCpu. Each cpu has its own clock, memory mapper,
+// private memory and devices, areas of the shared memory list are mapped into all of
+// them. Cpus run on their own threads and meet after every quantum of cycles. Writes to
+// shared ram are seen by other cpus at the latest after the next meeting, use mailbox
+// device to synchronize within a quantum. Code written to shared ram by one cpu is
+// decoded again by the others after the next meeting, until then they may run blocks
+// decoded before the write. Shared devices are not attached to any cpu, so they can not
+// raise interrupts, and their clock advances at each meeting.
+struct MultiCpuSimulation {
+    const std::unique_ptr<Clock> shared_clock;
+    const std::vector<std::shared_ptr<Device>> shared_devices;
+    const std::vector<std::shared_ptr<Memory16>> shared_memory;
+    // Pages covered by shared memory
+    const std::vector<uint8_t> shared_pages;
+    const std::vector<std::string> names;
+    const std::vector<std::unique_ptr<EmuSimulation>> cpus;
+
+    MultiCpuSimulation(std::unique_ptr<Clock> _shared_clock,
+                       std::vector<std::shared_ptr<Device>> _shared_devices,
+                       std::vector<std::shared_ptr<Memory16>> _shared_memory,
+                       std::vector<uint8_t> _shared_pages,
+                       std::vector<std::string> _names,
+                       std::vector<std::unique_ptr<EmuSimulation>> _cpus)
+        : shared_clock(std::move(_shared_clock)),
+          shared_devices(std::move(_shared_devices)),
+          shared_memory(std::move(_shared_memory)),
+          shared_pages(std::move(_shared_pages)), names(std::move(_names)),
+          cpus(std::move(_cpus)) {}
+
+    static constexpr uint64_t kDefaultQuantumCycles = 1000;
+
+    // Resets all cpus and runs until every one of them stops. Cycle and instruction
+    // limits apply to each cpu, timeout to the whole run. Result of a cpu is at its
+    // index. Failure of any cpu stops all of them and is thrown as
+    // EmuSimulation::SimulationFailedException.
+    std::vector<EmuSimulation::Result>
+    Run(const EmuSimulation::Limits &limits = {},
+        uint64_t quantum_cycles = kDefaultQuantumCycles);
+};
+
+} // namespace emu
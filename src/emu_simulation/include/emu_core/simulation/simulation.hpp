@@ -37,7 +37,13 @@ struct EmuSimulation {
     struct Result {
         double duration;
         uint64_t cpu_cycles;
+        uint64_t instructions;
+        emu6502::cpu::ExecutionResult execution;
         std::optional<uint8_t> halt_code;
+
+        [[nodiscard]] double Mips() const {
+            return static_cast<double>(instructions) / duration / 1.0e6;
+        }
     };
 
     class SimulationFailedException : public std::runtime_error {
@@ -55,7 +61,28 @@ struct EmuSimulation {
         Result result;
     };
 
-    Result Run(std::chrono::nanoseconds timeout = {});
+    // Zero means no limit, execution stops with BudgetExhausted status at the first one
+    // reached
+    struct Limits {
+        std::chrono::nanoseconds timeout{};
+        uint64_t max_cycles = 0;
+        uint64_t max_instructions = 0;
+    };
+
+    // Resets clock and cpu, then runs until the program stops or a limit is reached
+    Result Run(const Limits &limits);
+    Result Run(std::chrono::nanoseconds timeout = {}) {
+        return Run(Limits{.timeout = timeout});
+    }
+
+    // Resumable execution: RunSlice continues from the current state, so a long run can
+    // be split into slices. Limits apply to the slice, counters of Result are since the
+    // last Reset and duration is of the slice only.
+    void Reset();
+    Result RunSlice(const Limits &limits);
+
+private:
+    Result Execute(const Limits &limits, bool reset);
 };
 
 } // namespace emu
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "emu_core/device_factory.hpp"
+#include "emu_core/memory_configuration_file.hpp"
+#include "emu_core/package/package.hpp"
+#include "simulation.hpp"
+#include "simulation_builder.hpp"
+#include "simulation_scheduler.hpp"
+#include <memory>
+#include <vector>
+
+namespace emu {
+
+// Simulations of one package which differ only in config overrides, e.g. seed of
+// random.mt19937 or input of tty (see ApplyConfigOverrides). Memory config and image
+// files are read from the package once for all instances.
+class SimulationBatch {
+public:
+    SimulationBatch(std::shared_ptr<DeviceFactory> device_factory,
+                    const package::IPackage *package,
+                    const SimulationBuildCpuConfig &cpu_config,
+                    const std::vector<ConfigOverrides> &instances);
+
+    // Resets all instances and runs them in parallel on the scheduler, limits apply to
+    // every instance on its own as in SimulationScheduler::Submit. Result of an instance
+    // is at its index. Failure of the first failed instance is thrown once all are done,
+    // its message starts with the index.
+    std::vector<EmuSimulation::Result> Run(SimulationScheduler &scheduler,
+                                           const EmuSimulation::Limits &limits);
+    // Runs on a scheduler with thread per core
+    std::vector<EmuSimulation::Result> Run(const EmuSimulation::Limits &limits);
+
+    [[nodiscard]] size_t Size() const { return simulations.size(); }
+    [[nodiscard]] EmuSimulation &Instance(size_t index) { return *simulations.at(index); }
+
+private:
+    std::vector<std::unique_ptr<EmuSimulation>> simulations;
+};
+
+} // namespace emu
@@ -7,6 +7,7 @@
 #include "emu_core/memory/memory_mapper.hpp"
 #include "emu_core/memory_configuration_file.hpp"
 #include "emu_core/package/package.hpp"
+#include "multi_cpu_simulation.hpp"
 #include "simulation.hpp"
 #include <memory>
 #include <string>
@@ -41,6 +42,13 @@ struct SimulationBuildVerboseConfig {
 struct SimulationBuildCpuConfig {
     uint64_t frequency;
     emu6502::InstructionSet instruction_set;
+    // CycleExact makes every bus access at its cycle, the others charge whole
+    // instruction costs
+    emu6502::cpu::ExecutionEngine engine = emu6502::cpu::ExecutionEngine::Default;
+    // Output of emu_6502_recompile, must outlive the simulation
+    const emu6502::cpu::RecompiledProgram *recompiled = nullptr;
+    // See Cpu::SetIdleLoopSkip, mapped devices are passed as device areas
+    bool idle_loop_skip = true;
 };
 
 std::unique_ptr<EmuSimulation>
@@ -48,4 +56,11 @@ BuildEmuSimulation(std::shared_ptr<DeviceFactory> device_factory,
                    package::IPackage *package, const SimulationBuildCpuConfig &cpu_config,
                    const SimulationBuildVerboseConfig &vc = {});
 
+// For memory config with cpus list, all cpus use the same cpu config. Recompiled program
+// and verbose output are not supported, cpu threads would share them.
+std::unique_ptr<MultiCpuSimulation>
+BuildMultiCpuSimulation(std::shared_ptr<DeviceFactory> device_factory,
+                        package::IPackage *package,
+                        const SimulationBuildCpuConfig &cpu_config);
+
 } // namespace emu
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "simulation.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace emu {
+
+// Runs many simulations on a fixed pool of threads. Each simulation runs in slices of
+// kSliceCycles (see EmuSimulation::RunSlice) and goes back to the end of the queue of its
+// thread, so all of them make progress. A thread with empty queue steals from the back
+// of queues of other threads.
+class SimulationScheduler {
+public:
+    explicit SimulationScheduler(size_t threads = std::thread::hardware_concurrency());
+    // Waits for all submitted simulations
+    ~SimulationScheduler();
+
+    SimulationScheduler(const SimulationScheduler &) = delete;
+    SimulationScheduler &operator=(const SimulationScheduler &) = delete;
+
+    // Resets the simulation and queues it, limits apply to the whole run. Timeout counts
+    // only the time the simulation runs, not the time it waits in the queue. Failure is
+    // reported by the future as EmuSimulation::SimulationFailedException. Simulation
+    // must not be used until the future is ready.
+    std::future<EmuSimulation::Result> Submit(EmuSimulation *simulation,
+                                              const EmuSimulation::Limits &limits = {});
+
+    // Waits until all submitted simulations are done
+    void Wait();
+
+    [[nodiscard]] size_t Threads() const { return workers.size(); }
+
+    static constexpr uint64_t kSliceCycles = 256 * 1024;
+
+private:
+    struct Task;
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Task>> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    // Guards counters below, workers sleep on wake when nothing is queued
+    std::mutex state_mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    size_t queued = 0;
+    size_t unfinished = 0;
+    size_t next_queue = 0;
+    bool stopping = false;
+
+    void Worker(size_t index);
+    void Push(size_t index, std::unique_ptr<Task> task);
+    std::unique_ptr<Task> Take(size_t index);
+    // Returns false once the simulation is done
+    static bool RunSlice(Task &task);
+    void Finish();
+};
+
+} // namespace emu
@@ -0,0 +1,145 @@
+#include "emu_core/simulation/multi_cpu_simulation.hpp"
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <exception>
+#include <fmt/format.h>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace emu {
+
+std::vector<EmuSimulation::Result>
+MultiCpuSimulation::Run(const EmuSimulation::Limits &limits, uint64_t quantum_cycles) {
+    constexpr auto kUnlimited = std::numeric_limits<uint64_t>::max();
+    if (quantum_cycles == 0) {
+        throw std::runtime_error("Quantum of multi cpu simulation can not be zero");
+    }
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (limits.timeout.count() > 0) {
+        deadline = std::chrono::steady_clock::now() + limits.timeout;
+    }
+    const uint64_t max_cycles = limits.max_cycles > 0 ? limits.max_cycles : kUnlimited;
+
+    const size_t count = cpus.size();
+    std::vector<EmuSimulation::Result> results(count);
+    std::vector<uint64_t> start_cycles(count);
+    // Written by thread of the cpu, read by the meeting
+    std::vector<char> active(count, 1);
+    std::vector<std::exception_ptr> errors(count);
+
+    // Page generations of each cpu at the last meeting, a cpu with a changed shared page
+    // has written it in the quantum
+    std::vector<emu6502::cpu::CodePageGenerationArray> seen_pages(count);
+
+    shared_clock->Reset();
+    for (size_t i = 0; i < count; ++i) {
+        cpus[i]->Reset();
+        start_cycles[i] = cpus[i]->cpu->ExecutedCycles();
+        seen_pages[i] = cpus[i]->cpu->CodePageGenerations();
+    }
+
+    // Blocks other cpus have decoded from a written shared page are dropped
+    auto invalidate_shared_pages = [&]() {
+        for (const uint8_t page : shared_pages) {
+            for (size_t i = 0; i < count; ++i) {
+                if (cpus[i]->cpu->CodePageGenerations()[page] == seen_pages[i][page]) {
+                    continue;
+                }
+                for (size_t other = 0; other < count; ++other) {
+                    if (other != i) {
+                        cpus[other]->cpu->OnMemoryStore(
+                            static_cast<emu6502::MemPtr>(page << 8));
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            seen_pages[i] = cpus[i]->cpu->CodePageGenerations();
+        }
+    };
+
+    // Cycles since start every cpu reaches in the current quantum. Both are changed only
+    // by the meeting, when all threads wait.
+    uint64_t target_cycles = std::min(quantum_cycles, max_cycles);
+    bool running = true;
+    auto meeting = [&]() noexcept {
+        shared_clock->Advance(target_cycles - shared_clock->CurrentCycle());
+        invalidate_shared_pages();
+        const bool any_active =
+            std::ranges::any_of(active, [](char a) { return a != 0; });
+        const bool any_failed =
+            std::ranges::any_of(errors, [](const auto &e) { return e != nullptr; });
+        running = any_active && !any_failed && target_cycles < max_cycles &&
+                  std::chrono::steady_clock::now() < deadline;
+        target_cycles = std::min(target_cycles + quantum_cycles, max_cycles);
+    };
+    std::barrier sync(static_cast<std::ptrdiff_t>(count), meeting);
+
+    auto run_quantum = [&](size_t i) {
+        auto &cpu = *cpus[i]->cpu;
+        auto &result = results[i];
+        const uint64_t spent_cycles = cpu.ExecutedCycles() - start_cycles[i];
+        if (spent_cycles >= target_cycles) {
+            return;
+        }
+
+        EmuSimulation::Limits slice{.max_cycles = target_cycles - spent_cycles};
+        if (limits.max_instructions > 0) {
+            slice.max_instructions = limits.max_instructions - result.instructions;
+        }
+        if (deadline != std::chrono::steady_clock::time_point::max()) {
+            // Zero timeout would mean no limit
+            slice.timeout = std::max<std::chrono::nanoseconds>(
+                deadline - std::chrono::steady_clock::now(), std::chrono::nanoseconds{1});
+        }
+
+        const double duration = result.duration;
+        result = cpus[i]->RunSlice(slice);
+        result.duration += duration;
+        const bool instructions_left =
+            limits.max_instructions == 0 || result.instructions < limits.max_instructions;
+        active[i] =
+            result.execution.status == emu6502::cpu::ExecutionStatus::BudgetExhausted &&
+            instructions_left;
+    };
+
+    auto run_cpu = [&](size_t i) {
+        while (running) {
+            if (active[i] != 0) {
+                try {
+                    run_quantum(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                    active[i] = 0;
+                }
+            }
+            sync.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < count; ++i) {
+        threads.emplace_back(run_cpu, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (errors[i] == nullptr) {
+            continue;
+        }
+        try {
+            std::rethrow_exception(errors[i]);
+        } catch (const EmuSimulation::SimulationFailedException &e) {
+            throw EmuSimulation::SimulationFailedException(
+                fmt::format("Cpu {}: {}", names[i], e.what()), e.Get(), e.GetResult());
+        }
+    }
+    return results;
+}
+
+} // namespace emu
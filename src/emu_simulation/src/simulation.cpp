@@ -1,11 +1,30 @@
 #include "emu_core/simulation/simulation.hpp"
 #include <boost/scope_exit.hpp>
 #include <chrono>
+#include <limits>
 
 namespace emu {
 
-EmuSimulation::Result EmuSimulation::Run(std::chrono::nanoseconds timeout) {
+void EmuSimulation::Reset() {
+    clock->Reset();
+    cpu->Reset();
+}
+
+EmuSimulation::Result EmuSimulation::Run(const Limits &limits) {
+    return Execute(limits, true);
+}
+
+EmuSimulation::Result EmuSimulation::RunSlice(const Limits &limits) {
+    return Execute(limits, false);
+}
+
+EmuSimulation::Result EmuSimulation::Execute(const Limits &limits, bool reset) {
+    constexpr auto kUnlimited = std::numeric_limits<uint64_t>::max();
     auto start = std::chrono::steady_clock::now();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (limits.timeout.count() > 0) {
+        deadline = start + limits.timeout;
+    }
 
     Result result;
     try {
@@ -15,17 +34,18 @@ EmuSimulation::Result EmuSimulation::Run(std::chrono::nanoseconds timeout) {
                 std::chrono::duration_cast<std::chrono::microseconds>(end - start);
             result.duration = static_cast<double>(delta.count()) / 1.0e6;
             result.cpu_cycles = clock->CurrentCycle();
+            result.instructions = cpu->ExecutedInstructions();
         };
 
-        clock->Reset();
-
-        if (timeout.count() > 0) {
-            cpu->ExecuteFor(timeout);
-        } else {
-            cpu->Execute();
+        if (reset) {
+            Reset();
+        }
+        result.execution = cpu->ExecuteBudget(
+            limits.max_instructions > 0 ? limits.max_instructions : kUnlimited,
+            limits.max_cycles > 0 ? limits.max_cycles : kUnlimited, deadline);
+        if (result.execution.status == emu6502::cpu::ExecutionStatus::Halted) {
+            result.halt_code = result.execution.halt_code;
         }
-    } catch (const emu6502::cpu::ExecutionHalted &e) {
-        result.halt_code = e.halt_code;
     } catch (const std::exception &e) {
         throw SimulationFailedException(fmt::format("{}: {}", typeid(e).name(), e.what()),
                                         std::current_exception(), result);
@@ -0,0 +1,106 @@
+#include "emu_core/simulation/simulation_batch.hpp"
+#include <fmt/format.h>
+#include <future>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+
+namespace emu {
+
+namespace {
+
+// Files of the package, each one is read once for the whole batch
+class FileCache {
+public:
+    explicit FileCache(const package::IPackage *package) : package(package) {}
+
+    const package::ByteVector &Load(const std::string &file_name,
+                                    std::optional<size_t> offset,
+                                    std::optional<size_t> length) {
+        auto key = std::make_tuple(file_name, offset, length);
+        auto it = files.find(key);
+        if (it == files.end()) {
+            it = files.emplace(key, package->LoadFile(file_name, offset, length)).first;
+        }
+        return it->second;
+    }
+
+private:
+    const package::IPackage *const package;
+    std::map<std::tuple<std::string, std::optional<size_t>, std::optional<size_t>>,
+             package::ByteVector>
+        files;
+};
+
+// Package as seen by one instance, config with its overrides applied
+class InstancePackage : public package::IPackage {
+public:
+    InstancePackage(MemoryConfig config, FileCache *files)
+        : config(std::move(config)), files(files) {}
+
+    MemoryConfig LoadMemoryConfig() const override { return config; }
+
+    package::ByteVector LoadFile(const std::string &file_name,
+                                 std::optional<size_t> offset,
+                                 std::optional<size_t> length) const override {
+        return files->Load(file_name, offset, length);
+    }
+
+private:
+    const MemoryConfig config;
+    FileCache *const files;
+};
+
+} // namespace
+
+SimulationBatch::SimulationBatch(std::shared_ptr<DeviceFactory> device_factory,
+                                 const package::IPackage *package,
+                                 const SimulationBuildCpuConfig &cpu_config,
+                                 const std::vector<ConfigOverrides> &instances) {
+    const auto config = package->LoadMemoryConfig();
+    FileCache files{package};
+    simulations.reserve(instances.size());
+    for (const auto &overrides : instances) {
+        InstancePackage instance_package{ApplyConfigOverrides(config, overrides), &files};
+        simulations.emplace_back(
+            BuildEmuSimulation(device_factory, &instance_package, cpu_config));
+    }
+}
+
+std::vector<EmuSimulation::Result>
+SimulationBatch::Run(SimulationScheduler &scheduler,
+                     const EmuSimulation::Limits &limits) {
+    std::vector<std::future<EmuSimulation::Result>> futures;
+    futures.reserve(simulations.size());
+    for (auto &simulation : simulations) {
+        futures.emplace_back(scheduler.Submit(simulation.get(), limits));
+    }
+
+    // Instances still use the simulations, so all of them finish before a failure is
+    // reported
+    std::vector<EmuSimulation::Result> results(simulations.size());
+    std::optional<EmuSimulation::SimulationFailedException> failure;
+    for (size_t i = 0; i < futures.size(); ++i) {
+        try {
+            results[i] = futures[i].get();
+        } catch (const EmuSimulation::SimulationFailedException &e) {
+            if (!failure.has_value()) {
+                failure.emplace(fmt::format("Instance {}: {}", i, e.what()), e.Get(),
+                                e.GetResult());
+            }
+        }
+    }
+    if (failure.has_value()) {
+        throw *failure;
+    }
+    return results;
+}
+
+std::vector<EmuSimulation::Result>
+SimulationBatch::Run(const EmuSimulation::Limits &limits) {
+    SimulationScheduler scheduler;
+    return Run(scheduler, limits);
+}
+
+} // namespace emu
@@ -6,6 +6,8 @@
 
 namespace emu {
 
+constexpr size_t kFlatMemorySize = 0x10000;
+
 struct BuilderState {
     std::shared_ptr<DeviceFactory> device_factory;
     SimulationBuildVerboseConfig verbose;
@@ -17,8 +19,13 @@ struct BuilderState {
     std::unique_ptr<emu6502::cpu::Debugger> debugger;
     std::vector<std::shared_ptr<Device>> devices;
     std::vector<std::shared_ptr<Memory16>> mapped_devices;
+    std::vector<std::pair<uint16_t, size_t>> device_areas;
 
-    void InitCpu(const SimulationBuildCpuConfig &cpu_config) {
+    // Set when single ram area covers whole address space, cpu can access it directly
+    // instead of going through memory mapper
+    memory::MemoryBlock16 *flat_memory = nullptr;
+
+    void InitClock(const SimulationBuildCpuConfig &cpu_config) {
         if (cpu_config.frequency == 0) {
             clock = std::make_unique<ClockSimple>();
         } else {
@@ -27,7 +34,9 @@ struct BuilderState {
 
         memory = std::make_unique<memory::MemoryMapper16>(clock.get(), false,
                                                           verbose.memory_mapper);
+    }
 
+    void InitCpu(const SimulationBuildCpuConfig &cpu_config) {
         if (verbose.cpu != nullptr) {
             debugger = std::make_unique<emu6502::cpu::VerboseDebugger>( //
                 cpu_config.instruction_set,                             //
@@ -37,28 +46,94 @@ struct BuilderState {
             );
         }
 
-        cpu = std::make_unique<emu6502::cpu::Cpu>( //
-            clock.get(),                           //
-            memory.get(),                          //
-            verbose.cpu,                           //
-            cpu_config.instruction_set,            //
-            debugger.get()                         //
+        if (flat_memory != nullptr && verbose.memory_mapper == nullptr) {
+            if (auto *simple = dynamic_cast<ClockSimple *>(clock.get())) {
+                cpu = MakeCpu<emu6502::cpu::BasicCpu<memory::MemoryBlock16, ClockSimple>>(
+                    cpu_config, simple, flat_memory);
+            } else {
+                cpu = MakeCpu<emu6502::cpu::BasicCpu<memory::MemoryBlock16, ClockSteady>>(
+                    cpu_config, static_cast<ClockSteady *>(clock.get()), flat_memory);
+            }
+        } else {
+            cpu = MakeCpu<emu6502::cpu::Cpu>(cpu_config, clock.get(), memory.get());
+        }
+        if (cpu_config.recompiled != nullptr) {
+            cpu->AttachRecompiledProgram(cpu_config.recompiled);
+        }
+        cpu->SetIdleLoopSkip(cpu_config.idle_loop_skip);
+        for (auto [offset, size] : device_areas) {
+            cpu->AddDeviceArea(offset, size);
+        }
+        for (const auto &device : devices) {
+            device->AttachCpu(&cpu->Scheduler(), cpu.get());
+        }
+    }
+
+    template <typename CpuT, typename ClockT, typename MemoryT>
+    std::unique_ptr<emu6502::cpu::Cpu> MakeCpu(const SimulationBuildCpuConfig &cpu_config,
+                                               ClockT *cpu_clock, MemoryT *cpu_memory) {
+        return std::make_unique<CpuT>(  //
+            cpu_clock,                  //
+            cpu_memory,                 //
+            verbose.cpu,                //
+            cpu_config.instruction_set, //
+            debugger.get(),             //
+            cpu_config.engine           //
         );
     }
 
-    void InitMemory() {
-        for (auto &dev : package->LoadMemoryConfig().entries) {
+    struct MappedArea {
+        uint16_t offset;
+        size_t size;
+        std::shared_ptr<Memory16> memory;
+        bool device;
+    };
+    std::vector<MappedArea> areas;
+
+    void InitMemory(const std::vector<MemoryConfigEntry> &entries) {
+        for (const auto &dev : entries) {
             auto [device_ptr, size] =
                 std::visit([&](auto &item) { return CreateMemoryDevice(dev.name, item); },
                            dev.entry_variant);
             if (device_ptr != nullptr) {
-                memory->MapArea(static_cast<uint16_t>(dev.offset),
-                                static_cast<uint16_t>(size), device_ptr.get());
+                areas.emplace_back(MappedArea{
+                    .offset = static_cast<uint16_t>(dev.offset),
+                    .size = size,
+                    .memory = device_ptr,
+                    .device = std::holds_alternative<MemoryConfigEntry::MappedDevice>(
+                        dev.entry_variant),
+                });
                 mapped_devices.emplace_back(std::move(device_ptr));
             }
         }
     }
 
+    // Shared areas are owned by the state which created them
+    void MapMemory(const std::vector<MappedArea> &shared_areas = {}) {
+        auto map_area = [&](const MappedArea &area, bool device) {
+            memory->MapArea(area.offset, static_cast<uint16_t>(area.size),
+                            area.memory.get());
+            if (device) {
+                device_areas.emplace_back(area.offset, area.size);
+            }
+        };
+        for (const auto &area : areas) {
+            map_area(area, area.device);
+        }
+        // Other cpus write there, polling it is never an idle loop
+        for (const auto &area : shared_areas) {
+            map_area(area, true);
+        }
+
+        if (areas.size() == 1 && shared_areas.empty() && areas.front().offset == 0) {
+            auto *block =
+                dynamic_cast<memory::MemoryBlock16 *>(areas.front().memory.get());
+            if (block != nullptr && block->block.size() == kFlatMemorySize) {
+                flat_memory = block;
+            }
+        }
+    }
+
     using MappedDevice = std::tuple<std::shared_ptr<Memory16>, size_t>;
 
     MappedDevice CreateMemoryDevice(std::string name,
@@ -74,6 +149,8 @@ struct BuilderState {
         std::vector<uint8_t> bytes;
         if (ra.image.has_value()) {
             bytes = package->LoadFile(ra.image->file, ra.image->offset, ra.size);
+        } else {
+            bytes.resize(ra.size.value_or(0));
         }
         const auto size = bytes.size();
         return {
@@ -93,8 +170,17 @@ BuildEmuSimulation(std::shared_ptr<DeviceFactory> device_factory,
     state.package = package;
     state.device_factory = device_factory;
 
+    auto config = package->LoadMemoryConfig();
+    if (!config.cpus.empty()) {
+        throw std::runtime_error(
+            fmt::format("Memory config defines {} cpus, use BuildMultiCpuSimulation",
+                        config.cpus.size()));
+    }
+
+    state.InitClock(cpu_config);
+    state.InitMemory(config.entries);
+    state.MapMemory();
     state.InitCpu(cpu_config);
-    state.InitMemory();
 
     return std::make_unique<EmuSimulation>( //
         std::move(state.clock),             //
@@ -106,4 +192,65 @@ BuildEmuSimulation(std::shared_ptr<DeviceFactory> device_factory,
     );
 }
 
+std::unique_ptr<MultiCpuSimulation>
+BuildMultiCpuSimulation(std::shared_ptr<DeviceFactory> device_factory,
+                        package::IPackage *package,
+                        const SimulationBuildCpuConfig &cpu_config) {
+    auto config = package->LoadMemoryConfig();
+    if (config.cpus.empty()) {
+        throw std::runtime_error("Memory config does not define cpus");
+    }
+    if (cpu_config.recompiled != nullptr) {
+        throw std::runtime_error("Recompiled program can not be used with multiple cpus");
+    }
+
+    BuilderState shared;
+    shared.package = package;
+    shared.device_factory = device_factory;
+    shared.clock = std::make_unique<ClockSimple>();
+    shared.InitMemory(config.entries);
+
+    std::vector<uint8_t> shared_pages;
+    for (const auto &area : shared.areas) {
+        if (area.size == 0) {
+            continue;
+        }
+        const size_t last_page = (area.offset + area.size - 1) >> 8;
+        for (size_t page = area.offset >> 8; page <= last_page; ++page) {
+            shared_pages.emplace_back(static_cast<uint8_t>(page));
+        }
+    }
+
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<EmuSimulation>> cpus;
+    for (const auto &cpu : config.cpus) {
+        BuilderState state;
+        state.package = package;
+        state.device_factory = device_factory;
+        state.InitClock(cpu_config);
+        state.InitMemory(cpu.entries);
+        state.MapMemory(shared.areas);
+        state.InitCpu(cpu_config);
+
+        names.emplace_back(cpu.name);
+        cpus.emplace_back(std::make_unique<EmuSimulation>( //
+            std::move(state.clock),                        //
+            std::move(state.memory),                       //
+            std::move(state.cpu),                          //
+            std::move(state.debugger),                     //
+            std::move(state.devices),                      //
+            std::move(state.mapped_devices)                //
+            ));
+    }
+
+    return std::make_unique<MultiCpuSimulation>( //
+        std::move(shared.clock),                 //
+        std::move(shared.devices),               //
+        std::move(shared.mapped_devices),        //
+        std::move(shared_pages),                 //
+        std::move(names),                        //
+        std::move(cpus)                          //
+    );
+}
+
 } // namespace emu
@@ -0,0 +1,183 @@
+#include "emu_core/simulation/simulation_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace emu {
+
+struct SimulationScheduler::Task {
+    EmuSimulation *simulation;
+    EmuSimulation::Limits limits;
+    std::promise<EmuSimulation::Result> promise;
+    EmuSimulation::Result result{};
+    uint64_t start_cycles = 0;
+    bool started = false;
+};
+
+SimulationScheduler::SimulationScheduler(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i) {
+        queues.emplace_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i] { Worker(i); });
+    }
+}
+
+SimulationScheduler::~SimulationScheduler() {
+    Wait();
+    {
+        std::lock_guard lock(state_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<EmuSimulation::Result>
+SimulationScheduler::Submit(EmuSimulation *simulation,
+                            const EmuSimulation::Limits &limits) {
+    auto task = std::make_unique<Task>();
+    task->simulation = simulation;
+    task->limits = limits;
+    auto future = task->promise.get_future();
+
+    size_t index = 0;
+    {
+        std::lock_guard lock(state_mutex);
+        ++unfinished;
+        index = next_queue++ % queues.size();
+    }
+    Push(index, std::move(task));
+    return future;
+}
+
+void SimulationScheduler::Wait() {
+    std::unique_lock lock(state_mutex);
+    done.wait(lock, [this] { return unfinished == 0; });
+}
+
+void SimulationScheduler::Worker(size_t index) {
+    for (;;) {
+        auto task = Take(index);
+        if (task == nullptr) {
+            std::unique_lock lock(state_mutex);
+            wake.wait(lock, [this] { return queued > 0 || stopping; });
+            if (stopping) {
+                return;
+            }
+            continue;
+        }
+
+        bool more = false;
+        try {
+            more = RunSlice(*task);
+            if (!more) {
+                task->promise.set_value(task->result);
+            }
+        } catch (...) {
+            task->promise.set_exception(std::current_exception());
+        }
+        if (more) {
+            Push(index, std::move(task));
+        } else {
+            Finish();
+        }
+    }
+}
+
+void SimulationScheduler::Push(size_t index, std::unique_ptr<Task> task) {
+    {
+        // Counted before it is visible, so Take never sees it uncounted
+        std::lock_guard lock(state_mutex);
+        ++queued;
+    }
+    {
+        auto &queue = *queues[index];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+std::unique_ptr<SimulationScheduler::Task> SimulationScheduler::Take(size_t index) {
+    for (size_t i = 0; i < queues.size(); ++i) {
+        auto &queue = *queues[(index + i) % queues.size()];
+        std::unique_ptr<Task> task;
+        {
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+        std::lock_guard lock(state_mutex);
+        --queued;
+        return task;
+    }
+    return nullptr;
+}
+
+bool SimulationScheduler::RunSlice(Task &task) {
+    auto &simulation = *task.simulation;
+    const auto &limits = task.limits;
+    if (!task.started) {
+        simulation.Reset();
+        task.start_cycles = simulation.cpu->ExecutedCycles();
+        task.started = true;
+    }
+
+    const std::chrono::duration<double> spent_time{task.result.duration};
+    EmuSimulation::Limits slice{.max_cycles = kSliceCycles};
+    if (limits.max_cycles > 0) {
+        const uint64_t spent_cycles =
+            simulation.cpu->ExecutedCycles() - task.start_cycles;
+        slice.max_cycles = std::min(kSliceCycles, limits.max_cycles - spent_cycles);
+    }
+    if (limits.max_instructions > 0) {
+        slice.max_instructions = limits.max_instructions - task.result.instructions;
+    }
+    if (limits.timeout.count() > 0) {
+        // Zero timeout would mean no limit
+        slice.timeout = std::max<std::chrono::nanoseconds>(
+            limits.timeout -
+                std::chrono::duration_cast<std::chrono::nanoseconds>(spent_time),
+            std::chrono::nanoseconds{1});
+    }
+
+    const double duration = task.result.duration;
+    try {
+        task.result = simulation.RunSlice(slice);
+    } catch (const EmuSimulation::SimulationFailedException &e) {
+        auto result = e.GetResult();
+        result.duration += duration;
+        throw EmuSimulation::SimulationFailedException(e.what(), e.Get(), result);
+    }
+    task.result.duration += duration;
+
+    const auto &result = task.result;
+    const uint64_t spent_cycles = simulation.cpu->ExecutedCycles() - task.start_cycles;
+    const bool instructions_left =
+        limits.max_instructions == 0 || result.instructions < limits.max_instructions;
+    const bool cycles_left = limits.max_cycles == 0 || spent_cycles < limits.max_cycles;
+    const std::chrono::duration<double> run_time{result.duration};
+    const bool time_left = limits.timeout.count() == 0 || run_time < limits.timeout;
+    return result.execution.status == emu6502::cpu::ExecutionStatus::BudgetExhausted &&
+           instructions_left && cycles_left && time_left;
+}
+
+void SimulationScheduler::Finish() {
+    std::lock_guard lock(state_mutex);
+    if (--unfinished == 0) {
+        done.notify_all();
+    }
+}
+
+} // namespace emu
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+
+#include "emu_core/simulation/multi_cpu_simulation.hpp"
+#include "emu_core/simulation/simulation_builder.hpp"
+#include "simulation_test_helper.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace emu::test {
+namespace {
+
+using namespace std::string_literals;
+using emu6502::cpu::ExecutionEngine;
+using emu6502::cpu::ExecutionStatus;
+
+// Upper half of the shared area is not mapped
+const auto kMultiCpuConfig = R"==(
+memory:
+- ram:
+  offset: 0x8000
+  size: 0x0800
+  name: shared
+  image:
+    file: shared.bin
+    offset: 0x8000
+cpus:
+- name: first
+  memory:
+  - ram:
+    offset: 0x0000
+    size: 0x8000
+  - ram:
+    offset: 0x9000
+    size: 0x7000
+    image:
+      file: first.bin
+      offset: 0x9000
+- name: second
+  memory:
+  - ram:
+    offset: 0x0000
+    size: 0x8000
+  - ram:
+    offset: 0x9000
+    size: 0x7000
+    image:
+      file: second.bin
+      offset: 0x9000
+)=="s;
+
+// VALUE is called by the reader, the writer changes the value it loads
+const auto kSharedCode = R"==(
+.org 0x8000
+VALUE:
+    LDA #$01
+    RTS
+)=="s;
+
+const auto kWriterCode = R"==(
+.isr reset ENTRY
+
+.org 0xA000
+ENTRY:
+    LDX #$00
+WAIT:
+    DEX
+    BNE WAIT
+    LDA #$02
+    STA $8001
+    HLT #$00
+)=="s;
+
+const auto kReaderCode = R"==(
+.isr reset ENTRY
+
+.org 0xA000
+ENTRY:
+    JSR $8000
+    CMP #$01
+    BEQ ENTRY
+    HLT A
+)=="s;
+
+class MultiCpuSimulationTest : public testing::Test {
+public:
+    TestPackage package{kMultiCpuConfig};
+
+    void SetUp() override { package.AddImage("shared.bin", kSharedCode); }
+
+    std::unique_ptr<MultiCpuSimulation>
+    Build(const std::string &first, const std::string &second,
+          ExecutionEngine engine = ExecutionEngine::Default) {
+        package.AddImage("first.bin", first);
+        package.AddImage("second.bin", second);
+        return BuildMultiCpuSimulation(std::make_shared<NoDeviceFactory>(), &package,
+                                       {
+                                           .frequency = 0,
+                                           .instruction_set =
+                                               emu6502::InstructionSet::NMOS6502Emu,
+                                           .engine = engine,
+                                       });
+    }
+};
+
+TEST_F(MultiCpuSimulationTest, EachCpuRunsOnItsOwnThread) {
+    auto simulation = Build(kNoteCode, kNoteCode);
+    ASSERT_EQ(simulation->cpus.size(), 2);
+    EXPECT_EQ(simulation->names, (std::vector<std::string>{"first", "second"}));
+    EXPECT_EQ(simulation->shared_pages.size(), 8);
+
+    std::mutex mutex;
+    std::array<std::set<std::thread::id>, 2> threads;
+    for (size_t i = 0; i < 2; ++i) {
+        simulation->cpus[i]->cpu->AddNativeRoutine(
+            kNoteAddress, [&, i](emu6502::cpu::Registers &, Memory16 &) -> uint64_t {
+                std::lock_guard lock(mutex);
+                threads[i].insert(std::this_thread::get_id());
+                return 6;
+            });
+    }
+
+    auto results = simulation->Run({.max_instructions = 20'000});
+    ASSERT_EQ(results.size(), 2);
+    for (size_t i = 0; i < 2; ++i) {
+        EXPECT_EQ(results[i].instructions, 20'000);
+        ASSERT_EQ(threads[i].size(), 1);
+        EXPECT_NE(*threads[i].begin(), std::this_thread::get_id());
+    }
+    EXPECT_NE(*threads[0].begin(), *threads[1].begin());
+}
+
+TEST_F(MultiCpuSimulationTest, CpusMeetAfterEveryQuantum) {
+    constexpr uint64_t kQuantum = 500;
+    constexpr uint64_t kMaxCycles = 200'000;
+    auto simulation = Build(kNoteCode, kNoteCode);
+
+    // Cycles of a cpu may be ahead of the other one by less than two quanta: one is in
+    // the last quantum, the other has made its last note at the start of it
+    std::array<std::atomic<uint64_t>, 2> progress{};
+    std::atomic<uint64_t> max_lead{0};
+    for (size_t i = 0; i < 2; ++i) {
+        auto *cpu = simulation->cpus[i]->cpu.get();
+        cpu->AddNativeRoutine(kNoteAddress,
+                              [&, i, cpu](emu6502::cpu::Registers &, Memory16 &) {
+                                  const uint64_t own = cpu->ExecutedCycles();
+                                  progress[i] = own;
+                                  const uint64_t other = progress[1 - i];
+                                  if (own > other) {
+                                      uint64_t lead = max_lead;
+                                      while (own - other > lead &&
+                                             !max_lead.compare_exchange_weak(
+                                                 lead, own - other)) {
+                                      }
+                                  }
+                                  return uint64_t{6};
+                              });
+    }
+
+    auto results = simulation->Run({.max_cycles = kMaxCycles}, kQuantum);
+    for (const auto &result : results) {
+        EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+        EXPECT_GE(result.cpu_cycles, kMaxCycles);
+    }
+    EXPECT_GT(max_lead.load(), 0);
+    EXPECT_LT(max_lead.load(), 2 * kQuantum + 32);
+}
+
+TEST_F(MultiCpuSimulationTest, LimitsApplyToEachCpu) {
+    constexpr uint64_t kMaxInstructions = 300'001;
+    constexpr uint64_t kMaxCycles = 50'001;
+    auto simulation = Build(kEndlessCode, kHaltCode);
+    simulation->cpus[1]->memory->Store(kHaltCodeAddress, 0x05);
+
+    // Halted cpu does not stop the other one
+    auto results = simulation->Run({.max_instructions = kMaxInstructions});
+    EXPECT_EQ(results[0].execution.status, ExecutionStatus::BudgetExhausted);
+    EXPECT_EQ(results[0].instructions, kMaxInstructions);
+    EXPECT_EQ(results[1].execution.status, ExecutionStatus::Halted);
+    EXPECT_EQ(results[1].halt_code, 0x05);
+    EXPECT_LT(results[1].instructions, kMaxInstructions);
+
+    results = simulation->Run({.max_cycles = kMaxCycles});
+    for (const auto &result : results) {
+        EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+        EXPECT_GE(result.cpu_cycles, kMaxCycles);
+        EXPECT_LT(result.cpu_cycles, kMaxCycles + 16);
+    }
+}
+
+TEST_F(MultiCpuSimulationTest, FailureOfOneCpuStopsAll) {
+    auto simulation = Build(kEndlessCode, kFailingCode);
+    try {
+        simulation->Run();
+        ADD_FAILURE() << "failure was not reported";
+    } catch (const EmuSimulation::SimulationFailedException &e) {
+        EXPECT_EQ(std::string(e.what()).rfind("Cpu second: ", 0), 0) << e.what();
+        EXPECT_NE(std::string(e.what()).find("8fff"), std::string::npos) << e.what();
+    }
+}
+
+TEST_F(MultiCpuSimulationTest, CodeWrittenByOtherCpuIsDecodedAgain) {
+    for (auto engine :
+         {ExecutionEngine::Reference, ExecutionEngine::Cached, ExecutionEngine::Jit}) {
+        SCOPED_TRACE(to_string(engine));
+        auto simulation = Build(kWriterCode, kReaderCode, engine);
+
+        auto results = simulation->Run({.max_cycles = 100'000}, 200);
+        EXPECT_EQ(results[0].halt_code, 0x00);
+        EXPECT_EQ(results[1].execution.status, ExecutionStatus::Halted);
+        EXPECT_EQ(results[1].halt_code, 0x02);
+    }
+}
+
+} // namespace
+} // namespace emu::test
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "emu_core/simulation/simulation_batch.hpp"
+#include "simulation_test_helper.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace emu::test {
+namespace {
+
+using namespace std::string_literals;
+using emu6502::cpu::ExecutionStatus;
+
+// Shared area is not mapped, program image is selected by instance override
+const auto kBatchConfig = R"==(
+memory:
+- ram:
+  offset: 0x0000
+  size: 0x8000
+- ram:
+  offset: 0x9000
+  size: 0x7000
+  image:
+    file: $program
+    offset: 0x9000
+)=="s;
+
+class SimulationBatchTest : public testing::Test {
+public:
+    TestPackage package{kBatchConfig};
+    std::shared_ptr<DeviceFactory> device_factory = std::make_shared<NoDeviceFactory>();
+    SimulationBuildCpuConfig cpu_config{
+        .frequency = 0,
+        .instruction_set = emu6502::InstructionSet::NMOS6502Emu,
+    };
+
+    void SetUp() override {
+        package.AddImage("halt.bin", kHaltCode);
+        package.AddImage("endless.bin", kEndlessCode);
+        package.AddImage("failing.bin", kFailingCode);
+    }
+
+    SimulationBatch MakeBatch(const std::vector<std::string> &programs) {
+        std::vector<ConfigOverrides> instances;
+        for (const auto &program : programs) {
+            instances.emplace_back(ConfigOverrides{{"program", program}});
+        }
+        return SimulationBatch(device_factory, &package, cpu_config, instances);
+    }
+};
+
+TEST_F(SimulationBatchTest, ResultOfInstanceIsAtItsIndex) {
+    auto batch = MakeBatch({"halt.bin", "halt.bin", "endless.bin", "halt.bin",
+                            "halt.bin", "endless.bin"});
+    ASSERT_EQ(batch.Size(), 6);
+    for (size_t i = 0; i < batch.Size(); ++i) {
+        batch.Instance(i).memory->Store(kHaltCodeAddress, static_cast<uint8_t>(i));
+    }
+
+    SimulationScheduler scheduler(2);
+    auto results = batch.Run(scheduler, {.max_instructions = 400'000});
+    ASSERT_EQ(results.size(), 6);
+    for (size_t i : {0, 1, 3, 4}) {
+        EXPECT_EQ(results[i].execution.status, ExecutionStatus::Halted) << i;
+        EXPECT_EQ(results[i].halt_code, i);
+    }
+    for (size_t i : {2, 5}) {
+        EXPECT_EQ(results[i].execution.status, ExecutionStatus::BudgetExhausted) << i;
+        EXPECT_FALSE(results[i].halt_code.has_value()) << i;
+    }
+}
+
+TEST_F(SimulationBatchTest, LimitsApplyToEveryInstance) {
+    constexpr uint64_t kMaxInstructions = 300'001;
+    constexpr uint64_t kMaxCycles = 700'001;
+    auto batch = MakeBatch({"endless.bin", "endless.bin", "endless.bin"});
+
+    auto results = batch.Run({.max_instructions = kMaxInstructions});
+    for (const auto &result : results) {
+        EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+        EXPECT_EQ(result.instructions, kMaxInstructions);
+    }
+
+    // Next run starts again from reset
+    results = batch.Run({.max_cycles = kMaxCycles});
+    for (const auto &result : results) {
+        EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+        EXPECT_GE(result.cpu_cycles, kMaxCycles);
+        EXPECT_LT(result.cpu_cycles, kMaxCycles + 16);
+        EXPECT_LT(result.instructions, kMaxInstructions);
+    }
+}
+
+TEST_F(SimulationBatchTest, FailureNamesItsInstance) {
+    auto batch = MakeBatch({"halt.bin", "failing.bin", "halt.bin", "failing.bin"});
+    for (size_t i = 0; i < batch.Size(); ++i) {
+        batch.Instance(i).memory->Store(kHaltCodeAddress, static_cast<uint8_t>(0x40 + i));
+    }
+
+    SimulationScheduler scheduler(2);
+    try {
+        batch.Run(scheduler, {});
+        ADD_FAILURE() << "failure was not reported";
+    } catch (const EmuSimulation::SimulationFailedException &e) {
+        EXPECT_EQ(std::string(e.what()).rfind("Instance 1: ", 0), 0) << e.what();
+        EXPECT_NE(std::string(e.what()).find("8fff"), std::string::npos) << e.what();
+        EXPECT_GT(e.GetResult().instructions, 0);
+    }
+    // Other instances are run to their end before the failure is thrown
+    EXPECT_EQ(batch.Instance(0).cpu->reg.a, 0x40);
+    EXPECT_EQ(batch.Instance(2).cpu->reg.a, 0x42);
+}
+
+} // namespace
+} // namespace emu::test
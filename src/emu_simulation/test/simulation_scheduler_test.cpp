@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "emu_core/simulation/simulation_scheduler.hpp"
+#include "simulation_test_helper.hpp"
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace emu::test {
+namespace {
+
+using emu6502::cpu::ExecutionStatus;
+
+TEST(SimulationSchedulerTest, SubmitRunsSimulationToItsEnd) {
+    auto simulation = MakeHaltingSimulation(0x42);
+    SimulationScheduler scheduler(1);
+    EXPECT_EQ(scheduler.Threads(), 1);
+
+    auto result = scheduler.Submit(simulation.get()).get();
+    EXPECT_EQ(result.execution.status, ExecutionStatus::Halted);
+    EXPECT_EQ(result.halt_code, 0x42);
+    EXPECT_GT(result.cpu_cycles, SimulationScheduler::kSliceCycles);
+}
+
+TEST(SimulationSchedulerTest, RunsMoreSimulationsThanThreads) {
+    constexpr size_t kCount = 16;
+    std::vector<std::unique_ptr<EmuSimulation>> simulations;
+    for (size_t i = 0; i < kCount; ++i) {
+        simulations.emplace_back(MakeHaltingSimulation(static_cast<uint8_t>(i)));
+    }
+
+    SimulationScheduler scheduler(2);
+    std::vector<std::future<EmuSimulation::Result>> futures;
+    for (auto &simulation : simulations) {
+        futures.emplace_back(scheduler.Submit(simulation.get()));
+    }
+    for (size_t i = 0; i < kCount; ++i) {
+        auto result = futures[i].get();
+        EXPECT_EQ(result.execution.status, ExecutionStatus::Halted) << i;
+        EXPECT_EQ(result.halt_code, i);
+    }
+}
+
+TEST(SimulationSchedulerTest, LimitsSpanSeveralSlices) {
+    constexpr uint64_t kMaxInstructions = 1'000'003;
+    constexpr uint64_t kMaxCycles = 3 * SimulationScheduler::kSliceCycles + 1001;
+    auto by_instructions = MakeSimulation(kEndlessCode);
+    auto by_cycles = MakeSimulation(kEndlessCode);
+
+    SimulationScheduler scheduler(1);
+    auto instructions_future =
+        scheduler.Submit(by_instructions.get(), {.max_instructions = kMaxInstructions});
+    auto cycles_future = scheduler.Submit(by_cycles.get(), {.max_cycles = kMaxCycles});
+
+    auto result = instructions_future.get();
+    EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+    EXPECT_EQ(result.instructions, kMaxInstructions);
+
+    result = cycles_future.get();
+    EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+    // Reset cycles are counted by the clock, not by the limit
+    EXPECT_GE(result.cpu_cycles, kMaxCycles);
+    EXPECT_LT(result.cpu_cycles, kMaxCycles + 16);
+}
+
+TEST(SimulationSchedulerTest, TimeoutCountsOnlyRunTime) {
+    constexpr std::chrono::milliseconds kTimeout{50};
+    auto first = MakeSimulation(kEndlessCode);
+    auto second = MakeSimulation(kEndlessCode);
+
+    SimulationScheduler scheduler(1);
+    auto start = std::chrono::steady_clock::now();
+    auto first_future = scheduler.Submit(first.get(), {.timeout = kTimeout});
+    auto second_future = scheduler.Submit(second.get(), {.timeout = kTimeout});
+    for (auto *future : {&first_future, &second_future}) {
+        auto result = future->get();
+        EXPECT_EQ(result.execution.status, ExecutionStatus::BudgetExhausted);
+        EXPECT_GE(result.duration, 0.05);
+        EXPECT_LT(result.duration, 1.0);
+    }
+    // Both ran on one thread, one after another slice by slice
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 2 * kTimeout);
+}
+
+TEST(SimulationSchedulerTest, FailureIsReportedByItsFuture) {
+    auto failing = MakeSimulation(kFailingCode);
+    auto halting = MakeHaltingSimulation(0x07);
+
+    SimulationScheduler scheduler(2);
+    auto failed = scheduler.Submit(failing.get());
+    auto done = scheduler.Submit(halting.get());
+
+    try {
+        failed.get();
+        ADD_FAILURE() << "failure was not reported";
+    } catch (const EmuSimulation::SimulationFailedException &e) {
+        EXPECT_NE(std::string(e.what()).find("8fff"), std::string::npos) << e.what();
+        EXPECT_GT(e.GetResult().instructions, 0);
+    }
+    EXPECT_EQ(done.get().halt_code, 0x07);
+}
+
+TEST(SimulationSchedulerTest, WaitReturnsWhenAllSimulationsAreDone) {
+    constexpr uint64_t kMaxInstructions = 100'000;
+    std::vector<std::unique_ptr<EmuSimulation>> simulations;
+    for (size_t i = 0; i < 6; ++i) {
+        simulations.emplace_back(MakeSimulation(kEndlessCode));
+    }
+
+    SimulationScheduler scheduler(3);
+    std::vector<std::future<EmuSimulation::Result>> futures;
+    for (auto &simulation : simulations) {
+        futures.emplace_back(
+            scheduler.Submit(simulation.get(), {.max_instructions = kMaxInstructions}));
+    }
+    scheduler.Wait();
+    for (auto &future : futures) {
+        ASSERT_EQ(future.wait_for(std::chrono::seconds{0}), std::future_status::ready);
+        EXPECT_EQ(future.get().instructions, kMaxInstructions);
+    }
+}
+
+TEST(SimulationSchedulerTest, IdleThreadStealsQueuedSimulations) {
+    constexpr size_t kLongCount = 4;
+    std::mutex mutex;
+    std::set<std::thread::id> long_threads;
+    auto note = [&](emu6502::cpu::Registers &, Memory16 &) -> uint64_t {
+        std::lock_guard lock(mutex);
+        long_threads.insert(std::this_thread::get_id());
+        return 6;
+    };
+
+    // Submissions alternate between the two queues, long ones all go to the first
+    std::vector<std::unique_ptr<EmuSimulation>> simulations;
+    SimulationScheduler scheduler(2);
+    std::vector<std::future<EmuSimulation::Result>> futures;
+    for (size_t i = 0; i < kLongCount; ++i) {
+        auto &long_one = simulations.emplace_back(MakeSimulation(kNoteCode));
+        long_one->cpu->AddNativeRoutine(kNoteAddress, note);
+        futures.emplace_back(
+            scheduler.Submit(long_one.get(), {.max_instructions = 500'000}));
+        auto &short_one = simulations.emplace_back(MakeHaltingSimulation(0));
+        futures.emplace_back(scheduler.Submit(short_one.get()));
+    }
+    scheduler.Wait();
+
+    for (auto &future : futures) {
+        EXPECT_NO_THROW(future.get());
+    }
+    std::lock_guard lock(mutex);
+    EXPECT_EQ(long_threads.size(), 2);
+}
+
+} // namespace
+} // namespace emu::test
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "emu_6502/assembler/compiler.hpp"
+#include "emu_core/clock.hpp"
+#include "emu_core/memory/memory_block.hpp"
+#include "emu_core/device_factory.hpp"
+#include "emu_core/memory/memory_mapper.hpp"
+#include "emu_core/memory_configuration_file.hpp"
+#include "emu_core/package/package.hpp"
+#include "emu_core/simulation/simulation.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace emu::test {
+
+// RAM is mapped below and above the shared area, which is left unmapped unless shared
+// memory is given, so a store to it fails
+constexpr emu6502::MemPtr kSharedBase = 0x8000;
+constexpr emu6502::MemPtr kSharedSize = 0x1000;
+constexpr emu6502::MemPtr kHighBase = kSharedBase + kSharedSize;
+constexpr size_t kHighSize = 0x10000 - kHighBase;
+
+// Counts down 64K times, which takes more than one slice, then halts with code at $10
+inline const std::string kHaltCode = R"==(
+.isr reset ENTRY
+
+.org 0xA000
+ENTRY:
+    LDX #$00
+    LDY #$00
+LOOP:
+    DEX
+    BNE LOOP
+    DEY
+    BNE LOOP
+    LDA $10
+    HLT A
+)==";
+constexpr emu6502::MemPtr kHaltCodeAddress = 0x10;
+
+inline const std::string kEndlessCode = R"==(
+.isr reset ENTRY
+
+.org 0xA000
+ENTRY:
+    INX
+    JMP ENTRY
+)==";
+
+// Store to the last byte of the shared area fails when it is not mapped
+inline const std::string kFailingCode = R"==(
+.isr reset ENTRY
+
+.org 0xA000
+ENTRY:
+    LDX #$10
+LOOP:
+    DEX
+    BNE LOOP
+    STA $8FFF
+    HLT #$00
+)==";
+
+// NOTE is replaced by a native routine
+inline const std::string kNoteCode = R"==(
+.isr reset ENTRY
+
+.org 0xA000
+ENTRY:
+    JSR NOTE
+    JMP ENTRY
+
+.org 0xA100
+NOTE:
+    RTS
+)==";
+constexpr emu6502::MemPtr kNoteAddress = 0xA100;
+
+inline std::unique_ptr<EmuSimulation>
+MakeSimulation(const std::string &code,
+               emu6502::cpu::ExecutionEngine engine =
+                   emu6502::cpu::ExecutionEngine::Default,
+               std::shared_ptr<Memory16> shared = nullptr) {
+    auto clock = std::make_unique<ClockSimple>();
+    auto memory = std::make_unique<memory::MemoryMapper16>(clock.get(), false);
+    std::vector<std::shared_ptr<Memory16>> areas{
+        std::make_shared<memory::MemoryBlock16>(clock.get(),
+                                                std::vector<uint8_t>(kSharedBase)),
+        std::make_shared<memory::MemoryBlock16>(clock.get(),
+                                                std::vector<uint8_t>(kHighSize)),
+    };
+    memory->MapArea(0, kSharedBase, areas[0].get());
+    memory->MapArea(kHighBase, static_cast<emu6502::MemPtr>(kHighSize), areas[1].get());
+    if (shared != nullptr) {
+        memory->MapArea(kSharedBase, kSharedSize, shared.get());
+        areas.emplace_back(std::move(shared));
+    }
+
+    auto program =
+        emu6502::assembler::CompileString(code, emu6502::InstructionSet::NMOS6502Emu);
+    for (auto [address, value] : program->sparse_binary_code.sparse_map) {
+        memory->Store(address, value);
+    }
+
+    auto cpu = std::make_unique<emu6502::cpu::Cpu>(clock.get(), memory.get(), nullptr,
+                                                   emu6502::InstructionSet::NMOS6502Emu,
+                                                   nullptr, engine);
+    return std::make_unique<EmuSimulation>(std::move(clock), std::move(memory),
+                                           std::move(cpu), nullptr,
+                                           std::vector<std::shared_ptr<Device>>{},
+                                           std::move(areas));
+}
+
+inline std::unique_ptr<EmuSimulation> MakeHaltingSimulation(uint8_t halt_code) {
+    auto simulation = MakeSimulation(kHaltCode);
+    simulation->memory->Store(kHaltCodeAddress, halt_code);
+    return simulation;
+}
+
+// Memory config text and files with assembled code, images are cut out of the address
+// space of the code
+class TestPackage : public package::IPackage {
+public:
+    explicit TestPackage(std::string config) : config(std::move(config)) {}
+
+    void AddImage(const std::string &file_name, const std::string &code) {
+        auto program =
+            emu6502::assembler::CompileString(code, emu6502::InstructionSet::NMOS6502Emu);
+        auto &bytes = files[file_name];
+        bytes.assign(0x10000, 0);
+        for (auto [address, value] : program->sparse_binary_code.sparse_map) {
+            bytes[address] = value;
+        }
+    }
+
+    MemoryConfig LoadMemoryConfig() const override {
+        return LoadMemoryConfigurationFromString(config);
+    }
+
+    package::ByteVector LoadFile(const std::string &file_name,
+                                 std::optional<size_t> offset,
+                                 std::optional<size_t> length) const override {
+        const auto &bytes = files.at(file_name);
+        const auto begin = std::min(offset.value_or(0), bytes.size());
+        const auto end = std::min(begin + length.value_or(bytes.size()), bytes.size());
+        return {bytes.begin() + begin, bytes.begin() + end};
+    }
+
+private:
+    const std::string config;
+    std::map<std::string, package::ByteVector> files;
+};
+
+struct NoDeviceFactory : public DeviceFactory {
+    std::shared_ptr<Device> CreateDevice(const std::string &name,
+                                         const MemoryConfigEntry::MappedDevice &,
+                                         Clock *, std::ostream *) const override {
+        throw std::runtime_error("Unexpected device " + name);
+    }
+};
+
+} // namespace emu::test
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "emu_core/memory.hpp"
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace emu::module::mailbox {
+
+struct MailboxLayout {
+    uint64_t semaphores = 8;
+    uint64_t channels = 4;
+    uint64_t channel_size = 16;
+};
+
+// Synchronization of cpus in multi cpu system, mapped in the shared memory list. Can be
+// accessed from threads of all cpus at once.
+//
+// Registers start with semaphores. Reading a semaphore returns its value and sets it to
+// 1, so reading 0 means it was taken. Writing sets the value, 0 releases it.
+// Then each channel has two registers. Writing DATA queues a byte, it is dropped when the
+// channel is full. Reading DATA takes the oldest byte, 0 when the channel is empty.
+// COUNT reads number of queued bytes, writing it clears the channel.
+class MailboxDevice : public Memory16 {
+public:
+    explicit MailboxDevice(const MailboxLayout &layout = {},
+                           std::ostream *verbose_output = nullptr);
+
+    [[nodiscard]] uint8_t Load(Address_t address) const override;
+    void Store(Address_t address, uint8_t value) override;
+    [[nodiscard]] std::optional<uint8_t> DebugRead(Address_t address) const override;
+
+    [[nodiscard]] static size_t MemorySize(const MailboxLayout &layout) {
+        return layout.semaphores + 2 * layout.channels;
+    }
+    [[nodiscard]] static Address_t SemaphoreRegister(const MailboxLayout &layout,
+                                                     uint64_t index);
+    [[nodiscard]] static Address_t ChannelDataRegister(const MailboxLayout &layout,
+                                                       uint64_t channel);
+    [[nodiscard]] static Address_t ChannelCountRegister(const MailboxLayout &layout,
+                                                        uint64_t channel);
+
+private:
+    const MailboxLayout layout;
+    std::ostream *const verbose_output;
+
+    mutable std::mutex mutex;
+    mutable std::vector<uint8_t> semaphores;
+    mutable std::vector<std::deque<uint8_t>> channels;
+
+    [[noreturn]] void Error(const std::string &msg) const;
+};
+
+} // namespace emu::module::mailbox
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "emu/module/mailbox/mailbox_device.hpp"
+#include "emu_core/device_factory.hpp"
+#include <cstdint>
+
+namespace emu::module::mailbox {
+
+struct MailboxDeviceInstance : public Device,
+                               std::enable_shared_from_this<MailboxDeviceInstance> {
+    ~MailboxDeviceInstance() override = default;
+
+    std::shared_ptr<Memory16> GetMemory() override { return device; }
+    size_t GetMemorySize() override { return MailboxDevice::MemorySize(layout); };
+    MailboxLayout layout;
+    std::shared_ptr<MailboxDevice> device;
+};
+
+// Config items semaphores, channels and channel_size, see MailboxLayout for defaults
+MailboxLayout LoadMailboxLayout(const MemoryConfigEntry::MappedDevice &md);
+
+struct MailboxDeviceFactory : public DeviceFactory {
+    MailboxDeviceFactory() = default;
+    ~MailboxDeviceFactory() override = default;
+
+    std::shared_ptr<Device>
+    CreateDevice(const std::string &name, const MemoryConfigEntry::MappedDevice &md,
+                 Clock *clock, std::ostream *verbose_output = nullptr) const override;
+};
+
+} // namespace emu::module::mailbox
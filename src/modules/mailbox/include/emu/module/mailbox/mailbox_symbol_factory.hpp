@@ -0,0 +1,19 @@
+#pragma once
+
+#include "emu_core/symbol_factory.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace emu::module::mailbox {
+
+struct MailboxDeviceSymbolFactory : public SymbolFactory {
+    MailboxDeviceSymbolFactory() = default;
+    ~MailboxDeviceSymbolFactory() override = default;
+
+    static constexpr auto kClassName = "MAILBOX";
+
+    SymbolDefVector GetSymbols(const MemoryConfigEntry &entry,
+                               const MemoryConfigEntry::MappedDevice &md) const override;
+};
+
+} // namespace emu::module::mailbox
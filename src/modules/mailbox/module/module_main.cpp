@@ -0,0 +1,8 @@
+#include "emu/module/mailbox/mailbox_device_factory.hpp"
+#include "emu/module/mailbox/mailbox_symbol_factory.hpp"
+#include "emu_core/plugins/plugin.hpp"
+
+using namespace emu::module::mailbox;
+
+EMU_DEFINE_FACTORIES(MailboxDeviceFactory, MailboxDeviceSymbolFactory, mailbox)
+EMU_DEFINE_FACTORIES(MailboxDeviceFactory, MailboxDeviceSymbolFactory, default)
@@ -0,0 +1,113 @@
+#include "emu/module/mailbox/mailbox_device.hpp"
+#include <fmt/format.h>
+#include <limits>
+#include <stdexcept>
+
+namespace emu::module::mailbox {
+
+MailboxDevice::MailboxDevice(const MailboxLayout &layout, std::ostream *verbose_output)
+    : layout(layout), verbose_output(verbose_output), semaphores(layout.semaphores, 0),
+      channels(layout.channels) {
+    if (MemorySize(layout) > std::numeric_limits<Address_t>::max()) {
+        Error(fmt::format("MailboxDevice: {} semaphores and {} channels do not fit "
+                          "address space",
+                          layout.semaphores, layout.channels));
+    }
+    if (layout.channel_size > std::numeric_limits<uint8_t>::max()) {
+        Error(fmt::format("MailboxDevice: Channel size {} does not fit COUNT register",
+                          layout.channel_size));
+    }
+}
+
+Memory16::Address_t MailboxDevice::SemaphoreRegister(const MailboxLayout &layout,
+                                                     uint64_t index) {
+    return static_cast<Address_t>(index);
+}
+
+Memory16::Address_t MailboxDevice::ChannelDataRegister(const MailboxLayout &layout,
+                                                       uint64_t channel) {
+    return static_cast<Address_t>(layout.semaphores + 2 * channel);
+}
+
+Memory16::Address_t MailboxDevice::ChannelCountRegister(const MailboxLayout &layout,
+                                                        uint64_t channel) {
+    return static_cast<Address_t>(layout.semaphores + 2 * channel + 1);
+}
+
+std::optional<uint8_t> MailboxDevice::DebugRead(Address_t address) const {
+    std::lock_guard lock(mutex);
+    if (address < layout.semaphores) {
+        return semaphores[address];
+    }
+    auto channel_address = address - layout.semaphores;
+    if (channel_address / 2 >= layout.channels) {
+        return std::nullopt;
+    }
+    const auto &channel = channels[channel_address / 2];
+    if (channel_address % 2 == 0) {
+        if (channel.empty()) {
+            return std::nullopt;
+        }
+        return channel.front();
+    }
+    return static_cast<uint8_t>(channel.size());
+}
+
+uint8_t MailboxDevice::Load(Address_t address) const {
+    std::lock_guard lock(mutex);
+    if (address < layout.semaphores) {
+        auto value = semaphores[address];
+        semaphores[address] = 1;
+        return value;
+    }
+    auto channel_address = address - layout.semaphores;
+    if (channel_address / 2 >= layout.channels) {
+        Error(fmt::format("MailboxDevice: Attempt to read address {:04x}", address));
+    }
+    auto &channel = channels[channel_address / 2];
+    if (channel_address % 2 == 0) {
+        if (channel.empty()) {
+            return 0;
+        }
+        auto value = channel.front();
+        channel.pop_front();
+        return value;
+    }
+    return static_cast<uint8_t>(channel.size());
+}
+
+void MailboxDevice::Store(Address_t address, uint8_t value) {
+    std::lock_guard lock(mutex);
+    if (address < layout.semaphores) {
+        semaphores[address] = value;
+        return;
+    }
+    auto channel_address = address - layout.semaphores;
+    if (channel_address / 2 >= layout.channels) {
+        Error(fmt::format("MailboxDevice: Attempt to write address {:04x} with {:02x}",
+                          address, value));
+    }
+    auto &channel = channels[channel_address / 2];
+    if (channel_address % 2 != 0) {
+        channel.clear();
+        return;
+    }
+    if (channel.size() >= layout.channel_size) {
+        if (verbose_output != nullptr) {
+            (*verbose_output) << fmt::format(
+                "MailboxDevice: Channel {} is full, byte {:02x} dropped\n",
+                channel_address / 2, value);
+        }
+        return;
+    }
+    channel.push_back(value);
+}
+
+void MailboxDevice::Error(const std::string &msg) const {
+    if (verbose_output != nullptr) {
+        (*verbose_output) << msg << "\n";
+    }
+    throw std::runtime_error(msg);
+}
+
+} // namespace emu::module::mailbox
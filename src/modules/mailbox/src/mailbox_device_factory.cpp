@@ -0,0 +1,41 @@
+#include "emu/module/mailbox/mailbox_device_factory.hpp"
+#include <cstdint>
+#include <fmt/format.h>
+#include <stdexcept>
+
+namespace emu::module::mailbox {
+
+namespace {
+
+uint64_t GetCount(const MemoryConfigEntry::MappedDevice &md, const std::string &key,
+                  uint64_t default_value) {
+    auto value = md.GetConfigItem<int64_t>(key, static_cast<int64_t>(default_value));
+    if (value < 0) {
+        throw std::runtime_error(
+            fmt::format("Mailbox config item '{}' can not be negative", key));
+    }
+    return static_cast<uint64_t>(value);
+}
+
+} // namespace
+
+MailboxLayout LoadMailboxLayout(const MemoryConfigEntry::MappedDevice &md) {
+    const MailboxLayout defaults;
+    return MailboxLayout{
+        .semaphores = GetCount(md, "semaphores", defaults.semaphores),
+        .channels = GetCount(md, "channels", defaults.channels),
+        .channel_size = GetCount(md, "channel_size", defaults.channel_size),
+    };
+}
+
+std::shared_ptr<Device>
+MailboxDeviceFactory::CreateDevice(const std::string &name,
+                                   const MemoryConfigEntry::MappedDevice &md,
+                                   Clock *clock, std::ostream *verbose_output) const {
+    auto instance = std::make_shared<MailboxDeviceInstance>();
+    instance->layout = LoadMailboxLayout(md);
+    instance->device = std::make_shared<MailboxDevice>(instance->layout, verbose_output);
+    return instance;
+}
+
+} // namespace emu::module::mailbox
@@ -0,0 +1,29 @@
+#include "emu/module/mailbox/mailbox_symbol_factory.hpp"
+#include "emu/module/mailbox/mailbox_device.hpp"
+#include "emu/module/mailbox/mailbox_device_factory.hpp"
+#include <fmt/format.h>
+
+namespace emu::module::mailbox {
+
+SymbolDefVector
+MailboxDeviceSymbolFactory::GetSymbols(const MemoryConfigEntry &entry,
+                                       const MemoryConfigEntry::MappedDevice &md) const {
+    auto base = entry.offset;
+    auto layout = LoadMailboxLayout(md);
+    SymbolDefVectorBuilder r{kClassName, entry.name};
+    r.EmitSymbol("BASE_ADDRESS", base);
+    for (uint64_t i = 0; i < layout.semaphores; ++i) {
+        r.EmitSymbol(fmt::format("SEMAPHORE_{}", i), base,
+                     MailboxDevice::SemaphoreRegister(layout, i));
+    }
+    for (uint64_t i = 0; i < layout.channels; ++i) {
+        r.EmitSymbol(fmt::format("CHANNEL_{}_DATA", i), base,
+                     MailboxDevice::ChannelDataRegister(layout, i));
+        r.EmitSymbol(fmt::format("CHANNEL_{}_COUNT", i), base,
+                     MailboxDevice::ChannelCountRegister(layout, i));
+    }
+    r.EmitAlias("CHANNEL_SIZE", layout.channel_size);
+    return r.entries;
+}
+
+} // namespace emu::module::mailbox
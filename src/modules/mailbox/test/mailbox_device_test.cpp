@@ -0,0 +1,105 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "emu/module/mailbox/mailbox_device.hpp"
+#include "emu/module/mailbox/mailbox_device_factory.hpp"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace emu::module::mailbox::test {
+namespace {
+
+using namespace ::testing;
+
+class MailboxDeviceTest : public testing::Test {
+public:
+    const MailboxLayout layout{.semaphores = 2, .channels = 2, .channel_size = 3};
+    MailboxDevice device{layout};
+
+    Memory16::Address_t Data(uint64_t channel) const {
+        return MailboxDevice::ChannelDataRegister(layout, channel);
+    }
+    Memory16::Address_t Count(uint64_t channel) const {
+        return MailboxDevice::ChannelCountRegister(layout, channel);
+    }
+};
+
+TEST_F(MailboxDeviceTest, Layout) {
+    EXPECT_EQ(MailboxDevice::MemorySize(layout), 6);
+    EXPECT_EQ(MailboxDevice::SemaphoreRegister(layout, 1), 1);
+    EXPECT_EQ(Data(0), 2);
+    EXPECT_EQ(Count(0), 3);
+    EXPECT_EQ(Data(1), 4);
+    EXPECT_EQ(Count(1), 5);
+    EXPECT_THROW((void)device.Load(6), std::runtime_error);
+    EXPECT_THROW(device.Store(6, 0), std::runtime_error);
+}
+
+TEST_F(MailboxDeviceTest, Semaphore) {
+    EXPECT_EQ(device.Load(0), 0);
+    EXPECT_EQ(device.Load(0), 1);
+    EXPECT_EQ(device.Load(1), 0);
+    device.Store(0, 0);
+    EXPECT_EQ(device.DebugRead(0), 0);
+    EXPECT_EQ(device.Load(0), 0);
+    EXPECT_EQ(device.DebugRead(0), 1);
+}
+
+TEST_F(MailboxDeviceTest, Channel) {
+    EXPECT_EQ(device.Load(Count(0)), 0);
+    EXPECT_EQ(device.Load(Data(0)), 0);
+    for (uint8_t i = 1; i <= 4; ++i) {
+        device.Store(Data(0), i);
+    }
+    EXPECT_EQ(device.Load(Count(0)), 3);
+    EXPECT_EQ(device.Load(Count(1)), 0);
+    EXPECT_EQ(device.DebugRead(Data(0)), 1);
+    EXPECT_EQ(device.Load(Data(0)), 1);
+    EXPECT_EQ(device.Load(Data(0)), 2);
+    EXPECT_EQ(device.Load(Count(0)), 1);
+    device.Store(Count(0), 0);
+    EXPECT_EQ(device.Load(Count(0)), 0);
+    EXPECT_EQ(device.DebugRead(Data(0)), std::nullopt);
+}
+
+TEST_F(MailboxDeviceTest, SemaphoreFromThreads) {
+    constexpr int kThreads = 4;
+    constexpr int kIterations = 10000;
+    int counter = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < kIterations; ++i) {
+                while (device.Load(0) != 0) {
+                }
+                ++counter;
+                device.Store(0, 0);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter, kThreads * kIterations);
+}
+
+TEST(MailboxDeviceFactoryTest, LayoutFromConfig) {
+    MemoryConfigEntry::MappedDevice md{
+        .module_name = "mailbox",
+        .class_name = "default",
+        .config = {{"semaphores", int64_t{3}}, {"channel_size", int64_t{8}}},
+    };
+    auto device = MailboxDeviceFactory{}.CreateDevice("mb", md, nullptr);
+    EXPECT_EQ(device->GetMemorySize(), 3 + 2 * MailboxLayout{}.channels);
+
+    md.config["channels"] = int64_t{-1};
+    EXPECT_THROW((void)LoadMailboxLayout(md), std::runtime_error);
+    md.config["channels"] = int64_t{1};
+    md.config["channel_size"] = int64_t{256};
+    EXPECT_THROW((void)MailboxDeviceFactory{}.CreateDevice("mb", md, nullptr),
+                 std::runtime_error);
+}
+
+} // namespace
+} // namespace emu::module::mailbox::test